@@ -0,0 +1,313 @@
+// AhoCorasick.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLAHOCORASICK_HPP
+#define UTLAHOCORASICK_HPP
+
+#include "util/Config.hpp"
+#include "util/Algorithm.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the Aho-Corasick automaton for finding many patterns in a byte range in
+   * a single pass. The automaton is stored as a complete transition table, so that scanning costs
+   * exactly one table lookup per input byte. To keep the table small the input alphabet is
+   * compressed into classes: all bytes that do not occur in any pattern share a single column.
+   * Entries directly contain the row offset of the target state, with the most significant bit
+   * flagging states that have output, so that the common path neither multiplies nor loads
+   * anything besides the transition itself.
+   * @note empty patterns never match; if a pattern is given more than once, only the first
+   *       occurrence gets reported
+   * @note row offsets have to fit into 31 bits, pattern sets whose table could exceed that
+   *       (about 8 MiB of patterns using all byte values) are rejected, see good
+   */
+  class AhoCorasick
+  {
+  public:
+    AhoCorasick(byte_t const* const* patterns, size_t const* lengths, size_t count);
+    AhoCorasick(AhoCorasick const&) = delete;
+
+    ~AhoCorasick();
+
+    AhoCorasick& operator =(AhoCorasick const&) = delete;
+
+    template<typename FunctorT>
+    void search(byte_t const* begin, byte_t const* end, FunctorT const& functor) const;
+
+    byte_t const* find(byte_t const* begin, byte_t const* end, size_t& pattern) const;
+
+    size_t states() const;
+
+    bool good() const;
+
+  private:
+    enum : uint32_t
+    {
+      MATCH = 0x80000000,
+      EMPTY = 0xffffffff,
+    };
+
+    uint16_t classes_[256];
+    size_t class_count_;
+    size_t state_count_;
+
+    uint32_t* table_;
+    uint32_t* output_;
+    uint32_t* dictionary_;
+    size_t* lengths_;
+    bool good_;
+
+    template<typename FunctorT>
+    bool report(uint32_t state, byte_t const* position, FunctorT const& functor) const;
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param patterns array of pointers to the patterns to search for
+   * @param lengths array of the lengths of the patterns
+   * @param count number of patterns
+   */
+  inline AhoCorasick::AhoCorasick(byte_t const* const* patterns, size_t const* lengths,
+                                  size_t count)
+    : class_count_(1),
+      state_count_(1),
+      table_(nullptr),
+      output_(nullptr),
+      dictionary_(nullptr),
+      lengths_(new size_t[count]),
+      good_(true)
+  {
+    size_t total = 0;
+
+    // class zero is reserved for all bytes not part of any pattern
+    fill(classes_, classes_ + 256, 0);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      for (size_t j = 0; j < lengths[i]; ++j)
+      {
+        uint16_t& class_ = classes_[patterns[i][j]];
+
+        if (class_ == 0)
+          class_ = static_cast<uint16_t>(class_count_++);
+      }
+
+      lengths_[i] = lengths[i];
+      total += lengths[i];
+    }
+
+    size_t max_states = total + 1;
+
+    // every row offset has to stay below the MATCH flag, otherwise we do without the patterns
+    if (max_states * class_count_ > MATCH)
+    {
+      fill(classes_, classes_ + 256, 0);
+
+      good_        = false;
+      count        = 0;
+      class_count_ = 1;
+      max_states   = 1;
+    }
+
+    table_      = new uint32_t[max_states * class_count_];
+    output_     = new uint32_t[max_states]();
+    dictionary_ = new uint32_t[max_states]();
+
+    fill(table_, table_ + max_states * class_count_, static_cast<uint32_t>(EMPTY));
+
+    // first build the trie
+    for (size_t i = 0; i < count; ++i)
+    {
+      uint32_t state = 0;
+
+      for (size_t j = 0; j < lengths[i]; ++j)
+      {
+        uint32_t& next = table_[state * class_count_ + classes_[patterns[i][j]]];
+
+        if (next == EMPTY)
+          next = static_cast<uint32_t>(state_count_++);
+
+        state = next;
+      }
+
+      if (state != 0 && output_[state] == 0)
+        output_[state] = static_cast<uint32_t>(i + 1);
+    }
+
+    // now complete the transitions using the failure function, visiting the states in
+    // breadth-first order guarantees that the row of a state's failure state is already complete
+    uint32_t* failure = new uint32_t[state_count_];
+    uint32_t* queue   = new uint32_t[state_count_];
+    size_t    head    = 0;
+    size_t    tail    = 0;
+
+    for (size_t c = 0; c < class_count_; ++c)
+    {
+      uint32_t& next = table_[c];
+
+      if (next == EMPTY)
+        next = 0;
+      else
+      {
+        failure[next] = 0;
+        queue[tail++] = next;
+      }
+    }
+
+    while (head != tail)
+    {
+      uint32_t state = queue[head++];
+
+      uint32_t*       row      = table_ + state * class_count_;
+      uint32_t const* fail_row = table_ + failure[state] * class_count_;
+
+      for (size_t c = 0; c < class_count_; ++c)
+      {
+        if (row[c] == EMPTY)
+          row[c] = fail_row[c];
+        else
+        {
+          uint32_t next = row[c];
+          uint32_t fail = fail_row[c];
+
+          failure[next]     = fail;
+          dictionary_[next] = output_[fail] != 0 ? fail : dictionary_[fail];
+          queue[tail++]     = next;
+        }
+      }
+    }
+
+    delete[] queue;
+    delete[] failure;
+
+    // last, convert the state numbers into row offsets and mark states with output
+    for (size_t i = 0; i < state_count_ * class_count_; ++i)
+    {
+      uint32_t state = table_[i];
+      uint32_t flag  = output_[state] != 0 || dictionary_[state] != 0
+                       ? static_cast<uint32_t>(MATCH)
+                       : 0;
+
+      table_[i] = static_cast<uint32_t>(state * class_count_) | flag;
+    }
+  }
+
+  /**
+   * The destructor frees all memory used by the automaton.
+   */
+  inline AhoCorasick::~AhoCorasick()
+  {
+    delete[] lengths_;
+    delete[] dictionary_;
+    delete[] output_;
+    delete[] table_;
+  }
+
+  /**
+   * This method finds all occurrences of all patterns in the given range.
+   * @param begin begin of range to search in
+   * @param end end of range to search in
+   * @param functor functor invoked for every match with the index of the matching pattern and a
+   *        pointer right after the match; it returns true to continue the search, false to stop
+   */
+  template<typename FunctorT>
+  void AhoCorasick::search(byte_t const* begin, byte_t const* end, FunctorT const& functor) const
+  {
+    uint32_t state = 0;
+
+    for ( ; begin != end; ++begin)
+    {
+      uint32_t next = table_[state + classes_[*begin]];
+      state = next & ~MATCH;
+
+      if (__builtin_expect(next & MATCH, 0))
+      {
+        if (!report(state, begin + 1, functor))
+          return;
+      }
+    }
+  }
+
+  /**
+   * @param begin begin of range to search in
+   * @param end end of range to search in
+   * @param pattern (out) index of the pattern found, only valid if a match was found
+   * @return pointer to the begin of the match that ends first (in case of multiple matches ending
+   *         at the same position it is the longest one) or 'end' if no pattern occurs at all
+   */
+  inline byte_t const* AhoCorasick::find(byte_t const* begin, byte_t const* end,
+                                         size_t& pattern) const
+  {
+    byte_t const* result = end;
+
+    search(begin, end, [&](size_t index, byte_t const* position)
+    {
+      pattern = index;
+      result  = position - lengths_[index];
+      return false;
+    });
+    return result;
+  }
+
+  /**
+   * @return number of states of the automaton
+   */
+  inline size_t AhoCorasick::states() const
+  {
+    return state_count_;
+  }
+
+  /**
+   * @return true if the automaton searches for the patterns given, false if the pattern set was
+   *         rejected for being too large, in which case nothing ever matches
+   */
+  inline bool AhoCorasick::good() const
+  {
+    return good_;
+  }
+
+  /**
+   * This method reports all patterns ending in the given state.
+   * @param state row offset of the state
+   * @return false if the search is to be stopped, true otherwise
+   */
+  template<typename FunctorT>
+  bool AhoCorasick::report(uint32_t state, byte_t const* position, FunctorT const& functor) const
+  {
+    uint32_t index = static_cast<uint32_t>(state / class_count_);
+
+    if (output_[index] == 0)
+      index = dictionary_[index];
+
+    for ( ; index != 0; index = dictionary_[index])
+    {
+      if (!functor(static_cast<size_t>(output_[index] - 1), position))
+        return false;
+    }
+    return true;
+  }
+}
+
+
+#endif
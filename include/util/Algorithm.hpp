@@ -202,88 +202,19 @@ namespace utl
   }
 
   /**
-   * This is the specialized version of copy for pointers to unsigned char. IteratorT is optimized for
+   * This is the specialized version of copy for pointers to unsigned char. It is optimized for
    * better performance and can be always used for POD like types.
+   * @note just as the generic version this function handles overlapping ranges
    */
   template<>
   inline byte_t* copy(byte_t const* begin, byte_t const* end, byte_t* destination)
   {
-    // number of bytes to copy in "one rush"
-    int const BLOCK_SIZE = 16 * sizeof(ulong_t);
-
-    // only use the optimized version for large memory blocks greater or equal 2 * "BLOCK_SIZE"
-    // because if less than 2 * "BLOCK_SIZE" we could get "tmp_end" less than "tmp_begin" below
-    // which would be bad (but it does not make sense to use the optimized version in that case
-    // anyway)
-    // also destination must not be in [begin - BLOCKSIZE, begin + BLOCKIZE], because we would run
-    // into problems with overlapping ranges
-    // @todo use difference() function here
-    if (end - begin >= 2 * BLOCK_SIZE &&
-      !(begin - BLOCK_SIZE <= destination && destination <= begin + BLOCK_SIZE))
-    {
-      // @todo Null should be declared somewhere globally
-      byte_t const* Null = 0;
-
-      int const mod1 = (begin - Null) % BLOCK_SIZE;
-      int const mod2 = (end   - Null) % BLOCK_SIZE;
-
-      // first copy until we are "BLOCK_SIZE" aligned
-      // e.g., if "begin" is 1025 then we are not 4 byte aligned (1024 would be)
-      //       we add (4 - (1025 % 4)) = 4 - 1 = 3 bytes to "begin" and are 4 byte aligned
-      //       so 1025 + 3 = 1028
-      if (mod1 != 0)
-      {
-        byte_t const* tmp_end = begin + (BLOCK_SIZE - mod1);
-
-        while (begin != tmp_end)
-          *destination++ = *begin++;
-      }
-
-      // next copy the main part while staying "BLOCK_SIZE" aligned
-      // note that tmp_end2 needs to point right after the last valid entry
-      // e.g. if "end" is 1027 then we are not 4 byte aligned
-      //      we subtract 1027 % 4 = 3 bytes from "end" to get a 4 byte aligned address
-      ulong_t const* tmp_begin = reinterpret_cast<ulong_t const*>(begin);
-      ulong_t const* tmp_end   = reinterpret_cast<ulong_t const*>(end - mod2);
-      ulong_t*       tmp_dest  = reinterpret_cast<ulong_t*>      (destination);
-
-      while (tmp_begin != tmp_end)
-      {
-        // "BLOCK_SIZE" is 16 * sizeof(ulong_t) so we need to copy 16 ulong_ts in "one rush"
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-        *tmp_dest++ = *tmp_begin++;
-      }
-
-      // next copy the last part that is not "BLOCK_SIZE" aligned
-      if (mod2 != 0)
-      {
-        begin       = reinterpret_cast<byte_t const*>(tmp_begin);
-        destination = reinterpret_cast<byte_t*>      (tmp_dest);
-
-        while (begin != end)
-          *destination++ = *begin++;
-      }
-      return destination;
-    }
-    else
-      return simpleCopy(begin, end, destination);
+    size_t size = end - begin;
+
+    // the compiler expands this to inline moves for small constant sizes and to a call of the
+    // tuned library implementation otherwise; either way no unaligned word accesses are required
+    __builtin_memmove(destination, begin, size);
+    return destination + size;
   }
 
   /**
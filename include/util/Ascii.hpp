@@ -0,0 +1,180 @@
+// Ascii.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLASCII_HPP
+#define UTLASCII_HPP
+
+#include "util/Config.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  bool isAscii(byte_t const* begin, byte_t const* end);
+  bool isAscii(char const* begin, char const* end);
+
+  byte_t* toLower(byte_t const* begin, byte_t const* end, byte_t* destination);
+  char* toLower(char const* begin, char const* end, char* destination);
+
+  byte_t* toUpper(byte_t const* begin, byte_t const* end, byte_t* destination);
+  char* toUpper(char const* begin, char const* end, char* destination);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * @return true if all bytes in [begin, end) are ASCII characters
+     */
+    inline bool isAsciiScalar(byte_t const* begin, byte_t const* end)
+    {
+      byte_t bits = 0;
+
+      for ( ; begin != end; ++begin)
+        bits |= *begin;
+
+      return (bits & 0x80) == 0;
+    }
+
+    /**
+     * This function converts the characters in [begin, end) to lower or upper case and stores
+     * the result in 'destination'.
+     * @param first first character to convert ('A' or 'a')
+     * @param last last character to convert ('Z' or 'z')
+     */
+    inline byte_t* convertCase(byte_t const* begin, byte_t const* end, byte_t* destination,
+                               byte_t first, byte_t last)
+    {
+#ifdef UTL_SIMD_SSE2
+      // signed comparisons are fine here as non-ASCII bytes are negative and never in range
+      __m128i const lower = _mm_set1_epi8(static_cast<char>(first - 1));
+      __m128i const upper = _mm_set1_epi8(static_cast<char>(last + 1));
+      __m128i const flip  = _mm_set1_epi8(0x20);
+
+      for ( ; end - begin >= 16; begin += 16, destination += 16)
+      {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+
+        __m128i above  = _mm_cmpgt_epi8(input, lower);
+        __m128i below  = _mm_cmplt_epi8(input, upper);
+        __m128i output = _mm_xor_si128(input, _mm_and_si128(_mm_and_si128(above, below), flip));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), output);
+      }
+#endif
+      for ( ; begin != end; ++begin, ++destination)
+      {
+        byte_t value = *begin;
+        *destination = first <= value && value <= last ? value ^ 0x20 : value;
+      }
+      return destination;
+    }
+  }
+
+
+  /**
+   * @param begin begin of range to check
+   * @param end end of range to check
+   * @return true if all bytes in the given range are ASCII characters (i.e., less than 0x80)
+   */
+  inline bool isAscii(byte_t const* begin, byte_t const* end)
+  {
+#ifdef UTL_SIMD_SSE2
+    __m128i bits = _mm_setzero_si128();
+
+    for ( ; end - begin >= 64; begin += 64)
+    {
+      __m128i const* block = reinterpret_cast<__m128i const*>(begin);
+
+      __m128i bits1 = _mm_or_si128(_mm_loadu_si128(block + 0), _mm_loadu_si128(block + 1));
+      __m128i bits2 = _mm_or_si128(_mm_loadu_si128(block + 2), _mm_loadu_si128(block + 3));
+
+      bits = _mm_or_si128(bits, _mm_or_si128(bits1, bits2));
+    }
+
+    for ( ; end - begin >= 16; begin += 16)
+      bits = _mm_or_si128(bits, _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin)));
+
+    if (_mm_movemask_epi8(bits) != 0)
+      return false;
+#endif
+    return impl::isAsciiScalar(begin, end);
+  }
+
+  /**
+   * @copydoc isAscii(byte_t const*, byte_t const*)
+   */
+  inline bool isAscii(char const* begin, char const* end)
+  {
+    return isAscii(reinterpret_cast<byte_t const*>(begin), reinterpret_cast<byte_t const*>(end));
+  }
+
+  /**
+   * This function converts all upper case ASCII characters in [begin, end) to lower case, all
+   * other bytes are copied unchanged.
+   * @param begin begin of range to convert
+   * @param end end of range to convert
+   * @param destination begin of output range, may equal 'begin' for an in place conversion
+   * @return pointer right after the last byte written to the output range
+   */
+  inline byte_t* toLower(byte_t const* begin, byte_t const* end, byte_t* destination)
+  {
+    return impl::convertCase(begin, end, destination, 'A', 'Z');
+  }
+
+  /**
+   * @copydoc toLower(byte_t const*, byte_t const*, byte_t*)
+   */
+  inline char* toLower(char const* begin, char const* end, char* destination)
+  {
+    byte_t* result = toLower(reinterpret_cast<byte_t const*>(begin),
+                             reinterpret_cast<byte_t const*>(end),
+                             reinterpret_cast<byte_t*>(destination));
+    return reinterpret_cast<char*>(result);
+  }
+
+  /**
+   * This function converts all lower case ASCII characters in [begin, end) to upper case, all
+   * other bytes are copied unchanged.
+   * @param begin begin of range to convert
+   * @param end end of range to convert
+   * @param destination begin of output range, may equal 'begin' for an in place conversion
+   * @return pointer right after the last byte written to the output range
+   */
+  inline byte_t* toUpper(byte_t const* begin, byte_t const* end, byte_t* destination)
+  {
+    return impl::convertCase(begin, end, destination, 'a', 'z');
+  }
+
+  /**
+   * @copydoc toUpper(byte_t const*, byte_t const*, byte_t*)
+   */
+  inline char* toUpper(char const* begin, char const* end, char* destination)
+  {
+    byte_t* result = toUpper(reinterpret_cast<byte_t const*>(begin),
+                             reinterpret_cast<byte_t const*>(end),
+                             reinterpret_cast<byte_t*>(destination));
+    return reinterpret_cast<char*>(result);
+  }
+}
+
+
+#endif
@@ -30,6 +30,12 @@ namespace utl
 
   template<typename T, size_t Bits>
   constexpr T rotateRight(T value, size_t shift);
+
+  template<typename T>
+  constexpr size_t countLeadingZeros(T value);
+
+  template<typename T>
+  constexpr size_t countTrailingZeros(T value);
 }
 
 
@@ -50,7 +56,7 @@ namespace utl
      *       safely assume that we can always perform 'Bit' shifts, so the algorithm is slightly
      *       more complicated and we only shift by 'Bit'-1 initially
      */
-    static T const value = (((static_cast<T>(1 << (Bits - 1)) - 1) << 1) | 1);
+    static T const value = (((static_cast<T>(static_cast<T>(1) << (Bits - 1)) - 1) << 1) | 1);
   };
 
 
@@ -66,7 +72,8 @@ namespace utl
     //assert(Bits  <= typ::typeBits(value));
     //assert(shift <= typ::typeBits(value));
     //assert((value & Mask<T, Bits>::value) == value);
-    return ((value << shift) | (value >> (Bits - shift))) & Mask<T, Bits>::value;
+    // a rotation by 'Bits' is none at all, and shifting by the width of T is undefined
+    return ((value << (shift % Bits)) | (value >> ((Bits - shift) % Bits))) & Mask<T, Bits>::value;
   }
 
   /**
@@ -81,7 +88,28 @@ namespace utl
     //assert(Bits  <= typ::typeBits(value));
     //assert(shift <= typ::typeBits(value));
     //assert((value & Mask<T, Bits>::value) == value);
-    return ((value >> shift) | (value << (Bits - shift))) & Mask<T, Bits>::value;
+    // a rotation by 'Bits' is none at all, and shifting by the width of T is undefined
+    return ((value >> (shift % Bits)) | (value << ((Bits - shift) % Bits))) & Mask<T, Bits>::value;
+  }
+
+  /**
+   * @param value some unsigned integral value, must not be zero
+   * @return number of zero bits above the most significant set bit of 'value'
+   */
+  template<typename T>
+  constexpr size_t countLeadingZeros(T value)
+  {
+    return __builtin_clzll(value) - (sizeof(unsigned long long) - sizeof(T)) * 8;
+  }
+
+  /**
+   * @param value some unsigned integral value, must not be zero
+   * @return number of zero bits below the least significant set bit of 'value'
+   */
+  template<typename T>
+  constexpr size_t countTrailingZeros(T value)
+  {
+    return __builtin_ctzll(value);
   }
 }
 
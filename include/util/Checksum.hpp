@@ -0,0 +1,458 @@
+// Checksum.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCHECKSUM_HPP
+#define UTLCHECKSUM_HPP
+
+#include "util/Bits.hpp"
+#include "util/Config.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  uint32_t crc32c(byte_t const* data, size_t size, uint32_t crc = 0);
+  uint64_t hash64(byte_t const* data, size_t size, uint64_t seed = 0);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * The CRC-32C (Castagnoli) polynomial in reflected bit order.
+     */
+    uint32_t const CRC32C_POLYNOMIAL = 0x82f63b78;
+
+    /**
+     * Sizes of the interleaved streams the hardware CRC is split into. Long inputs are
+     * processed three streams at a time, so that the latency of the crc32 instruction is
+     * hidden; the results are merged by shifting them over the following streams.
+     */
+    size_t const CRC32C_LONG  = 8192;
+    size_t const CRC32C_SHORT = 256;
+
+    /**
+     * @param first some polynomial modulo the CRC-32C polynomial, in reflected bit order
+     * @param second some other polynomial
+     * @return product of both modulo the CRC-32C polynomial
+     */
+    inline uint32_t crc32cMultiply(uint32_t first, uint32_t second)
+    {
+      uint32_t product = 0;
+
+      for (uint32_t mask = static_cast<uint32_t>(1) << 31; mask != 0; mask >>= 1)
+      {
+        if (first & mask)
+          product ^= second;
+
+        second = second & 1 ? (second >> 1) ^ CRC32C_POLYNOMIAL : second >> 1;
+      }
+      return product;
+    }
+
+    /**
+     * @param exponent some exponent
+     * @return x^exponent modulo the CRC-32C polynomial, in reflected bit order
+     */
+    inline uint32_t crc32cPower(size_t exponent)
+    {
+      uint32_t power = static_cast<uint32_t>(1) << 31;
+
+      for (size_t i = 0; i < exponent; ++i)
+        power = power & 1 ? (power >> 1) ^ CRC32C_POLYNOMIAL : power >> 1;
+
+      return power;
+    }
+
+    /**
+     * The tables required for calculating a CRC-32C, they are set up on first use.
+     */
+    struct Crc32cTables
+    {
+      // the tables for slicing-by-8
+      uint32_t slices[8][256];
+
+      // the tables for shifting a CRC over a long and a short stream, byte by byte
+      uint32_t long_shift[4][256];
+      uint32_t short_shift[4][256];
+
+      // the factors for doing the same with a carry-less multiplication
+      uint64_t long_factor;
+      uint64_t short_factor;
+
+      Crc32cTables();
+    };
+
+    /**
+     * The constructor calculates all tables.
+     */
+    inline Crc32cTables::Crc32cTables()
+    {
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+        uint32_t crc = i;
+
+        for (size_t j = 0; j < 8; ++j)
+          crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+
+        slices[0][i] = crc;
+      }
+
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+        for (size_t j = 1; j < 8; ++j)
+          slices[j][i] = (slices[j - 1][i] >> 8) ^ slices[0][slices[j - 1][i] & 0xff];
+      }
+
+      uint32_t const long_power  = crc32cPower(8 * CRC32C_LONG);
+      uint32_t const short_power = crc32cPower(8 * CRC32C_SHORT);
+
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+        for (size_t j = 0; j < 4; ++j)
+        {
+          long_shift[j][i]  = crc32cMultiply(i << (8 * j), long_power);
+          short_shift[j][i] = crc32cMultiply(i << (8 * j), short_power);
+        }
+      }
+
+      // a carry-less product reduced by the crc32 instruction is multiplied by x^33 as well
+      long_factor  = crc32cPower(8 * CRC32C_LONG - 33);
+      short_factor = crc32cPower(8 * CRC32C_SHORT - 33);
+    }
+
+    /**
+     * @return the tables for calculating a CRC-32C
+     */
+    inline Crc32cTables const& crc32cTables()
+    {
+      static Crc32cTables const tables;
+      return tables;
+    }
+
+    /**
+     * @param data pointer to at least eight bytes
+     * @return the eight bytes as a little endian number
+     */
+    inline uint64_t loadLittle64(byte_t const* data)
+    {
+      uint64_t value;
+      __builtin_memcpy(&value, data, sizeof(value));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      value = __builtin_bswap64(value);
+#endif
+      return value;
+    }
+
+    /**
+     * @param data pointer to at least four bytes
+     * @return the four bytes as a little endian number
+     */
+    inline uint32_t loadLittle32(byte_t const* data)
+    {
+      uint32_t value;
+      __builtin_memcpy(&value, data, sizeof(value));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      value = __builtin_bswap32(value);
+#endif
+      return value;
+    }
+
+    /**
+     * This function updates a CRC-32C with eight bytes at a time by means of lookup tables.
+     * @param crc CRC of the data preceding the given range, not inverted
+     * @param data pointer to some range of bytes
+     * @param size number of bytes in the range
+     * @return updated CRC, not inverted
+     */
+    inline uint32_t crc32cSoftware(uint32_t crc, byte_t const* data, size_t size)
+    {
+      Crc32cTables const& tables = crc32cTables();
+      uint32_t const (*slices)[256] = tables.slices;
+
+      while (size >= 8)
+      {
+        uint64_t word = loadLittle64(data) ^ crc;
+        uint32_t high = static_cast<uint32_t>(word >> 32);
+
+        crc = slices[7][word & 0xff] ^
+              slices[6][(word >> 8) & 0xff] ^
+              slices[5][(word >> 16) & 0xff] ^
+              slices[4][(word >> 24) & 0xff] ^
+              slices[3][high & 0xff] ^
+              slices[2][(high >> 8) & 0xff] ^
+              slices[1][(high >> 16) & 0xff] ^
+              slices[0][high >> 24];
+
+        data += 8;
+        size -= 8;
+      }
+
+      while (size > 0)
+      {
+        crc = (crc >> 8) ^ slices[0][(crc ^ *data) & 0xff];
+
+        ++data;
+        --size;
+      }
+      return crc;
+    }
+
+#if defined(UTL_SIMD_SSE42) && defined(__x86_64__)
+    /**
+     * @param crc CRC of some stream, not inverted
+     * @param table shift table for the length of the following stream
+     * @param factor factor for shifting over the same length by a carry-less multiplication
+     * @return the CRC shifted over the following stream, i.e., as if it was followed by zeros
+     */
+    inline uint32_t crc32cShift(uint32_t crc, uint32_t const (*table)[256], uint64_t factor)
+    {
+#if defined(UTL_SIMD_PCLMUL)
+      __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                             _mm_cvtsi64_si128(static_cast<long long>(factor)),
+                                             0x00);
+
+      return static_cast<uint32_t>(_mm_crc32_u64(0, _mm_cvtsi128_si64(product)));
+#else
+      return table[0][crc & 0xff] ^
+             table[1][(crc >> 8) & 0xff] ^
+             table[2][(crc >> 16) & 0xff] ^
+             table[3][crc >> 24];
+#endif
+    }
+
+    /**
+     * This function updates a CRC-32C by means of three interleaved streams of the given
+     * length at a time.
+     * @param crc CRC of the data preceding the given range, not inverted
+     * @param data pointer to some range of bytes, updated to the first byte not processed
+     * @param size number of bytes in the range, updated to the number of bytes not processed
+     * @param length length of each stream, a multiple of eight
+     * @param table shift table for streams of the given length
+     * @param factor factor for shifting over streams of the given length
+     * @return updated CRC, not inverted
+     */
+    inline uint32_t crc32cInterleaved(uint32_t crc, byte_t const*& data, size_t& size,
+                                      size_t length, uint32_t const (*table)[256],
+                                      uint64_t factor)
+    {
+      while (size >= 3 * length)
+      {
+        uint64_t crc0 = crc;
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+
+        for (byte_t const* end = data + length; data != end; data += 8)
+        {
+          crc0 = _mm_crc32_u64(crc0, loadLittle64(data));
+          crc1 = _mm_crc32_u64(crc1, loadLittle64(data + length));
+          crc2 = _mm_crc32_u64(crc2, loadLittle64(data + 2 * length));
+        }
+
+        crc = crc32cShift(static_cast<uint32_t>(crc0), table, factor) ^
+              static_cast<uint32_t>(crc1);
+        crc = crc32cShift(crc, table, factor) ^ static_cast<uint32_t>(crc2);
+
+        data += 2 * length;
+        size -= 3 * length;
+      }
+      return crc;
+    }
+
+    /**
+     * This function updates a CRC-32C by means of the crc32 instruction.
+     * @param crc CRC of the data preceding the given range, not inverted
+     * @param data pointer to some range of bytes
+     * @param size number of bytes in the range
+     * @return updated CRC, not inverted
+     */
+    inline uint32_t crc32cHardware(uint32_t crc, byte_t const* data, size_t size)
+    {
+      // align the data, so that none of the following loads crosses a cache line
+      while (size > 0 && reinterpret_cast<uintptr_t>(data) % 8 != 0)
+      {
+        crc = _mm_crc32_u8(crc, *data);
+
+        ++data;
+        --size;
+      }
+
+      if (size >= 3 * CRC32C_SHORT)
+      {
+        Crc32cTables const& tables = crc32cTables();
+
+        crc = crc32cInterleaved(crc, data, size, CRC32C_LONG, tables.long_shift,
+                                tables.long_factor);
+        crc = crc32cInterleaved(crc, data, size, CRC32C_SHORT, tables.short_shift,
+                                tables.short_factor);
+      }
+
+      uint64_t crc64 = crc;
+
+      while (size >= 8)
+      {
+        crc64 = _mm_crc32_u64(crc64, loadLittle64(data));
+
+        data += 8;
+        size -= 8;
+      }
+
+      crc = static_cast<uint32_t>(crc64);
+
+      while (size > 0)
+      {
+        crc = _mm_crc32_u8(crc, *data);
+
+        ++data;
+        --size;
+      }
+      return crc;
+    }
+#endif
+
+
+    uint64_t const HASH64_PRIME1 = 0x9e3779b185ebca87ull;
+    uint64_t const HASH64_PRIME2 = 0xc2b2ae3d27d4eb4full;
+    uint64_t const HASH64_PRIME3 = 0x165667b19e3779f9ull;
+    uint64_t const HASH64_PRIME4 = 0x85ebca77c2b2ae63ull;
+    uint64_t const HASH64_PRIME5 = 0x27d4eb2f165667c5ull;
+
+    /**
+     * @param accumulator some accumulator of the hash
+     * @param input next eight bytes of input
+     * @return the updated accumulator
+     */
+    inline uint64_t hash64Round(uint64_t accumulator, uint64_t input)
+    {
+      accumulator += input * HASH64_PRIME2;
+      accumulator  = rotateLeft<uint64_t, 64>(accumulator, 31);
+      return accumulator * HASH64_PRIME1;
+    }
+
+    /**
+     * @param hash hash the four accumulators are combined into
+     * @param accumulator one of the accumulators
+     * @return the updated hash
+     */
+    inline uint64_t hash64Merge(uint64_t hash, uint64_t accumulator)
+    {
+      hash ^= hash64Round(0, accumulator);
+      return hash * HASH64_PRIME1 + HASH64_PRIME4;
+    }
+  }
+
+
+  /**
+   * This function calculates the CRC-32C (Castagnoli) of a range of bytes, as used by iSCSI,
+   * SCTP, ext4, and others. With SSE4.2 available, it uses the crc32 instruction on three
+   * interleaved streams, whose results are merged by a carry-less multiplication if PCLMUL is
+   * available as well, or by lookup tables otherwise. Without SSE4.2 it falls back to
+   * slicing-by-8.
+   * @param data pointer to some range of bytes
+   * @param size number of bytes in the range
+   * @param crc CRC of the data preceding the given range, for calculating it piecewise
+   * @return CRC-32C of the data
+   */
+  inline uint32_t crc32c(byte_t const* data, size_t size, uint32_t crc)
+  {
+#if defined(UTL_SIMD_SSE42) && defined(__x86_64__)
+    return ~impl::crc32cHardware(~crc, data, size);
+#else
+    return ~impl::crc32cSoftware(~crc, data, size);
+#endif
+  }
+
+  /**
+   * This function calculates a 64 bit hash of a range of bytes. It is not suited for
+   * cryptographic purposes, but fast and well distributed. The algorithm is XXH64, so the
+   * values match those of other implementations of it.
+   * @param data pointer to some range of bytes
+   * @param size number of bytes in the range
+   * @param seed seed for varying the hash
+   * @return hash of the data
+   */
+  inline uint64_t hash64(byte_t const* data, size_t size, uint64_t seed)
+  {
+    byte_t const* end = data + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+      uint64_t accumulator1 = seed + impl::HASH64_PRIME1 + impl::HASH64_PRIME2;
+      uint64_t accumulator2 = seed + impl::HASH64_PRIME2;
+      uint64_t accumulator3 = seed;
+      uint64_t accumulator4 = seed - impl::HASH64_PRIME1;
+
+      for (byte_t const* last = end - 32; data <= last; data += 32)
+      {
+        accumulator1 = impl::hash64Round(accumulator1, impl::loadLittle64(data));
+        accumulator2 = impl::hash64Round(accumulator2, impl::loadLittle64(data + 8));
+        accumulator3 = impl::hash64Round(accumulator3, impl::loadLittle64(data + 16));
+        accumulator4 = impl::hash64Round(accumulator4, impl::loadLittle64(data + 24));
+      }
+
+      hash = rotateLeft<uint64_t, 64>(accumulator1, 1) +
+             rotateLeft<uint64_t, 64>(accumulator2, 7) +
+             rotateLeft<uint64_t, 64>(accumulator3, 12) +
+             rotateLeft<uint64_t, 64>(accumulator4, 18);
+
+      hash = impl::hash64Merge(hash, accumulator1);
+      hash = impl::hash64Merge(hash, accumulator2);
+      hash = impl::hash64Merge(hash, accumulator3);
+      hash = impl::hash64Merge(hash, accumulator4);
+    }
+    else
+      hash = seed + impl::HASH64_PRIME5;
+
+    hash += size;
+
+    for (; end - data >= 8; data += 8)
+    {
+      hash ^= impl::hash64Round(0, impl::loadLittle64(data));
+      hash  = rotateLeft<uint64_t, 64>(hash, 27) * impl::HASH64_PRIME1 + impl::HASH64_PRIME4;
+    }
+
+    if (end - data >= 4)
+    {
+      hash ^= impl::loadLittle32(data) * impl::HASH64_PRIME1;
+      hash  = rotateLeft<uint64_t, 64>(hash, 23) * impl::HASH64_PRIME2 + impl::HASH64_PRIME3;
+      data += 4;
+    }
+
+    for (; data != end; ++data)
+    {
+      hash ^= *data * impl::HASH64_PRIME5;
+      hash  = rotateLeft<uint64_t, 64>(hash, 11) * impl::HASH64_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= impl::HASH64_PRIME2;
+    hash ^= hash >> 29;
+    hash *= impl::HASH64_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+}
+
+
+#endif
@@ -0,0 +1,449 @@
+// Compress.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCOMPRESS_HPP
+#define UTLCOMPRESS_HPP
+
+#include "util/Assert.hpp"
+#include "util/Bits.hpp"
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class compresses blocks of data with an LZ77 scheme in the spirit of LZ4: the
+   * output is a sequence of literal runs and back references of at least four bytes into the
+   * preceding 64 KiB of the same block, encoded byte aligned so that decompression is little
+   * more than copying. Matches are searched for in hash chains, the search depth trades speed
+   * for compression ratio. Blocks are compressed independently of each other; the object
+   * only keeps the tables of the match finder, so that they are allocated once.
+   */
+  class BlockCompressor
+  {
+  public:
+    enum
+    {
+      DEPTH = 8,
+    };
+
+    explicit BlockCompressor(size_t depth = DEPTH);
+    ~BlockCompressor();
+
+    BlockCompressor(BlockCompressor const&) = delete;
+    BlockCompressor& operator =(BlockCompressor const&) = delete;
+
+    byte_t* compress(byte_t const* begin, byte_t const* end, byte_t* output);
+
+  private:
+    size_t depth_;
+
+    // the last position of each hash, and the distance to the previous one of each position
+    uint32_t* head_;
+    uint16_t* chain_;
+
+    // the position of the start of the current block, older positions are not used anymore
+    uint32_t base_;
+
+    void insert(uint32_t base, uint32_t position, byte_t const* data);
+  };
+
+
+  size_t compressBound(size_t size);
+
+  byte_t* decompressBlock(byte_t const* begin,
+                          byte_t const* end,
+                          byte_t* output,
+                          byte_t* output_end);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    enum
+    {
+      LZ_MIN_MATCH  = 4,
+      LZ_MAX_OFFSET = 65535,
+      LZ_WINDOW     = 65536,
+      LZ_HASH_BITS  = 15,
+    };
+
+    /**
+     * @param data pointer to at least four bytes
+     * @return hash of the four bytes
+     */
+    inline uint32_t lzHash(byte_t const* data)
+    {
+      uint32_t value;
+      __builtin_memcpy(&value, data, sizeof(value));
+
+      return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+    }
+
+    /**
+     * @param first pointer to some data
+     * @param second pointer to some data following it
+     * @param end end of the data
+     * @return number of bytes both have in common
+     */
+    inline size_t lzMatchLength(byte_t const* first, byte_t const* second, byte_t const* end)
+    {
+      byte_t const* start = second;
+
+      while (end - second >= 8)
+      {
+        uint64_t a;
+        uint64_t b;
+
+        __builtin_memcpy(&a, first, sizeof(a));
+        __builtin_memcpy(&b, second, sizeof(b));
+
+        if (a != b)
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+          return second - start + countTrailingZeros(a ^ b) / 8;
+#else
+          return second - start + countLeadingZeros(a ^ b) / 8;
+#endif
+        }
+
+        first  += 8;
+        second += 8;
+      }
+
+      while (second != end && *first == *second)
+      {
+        ++first;
+        ++second;
+      }
+      return second - start;
+    }
+
+    /**
+     * @param output pointer to write the length to
+     * @param length length exceeding what fits into the token, 15 or more
+     * @return pointer past the encoded length
+     */
+    inline byte_t* lzPutLength(byte_t* output, size_t length)
+    {
+      for (length -= 15; length >= 255; length -= 255)
+        *output++ = 255;
+
+      *output++ = static_cast<byte_t>(length);
+      return output;
+    }
+
+    /**
+     * @param begin pointer to the next input byte, updated past the length
+     * @param end end of the input
+     * @param length length from the token, updated with the extension
+     * @return true if the length could be read, false if the input is truncated
+     */
+    inline bool lzGetLength(byte_t const*& begin, byte_t const* end, size_t& length)
+    {
+      if (length != 15)
+        return true;
+
+      for (;;)
+      {
+        if (begin == end)
+          return false;
+
+        byte_t value = *begin++;
+        length += value;
+
+        if (value != 255)
+          return true;
+      }
+    }
+
+    /**
+     * @param output pointer to write the sequence to
+     * @param literals pointer to the literals preceding the match
+     * @param count number of literals
+     * @param offset distance of the match, zero for the last sequence that has no match
+     * @param length length of the match
+     * @return pointer past the sequence
+     */
+    inline byte_t* lzPutSequence(byte_t* output,
+                                 byte_t const* literals,
+                                 size_t count,
+                                 size_t offset,
+                                 size_t length)
+    {
+      byte_t* token = output++;
+      size_t extra = length - LZ_MIN_MATCH;
+
+      *token = static_cast<byte_t>(min(count, static_cast<size_t>(15)) << 4);
+
+      if (count >= 15)
+        output = lzPutLength(output, count);
+
+      __builtin_memcpy(output, literals, count);
+      output += count;
+
+      if (offset == 0)
+        return output;
+
+      *token |= static_cast<byte_t>(min(extra, static_cast<size_t>(15)));
+
+      *output++ = static_cast<byte_t>(offset);
+      *output++ = static_cast<byte_t>(offset >> 8);
+
+      if (extra >= 15)
+        output = lzPutLength(output, extra);
+
+      return output;
+    }
+  }
+
+
+  /**
+   * @param depth maximum number of earlier positions looked at for each match
+   */
+  inline BlockCompressor::BlockCompressor(size_t depth)
+    : depth_(max(depth, static_cast<size_t>(1))),
+      head_(new uint32_t[1 << impl::LZ_HASH_BITS]),
+      chain_(new uint16_t[impl::LZ_WINDOW]),
+      base_(1)
+  {
+    // position zero precedes every block, so it is never a candidate
+    __builtin_memset(head_, 0, sizeof(*head_) << impl::LZ_HASH_BITS);
+  }
+
+  /**
+   * The destructor frees the tables of the match finder.
+   */
+  inline BlockCompressor::~BlockCompressor()
+  {
+    delete[] chain_;
+    delete[] head_;
+  }
+
+  /**
+   * @param begin pointer to the first byte of the block
+   * @param end pointer past the last byte of the block
+   * @param output pointer to at least compressBound(end - begin) bytes to compress into
+   * @return pointer past the last byte of the compressed block
+   */
+  inline byte_t* BlockCompressor::compress(byte_t const* begin, byte_t const* end, byte_t* output)
+  {
+    size_t size = end - begin;
+
+    ASSERT(size < 0x80000000);
+
+    // positions are counted across blocks, start over before they wrap around
+    if (base_ > 0xffffffff - size)
+    {
+      __builtin_memset(head_, 0, sizeof(*head_) << impl::LZ_HASH_BITS);
+      base_ = 1;
+    }
+
+    uint32_t const base = base_;
+    base_ += static_cast<uint32_t>(size);
+
+    if (size < impl::LZ_MIN_MATCH)
+      return impl::lzPutSequence(output, begin, size, 0, 0);
+
+    byte_t const* anchor = begin;
+    byte_t const* last   = end - impl::LZ_MIN_MATCH;
+    byte_t const* next   = begin;
+
+    // as in LZ4, only the positions looked at are inserted into the hash chains, not the ones
+    // skipped or covered by a match, which is what makes the search cheap
+    while (next <= last)
+    {
+      uint32_t const position = base + static_cast<uint32_t>(next - begin);
+      uint32_t candidate = position;
+
+      insert(base, position, next);
+
+      size_t best_length = 0;
+      size_t best_offset = 0;
+
+      for (size_t i = 0; i < depth_; ++i)
+      {
+        uint16_t distance = chain_[candidate % impl::LZ_WINDOW];
+
+        if (distance == 0 || position - (candidate - distance) > impl::LZ_MAX_OFFSET)
+          break;
+
+        candidate -= distance;
+
+        byte_t const* match = begin + (candidate - base);
+
+        // a longer match has to agree at the byte just past the best one so far
+        if (match[best_length] != next[best_length] && best_length > 0)
+          continue;
+
+        size_t length = impl::lzMatchLength(match, next, end);
+
+        if (length > best_length)
+        {
+          best_length = length;
+          best_offset = position - candidate;
+
+          if (next + length == end)
+            break;
+        }
+      }
+
+      if (best_length < impl::LZ_MIN_MATCH)
+      {
+        // skip ahead faster the longer nothing matched, for incompressible data
+        next += 1 + ((next - anchor) >> 6);
+        continue;
+      }
+
+      output = impl::lzPutSequence(output, anchor, next - anchor, best_offset, best_length);
+
+      next  += best_length;
+      anchor = next;
+
+      // a position close to the end of the match lets repetitions of what follows it be found
+      if (next <= last)
+        insert(base, position + static_cast<uint32_t>(best_length) - 2, next - 2);
+    }
+
+    return impl::lzPutSequence(output, anchor, end - anchor, 0, 0);
+  }
+
+
+  /**
+   * This method makes a position the head of the hash chain of the four bytes at it.
+   * @param base position of the start of the current block
+   * @param position position of 'data' counted across blocks
+   * @param data pointer to at least four bytes of the current block
+   */
+  inline void BlockCompressor::insert(uint32_t base, uint32_t position, byte_t const* data)
+  {
+    uint32_t& head = head_[impl::lzHash(data)];
+    uint32_t distance = position - head;
+
+    chain_[position % impl::LZ_WINDOW] =
+      head >= base && distance <= impl::LZ_MAX_OFFSET ? static_cast<uint16_t>(distance) : 0;
+    head = position;
+  }
+
+  /**
+   * @param size number of bytes in a block
+   * @return maximum size of the block when compressed
+   */
+  inline size_t compressBound(size_t size)
+  {
+    return size + size / 255 + 16;
+  }
+
+  /**
+   * This function decompresses a block compressed by a BlockCompressor. All input is
+   * validated, corrupt data never causes reads or writes out of bounds. Bytes between the
+   * returned pointer and output_end may be overwritten.
+   * @param begin pointer to the first byte of the compressed block
+   * @param end pointer past the last byte of the compressed block
+   * @param output pointer to the memory to decompress into
+   * @param output_end end of the memory to decompress into
+   * @return pointer past the last byte decompressed, nullptr if the data is corrupt or does
+   *         not fit
+   */
+  inline byte_t* decompressBlock(byte_t const* begin,
+                                 byte_t const* end,
+                                 byte_t* output,
+                                 byte_t* output_end)
+  {
+    byte_t* const output_begin = output;
+
+    while (begin != end)
+    {
+      byte_t token = *begin++;
+      size_t count = token >> 4;
+
+      if (!impl::lzGetLength(begin, end, count))
+        return nullptr;
+
+      if (count > static_cast<size_t>(end - begin) ||
+          count > static_cast<size_t>(output_end - output))
+        return nullptr;
+
+      // short literal runs are copied with a single fixed size move where both sides have room
+      if (count <= 16 && end - begin >= 16 && output_end - output >= 16)
+        __builtin_memcpy(output, begin, 16);
+      else
+        __builtin_memcpy(output, begin, count);
+
+      output += count;
+      begin  += count;
+
+      // the last sequence consists of literals only
+      if (begin == end)
+        return output;
+
+      if (end - begin < 2)
+        return nullptr;
+
+      size_t offset = begin[0] | begin[1] << 8;
+      size_t length = token & 0x0f;
+
+      begin += 2;
+
+      if (offset == 0 || offset > static_cast<size_t>(output - output_begin))
+        return nullptr;
+
+      if (!impl::lzGetLength(begin, end, length))
+        return nullptr;
+
+      length += impl::LZ_MIN_MATCH;
+
+      if (length > static_cast<size_t>(output_end - output))
+        return nullptr;
+
+      byte_t const* match = output - offset;
+      byte_t* const stop  = output + length;
+
+      if (offset >= 8 && static_cast<size_t>(output_end - stop) >= 8)
+      {
+        // with the source at least eight bytes behind, eight byte moves never read ahead of
+        // what they wrote; the final move may write up to seven bytes past the match
+        for (; output < stop; output += 8, match += 8)
+          __builtin_memcpy(output, match, 8);
+
+        output = stop;
+      }
+      else if (offset >= length)
+      {
+        __builtin_memcpy(output, match, length);
+        output += length;
+      }
+      else
+      {
+        // the match overlaps with its own output, repeating a pattern
+        for (; output != stop; ++output, ++match)
+          *output = *match;
+      }
+    }
+
+    // a block always ends with a sequence of literals, even if empty
+    return nullptr;
+  }
+}
+
+
+#endif
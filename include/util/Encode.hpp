@@ -0,0 +1,491 @@
+// Encode.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/**
+ * This file provides bulk conversions of byte ranges to and from their hexadecimal and base64
+ * (RFC 4648, with padding) textual representations. With AVX2 available, 32 bytes of input
+ * are converted at a time by means of nibble lookups via vpshufb; the remainder, and every
+ * input an AVX2 kernel rejects, is handled by a scalar implementation.
+ */
+
+#ifndef UTLENCODE_HPP
+#define UTLENCODE_HPP
+
+#include "util/Config.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  size_t hexEncodedLength(size_t size);
+  size_t hexDecodedLength(size_t length);
+
+  char* hexEncode(byte_t const* begin, byte_t const* end, char* destination);
+  byte_t* hexDecode(char const* begin, char const* end, byte_t* destination);
+
+  size_t base64EncodedLength(size_t size);
+  size_t base64DecodedLength(size_t length);
+
+  char* base64Encode(byte_t const* begin, byte_t const* end, char* destination);
+  byte_t* base64Decode(char const* begin, char const* end, byte_t* destination);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * The digits of hexadecimal output, lower case as usual for dumps and digests.
+     */
+    char const HEX_DIGITS[] = "0123456789abcdef";
+
+    /**
+     * The base64 alphabet as defined by RFC 4648.
+     */
+    char const BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    /**
+     * The value marking a character that is not a valid digit.
+     */
+    byte_t const INVALID_DIGIT = 0xff;
+
+    /**
+     * @return table mapping each character to its value as a hexadecimal digit of either case,
+     *         INVALID_DIGIT for all other characters
+     */
+    inline byte_t const* hexValues()
+    {
+      static byte_t const values[256] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+          0,   1,   2,   3,   4,   5,   6,   7,   8,   9, 255, 255, 255, 255, 255, 255,
+        255,  10,  11,  12,  13,  14,  15, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255,  10,  11,  12,  13,  14,  15, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+      };
+      return values;
+    }
+
+    /**
+     * @return table mapping each character to its value as a base64 digit, INVALID_DIGIT for
+     *         all characters outside of the alphabet (including the padding character)
+     */
+    inline byte_t const* base64Values()
+    {
+      static byte_t const values[256] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  62, 255, 255, 255,  63,
+         52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255, 255, 255, 255, 255,
+        255,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+         15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255, 255,
+        255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+         41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+      };
+      return values;
+    }
+
+    /**
+     * This function hex encodes [begin, end) one byte at a time.
+     */
+    inline char* hexEncodeScalar(byte_t const* begin, byte_t const* end, char* destination)
+    {
+      for ( ; begin != end; ++begin, destination += 2)
+      {
+        destination[0] = HEX_DIGITS[*begin >> 4];
+        destination[1] = HEX_DIGITS[*begin & 0x0f];
+      }
+      return destination;
+    }
+
+    /**
+     * This function decodes [begin, end), which has to have an even length, one byte at a time.
+     */
+    inline byte_t* hexDecodeScalar(char const* begin, char const* end, byte_t* destination)
+    {
+      byte_t const* values = hexValues();
+
+      for ( ; begin != end; begin += 2, ++destination)
+      {
+        byte_t high = values[static_cast<byte_t>(begin[0])];
+        byte_t low  = values[static_cast<byte_t>(begin[1])];
+
+        if ((high | low) == INVALID_DIGIT)
+          return nullptr;
+
+        *destination = static_cast<byte_t>(high << 4 | low);
+      }
+      return destination;
+    }
+
+    /**
+     * This function base64 encodes [begin, end) three bytes at a time and pads the result.
+     */
+    inline char* base64EncodeScalar(byte_t const* begin, byte_t const* end, char* destination)
+    {
+      for ( ; end - begin >= 3; begin += 3, destination += 4)
+      {
+        uint32_t value = begin[0] << 16 | begin[1] << 8 | begin[2];
+
+        destination[0] = BASE64_DIGITS[value >> 18];
+        destination[1] = BASE64_DIGITS[value >> 12 & 0x3f];
+        destination[2] = BASE64_DIGITS[value >> 6 & 0x3f];
+        destination[3] = BASE64_DIGITS[value & 0x3f];
+      }
+
+      if (begin != end)
+      {
+        uint32_t value = begin[0] << 16 | (end - begin > 1 ? begin[1] << 8 : 0);
+
+        destination[0] = BASE64_DIGITS[value >> 18];
+        destination[1] = BASE64_DIGITS[value >> 12 & 0x3f];
+        destination[2] = end - begin > 1 ? BASE64_DIGITS[value >> 6 & 0x3f] : '=';
+        destination[3] = '=';
+        destination += 4;
+      }
+      return destination;
+    }
+
+    /**
+     * This function decodes [begin, end), which has to have a length that is a multiple of
+     * four, four characters at a time. Padding is only accepted in the last group.
+     */
+    inline byte_t* base64DecodeScalar(char const* begin, char const* end, byte_t* destination)
+    {
+      byte_t const* values = base64Values();
+
+      for ( ; begin != end; begin += 4)
+      {
+        byte_t const* group = reinterpret_cast<byte_t const*>(begin);
+
+        byte_t first  = values[group[0]];
+        byte_t second = values[group[1]];
+        byte_t third  = values[group[2]];
+        byte_t fourth = values[group[3]];
+
+        if ((first | second | third | fourth) == INVALID_DIGIT)
+        {
+          // only the last group may be padded, to one or two bytes
+          if (end - begin != 4 || (first | second) == INVALID_DIGIT || group[3] != '=')
+            return nullptr;
+
+          *destination++ = static_cast<byte_t>(first << 2 | second >> 4);
+
+          if (group[2] == '=')
+            return destination;
+
+          if (third == INVALID_DIGIT)
+            return nullptr;
+
+          *destination++ = static_cast<byte_t>(second << 4 | third >> 2);
+          return destination;
+        }
+
+        destination[0] = static_cast<byte_t>(first << 2 | second >> 4);
+        destination[1] = static_cast<byte_t>(second << 4 | third >> 2);
+        destination[2] = static_cast<byte_t>(third << 6 | fourth);
+        destination += 3;
+      }
+      return destination;
+    }
+
+#ifdef UTL_SIMD_AVX2
+    /**
+     * @param characters 32 characters to convert
+     * @param valid mask that has all bytes cleared that are not a hexadecimal digit
+     * @return values of the given hexadecimal digits
+     */
+    inline __m256i convertHexDigits(__m256i characters, __m256i& valid)
+    {
+      // a digit or a letter of either case is one that ends up in range after subtracting the
+      // first one, the range checks use unsigned minimums
+      __m256i digit  = _mm256_sub_epi8(characters, _mm256_set1_epi8('0'));
+      __m256i letter = _mm256_sub_epi8(_mm256_or_si256(characters, _mm256_set1_epi8(0x20)),
+                                       _mm256_set1_epi8('a'));
+
+      __m256i is_digit  = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+      __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+
+      valid = _mm256_and_si256(valid, _mm256_or_si256(is_digit, is_letter));
+
+      return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                             _mm256_and_si256(is_letter,
+                                              _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+    }
+#endif
+  }
+
+
+  /**
+   * @param size number of bytes to encode
+   * @return number of characters the hexadecimal representation of 'size' bytes takes
+   */
+  inline size_t hexEncodedLength(size_t size)
+  {
+    return 2 * size;
+  }
+
+  /**
+   * @param length number of characters to decode
+   * @return number of bytes 'length' hexadecimal digits decode to
+   */
+  inline size_t hexDecodedLength(size_t length)
+  {
+    return length / 2;
+  }
+
+  /**
+   * This function converts the bytes in [begin, end) into two lower case hexadecimal digits
+   * each.
+   * @param begin begin of range to encode
+   * @param end end of range to encode
+   * @param destination output range of at least hexEncodedLength(end - begin) characters
+   * @return pointer right after the last character written
+   */
+  inline char* hexEncode(byte_t const* begin, byte_t const* end, char* destination)
+  {
+#ifdef UTL_SIMD_AVX2
+    __m256i const digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                            '0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    __m256i const mask = _mm256_set1_epi8(0x0f);
+
+    for ( ; end - begin >= 32; begin += 32, destination += 64)
+    {
+      __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin));
+      __m256i high  = _mm256_and_si256(_mm256_srli_epi16(input, 4), mask);
+      __m256i low   = _mm256_and_si256(input, mask);
+
+      // the unpacks work per lane: 'first' covers bytes 0-7 and 16-23, 'second' the others
+      __m256i first  = _mm256_shuffle_epi8(digits, _mm256_unpacklo_epi8(high, low));
+      __m256i second = _mm256_shuffle_epi8(digits, _mm256_unpackhi_epi8(high, low));
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination),
+                          _mm256_permute2x128_si256(first, second, 0x20));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 32),
+                          _mm256_permute2x128_si256(first, second, 0x31));
+    }
+#endif
+    return impl::hexEncodeScalar(begin, end, destination);
+  }
+
+  /**
+   * This function converts hexadecimal digits, of either case, back into bytes.
+   * @param begin begin of range to decode
+   * @param end end of range to decode
+   * @param destination output range of at least hexDecodedLength(end - begin) bytes
+   * @return pointer right after the last byte written, nullptr if the input has an odd length
+   *         or contains a character that is not a hexadecimal digit; the contents of the
+   *         output range are unspecified in that case
+   */
+  inline byte_t* hexDecode(char const* begin, char const* end, byte_t* destination)
+  {
+    if ((end - begin) % 2 != 0)
+      return nullptr;
+
+#ifdef UTL_SIMD_AVX2
+    for ( ; end - begin >= 64; begin += 64, destination += 32)
+    {
+      __m256i valid  = _mm256_set1_epi8(-1);
+      __m256i first  = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin));
+      __m256i second = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin + 32));
+
+      first  = impl::convertHexDigits(first, valid);
+      second = impl::convertHexDigits(second, valid);
+
+      // leave the error reporting to the scalar code
+      if (_mm256_movemask_epi8(valid) != -1)
+        break;
+
+      // combine each pair of digits into a 16 bit value of high * 16 + low
+      first  = _mm256_maddubs_epi16(first, _mm256_set1_epi16(0x0110));
+      second = _mm256_maddubs_epi16(second, _mm256_set1_epi16(0x0110));
+
+      // packing works per lane as well, the permutation restores the order
+      __m256i output = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xd8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), output);
+    }
+#endif
+    return impl::hexDecodeScalar(begin, end, destination);
+  }
+
+  /**
+   * @param size number of bytes to encode
+   * @return number of characters the padded base64 representation of 'size' bytes takes
+   */
+  inline size_t base64EncodedLength(size_t size)
+  {
+    return (size + 2) / 3 * 4;
+  }
+
+  /**
+   * @param length number of characters to decode
+   * @return maximum number of bytes 'length' base64 characters decode to, the actual number
+   *         is up to two less depending on the padding
+   */
+  inline size_t base64DecodedLength(size_t length)
+  {
+    return length / 4 * 3;
+  }
+
+  /**
+   * This function converts the bytes in [begin, end) into base64, three bytes into four
+   * characters, padding the last group with '=' if necessary.
+   * @param begin begin of range to encode
+   * @param end end of range to encode
+   * @param destination output range of at least base64EncodedLength(end - begin) characters
+   * @return pointer right after the last character written
+   */
+  inline char* base64Encode(byte_t const* begin, byte_t const* end, char* destination)
+  {
+#ifdef UTL_SIMD_AVX2
+    // per lane lookup of the offset to add to a six bit value, indexed by the classification
+    // below: 0 for 'a'-'z', 1 to 10 for '0'-'9', 11 for '+', 12 for '/', and 13 for 'A'-'Z'
+    __m256i const offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // spread each group of three bytes a, b, c over four bytes as b, a, c, b
+    __m256i const spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+    // each lane takes 12 bytes, but loads 16 of them
+    for ( ; end - begin >= 28; begin += 24, destination += 32)
+    {
+      __m128i low  = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+      __m128i high = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin + 12));
+      __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+      input = _mm256_shuffle_epi8(input, spread);
+
+      // move the four six bit values of each 32 bit word into bytes of their own; the
+      // multiplications shift the 16 bit halves by different amounts at once
+      __m256i first  = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00)),
+                                          _mm256_set1_epi32(0x04000040));
+      __m256i second = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0)),
+                                          _mm256_set1_epi32(0x01000010));
+      __m256i values = _mm256_or_si256(first, second);
+
+      __m256i classes = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+      __m256i upper   = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+
+      classes = _mm256_or_si256(classes, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+      __m256i output = _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, classes));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), output);
+    }
+#endif
+    return impl::base64EncodeScalar(begin, end, destination);
+  }
+
+  /**
+   * This function converts padded base64 back into bytes. Bits of a padded last group that
+   * are not part of the data are ignored.
+   * @param begin begin of range to decode
+   * @param end end of range to decode
+   * @param destination output range of at least base64DecodedLength(end - begin) bytes
+   * @return pointer right after the last byte written, nullptr if the input's length is not
+   *         a multiple of four or it contains a character outside of the alphabet (padding
+   *         aside); the contents of the output range are unspecified in that case
+   */
+  inline byte_t* base64Decode(char const* begin, char const* end, byte_t* destination)
+  {
+    if ((end - begin) % 4 != 0)
+      return nullptr;
+
+#ifdef UTL_SIMD_AVX2
+    // validation and translation by nibble lookups: a character is valid if the bits looked
+    // up for its low and its high nibble do not intersect; the translation adds an offset
+    // determined by the high nibble, with '/' as the only exception among its neighbors
+    __m256i const low_bits  = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                               0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                               0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                               0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    __m256i const high_bits = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                               0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                               0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                               0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m256i const offsets   = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                               0, 0, 0, 0, 0, 0, 0, 0,
+                                               0, 16, 19, 4, -65, -65, -71, -71,
+                                               0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i const slash     = _mm256_set1_epi8('/');
+    // gather the three bytes of each 32 bit word, and the 12 bytes of each lane
+    __m256i const gather    = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                               -1, -1, -1, -1,
+                                               2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                               -1, -1, -1, -1);
+    __m256i const compact   = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    for ( ; end - begin >= 32; begin += 32, destination += 24)
+    {
+      __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin));
+
+      // vpshufb only looks at the low nibble and the sign bit of an index, masking with '/'
+      // (0x2f) clears the latter
+      __m256i high = _mm256_and_si256(_mm256_srli_epi32(input, 4), slash);
+      __m256i low  = _mm256_and_si256(input, slash);
+
+      // leave the error reporting (and the padding) to the scalar code
+      if (!_mm256_testz_si256(_mm256_shuffle_epi8(low_bits, low),
+                              _mm256_shuffle_epi8(high_bits, high)))
+        break;
+
+      __m256i shift  = _mm256_add_epi8(_mm256_cmpeq_epi8(input, slash), high);
+      __m256i values = _mm256_add_epi8(input, _mm256_shuffle_epi8(offsets, shift));
+
+      // merge pairs of six bit values into 12 bits, and pairs of those into 24 bits
+      values = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+      values = _mm256_madd_epi16(values, _mm256_set1_epi32(0x00011000));
+      values = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(values, gather), compact);
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(destination),
+                       _mm256_castsi256_si128(values));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + 16),
+                       _mm256_extracti128_si256(values, 1));
+    }
+#endif
+    return impl::base64DecodeScalar(begin, end, destination);
+  }
+}
+
+
+#endif
@@ -0,0 +1,961 @@
+// FormatFloat.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLFORMATFLOAT_HPP
+#define UTLFORMATFLOAT_HPP
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Algorithm.hpp"
+#include "util/FormatInteger.hpp"
+
+
+namespace utl
+{
+  /**
+   * The notations floating point values can be formatted in.
+   */
+  enum FloatFormat
+  {
+    FLOAT_SHORTEST,
+    FLOAT_SCIENTIFIC,
+    FLOAT_FIXED
+  };
+
+  enum
+  {
+    MAX_FLOAT_PRECISION  = 64,
+    /**
+     * The maximum number of characters any of the format functions produces: a fixed point
+     * number with a sign, 309 integer digits, a decimal point, and all fractional digits.
+     */
+    MAX_FLOAT_CHARACTERS = 1 + 309 + 1 + MAX_FLOAT_PRECISION
+  };
+
+
+  char* formatShortest(double value, char* destination);
+  char* formatShortest(float value, char* destination);
+
+  char* formatScientific(double value, char* destination, size_t precision);
+  char* formatFixed(double value, char* destination, size_t precision);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    __extension__ typedef unsigned __int128 Uint128;
+
+    /**
+     * A 128 bit value stored as two halves.
+     */
+    struct Split
+    {
+      uint64_t low;
+      uint64_t high;
+    };
+
+    /**
+     * A decimal floating point value, i.e., digits * 10^exponent.
+     */
+    struct Decimal
+    {
+      uint64_t digits;
+      int32_t  exponent;
+    };
+
+    enum
+    {
+      POW5_TABLE_SIZE   = 26,
+      POW5_BITCOUNT     = 125,
+      POW5_INV_BITCOUNT = 125
+    };
+
+    /**
+     * @return pointer to the powers of five 5^0 to 5^25
+     */
+    inline uint64_t const* pow5Table()
+    {
+      static uint64_t const table[POW5_TABLE_SIZE] = {
+        1ull, 5ull, 25ull, 125ull, 625ull, 3125ull, 15625ull, 78125ull, 390625ull, 1953125ull,
+        9765625ull, 48828125ull, 244140625ull, 1220703125ull, 6103515625ull, 30517578125ull,
+        152587890625ull, 762939453125ull, 3814697265625ull, 19073486328125ull, 95367431640625ull,
+        476837158203125ull, 2384185791015625ull, 11920928955078125ull, 59604644775390625ull,
+        298023223876953125ull,
+      };
+      return table;
+    }
+
+    /**
+     * @return pointer to the powers of five 5^0, 5^26, 5^52, ..., each shifted to a length of
+     *         125 bits
+     */
+    inline Split const* pow5Split()
+    {
+      static Split const table[] = {
+        { 0x0000000000000000ull, 0x1000000000000000ull },
+        { 0x0000000000000000ull, 0x14adf4b7320334b9ull },
+        { 0x0e549208b31adb10ull, 0x1aba4714957d300dull },
+        { 0x6dc6ad264d8f0866ull, 0x1145b7e285bf98f5ull },
+        { 0xeb1dbd923d8596caull, 0x1652efdc6018a1fcull },
+        { 0xb4c1b80b22ae923cull, 0x1cda62055b2d9d83ull },
+        { 0x5bb28b4e8f7e4c30ull, 0x12a5568b9f52f416ull },
+        { 0xf08aed437682d4fbull, 0x1819651531f9e78full },
+        { 0xb4ee134ad99bf150ull, 0x1f25c186a6f04c28ull },
+        { 0x16499ecb70c25f03ull, 0x1420eb449c8842e6ull },
+        { 0x85a56ead360865b0ull, 0x1a03fde214caf085ull },
+        { 0x093db1d57999890bull, 0x10cfeb353a97dad8ull },
+        { 0xcf38bb735e3f36acull, 0x15baaf44fa52673eull },
+      };
+      return table;
+    }
+
+    /**
+     * @return pointer to the two bit corrections of the powers of five derived from pow5Split,
+     *         sixteen per word
+     */
+    inline uint32_t const* pow5Offsets()
+    {
+      static uint32_t const table[] = {
+        0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u,
+        0x40000000u, 0x59695995u, 0x55545555u, 0x56555515u,
+        0x41150504u, 0x40555410u, 0x44555145u, 0x44504540u,
+        0x45555550u, 0x40004000u, 0x96440440u, 0x55565565u,
+        0x54454045u, 0x40154151u, 0x55559155u, 0x51405555u,
+        0x00000105u,
+      };
+      return table;
+    }
+
+    /**
+     * @return pointer to the inverses 2^(k - 1 + 125) / 5^i + 1 with 'k' being the number of bits
+     *         of 5^i for i = 0, 26, 52, ...
+     */
+    inline Split const* pow5InvSplit()
+    {
+      static Split const table[] = {
+        { 0x0000000000000001ull, 0x2000000000000000ull },
+        { 0x52a6c95fc0655034ull, 0x18c240c4aecb13bbull },
+        { 0x7ca8d50071dfc806ull, 0x1327fc58da0f6ff5ull },
+        { 0x6520247d3556476eull, 0x1da48ce468e7c702ull },
+        { 0x6139cdd76802e6e9ull, 0x16ef5b40c2fc7779ull },
+        { 0xf951a7ff43de8c79ull, 0x11bebdf578b2f391ull },
+        { 0x7be8bee8d6e957e8ull, 0x1b758d848fac54b0ull },
+        { 0x8bd3f9e999a423eaull, 0x153eda614071a3b7ull },
+        { 0x0848f973cb3ee3ceull, 0x10701bd527b4978cull },
+        { 0x153285ebb9efbfa2ull, 0x196fbb9bb44db44dull },
+        { 0xadeee7f86c07b696ull, 0x13ae3591f5b4d936ull },
+        { 0x4d686a4eaf182222ull, 0x1e74404f3daada91ull },
+        { 0x98c0a106e09ebd9full, 0x17900ea4fda7c257ull },
+      };
+      return table;
+    }
+
+    /**
+     * @return pointer to the two bit corrections of the inverses derived from pow5InvSplit,
+     *         sixteen per word
+     */
+    inline uint32_t const* pow5InvOffsets()
+    {
+      static uint32_t const table[] = {
+        0x54544554u, 0x04055545u, 0x10041000u, 0x00400414u,
+        0x40010000u, 0x41155555u, 0x00000454u, 0x00010044u,
+        0x40000000u, 0x44000041u, 0x50454450u, 0x55550054u,
+        0x51655554u, 0x40004000u, 0x01000001u, 0x00010500u,
+        0x51515411u, 0x05555554u, 0x00000000u,
+      };
+      return table;
+    }
+
+    /**
+     * @return number of bits of 5^e, for 0 <= e <= 3528
+     */
+    constexpr uint32_t pow5Bits(uint32_t e)
+    {
+      return ((e * 1217359) >> 19) + 1;
+    }
+
+    /**
+     * @return floor(log10(2^e)), for 0 <= e <= 1650
+     */
+    constexpr uint32_t log10Pow2(uint32_t e)
+    {
+      return (e * 78913) >> 18;
+    }
+
+    /**
+     * @return floor(log10(5^e)), for 0 <= e <= 2620
+     */
+    constexpr uint32_t log10Pow5(uint32_t e)
+    {
+      return (e * 732923) >> 20;
+    }
+
+    /**
+     * @return 5^i shifted to a length of 125 bits, computed from a table entry and a small
+     *         power of five
+     */
+    inline Split computePow5(uint32_t i)
+    {
+      uint32_t base   = i / POW5_TABLE_SIZE;
+      uint32_t base2  = base * POW5_TABLE_SIZE;
+      uint32_t offset = i - base2;
+      Split const& mul = pow5Split()[base];
+
+      if (offset == 0)
+        return mul;
+
+      uint64_t m  = pow5Table()[offset];
+      Uint128  b0 = static_cast<Uint128>(m) * mul.low;
+      Uint128  b2 = static_cast<Uint128>(m) * mul.high;
+      uint32_t delta = pow5Bits(i) - pow5Bits(base2);
+      uint32_t correction = (pow5Offsets()[i / 16] >> ((i % 16) << 1)) & 3;
+
+      Uint128 sum = (b0 >> delta) + (b2 << (64 - delta)) + correction;
+      Split result = {static_cast<uint64_t>(sum), static_cast<uint64_t>(sum >> 64)};
+      return result;
+    }
+
+    /**
+     * @return the inverse of 5^i as stored by pow5InvSplit, computed from the table entry of the
+     *         next greater multiple of 26 and a small power of five
+     */
+    inline Split computeInvPow5(uint32_t i)
+    {
+      uint32_t base   = (i + POW5_TABLE_SIZE - 1) / POW5_TABLE_SIZE;
+      uint32_t base2  = base * POW5_TABLE_SIZE;
+      uint32_t offset = base2 - i;
+      Split const& mul = pow5InvSplit()[base];
+
+      if (offset == 0)
+        return mul;
+
+      uint64_t m  = pow5Table()[offset];
+      Uint128  b0 = static_cast<Uint128>(m) * (mul.low - 1);
+      Uint128  b2 = static_cast<Uint128>(m) * mul.high;
+      uint32_t delta = pow5Bits(base2) - pow5Bits(i);
+      uint32_t correction = (pow5InvOffsets()[i / 16] >> ((i % 16) << 1)) & 3;
+
+      Uint128 sum = (b0 >> delta) + (b2 << (64 - delta)) + 1 + correction;
+      Split result = {static_cast<uint64_t>(sum), static_cast<uint64_t>(sum >> 64)};
+      return result;
+    }
+
+    /**
+     * @return true if 'value' is divisible by 5^p
+     */
+    inline bool multipleOfPowerOf5(uint64_t value, uint32_t p)
+    {
+      uint32_t count = 0;
+
+      for ( ; value % 5 == 0 && count < p; value /= 5)
+        ++count;
+
+      return count >= p;
+    }
+
+    /**
+     * @return true if 'value' is divisible by 2^p, for p < 64
+     */
+    inline bool multipleOfPowerOf2(uint64_t value, uint32_t p)
+    {
+      return (value & ((1ull << p) - 1)) == 0;
+    }
+
+    /**
+     * @return (m * mul) >> j, for j >= 64
+     */
+    inline uint64_t mulShift(uint64_t m, Split const& mul, uint32_t j)
+    {
+      Uint128 b0 = static_cast<Uint128>(m) * mul.low;
+      Uint128 b2 = static_cast<Uint128>(m) * mul.high;
+
+      return static_cast<uint64_t>(((b0 >> 64) + b2) >> (j - 64));
+    }
+
+    /**
+     * This function computes the shortest decimal representation that rounds to the given
+     * binary floating point value, using the Ryu algorithm by Ulf Adams. The interval of
+     * decimals rounding to the value is computed with 128 bit approximations of the powers of
+     * five, which are precise enough for values with mantissas of up to 53 bits. Among all
+     * shortest candidates the one closest to the value is picked.
+     * @param mantissa_bits stored mantissa of the value, without the implicit bit
+     * @param exponent_bits stored (biased) exponent of the value
+     * @param mantissa_width number of mantissa bits of the format (without the implicit bit)
+     * @param bias exponent bias of the format
+     * @return decimal representation of the absolute value, its digits are not a multiple of
+     *         ten unless they are zero
+     */
+    inline Decimal shortestDecimal(uint64_t mantissa_bits, uint32_t exponent_bits,
+                                   uint32_t mantissa_width, int32_t bias)
+    {
+      int32_t  e2;
+      uint64_t m2;
+
+      if (exponent_bits == 0)
+      {
+        e2 = 1 - bias - static_cast<int32_t>(mantissa_width) - 2;
+        m2 = mantissa_bits;
+      }
+      else
+      {
+        e2 = static_cast<int32_t>(exponent_bits) - bias - static_cast<int32_t>(mantissa_width) - 2;
+        m2 = (1ull << mantissa_width) | mantissa_bits;
+      }
+
+      // the interval of decimals rounding to the value is closed if the mantissa is even
+      bool const accept_bounds = (m2 & 1) == 0;
+
+      // the lower neighbor is closer if the mantissa is a power of two (and no subnormal)
+      uint64_t const mv = 4 * m2;
+      uint32_t const mm_shift = mantissa_bits != 0 || exponent_bits <= 1;
+
+      uint64_t vr;
+      uint64_t vp;
+      uint64_t vm;
+      int32_t  e10;
+      bool vm_trailing_zeros = false;
+      bool vr_trailing_zeros = false;
+
+      if (e2 >= 0)
+      {
+        uint32_t q = log10Pow2(e2) - (e2 > 3);
+        uint32_t k = POW5_INV_BITCOUNT + pow5Bits(q) - 1;
+        uint32_t i = q + k - e2;
+        Split mul = computeInvPow5(q);
+
+        e10 = static_cast<int32_t>(q);
+        vr  = mulShift(4 * m2, mul, i);
+        vp  = mulShift(4 * m2 + 2, mul, i);
+        vm  = mulShift(4 * m2 - 1 - mm_shift, mul, i);
+
+        // only check for trailing zeros where they are possible at all, for q > 21 the value
+        // cannot be divisible by 5^q
+        if (q <= 21)
+        {
+          if (mv % 5 == 0)
+            vr_trailing_zeros = multipleOfPowerOf5(mv, q);
+          else if (accept_bounds)
+            vm_trailing_zeros = multipleOfPowerOf5(mv - 1 - mm_shift, q);
+          else
+            vp -= multipleOfPowerOf5(mv + 2, q);
+        }
+      }
+      else
+      {
+        uint32_t q = log10Pow5(-e2) - (-e2 > 1);
+        uint32_t i = -e2 - q;
+        uint32_t k = pow5Bits(i) - POW5_BITCOUNT;
+        uint32_t j = q - k;
+        Split mul = computePow5(i);
+
+        e10 = static_cast<int32_t>(q) + e2;
+        vr  = mulShift(4 * m2, mul, j);
+        vp  = mulShift(4 * m2 + 2, mul, j);
+        vm  = mulShift(4 * m2 - 1 - mm_shift, mul, j);
+
+        if (q <= 1)
+        {
+          // mv has at least q trailing zero bits and -e2 >= q
+          vr_trailing_zeros = true;
+
+          if (accept_bounds)
+            vm_trailing_zeros = mm_shift == 1;
+          else
+            --vp;
+        }
+        else if (q < 63)
+          vr_trailing_zeros = multipleOfPowerOf2(mv, q);
+      }
+
+      // remove digits as long as the interval still contains a shorter decimal
+      int32_t removed = 0;
+      uint64_t output;
+
+      if (vm_trailing_zeros || vr_trailing_zeros)
+      {
+        uint8_t last_removed = 0;
+
+        for ( ; vp / 10 > vm / 10; vr /= 10, vp /= 10, vm /= 10, ++removed)
+        {
+          vm_trailing_zeros &= vm % 10 == 0;
+          vr_trailing_zeros &= last_removed == 0;
+          last_removed = static_cast<uint8_t>(vr % 10);
+        }
+
+        if (vm_trailing_zeros)
+        {
+          for ( ; vm % 10 == 0; vr /= 10, vp /= 10, vm /= 10, ++removed)
+          {
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = static_cast<uint8_t>(vr % 10);
+          }
+        }
+
+        // an exact tie is rounded to even
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+          last_removed = 4;
+
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+      }
+      else
+      {
+        // the common case, which does not have to care about exact ties
+        bool round_up = false;
+
+        if (vp / 100 > vm / 100)
+        {
+          round_up = vr % 100 >= 50;
+          vr /= 100;
+          vp /= 100;
+          vm /= 100;
+          removed += 2;
+        }
+
+        for ( ; vp / 10 > vm / 10; vr /= 10, vp /= 10, vm /= 10, ++removed)
+          round_up = vr % 10 >= 5;
+
+        output = vr + (vr == vm || round_up);
+      }
+
+      Decimal result = {output, e10 + removed};
+      return result;
+    }
+
+    /**
+     * @return pointer right after the characters [begin, end) copied to 'destination'
+     */
+    inline char* copyCharacters(char const* begin, char const* end, char* destination)
+    {
+      __builtin_memcpy(destination, begin, end - begin);
+      return destination + (end - begin);
+    }
+
+    /**
+     * This function lays out the digits of a decimal with a decimal point where they fit into
+     * 21 characters and in exponential notation otherwise, following the rules JavaScript uses
+     * for converting numbers to strings.
+     * @return pointer right after the last character written
+     */
+    inline char* writeShortest(Decimal decimal, char* destination)
+    {
+      char digits[24];
+      int32_t length = static_cast<int32_t>(formatInteger(decimal.digits, digits) - digits);
+      int32_t point  = decimal.exponent + length;
+
+      if (length <= point && point <= 21)
+      {
+        destination = copyCharacters(digits, digits + length, destination);
+        fill(destination, destination + (point - length), '0');
+        return destination + (point - length);
+      }
+
+      if (0 < point && point <= 21)
+      {
+        destination = copyCharacters(digits, digits + point, destination);
+        *destination++ = '.';
+        return copyCharacters(digits + point, digits + length, destination);
+      }
+
+      if (-6 < point && point <= 0)
+      {
+        *destination++ = '0';
+        *destination++ = '.';
+        fill(destination, destination - point, '0');
+        return copyCharacters(digits, digits + length, destination - point);
+      }
+
+      *destination++ = digits[0];
+
+      if (length > 1)
+      {
+        *destination++ = '.';
+        destination = copyCharacters(digits + 1, digits + length, destination);
+      }
+
+      *destination++ = 'e';
+      *destination++ = point > 0 ? '+' : '-';
+      return formatInteger(point > 0 ? point - 1 : 1 - point, destination);
+    }
+
+    /**
+     * This function writes "nan", "inf", or "-inf".
+     * @return pointer right after the last character written
+     */
+    inline char* writeSpecial(bool negative, uint64_t mantissa_bits, char* destination)
+    {
+      char const* string = mantissa_bits != 0 ? "nan" : negative ? "-inf" : "inf";
+
+      while (*string != '\0')
+        *destination++ = *string++;
+
+      return destination;
+    }
+
+    /**
+     * @return true if a number ending in 'last' followed by 'next' and, if 'sticky' is true,
+     *         further non-zero digits has to be rounded up, ties are rounded to even
+     */
+    inline bool roundUp(char last, char next, bool sticky)
+    {
+      return next > '5' || (next == '5' && (sticky || (last - '0') % 2 == 1));
+    }
+
+    /**
+     * This function adds one to the given decimal digits.
+     * @return true if the addition overflowed, i.e., all digits were nine and are now zero
+     */
+    inline bool incrementDigits(char* digits, size_t count)
+    {
+      for (size_t i = count; i > 0; --i)
+      {
+        if (digits[i - 1] != '9')
+        {
+          ++digits[i - 1];
+          return false;
+        }
+        digits[i - 1] = '0';
+      }
+      return true;
+    }
+
+
+    /**
+     * This class produces the exact decimal expansion of a finite non-negative binary floating
+     * point value mantissa * 2^exponent. The integral digits are computed at once, fractional
+     * digits one by one on request. Values with an integral part exceeding 64 bit and the
+     * fractional part are kept in a fixed size big integer.
+     */
+    class ExactDecimal
+    {
+    public:
+      ExactDecimal(uint64_t mantissa, int32_t exponent);
+
+      size_t integral(char* destination);
+      char fraction();
+
+      bool exhausted() const;
+
+    private:
+      enum
+      {
+        // 1074 fractional bits plus four bits of head room for multiplications by ten
+        WORDS = (1074 + 4 + 31) / 32
+      };
+
+      uint64_t mantissa_;
+      int32_t  exponent_;
+
+      uint32_t words_[WORDS];
+      size_t   size_;
+      size_t   bits_;
+    };
+
+
+    /**
+     * @param mantissa mantissa of the value, at most 53 bits wide
+     * @param exponent binary exponent of the value, at most 971
+     */
+    inline ExactDecimal::ExactDecimal(uint64_t mantissa, int32_t exponent)
+      : mantissa_(mantissa),
+        exponent_(exponent),
+        size_(0),
+        bits_(0)
+    {
+      if (exponent < 0)
+      {
+        bits_ = -exponent;
+        size_ = (bits_ + 4 + 31) / 32;
+
+        uint64_t fraction = bits_ < 64 ? mantissa & ((1ull << bits_) - 1) : mantissa;
+
+        for (size_t i = 0; i < size_; ++i)
+          words_[i] = 0;
+
+        words_[0] = static_cast<uint32_t>(fraction);
+
+        if (size_ > 1)
+          words_[1] = static_cast<uint32_t>(fraction >> 32);
+      }
+    }
+
+    /**
+     * @param destination pointer to write the digits of the integral part to, there has to be
+     *        room for 309 characters
+     * @return number of digits written, zero if the integral part is zero
+     */
+    inline size_t ExactDecimal::integral(char* destination)
+    {
+      uint64_t value;
+
+      if (exponent_ < 0)
+        value = bits_ < 64 ? mantissa_ >> bits_ : 0;
+      else if (exponent_ <= 64 - 53)
+        value = mantissa_ << exponent_;
+      else
+      {
+        // the fraction is unused for values this large, so its words serve as the big integer
+        size_t word = exponent_ / 32;
+        Uint128 shifted = static_cast<Uint128>(mantissa_) << (exponent_ % 32);
+
+        for (size_t i = 0; i < word; ++i)
+          words_[i] = 0;
+
+        words_[word + 0] = static_cast<uint32_t>(shifted);
+        words_[word + 1] = static_cast<uint32_t>(shifted >> 32);
+        words_[word + 2] = static_cast<uint32_t>(shifted >> 64);
+
+        size_t size = word + 3;
+        char buffer[320];
+        char* end = buffer + sizeof(buffer);
+        char* begin = end;
+
+        // divide by 10^9 repeatedly, every remainder provides nine digits
+        for (;;)
+        {
+          while (size > 0 && words_[size - 1] == 0)
+            --size;
+
+          uint64_t remainder = 0;
+
+          for (size_t i = size; i > 0; --i)
+          {
+            uint64_t current = (remainder << 32) | words_[i - 1];
+
+            words_[i - 1] = static_cast<uint32_t>(current / 1000000000);
+            remainder = current % 1000000000;
+          }
+
+          while (size > 0 && words_[size - 1] == 0)
+            --size;
+
+          if (size == 0)
+          {
+            begin -= countDigits(remainder);
+            formatInteger(remainder, begin);
+            break;
+          }
+
+          begin -= 9;
+          formatInteger(remainder, begin, BASE_DECIMAL, 9);
+        }
+
+        copyCharacters(begin, end, destination);
+        return end - begin;
+      }
+
+      return value == 0 ? 0 : formatInteger(value, destination) - destination;
+    }
+
+    /**
+     * @return the next fractional digit, '0' once the fraction is exhausted
+     */
+    inline char ExactDecimal::fraction()
+    {
+      uint64_t carry = 0;
+
+      for (size_t i = 0; i < size_; ++i)
+      {
+        uint64_t product = static_cast<uint64_t>(words_[i]) * 10 + carry;
+
+        words_[i] = static_cast<uint32_t>(product);
+        carry = product >> 32;
+      }
+
+      if (size_ == 0)
+        return '0';
+
+      // the digit is made up of the (at most four) bits above the fraction bits
+      size_t word   = bits_ / 32;
+      size_t offset = bits_ % 32;
+      uint64_t top  = words_[word];
+
+      if (word + 1 < size_)
+      {
+        top |= static_cast<uint64_t>(words_[word + 1]) << 32;
+        words_[word + 1] = 0;
+      }
+
+      words_[word] &= (1u << offset) - 1;
+      return static_cast<char>('0' + (top >> offset));
+    }
+
+    /**
+     * @return true if all further fractional digits are zero
+     */
+    inline bool ExactDecimal::exhausted() const
+    {
+      for (size_t i = 0; i < size_; ++i)
+      {
+        if (words_[i] != 0)
+          return false;
+      }
+      return true;
+    }
+
+
+    /**
+     * This function splits a double value into its components.
+     * @param mantissa (out) mantissa of the absolute value, including the implicit bit
+     * @param exponent (out) binary exponent of the absolute value
+     * @return pointer right after the sign written to 'destination' or nullptr if 'value' is
+     *         not finite, in which case its textual representation has been written
+     */
+    inline char* decompose(double value, char* destination, uint64_t& mantissa, int32_t& exponent)
+    {
+      uint64_t bits;
+      __builtin_memcpy(&bits, &value, sizeof(bits));
+
+      bool     negative      = (bits >> 63) != 0;
+      uint64_t mantissa_bits = bits & ((1ull << 52) - 1);
+      uint32_t exponent_bits = static_cast<uint32_t>(bits >> 52) & 0x7ff;
+
+      if (exponent_bits == 0x7ff)
+        return nullptr;
+
+      if (negative)
+        *destination++ = '-';
+
+      if (exponent_bits == 0)
+      {
+        mantissa = mantissa_bits;
+        exponent = 1 - 1023 - 52;
+      }
+      else
+      {
+        mantissa = mantissa_bits | (1ull << 52);
+        exponent = static_cast<int32_t>(exponent_bits) - 1023 - 52;
+      }
+      return destination;
+    }
+
+    /**
+     * @return pointer right after "nan", "inf", or "-inf" written for the given non-finite value
+     */
+    inline char* writeSpecial(double value, char* destination)
+    {
+      uint64_t bits;
+      __builtin_memcpy(&bits, &value, sizeof(bits));
+
+      return writeSpecial((bits >> 63) != 0, bits & ((1ull << 52) - 1), destination);
+    }
+  }
+
+
+  /**
+   * This function formats a double value with the least number of significant digits that are
+   * required to read back exactly the same value. Values with a decimal exponent from -7 to 20
+   * are formatted with a decimal point (e.g., 0.001, 1.5, 100), all others in exponential
+   * notation (e.g., 1e-7, 2.5e+21). Non-finite values are formatted as "nan", "inf", and
+   * "-inf". No allocations and no library calls are made.
+   * @param value value to format
+   * @param destination pointer to write the result to, there has to be room for
+   *        MAX_FLOAT_CHARACTERS characters
+   * @return pointer right after the last character written
+   */
+  inline char* formatShortest(double value, char* destination)
+  {
+    uint64_t bits;
+    __builtin_memcpy(&bits, &value, sizeof(bits));
+
+    bool     negative      = (bits >> 63) != 0;
+    uint64_t mantissa_bits = bits & ((1ull << 52) - 1);
+    uint32_t exponent_bits = static_cast<uint32_t>(bits >> 52) & 0x7ff;
+
+    if (exponent_bits == 0x7ff)
+      return impl::writeSpecial(negative, mantissa_bits, destination);
+
+    if (negative)
+      *destination++ = '-';
+
+    if (exponent_bits == 0 && mantissa_bits == 0)
+    {
+      *destination++ = '0';
+      return destination;
+    }
+
+    impl::Decimal decimal = impl::shortestDecimal(mantissa_bits, exponent_bits, 52, 1023);
+    return impl::writeShortest(decimal, destination);
+  }
+
+  /**
+   * @copydoc formatShortest(double, char*)
+   */
+  inline char* formatShortest(float value, char* destination)
+  {
+    uint32_t bits;
+    __builtin_memcpy(&bits, &value, sizeof(bits));
+
+    bool     negative      = (bits >> 31) != 0;
+    uint32_t mantissa_bits = bits & ((1u << 23) - 1);
+    uint32_t exponent_bits = (bits >> 23) & 0xff;
+
+    if (exponent_bits == 0xff)
+      return impl::writeSpecial(negative, mantissa_bits, destination);
+
+    if (negative)
+      *destination++ = '-';
+
+    if (exponent_bits == 0 && mantissa_bits == 0)
+    {
+      *destination++ = '0';
+      return destination;
+    }
+
+    impl::Decimal decimal = impl::shortestDecimal(mantissa_bits, exponent_bits, 23, 127);
+    return impl::writeShortest(decimal, destination);
+  }
+
+  /**
+   * This function formats a double value in scientific notation with the given number of
+   * fractional digits (e.g., 1.500e+03 for a precision of three), just like printf's %e
+   * conversion does. The exact value is rounded, with ties being rounded to even.
+   * @param value value to format
+   * @param destination pointer to write the result to, there has to be room for
+   *        MAX_FLOAT_CHARACTERS characters
+   * @param precision number of digits after the decimal point, at most MAX_FLOAT_PRECISION
+   * @return pointer right after the last character written
+   */
+  inline char* formatScientific(double value, char* destination, size_t precision)
+  {
+    uint64_t mantissa;
+    int32_t  exponent;
+    char* begin = impl::decompose(value, destination, mantissa, exponent);
+
+    if (begin == nullptr)
+      return impl::writeSpecial(value, destination);
+
+    precision = min<size_t>(precision, MAX_FLOAT_PRECISION);
+    destination = begin;
+
+    char digits[309 + MAX_FLOAT_PRECISION + 2];
+    size_t count = 0;
+    int32_t exponent10 = 0;
+
+    if (mantissa != 0)
+    {
+      impl::ExactDecimal exact(mantissa, exponent);
+
+      count = exact.integral(digits);
+
+      if (count > 0)
+        exponent10 = static_cast<int32_t>(count) - 1;
+      else
+      {
+        // skip the leading zeros of the fraction
+        char digit;
+
+        for (exponent10 = -1; (digit = exact.fraction()) == '0'; --exponent10)
+          ;
+
+        digits[count++] = digit;
+      }
+
+      while (count < precision + 2)
+        digits[count++] = exact.fraction();
+
+      bool sticky = !exact.exhausted();
+
+      for (size_t i = precision + 2; i < count; ++i)
+        sticky = sticky || digits[i] != '0';
+
+      if (impl::roundUp(digits[precision], digits[precision + 1], sticky))
+      {
+        if (impl::incrementDigits(digits, precision + 1))
+        {
+          digits[0] = '1';
+          ++exponent10;
+        }
+      }
+    }
+    else
+      fill(digits, digits + precision + 1, '0');
+
+    *destination++ = digits[0];
+
+    if (precision > 0)
+    {
+      *destination++ = '.';
+      destination = impl::copyCharacters(digits + 1, digits + precision + 1, destination);
+    }
+
+    *destination++ = 'e';
+    *destination++ = exponent10 < 0 ? '-' : '+';
+    return formatInteger(exponent10 < 0 ? -exponent10 : exponent10, destination, BASE_DECIMAL, 2);
+  }
+
+  /**
+   * This function formats a double value in fixed point notation with the given number of
+   * fractional digits (e.g., 1500.000 for a precision of three), just like printf's %f
+   * conversion does. The exact value is rounded, with ties being rounded to even.
+   * @param value value to format
+   * @param destination pointer to write the result to, there has to be room for
+   *        MAX_FLOAT_CHARACTERS characters
+   * @param precision number of digits after the decimal point, at most MAX_FLOAT_PRECISION
+   * @return pointer right after the last character written
+   */
+  inline char* formatFixed(double value, char* destination, size_t precision)
+  {
+    uint64_t mantissa;
+    int32_t  exponent;
+    char* begin = impl::decompose(value, destination, mantissa, exponent);
+
+    if (begin == nullptr)
+      return impl::writeSpecial(value, destination);
+
+    precision = min<size_t>(precision, MAX_FLOAT_PRECISION);
+    destination = begin;
+
+    // the first character is reserved for a carry out of the integral digits
+    char digits[1 + 309 + MAX_FLOAT_PRECISION + 1];
+    impl::ExactDecimal exact(mantissa, exponent);
+
+    size_t integral = exact.integral(digits + 1);
+
+    if (integral == 0)
+      digits[++integral] = '0';
+
+    char* fraction = digits + 1 + integral;
+
+    for (size_t i = 0; i <= precision; ++i)
+      fraction[i] = exact.fraction();
+
+    char* first = digits + 1;
+
+    // without fractional digits the last digit kept is the last integral one
+    if (impl::roundUp(fraction[precision - 1], fraction[precision], !exact.exhausted()))
+    {
+      if (impl::incrementDigits(first, integral + precision))
+        *--first = '1';
+    }
+
+    destination = impl::copyCharacters(first, fraction, destination);
+
+    if (precision > 0)
+    {
+      *destination++ = '.';
+      destination = impl::copyCharacters(fraction, fraction + precision, destination);
+    }
+    return destination;
+  }
+}
+
+
+#endif
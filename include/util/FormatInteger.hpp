@@ -0,0 +1,316 @@
+// FormatInteger.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLFORMATINTEGER_HPP
+#define UTLFORMATINTEGER_HPP
+
+#include <type/Traits.hpp>
+
+#include "util/Config.hpp"
+#include "util/Bits.hpp"
+#include "util/Util.hpp"
+#include "util/NumberBase.hpp"
+
+
+namespace utl
+{
+  /**
+   * The maximum number of characters formatInteger produces for any integer type up to 64 bit
+   * without padding: 64 binary digits and a sign.
+   */
+  enum
+  {
+    MAX_INTEGER_CHARACTERS = 65
+  };
+
+
+  template<typename T>
+  size_t countDigits(T value, uint8_t base = BASE_DECIMAL);
+
+  template<typename T>
+  size_t maxDigits(uint8_t base = BASE_DECIMAL);
+
+  template<typename T>
+  size_t integerLength(T value, uint8_t base = BASE_DECIMAL, size_t width = 0);
+
+  template<typename T>
+  char* formatInteger(T value, char* destination, uint8_t base = BASE_DECIMAL, size_t width = 0);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * @return pointer to the 200 characters "00", "01", ..., "99"
+     */
+    inline char const* digitPairs()
+    {
+      static char const pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+      return pairs;
+    }
+
+    /**
+     * @return number of decimal digits of 'value'
+     */
+    inline size_t countDecimalDigits(uint64_t value)
+    {
+      // the first entry is zero and not one, so that zero has one digit as well
+      static uint64_t const powers[] = {
+        0ull,
+        10ull,
+        100ull,
+        1000ull,
+        10000ull,
+        100000ull,
+        1000000ull,
+        10000000ull,
+        100000000ull,
+        1000000000ull,
+        10000000000ull,
+        100000000000ull,
+        1000000000000ull,
+        10000000000000ull,
+        100000000000000ull,
+        1000000000000000ull,
+        10000000000000000ull,
+        100000000000000000ull,
+        1000000000000000000ull,
+        10000000000000000000ull,
+      };
+
+      // 1233/4096 approximates log10(2), the estimate is either exact or one too large
+      size_t bits     = 64 - countLeadingZeros(value | 1);
+      size_t estimate = bits * 1233 >> 12;
+
+      return estimate + 1 - (value < powers[estimate]);
+    }
+
+    /**
+     * @return number of binary digits of 'value', one for zero
+     */
+    inline size_t countBits(uint64_t value)
+    {
+      return 64 - countLeadingZeros(value | 1);
+    }
+
+    /**
+     * @return log2(base) if 'base' is a power of two, zero otherwise
+     */
+    inline size_t baseShift(uint8_t base)
+    {
+      return (base & (base - 1)) == 0 ? countTrailingZeros(base) : 0;
+    }
+
+    /**
+     * This function writes the decimal digits of 'value' backwards, two at a time.
+     * @param value value to format
+     * @param end pointer right after the last digit to write
+     */
+    template<typename T>
+    inline void writeDecimal(T value, char* end)
+    {
+      char const* pairs = digitPairs();
+
+      while (value >= 100)
+      {
+        size_t index = static_cast<size_t>(value % 100) * 2;
+        value /= 100;
+
+        *--end = pairs[index + 1];
+        *--end = pairs[index];
+      }
+
+      if (value >= 10)
+      {
+        size_t index = static_cast<size_t>(value) * 2;
+
+        *--end = pairs[index + 1];
+        *--end = pairs[index];
+      }
+      else
+        *--end = static_cast<char>('0' + value);
+    }
+
+    /**
+     * This function writes the digits of 'value' in a base that is a power of two backwards.
+     * @param value value to format
+     * @param end pointer right after the last digit to write
+     * @param shift log2 of the base
+     */
+    template<typename T>
+    inline void writeShifted(T value, char* end, size_t shift)
+    {
+      T const mask = static_cast<T>((1u << shift) - 1);
+
+      do
+      {
+        *--end = "0123456789ABCDEF"[value & mask];
+        value >>= shift;
+      } while (value != 0);
+    }
+
+    /**
+     * This function writes the digits of 'value' in an arbitrary base backwards.
+     * @param value value to format
+     * @param end pointer right after the last digit to write
+     * @param base base to use
+     */
+    template<typename T>
+    inline void writeGeneric(T value, char* end, uint8_t base)
+    {
+      do
+      {
+        *--end = "0123456789ABCDEF"[value % base];
+        value /= base;
+      } while (value != 0);
+    }
+
+    /**
+     * @param value value to format, must not be negative
+     * @param destination pointer to write the digits to
+     * @param base base to use
+     * @param width minimum number of digits, the value is padded with zeros to that many
+     * @return pointer right after the last digit written
+     */
+    template<typename T>
+    inline char* formatDigits(T value, char* destination, uint8_t base, size_t width)
+    {
+      size_t count = countDigits(value, base);
+      size_t shift = baseShift(base);
+
+      for (size_t i = count; i < width; ++i)
+        *destination++ = '0';
+
+      char* end = destination + count;
+
+      if (base == BASE_DECIMAL)
+        writeDecimal(value, end);
+      else if (shift != 0)
+        writeShifted(value, end, shift);
+      else
+        writeGeneric(value, end, base);
+
+      return end;
+    }
+  }
+
+
+  /**
+   * @param value some value (a negative value's sign is not counted)
+   * @param base base to use, has to be between BASE_MIN and BASE_MAX (exclusive)
+   * @return number of digits 'value' has in the given base
+   */
+  template<typename T>
+  inline size_t countDigits(T value, uint8_t base)
+  {
+    typedef typename typ::MakeUnsigned<typename typ::RemoveConst<T>::Type>::Type Unsigned;
+
+    Unsigned magnitude = static_cast<Unsigned>(value);
+
+    if (impl::isSigned<T>() && value < 0)
+      magnitude = static_cast<Unsigned>(0 - magnitude);
+
+    if (base == BASE_DECIMAL)
+      return impl::countDecimalDigits(magnitude);
+
+    size_t shift = impl::baseShift(base);
+
+    if (shift != 0)
+      return (impl::countBits(magnitude) + shift - 1) / shift;
+
+    size_t count = 1;
+
+    for ( ; magnitude >= base; magnitude /= base)
+      ++count;
+
+    return count;
+  }
+
+  /**
+   * @param base base to use, has to be between BASE_MIN and BASE_MAX (exclusive)
+   * @return number of digits of the greatest value the unsigned counterpart of T can hold, i.e.,
+   *         the number of digits every value of that type has when it is printed with fixed
+   *         width
+   */
+  template<typename T>
+  inline size_t maxDigits(uint8_t base)
+  {
+    typedef typename typ::MakeUnsigned<typename typ::RemoveConst<T>::Type>::Type Unsigned;
+
+    return countDigits(static_cast<Unsigned>(~static_cast<Unsigned>(0)), base);
+  }
+
+  /**
+   * @param value some value
+   * @param base base to use, has to be between BASE_MIN and BASE_MAX (exclusive)
+   * @param width minimum number of digits, as for formatInteger
+   * @return number of characters formatInteger writes for the given arguments, including the
+   *         sign
+   */
+  template<typename T>
+  inline size_t integerLength(T value, uint8_t base, size_t width)
+  {
+    size_t sign = impl::isSigned<T>() && value < 0;
+    return sign + max(countDigits(value, base), width);
+  }
+
+  /**
+   * This function formats an integer. Digits are produced from the least significant one
+   * onwards and written back to front. Decimal digits are produced two at a time from a table,
+   * digits in bases that are powers of two by shifting and masking.
+   * @param value value to format
+   * @param destination pointer to write the result to, there has to be room for
+   *        max(MAX_INTEGER_CHARACTERS, width + 1) characters
+   * @param base base to use, has to be between BASE_MIN and BASE_MAX (exclusive), digits above
+   *        nine are printed as upper case letters
+   * @param width minimum number of digits, the value is padded with leading zeros up to that
+   *        many, a minus sign for a negative value is not counted
+   * @return pointer right after the last character written
+   */
+  template<typename T>
+  inline char* formatInteger(T value, char* destination, uint8_t base, size_t width)
+  {
+    typedef typename typ::MakeUnsigned<typename typ::RemoveConst<T>::Type>::Type Unsigned;
+
+    Unsigned magnitude = static_cast<Unsigned>(value);
+
+    if (impl::isSigned<T>() && value < 0)
+    {
+      *destination++ = '-';
+      magnitude = static_cast<Unsigned>(0 - magnitude);
+    }
+
+    return impl::formatDigits(magnitude, destination, base, width);
+  }
+}
+
+
+#endif
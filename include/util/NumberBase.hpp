@@ -0,0 +1,42 @@
+// NumberBase.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLNUMBERBASE_HPP
+#define UTLNUMBERBASE_HPP
+
+
+namespace utl
+{
+  /**
+   * The bases supported for printing and parsing numbers. Valid bases are those strictly
+   * between BASE_MIN and BASE_MAX.
+   */
+  enum
+  {
+    BASE_MIN         = 1,
+    BASE_BINARY      = 2,
+    BASE_OCTAL       = 8,
+    BASE_DECIMAL     = 10,
+    BASE_HEXADECIMAL = 16,
+    BASE_MAX         = 17
+  };
+}
+
+
+#endif
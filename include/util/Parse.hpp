@@ -0,0 +1,346 @@
+// Parse.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLPARSE_HPP
+#define UTLPARSE_HPP
+
+#include <type/Traits.hpp>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Bits.hpp"
+#include "util/NumberBase.hpp"
+
+
+namespace utl
+{
+  /**
+   * The outcome of parsing a number.
+   */
+  enum ParseStatus
+  {
+    PARSE_SUCCESS,
+    PARSE_INVALID,
+    PARSE_OVERFLOW,
+  };
+
+  /**
+   * The result of parsing a number: the value parsed, a pointer to the first character not
+   * belonging to the number, and the status.
+   */
+  template<typename T>
+  struct ParseResult
+  {
+    T value;
+    char const* end;
+    ParseStatus status;
+  };
+
+
+  template<typename T>
+  ParseResult<T> parse(char const* begin, char const* end, uint8_t base = BASE_DECIMAL);
+
+  uint8_t digitValue(char c);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * @return pointer to a table mapping each character to the value of the digit it represents
+     *         (letters are digits from ten on, regardless of case) or 0xff if it is no digit
+     */
+    inline byte_t const* digitTable()
+    {
+      static byte_t const table[256] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+          0,   1,   2,   3,   4,   5,   6,   7,   8,   9, 255, 255, 255, 255, 255, 255,
+        255,  10,  11,  12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,
+         25,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35, 255, 255, 255, 255, 255,
+        255,  10,  11,  12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,
+         25,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+      };
+      return table;
+    }
+
+    /**
+     * This function combines eight decimal digit values, stored one per byte with the most
+     * significant digit in the lowest byte, into the number they represent. The digits are
+     * merged pairwise in three multiplications instead of eight.
+     */
+    inline uint64_t combineDigits(uint64_t digits)
+    {
+      uint64_t const mask = 0x000000ff000000ffull;
+      uint64_t const mul1 = 100 + (1000000ull << 32);
+      uint64_t const mul2 = 1 + (10000ull << 32);
+
+      digits = digits * 10 + (digits >> 8);
+      return (((digits & mask) * mul1) + (((digits >> 16) & mask) * mul2)) >> 32;
+    }
+
+    /**
+     * This function parses decimal digits. It checks eight characters at once and converts all
+     * of the leading digits among them without a loop.
+     * @param begin (in/out) begin of digits, afterwards the first character that is no digit
+     * @param end end of range to parse
+     * @param value (out) the parsed value
+     * @return true if the value does not fit into 64 bit, false otherwise
+     */
+    inline bool parseDecimal(char const*& begin, char const* end, uint64_t& value)
+    {
+      static uint64_t const powers[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+      };
+
+      // up to 19 decimal digits always fit into 64 bit, only beyond that we have to check for
+      // overflows
+      uint64_t result   = 0;
+      size_t   total    = 0;
+      bool     overflow = false;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      while (end - begin >= 8)
+      {
+        uint64_t chunk;
+        __builtin_memcpy(&chunk, begin, sizeof(chunk));
+
+        // digits become values 0 to 9, a byte is no digit if it is 10 or above afterwards
+        uint64_t digits = chunk ^ 0x3030303030303030ull;
+        uint64_t others = (((digits & 0x7f7f7f7f7f7f7f7full) + 0x7676767676767676ull) | digits) &
+                          0x8080808080808080ull;
+
+        size_t count = others == 0 ? 8 : countTrailingZeros(others) / 8;
+
+        if (count == 0)
+          break;
+
+        // move the digits to the top, so that the bytes below act as leading zeros
+        digits <<= 8 * (8 - count);
+        total += count;
+
+        if (__builtin_expect(total <= 19, 1))
+          result = result * powers[count] + combineDigits(digits);
+        else
+        {
+          overflow |= __builtin_mul_overflow(result, powers[count], &result);
+          overflow |= __builtin_add_overflow(result, combineDigits(digits), &result);
+        }
+
+        begin += count;
+
+        if (count < 8)
+        {
+          value = result;
+          return overflow;
+        }
+      }
+#endif
+      for ( ; begin != end; ++begin)
+      {
+        uint64_t digit = static_cast<byte_t>(*begin - '0');
+
+        if (digit > 9)
+          break;
+
+        if (++total <= 19)
+          result = result * 10 + digit;
+        else
+        {
+          overflow |= __builtin_mul_overflow(result, 10, &result);
+          overflow |= __builtin_add_overflow(result, digit, &result);
+        }
+      }
+
+      value = result;
+      return overflow;
+    }
+
+    /**
+     * This function parses digits of a base that is a power of two, so that digits can simply be
+     * shifted into place.
+     * @param shift number of bits per digit
+     * @see parseDecimal
+     */
+    inline bool parseShifted(char const*& begin, char const* end, unsigned shift, uint64_t& value)
+    {
+      byte_t const* table = digitTable();
+      byte_t const  base  = static_cast<byte_t>(1 << shift);
+
+      uint64_t result   = 0;
+      bool     overflow = false;
+
+      for ( ; begin != end; ++begin)
+      {
+        byte_t digit = table[static_cast<byte_t>(*begin)];
+
+        if (digit >= base)
+          break;
+
+        overflow |= (result >> (64 - shift)) != 0;
+        result = (result << shift) | digit;
+      }
+
+      value = result;
+      return overflow;
+    }
+
+    /**
+     * This function parses digits of an arbitrary base.
+     * @see parseDecimal
+     */
+    inline bool parseGeneric(char const*& begin, char const* end, uint8_t base, uint64_t& value)
+    {
+      byte_t const* table = digitTable();
+
+      uint64_t result   = 0;
+      bool     overflow = false;
+
+      for ( ; begin != end; ++begin)
+      {
+        byte_t digit = table[static_cast<byte_t>(*begin)];
+
+        if (digit >= base)
+          break;
+
+        overflow |= __builtin_mul_overflow(result, base, &result);
+        overflow |= __builtin_add_overflow(result, static_cast<uint64_t>(digit), &result);
+      }
+
+      value = result;
+      return overflow;
+    }
+
+    /**
+     * @see parseDecimal
+     */
+    inline bool parseDigits(char const*& begin, char const* end, uint8_t base, uint64_t& value)
+    {
+      switch (base)
+      {
+      case BASE_DECIMAL:
+        return parseDecimal(begin, end, value);
+
+      case BASE_HEXADECIMAL:
+        return parseShifted(begin, end, 4, value);
+
+      case BASE_OCTAL:
+        return parseShifted(begin, end, 3, value);
+
+      case BASE_BINARY:
+        return parseShifted(begin, end, 1, value);
+
+      case 4:
+        return parseShifted(begin, end, 2, value);
+      }
+      return parseGeneric(begin, end, base, value);
+    }
+  }
+
+
+  /**
+   * @param c character to convert
+   * @return value of the digit represented by the given character (letters are accepted in
+   *         upper and lower case) or a value of at least BASE_MAX if it is no digit
+   */
+  inline uint8_t digitValue(char c)
+  {
+    return impl::digitTable()[static_cast<byte_t>(c)];
+  }
+
+  /**
+   * This function parses an integer in the given base. The number may be preceded by a '+' or,
+   * for signed types, a '-' sign. Neither whitespace nor prefixes such as "0x" are skipped.
+   * Parsing stops at the first character that is no digit in the given base.
+   * @param begin begin of range to parse
+   * @param end end of range to parse
+   * @param base base the number is represented in
+   * @return the parsed value along with a pointer to the first character not parsed and the
+   *         status; if the value does not fit into T the status is PARSE_OVERFLOW, the value is
+   *         saturated to the minimum or maximum of T, and all digits are consumed nevertheless;
+   *         if there are no digits at all (or the base is invalid) the status is PARSE_INVALID
+   *         and the end is equal to 'begin'
+   */
+  template<typename T>
+  ParseResult<T> parse(char const* begin, char const* end, uint8_t base)
+  {
+    typedef typename typ::MakeUnsigned<T>::Type Unsigned;
+
+    ParseResult<T> result = {0, begin, PARSE_INVALID};
+
+    if (base <= BASE_MIN || base >= BASE_MAX)
+      return result;
+
+    char const* it = begin;
+    bool negative  = false;
+
+    if (it != end && (*it == '+' || (*it == '-' && impl::isSigned<T>())))
+    {
+      negative = *it == '-';
+      ++it;
+    }
+
+    char const* digits = it;
+
+    uint64_t value;
+    bool overflow = impl::parseDigits(it, end, base, value);
+
+    if (it == digits)
+      return result;
+
+    Unsigned maximum = static_cast<Unsigned>(~static_cast<Unsigned>(0));
+    Unsigned limit   = maximum;
+
+    if (impl::isSigned<T>())
+    {
+      maximum = maximum >> 1;
+      limit   = negative ? maximum + 1 : maximum;
+    }
+
+    result.end = it;
+
+    if (overflow || value > limit)
+    {
+      result.value  = negative ? static_cast<T>(maximum + 1) : static_cast<T>(maximum);
+      result.status = PARSE_OVERFLOW;
+    }
+    else
+    {
+      Unsigned magnitude = static_cast<Unsigned>(value);
+
+      result.value  = static_cast<T>(negative ? 0 - magnitude : magnitude);
+      result.status = PARSE_SUCCESS;
+    }
+    return result;
+  }
+}
+
+
+#endif
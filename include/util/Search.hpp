@@ -0,0 +1,352 @@
+// Search.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLSEARCH_HPP
+#define UTLSEARCH_HPP
+
+#include <type/Traits.hpp>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Bits.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  template<typename Iterator1T, typename Iterator2T>
+  Iterator1T search(Iterator1T begin, Iterator1T end, Iterator2T needle_begin, Iterator2T needle_end);
+
+  byte_t const* searchBytes(byte_t const* begin, byte_t const* end,
+                            byte_t const* needle, size_t length);
+
+  byte_t const* searchTwoWay(byte_t const* begin, byte_t const* end,
+                             byte_t const* needle, size_t length);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * This template tells whether the given type is a byte sized character type.
+     */
+    template<typename T>
+    struct IsByte
+    {
+      static bool const value = false;
+    };
+
+    template<> struct IsByte<char>    { static bool const value = true; };
+    template<> struct IsByte<schar_t> { static bool const value = true; };
+    template<> struct IsByte<uchar_t> { static bool const value = true; };
+
+    /**
+     * This template tells whether the given type is a pointer to byte sized characters, which
+     * can be searched using the optimized searchBytes function.
+     */
+    template<typename T>
+    struct IsBytePointer
+    {
+      static bool const value = false;
+    };
+
+    template<typename T>
+    struct IsBytePointer<T*>
+    {
+      static bool const value = IsByte<typename typ::RemoveConst<T>::Type>::value;
+    };
+
+    template<bool Value>
+    struct Bool
+    {
+    };
+
+
+    /**
+     * This is the generic version of search that works for all kinds of iterators.
+     */
+    template<typename Iterator1T, typename Iterator2T>
+    Iterator1T search(Iterator1T begin, Iterator1T end,
+                      Iterator2T needle_begin, Iterator2T needle_end, Bool<false>)
+    {
+      for ( ; ; ++begin)
+      {
+        Iterator1T it1 = begin;
+        Iterator2T it2 = needle_begin;
+
+        for ( ; ; ++it1, ++it2)
+        {
+          if (it2 == needle_end)
+            return begin;
+
+          if (it1 == end)
+            return end;
+
+          if (!(*it1 == *it2))
+            break;
+        }
+      }
+    }
+
+    /**
+     * This is the version of search used for ranges of bytes and characters.
+     */
+    template<typename Iterator1T, typename Iterator2T>
+    Iterator1T search(Iterator1T begin, Iterator1T end,
+                      Iterator2T needle_begin, Iterator2T needle_end, Bool<true>)
+    {
+      byte_t const* first  = reinterpret_cast<byte_t const*>(begin);
+      byte_t const* last   = reinterpret_cast<byte_t const*>(end);
+      byte_t const* needle = reinterpret_cast<byte_t const*>(needle_begin);
+
+      return begin + (searchBytes(first, last, needle, needle_end - needle_begin) - first);
+    }
+
+    /**
+     * @return true if the 'count' bytes at 'first' and 'second' are equal
+     */
+    inline bool equal(byte_t const* first, byte_t const* second, size_t count)
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (first[i] != second[i])
+          return false;
+      }
+      return true;
+    }
+
+    /**
+     * This function computes the critical factorization of the given needle as required by the
+     * Two-Way algorithm by means of the maximal suffix with respect to the given ordering.
+     * @param needle needle to factorize
+     * @param length length of 'needle'
+     * @param period (out) period of the maximal suffix
+     * @param greater true to use the regular ordering, false to use the reverse one
+     * @return position right before the maximal suffix (size_t(-1) if it starts at zero)
+     */
+    inline size_t maximalSuffix(byte_t const* needle, size_t length, size_t& period, bool greater)
+    {
+      size_t i = static_cast<size_t>(-1);
+      size_t j = 0;
+      size_t k = 1;
+      size_t p = 1;
+
+      while (j + k < length)
+      {
+        byte_t a = needle[i + k];
+        byte_t b = needle[j + k];
+
+        if (a == b)
+        {
+          if (k == p)
+          {
+            j += p;
+            k = 1;
+          }
+          else
+            ++k;
+        }
+        else if ((a > b) == greater)
+        {
+          j += k;
+          k = 1;
+          p = j - i;
+        }
+        else
+        {
+          i = j++;
+          k = p = 1;
+        }
+      }
+
+      period = p;
+      return i;
+    }
+
+    /**
+     * This function searches the given needle using the first and the last byte of it as a filter
+     * for candidate positions. Sixteen candidates are checked at once. Candidates get verified
+     * byte by byte, which is quadratic for pathological inputs. To still guarantee linear time we
+     * bail out once the verification work gets out of proportion and let the caller continue
+     * with the Two-Way algorithm.
+     * @param begin (in/out) begin of haystack, afterwards the first position not yet checked
+     * @return pointer to the first occurrence or nullptr if the search has to be continued at
+     *         'begin' by other means
+     */
+    inline byte_t const* searchFiltered(byte_t const*& begin, byte_t const* end,
+                                        byte_t const* needle, size_t length)
+    {
+#ifdef UTL_SIMD_SSE2
+      __m128i const first = _mm_set1_epi8(static_cast<char>(needle[0]));
+      __m128i const last  = _mm_set1_epi8(static_cast<char>(needle[length - 1]));
+
+      byte_t const* start = begin;
+      size_t work = 0;
+
+      // the last load starts at 'begin + length - 1' and must not exceed 'end'
+      for ( ; end - begin >= static_cast<ptrdiff_t>(length - 1 + 16); begin += 16)
+      {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+        __m128i block_last  = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin + length - 1));
+
+        __m128i eq_first = _mm_cmpeq_epi8(first, block_first);
+        __m128i eq_last  = _mm_cmpeq_epi8(last, block_last);
+
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(eq_first, eq_last));
+
+        while (mask != 0)
+        {
+          size_t offset = countTrailingZeros(mask);
+
+          if (length <= 2 || equal(begin + offset + 1, needle + 1, length - 2))
+            return begin + offset;
+
+          work += length;
+          mask &= mask - 1;
+        }
+
+        if (work > 4 * static_cast<size_t>(begin - start) + 1024)
+        {
+          begin += 16;
+          return nullptr;
+        }
+      }
+#else
+      (void)end;
+      (void)needle;
+      (void)length;
+#endif
+      // let the caller handle the rest
+      return nullptr;
+    }
+  }
+
+  /**
+   * This function implements the Two-Way string matching algorithm by Crochemore and Perrin. It
+   * runs in linear time and requires constant space.
+   * @param begin begin of haystack
+   * @param end end of haystack
+   * @param needle begin of needle
+   * @param length length of 'needle', must not be zero
+   * @return pointer to the first occurrence of the needle in the haystack or 'end' if none
+   */
+  inline byte_t const* searchTwoWay(byte_t const* begin, byte_t const* end,
+                                    byte_t const* needle, size_t length)
+  {
+    size_t period1;
+    size_t period2;
+    size_t suffix1 = impl::maximalSuffix(needle, length, period1, true);
+    size_t suffix2 = impl::maximalSuffix(needle, length, period2, false);
+
+    // the critical factorization is the one with the longer maximal suffix
+    size_t suffix = suffix2 + 1 > suffix1 + 1 ? suffix2 : suffix1;
+    size_t period = suffix2 + 1 > suffix1 + 1 ? period2 : period1;
+    size_t memory0;
+
+    if (period <= length - suffix - 1 &&
+        impl::equal(needle, needle + period, suffix + 1))
+    {
+      // periodic needle, we remember how much of it we already matched
+      memory0 = length - period;
+    }
+    else
+    {
+      memory0 = 0;
+      period  = max(suffix + 1, length - suffix - 1) + 1;
+    }
+
+    size_t memory = 0;
+
+    while (static_cast<size_t>(end - begin) >= length)
+    {
+      // compare the right half
+      size_t k = max(suffix + 1, memory);
+
+      while (k < length && needle[k] == begin[k])
+        ++k;
+
+      if (k < length)
+      {
+        begin += k - suffix;
+        memory = 0;
+        continue;
+      }
+
+      // compare the left half
+      for (k = suffix + 1; k > memory && needle[k - 1] == begin[k - 1]; --k)
+        ;
+
+      if (k <= memory)
+        return begin;
+
+      begin += period;
+      memory = memory0;
+    }
+    return end;
+  }
+
+  /**
+   * This function finds the first occurrence of the sequence [needle_begin, needle_end) in the
+   * range [begin, end). Ranges of bytes or characters given by pointers are searched using
+   * searchBytes.
+   * @return iterator to the begin of the first occurrence or 'end' if there is none
+   * @note an empty needle is found at 'begin'
+   */
+  template<typename Iterator1T, typename Iterator2T>
+  inline Iterator1T search(Iterator1T begin, Iterator1T end,
+                           Iterator2T needle_begin, Iterator2T needle_end)
+  {
+    typedef impl::Bool<impl::IsBytePointer<Iterator1T>::value &&
+                       impl::IsBytePointer<Iterator2T>::value> Bytes;
+
+    return impl::search(begin, end, needle_begin, needle_end, Bytes());
+  }
+
+  /**
+   * This function searches a byte range for a sequence of bytes. It filters candidate positions
+   * by the first and the last byte of the needle using SIMD instructions (if available) and
+   * falls back to the Two-Way algorithm, so that linear run time is guaranteed in any case.
+   * @param begin begin of haystack
+   * @param end end of haystack
+   * @param needle begin of needle
+   * @param length length of 'needle'
+   * @return pointer to the first occurrence of the needle in the haystack or 'end' if none
+   */
+  inline byte_t const* searchBytes(byte_t const* begin, byte_t const* end,
+                                   byte_t const* needle, size_t length)
+  {
+    if (length == 0)
+      return begin;
+
+    if (static_cast<size_t>(end - begin) < length)
+      return end;
+
+    byte_t const* result = impl::searchFiltered(begin, end, needle, length);
+
+    if (result != nullptr)
+      return result;
+
+    return searchTwoWay(begin, end, needle, length);
+  }
+}
+
+
+#endif
@@ -0,0 +1,62 @@
+// Simd.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/**
+ * This file pulls in the vector intrinsics available for the target the code is compiled for.
+ * Whether a vectorized code path is used is decided at compile time (e.g., by means of -march),
+ * every user of the intrinsics provides a scalar fallback. The following defines are provided:
+ * - UTL_SIMD_SSE2   if SSE2 instructions can be used
+ * - UTL_SIMD_SSSE3  if SSSE3 instructions (most notably pshufb) can be used
+ * - UTL_SIMD_SSE42  if SSE4.2 instructions (most notably crc32) can be used
+ * - UTL_SIMD_PCLMUL if the carry-less multiplication instruction (pclmulqdq) can be used
+ * - UTL_SIMD_AVX2   if AVX2 instructions can be used
+ */
+
+#ifndef UTLSIMD_HPP
+#define UTLSIMD_HPP
+
+#include "util/Config.hpp"
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define UTL_SIMD_SSE2
+#endif
+
+#if defined(__SSSE3__)
+#  include <tmmintrin.h>
+#  define UTL_SIMD_SSSE3
+#endif
+
+#if defined(__SSE4_2__)
+#  include <nmmintrin.h>
+#  define UTL_SIMD_SSE42
+#endif
+
+#if defined(__PCLMUL__)
+#  include <wmmintrin.h>
+#  define UTL_SIMD_PCLMUL
+#endif
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define UTL_SIMD_AVX2
+#endif
+
+
+#endif
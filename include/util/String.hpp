@@ -24,6 +24,7 @@
 #include "util/Util.hpp"
 #include "util/Assert.hpp"
 #include "util/Algorithm.hpp"
+#include "util/StringLength.hpp"
 
 
 namespace utl
@@ -50,6 +51,10 @@ namespace utl
   {
     ASSERTOP(string, ne, nullptr);
 
+    // strings of bytes are handled by the vectorized version
+    if (sizeof(CharT) == 1)
+      return lengthBytes(reinterpret_cast<char const*>(string));
+
     size_t length = 0;
 
     while (*string != '\0')
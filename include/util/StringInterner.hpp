@@ -0,0 +1,462 @@
+// StringInterner.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLSTRINGINTERNER_HPP
+#define UTLSTRINGINTERNER_HPP
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Bits.hpp"
+#include "util/Algorithm.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class maps strings to small, dense, and stable 32 bit identifiers. Each unique string is
+   * stored exactly once in an append-only arena and can be retrieved through its identifier for
+   * the lifetime of the interner. Two strings interned in the same object are equal if and only if
+   * their identifiers are.
+   * Interning new strings is serialized internally, lookups (find, string, length) take no locks
+   * at all and may run concurrently with each other and with intern.
+   * @note strings are stored zero terminated, so the pointer returned by string() can be used as a
+   *       C-style string as long as the interned string itself contains no zero character
+   */
+  template<typename CharT>
+  class StringInterner
+  {
+  public:
+    typedef uint32_t Id;
+
+    static Id const INVALID = static_cast<Id>(-1);
+
+    StringInterner();
+    StringInterner(StringInterner const&) = delete;
+
+    ~StringInterner();
+
+    StringInterner& operator =(StringInterner const&) = delete;
+
+    Id intern(CharT const* string, size_t length);
+    Id find(CharT const* string, size_t length) const;
+
+    CharT const* string(Id id) const;
+    size_t length(Id id) const;
+
+    size_t size() const;
+
+  private:
+    /**
+     * Information about an interned string. Entries are never moved once created.
+     */
+    struct Entry
+    {
+      CharT const* string;
+      size_t length;
+      uint32_t hash;
+    };
+
+    /**
+     * The open addressing hash index. Each slot contains the hash of the string in the upper 32
+     * bits and its identifier plus one in the lower 32 bits, zero denotes an empty slot. An index
+     * is never modified after it got replaced by a larger one, it is merely kept around until
+     * destruction in case readers still access it.
+     */
+    struct Index
+    {
+      Index* retired;
+      uint64_t* slots;
+      size_t mask;
+    };
+
+    /**
+     * A block of arena memory, the characters follow the header directly.
+     */
+    struct Chunk
+    {
+      Chunk* next;
+    };
+
+    // the first segment holds 2^SEGMENT_SHIFT entries, each following one twice as much as its
+    // predecessor, so that 32 bit identifiers can be mapped without ever moving an entry
+    static size_t const SEGMENT_SHIFT = 6;
+    static size_t const SEGMENT_COUNT = 32 - SEGMENT_SHIFT + 1;
+
+    static size_t const CHUNK_SIZE = 64 * 1024 / sizeof(CharT);
+    static size_t const INDEX_SIZE = 256;
+
+    Entry* segments_[SEGMENT_COUNT];
+    Index* index_;
+
+    Chunk* chunks_;
+    CharT* current_;
+    CharT* end_;
+
+    Id size_;
+    bool lock_;
+
+    static uint32_t hash(CharT const* string, size_t length);
+    static bool equal(Entry const& entry, CharT const* string, size_t length);
+
+    static Index* createIndex(size_t size);
+    static void destroyIndex(Index* index);
+
+    Entry const* entry(Id id) const;
+    Id lookup(Index const* index, uint32_t hash, CharT const* string, size_t length) const;
+
+    CharT const* store(CharT const* string, size_t length);
+    Entry* allocate(Id id);
+
+    void insert(Index* index, uint32_t hash, Id id);
+    void grow();
+
+    void lock();
+    void unlock();
+  };
+}
+
+
+namespace utl
+{
+  template<typename CharT>
+  typename StringInterner<CharT>::Id const StringInterner<CharT>::INVALID;
+
+
+  /**
+   * The default constructor creates an empty interner.
+   */
+  template<typename CharT>
+  StringInterner<CharT>::StringInterner()
+    : index_(createIndex(INDEX_SIZE)),
+      chunks_(nullptr),
+      current_(nullptr),
+      end_(nullptr),
+      size_(0),
+      lock_(false)
+  {
+    fill(segments_, segments_ + SEGMENT_COUNT, nullptr);
+  }
+
+  /**
+   * The destructor releases all memory, all pointers previously handed out become invalid.
+   */
+  template<typename CharT>
+  StringInterner<CharT>::~StringInterner()
+  {
+    for (Index* index = index_; index != nullptr; )
+    {
+      Index* retired = index->retired;
+      destroyIndex(index);
+      index = retired;
+    }
+
+    for (Chunk* chunk = chunks_; chunk != nullptr; )
+    {
+      Chunk* next = chunk->next;
+      delete[] reinterpret_cast<byte_t*>(chunk);
+      chunk = next;
+    }
+
+    for (size_t i = 0; i < SEGMENT_COUNT; ++i)
+      delete[] segments_[i];
+  }
+
+  /**
+   * @param string string to intern (does not need to be zero terminated)
+   * @param length number of characters in 'string'
+   * @return identifier of the given string, INVALID if the identifier space is exhausted
+   */
+  template<typename CharT>
+  typename StringInterner<CharT>::Id StringInterner<CharT>::intern(CharT const* string,
+                                                                   size_t length)
+  {
+    uint32_t hash = StringInterner::hash(string, length);
+    Id id = lookup(__atomic_load_n(&index_, __ATOMIC_ACQUIRE), hash, string, length);
+
+    if (id != INVALID)
+      return id;
+
+    lock();
+
+    // somebody else might have interned the very same string while we were waiting for the lock,
+    // no need for an acquire here as the lock already orders us after that
+    id = lookup(index_, hash, string, length);
+
+    if (id == INVALID && size_ != INVALID)
+    {
+      id = size_;
+
+      Entry* entry  = allocate(id);
+      entry->string = store(string, length);
+      entry->length = length;
+      entry->hash   = hash;
+
+      // keep the load factor at or below one half
+      if ((static_cast<size_t>(size_) + 1) * 2 > index_->mask + 1)
+        grow();
+
+      insert(index_, hash, id);
+      __atomic_store_n(&size_, size_ + 1, __ATOMIC_RELEASE);
+    }
+
+    unlock();
+    return id;
+  }
+
+  /**
+   * @param string string to look up (does not need to be zero terminated)
+   * @param length number of characters in 'string'
+   * @return identifier of the given string or INVALID if it was never interned
+   */
+  template<typename CharT>
+  typename StringInterner<CharT>::Id StringInterner<CharT>::find(CharT const* string,
+                                                                 size_t length) const
+  {
+    Index const* index = __atomic_load_n(&index_, __ATOMIC_ACQUIRE);
+    return lookup(index, hash(string, length), string, length);
+  }
+
+  /**
+   * @param id identifier as returned by intern()
+   * @return pointer to the interned (and zero terminated) string
+   */
+  template<typename CharT>
+  inline CharT const* StringInterner<CharT>::string(Id id) const
+  {
+    return entry(id)->string;
+  }
+
+  /**
+   * @param id identifier as returned by intern()
+   * @return number of characters in the interned string (excluding the zero terminator)
+   */
+  template<typename CharT>
+  inline size_t StringInterner<CharT>::length(Id id) const
+  {
+    return entry(id)->length;
+  }
+
+  /**
+   * @return number of unique strings interned so far
+   */
+  template<typename CharT>
+  inline size_t StringInterner<CharT>::size() const
+  {
+    return __atomic_load_n(&size_, __ATOMIC_ACQUIRE);
+  }
+
+  /**
+   * This function implements the 32 bit FNV-1a hash.
+   */
+  template<typename CharT>
+  inline uint32_t StringInterner<CharT>::hash(CharT const* string, size_t length)
+  {
+    byte_t const* begin = reinterpret_cast<byte_t const*>(string);
+    byte_t const* end   = reinterpret_cast<byte_t const*>(string + length);
+
+    uint32_t hash = 2166136261u;
+
+    for ( ; begin != end; ++begin)
+    {
+      hash ^= *begin;
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  template<typename CharT>
+  inline bool StringInterner<CharT>::equal(Entry const& entry, CharT const* string, size_t length)
+  {
+    if (entry.length != length)
+      return false;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+      if (entry.string[i] != string[i])
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * @param size number of slots in the index, needs to be a power of two
+   */
+  template<typename CharT>
+  typename StringInterner<CharT>::Index* StringInterner<CharT>::createIndex(size_t size)
+  {
+    Index* index = new Index;
+    index->retired = nullptr;
+    index->slots   = new uint64_t[size]();
+    index->mask    = size - 1;
+    return index;
+  }
+
+  template<typename CharT>
+  void StringInterner<CharT>::destroyIndex(Index* index)
+  {
+    delete[] index->slots;
+    delete index;
+  }
+
+  /**
+   * @param id identifier of an existing entry
+   * @return pointer to the entry with the given identifier
+   */
+  template<typename CharT>
+  inline typename StringInterner<CharT>::Entry const* StringInterner<CharT>::entry(Id id) const
+  {
+    // 'position' is at least 2^SEGMENT_SHIFT and its most significant bit tells the segment
+    uint64_t position = static_cast<uint64_t>(id) + (1 << SEGMENT_SHIFT);
+    size_t   bits     = 63 - countLeadingZeros(position);
+    size_t   segment  = bits - SEGMENT_SHIFT;
+
+    Entry const* entries = __atomic_load_n(&segments_[segment], __ATOMIC_ACQUIRE);
+    return entries + (position - (static_cast<uint64_t>(1) << bits));
+  }
+
+  /**
+   * This method performs the actual lock free lookup of a string in the given index.
+   */
+  template<typename CharT>
+  typename StringInterner<CharT>::Id StringInterner<CharT>::lookup(Index const* index,
+                                                                   uint32_t hash,
+                                                                   CharT const* string,
+                                                                   size_t length) const
+  {
+    for (size_t i = hash & index->mask; ; i = (i + 1) & index->mask)
+    {
+      uint64_t slot = __atomic_load_n(&index->slots[i], __ATOMIC_ACQUIRE);
+
+      if (slot == 0)
+        return INVALID;
+
+      if (static_cast<uint32_t>(slot >> 32) == hash)
+      {
+        Id id = static_cast<Id>(slot) - 1;
+
+        if (equal(*entry(id), string, length))
+          return id;
+      }
+    }
+  }
+
+  /**
+   * This method copies the given string into the arena and zero terminates it.
+   * @return pointer to the copy
+   */
+  template<typename CharT>
+  CharT const* StringInterner<CharT>::store(CharT const* string, size_t length)
+  {
+    if (static_cast<size_t>(end_ - current_) < length + 1)
+    {
+      // strings that exceed the regular chunk size get a chunk of their own
+      size_t count = max(CHUNK_SIZE, length + 1);
+      byte_t* memory = new byte_t[sizeof(Chunk) + count * sizeof(CharT)];
+
+      Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+      chunk->next = chunks_;
+      chunks_ = chunk;
+
+      current_ = reinterpret_cast<CharT*>(memory + sizeof(Chunk));
+      end_     = current_ + count;
+    }
+
+    CharT* result = current_;
+
+    copy(string, string + length, result);
+    result[length] = CharT();
+
+    current_ += length + 1;
+    return result;
+  }
+
+  /**
+   * @param id identifier of the entry to allocate, must be the next unused one
+   * @return pointer to the (uninitialized) entry for 'id'
+   */
+  template<typename CharT>
+  typename StringInterner<CharT>::Entry* StringInterner<CharT>::allocate(Id id)
+  {
+    uint64_t position = static_cast<uint64_t>(id) + (1 << SEGMENT_SHIFT);
+    size_t   bits     = 63 - countLeadingZeros(position);
+    size_t   segment  = bits - SEGMENT_SHIFT;
+    uint64_t offset   = position - (static_cast<uint64_t>(1) << bits);
+
+    if (segments_[segment] == nullptr)
+    {
+      Entry* entries = new Entry[static_cast<size_t>(1) << bits];
+      __atomic_store_n(&segments_[segment], entries, __ATOMIC_RELEASE);
+    }
+    return segments_[segment] + offset;
+  }
+
+  /**
+   * @param index index to insert into, must have at least one free slot
+   * @param hash hash of the string to insert
+   * @param id identifier of the string to insert
+   */
+  template<typename CharT>
+  void StringInterner<CharT>::insert(Index* index, uint32_t hash, Id id)
+  {
+    size_t i = hash & index->mask;
+
+    while (index->slots[i] != 0)
+      i = (i + 1) & index->mask;
+
+    // publishing the slot makes the entry (written before) visible to readers
+    uint64_t slot = (static_cast<uint64_t>(hash) << 32) | (static_cast<uint64_t>(id) + 1);
+    __atomic_store_n(&index->slots[i], slot, __ATOMIC_RELEASE);
+  }
+
+  /**
+   * This method replaces the current index with one twice its size. The old index stays valid
+   * for readers that might still be traversing it.
+   */
+  template<typename CharT>
+  void StringInterner<CharT>::grow()
+  {
+    Index* old   = index_;
+    Index* index = createIndex((old->mask + 1) * 2);
+
+    for (Id id = 0; id < size_; ++id)
+      insert(index, entry(id)->hash, id);
+
+    index->retired = old;
+    __atomic_store_n(&index_, index, __ATOMIC_RELEASE);
+  }
+
+  template<typename CharT>
+  inline void StringInterner<CharT>::lock()
+  {
+    while (__atomic_exchange_n(&lock_, true, __ATOMIC_ACQUIRE))
+    {
+      while (__atomic_load_n(&lock_, __ATOMIC_RELAXED))
+        ;
+    }
+  }
+
+  template<typename CharT>
+  inline void StringInterner<CharT>::unlock()
+  {
+    __atomic_store_n(&lock_, false, __ATOMIC_RELEASE);
+  }
+}
+
+
+#endif
@@ -0,0 +1,79 @@
+// StringLength.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLSTRINGLENGTH_HPP
+#define UTLSTRINGLENGTH_HPP
+
+#include "util/Config.hpp"
+#include "util/Bits.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  size_t lengthBytes(char const* string);
+}
+
+
+namespace utl
+{
+  /**
+   * This function determines the length of a zero terminated string of bytes. It checks 16 bytes
+   * at a time for the terminating zero byte. Loads are aligned, so that they never cross a page
+   * boundary and can safely read beyond the end of the string.
+   * @param string zero terminated string
+   * @return length of the given string (excluding zero termination byte)
+   * @note in contrast to length, this function has no dependencies on the assertion machinery
+   *       and can be used by the lowest level parts of the library (e.g., OutStream)
+   */
+  __attribute__((no_sanitize_address))
+  inline size_t lengthBytes(char const* string)
+  {
+#ifdef UTL_SIMD_SSE2
+    size_t const offset = reinterpret_cast<size_t>(string) % 16;
+
+    __m128i const  zero  = _mm_setzero_si128();
+    __m128i const* block = reinterpret_cast<__m128i const*>(string - offset);
+
+    // bytes in front of the string are masked out of the first block
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero)) >> offset;
+
+    if (mask != 0)
+      return countTrailingZeros(mask);
+
+    for (;;)
+    {
+      mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(++block), zero));
+
+      if (mask != 0)
+        return reinterpret_cast<char const*>(block) - string + countTrailingZeros(mask);
+    }
+#else
+    char const* end = string;
+
+    while (*end != '\0')
+      ++end;
+
+    return end - string;
+#endif
+  }
+}
+
+
+#endif
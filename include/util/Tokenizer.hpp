@@ -0,0 +1,427 @@
+// Tokenizer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLTOKENIZER_HPP
+#define UTLTOKENIZER_HPP
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Bits.hpp"
+#include "util/Algorithm.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class represents a set of delimiter bytes. It classifies blocks of 64 bytes at once into
+   * a bit mask with one bit per byte that is set if the byte is a delimiter.
+   * For up to eight delimiters the classification is vectorized: each delimiter is assigned a bit
+   * and two 16 entry tables, indexed by the low and the high nibble of a byte, contain the bits
+   * of all delimiters with the respective nibble. A byte is a delimiter if the table entries for
+   * its two nibbles share a bit. The lookups are done with a byte shuffle (pshufb), so that 16
+   * (or 32 with AVX2) bytes get classified with a handful of instructions.
+   */
+  class DelimiterSet
+  {
+  public:
+    static size_t const BLOCK_SIZE = 64;
+
+    DelimiterSet(char const* delimiters, size_t count);
+
+    bool contains(byte_t value) const;
+
+    uint64_t classify(byte_t const* block) const;
+    uint64_t classify(byte_t const* begin, byte_t const* end) const;
+
+    byte_t const* find(byte_t const* begin, byte_t const* end) const;
+
+  private:
+    alignas(16) byte_t low_[16];
+    alignas(16) byte_t high_[16];
+
+    bool table_[256];
+    bool vectorized_;
+
+    uint64_t classifyVector(byte_t const* block) const;
+    uint64_t classifyScalar(byte_t const* begin, byte_t const* end) const;
+  };
+
+
+  /**
+   * A token as yielded by the Tokenizer, it references the tokenized data directly.
+   */
+  struct Token
+  {
+    byte_t const* pointer;
+    size_t length;
+  };
+
+
+  /**
+   * This class splits a byte range into tokens separated by single delimiter bytes. The range is
+   * never copied. Tokens are retrieved by iterating over the tokenizer. Just as for the common
+   * 'split' functionality, N delimiters always separate N + 1 (possibly empty) tokens.
+   */
+  class Tokenizer
+  {
+  public:
+    class Iterator
+    {
+    public:
+      Iterator();
+      Iterator(Tokenizer const& tokenizer);
+
+      Token const& operator *() const;
+      Token const* operator ->() const;
+
+      Iterator& operator ++();
+      Iterator operator ++(int);
+
+      bool operator ==(Iterator const& rhs) const;
+      bool operator !=(Iterator const& rhs) const;
+
+    private:
+      Tokenizer const* tokenizer_;
+
+      Token token_;
+
+      // begin of the next token
+      byte_t const* start_;
+      // begin of the block the mask belongs to
+      byte_t const* block_;
+      // delimiters in the current block not yet consumed
+      uint64_t mask_;
+
+      uint64_t classify() const;
+      void next();
+    };
+
+    Tokenizer(byte_t const* begin, byte_t const* end, DelimiterSet const& delimiters);
+    Tokenizer(char const* begin, char const* end, DelimiterSet const& delimiters);
+
+    Iterator begin() const;
+    Iterator end() const;
+
+  private:
+    byte_t const* begin_;
+    byte_t const* end_;
+
+    DelimiterSet const* delimiters_;
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param delimiters array of delimiter characters
+   * @param count number of delimiters in 'delimiters'
+   */
+  inline DelimiterSet::DelimiterSet(char const* delimiters, size_t count)
+    : vectorized_(count <= 8)
+  {
+    fill(low_, low_ + 16, 0);
+    fill(high_, high_ + 16, 0);
+    fill(table_, table_ + 256, false);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      byte_t delimiter = static_cast<byte_t>(delimiters[i]);
+
+      table_[delimiter] = true;
+
+      if (vectorized_)
+      {
+        low_[delimiter & 0x0f] |= static_cast<byte_t>(1 << i);
+        high_[delimiter >> 4]  |= static_cast<byte_t>(1 << i);
+      }
+    }
+  }
+
+  /**
+   * @param value some byte
+   * @return true if the given byte is a delimiter, false if not
+   */
+  inline bool DelimiterSet::contains(byte_t value) const
+  {
+    return table_[value];
+  }
+
+  /**
+   * @param block pointer to BLOCK_SIZE bytes to classify
+   * @return bit mask with bit i set if block[i] is a delimiter
+   */
+  inline uint64_t DelimiterSet::classify(byte_t const* block) const
+  {
+    return vectorized_ ? classifyVector(block) : classifyScalar(block, block + BLOCK_SIZE);
+  }
+
+  /**
+   * @param begin begin of a range of at most BLOCK_SIZE bytes to classify
+   * @param end end of range
+   * @return bit mask with bit i set if begin[i] is a delimiter
+   */
+  inline uint64_t DelimiterSet::classify(byte_t const* begin, byte_t const* end) const
+  {
+    if (static_cast<size_t>(end - begin) == BLOCK_SIZE)
+      return classify(begin);
+
+    return classifyScalar(begin, end);
+  }
+
+  /**
+   * @param begin begin of range to search
+   * @param end end of range to search
+   * @return pointer to the first delimiter in [begin, end), 'end' if there is none
+   */
+  inline byte_t const* DelimiterSet::find(byte_t const* begin, byte_t const* end) const
+  {
+    for ( ; static_cast<size_t>(end - begin) >= BLOCK_SIZE; begin += BLOCK_SIZE)
+    {
+      uint64_t mask = classify(begin);
+
+      if (mask != 0)
+        return begin + countTrailingZeros(mask);
+    }
+
+    uint64_t mask = classifyScalar(begin, end);
+    return mask != 0 ? begin + countTrailingZeros(mask) : end;
+  }
+
+  inline uint64_t DelimiterSet::classifyVector(byte_t const* block) const
+  {
+#if defined(UTL_SIMD_AVX2)
+    __m128i const low128  = _mm_load_si128(reinterpret_cast<__m128i const*>(low_));
+    __m128i const high128 = _mm_load_si128(reinterpret_cast<__m128i const*>(high_));
+
+    __m256i const low  = _mm256_broadcastsi128_si256(low128);
+    __m256i const high = _mm256_broadcastsi128_si256(high128);
+    __m256i const mask = _mm256_set1_epi8(0x0f);
+    __m256i const zero = _mm256_setzero_si256();
+
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < BLOCK_SIZE; i += 32)
+    {
+      __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block + i));
+
+      __m256i low_nibbles  = _mm256_and_si256(input, mask);
+      __m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi16(input, 4), mask);
+
+      __m256i low_bits  = _mm256_shuffle_epi8(low, low_nibbles);
+      __m256i high_bits = _mm256_shuffle_epi8(high, high_nibbles);
+      __m256i none      = _mm256_cmpeq_epi8(_mm256_and_si256(low_bits, high_bits), zero);
+
+      uint32_t bits = ~static_cast<uint32_t>(_mm256_movemask_epi8(none));
+      result |= static_cast<uint64_t>(bits) << i;
+    }
+    return result;
+#elif defined(UTL_SIMD_SSSE3)
+    __m128i const low  = _mm_load_si128(reinterpret_cast<__m128i const*>(low_));
+    __m128i const high = _mm_load_si128(reinterpret_cast<__m128i const*>(high_));
+    __m128i const mask = _mm_set1_epi8(0x0f);
+    __m128i const zero = _mm_setzero_si128();
+
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < BLOCK_SIZE; i += 16)
+    {
+      __m128i input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + i));
+
+      __m128i low_nibbles  = _mm_and_si128(input, mask);
+      __m128i high_nibbles = _mm_and_si128(_mm_srli_epi16(input, 4), mask);
+
+      __m128i low_bits  = _mm_shuffle_epi8(low, low_nibbles);
+      __m128i high_bits = _mm_shuffle_epi8(high, high_nibbles);
+      __m128i none      = _mm_cmpeq_epi8(_mm_and_si128(low_bits, high_bits), zero);
+
+      uint64_t bits = static_cast<uint64_t>(~_mm_movemask_epi8(none) & 0xffff);
+      result |= bits << i;
+    }
+    return result;
+#else
+    return classifyScalar(block, block + BLOCK_SIZE);
+#endif
+  }
+
+  inline uint64_t DelimiterSet::classifyScalar(byte_t const* begin, byte_t const* end) const
+  {
+    uint64_t result = 0;
+
+    for (size_t i = 0; begin + i != end; ++i)
+      result |= static_cast<uint64_t>(table_[begin[i]]) << i;
+
+    return result;
+  }
+
+
+  /**
+   * The default constructor creates an end iterator.
+   */
+  inline Tokenizer::Iterator::Iterator()
+    : tokenizer_(nullptr),
+      token_(),
+      start_(nullptr),
+      block_(nullptr),
+      mask_(0)
+  {
+  }
+
+  /**
+   * @param tokenizer tokenizer to iterate over, the iterator points to its first token
+   */
+  inline Tokenizer::Iterator::Iterator(Tokenizer const& tokenizer)
+    : tokenizer_(&tokenizer),
+      token_(),
+      start_(tokenizer.begin_),
+      block_(tokenizer.begin_),
+      mask_(0)
+  {
+    mask_ = classify();
+    next();
+  }
+
+  inline Token const& Tokenizer::Iterator::operator *() const
+  {
+    return token_;
+  }
+
+  inline Token const* Tokenizer::Iterator::operator ->() const
+  {
+    return &token_;
+  }
+
+  inline Tokenizer::Iterator& Tokenizer::Iterator::operator ++()
+  {
+    next();
+    return *this;
+  }
+
+  inline Tokenizer::Iterator Tokenizer::Iterator::operator ++(int)
+  {
+    Iterator it = *this;
+    next();
+    return it;
+  }
+
+  /**
+   * @note all iterators past the last token compare equal
+   */
+  inline bool Tokenizer::Iterator::operator ==(Iterator const& rhs) const
+  {
+    return tokenizer_ == rhs.tokenizer_ && token_.pointer == rhs.token_.pointer;
+  }
+
+  inline bool Tokenizer::Iterator::operator !=(Iterator const& rhs) const
+  {
+    return !(*this == rhs);
+  }
+
+  /**
+   * @return delimiter mask of the block starting at block_
+   */
+  inline uint64_t Tokenizer::Iterator::classify() const
+  {
+    size_t size = min<size_t>(DelimiterSet::BLOCK_SIZE, tokenizer_->end_ - block_);
+    return tokenizer_->delimiters_->classify(block_, block_ + size);
+  }
+
+  /**
+   * This method advances the iterator to the next token.
+   */
+  inline void Tokenizer::Iterator::next()
+  {
+    // the last token was yielded already, become an end iterator
+    if (start_ == nullptr)
+    {
+      tokenizer_ = nullptr;
+      token_     = Token();
+      return;
+    }
+
+    byte_t const* end = tokenizer_->end_;
+
+    while (mask_ == 0)
+    {
+      if (static_cast<size_t>(end - block_) <= DelimiterSet::BLOCK_SIZE)
+      {
+        // no more delimiters, the remainder of the range forms the last token
+        token_.pointer = start_;
+        token_.length  = end - start_;
+        start_ = nullptr;
+        return;
+      }
+
+      block_ += DelimiterSet::BLOCK_SIZE;
+      mask_   = classify();
+    }
+
+    byte_t const* delimiter = block_ + countTrailingZeros(mask_);
+    mask_ &= mask_ - 1;
+
+    token_.pointer = start_;
+    token_.length  = delimiter - start_;
+    start_ = delimiter + 1;
+  }
+
+
+  /**
+   * @param begin begin of range to tokenize
+   * @param end end of range to tokenize
+   * @param delimiters set of delimiters separating the tokens, it has to outlive the tokenizer
+   */
+  inline Tokenizer::Tokenizer(byte_t const* begin, byte_t const* end,
+                              DelimiterSet const& delimiters)
+    : begin_(begin),
+      end_(end),
+      delimiters_(&delimiters)
+  {
+  }
+
+  /**
+   * @copydoc Tokenizer::Tokenizer(byte_t const*, byte_t const*, DelimiterSet const&)
+   */
+  inline Tokenizer::Tokenizer(char const* begin, char const* end,
+                              DelimiterSet const& delimiters)
+    : begin_(reinterpret_cast<byte_t const*>(begin)),
+      end_(reinterpret_cast<byte_t const*>(end)),
+      delimiters_(&delimiters)
+  {
+  }
+
+  /**
+   * @return iterator pointing to the first token
+   */
+  inline Tokenizer::Iterator Tokenizer::begin() const
+  {
+    return Iterator(*this);
+  }
+
+  /**
+   * @return iterator pointing past the last token
+   */
+  inline Tokenizer::Iterator Tokenizer::end() const
+  {
+    return Iterator();
+  }
+}
+
+
+#endif
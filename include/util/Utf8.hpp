@@ -0,0 +1,393 @@
+// Utf8.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLUTF8_HPP
+#define UTLUTF8_HPP
+
+#include "util/Config.hpp"
+#include "util/Algorithm.hpp"
+#include "util/Simd.hpp"
+
+
+namespace utl
+{
+  bool validateUtf8(byte_t const* begin, byte_t const* end);
+  bool validateUtf8(char const* begin, char const* end);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * The error classes detected by looking at pairs of adjacent bytes. The comments show the
+     * offending byte pairs, '_' denotes an arbitrary bit.
+     */
+    enum : byte_t
+    {
+      TOO_SHORT      = 1 << 0, // 11______ 0_______ or 11______ 11______
+      TOO_LONG       = 1 << 1, // 0_______ 10______
+      OVERLONG_3     = 1 << 2, // 11100000 100_____
+      TOO_LARGE      = 1 << 3, // 11110100 1001____ and all larger leads with 1001____ or 101_____
+      SURROGATE      = 1 << 4, // 11101101 101_____
+      OVERLONG_2     = 1 << 5, // 1100000_ 10______
+      TOO_LARGE_1000 = 1 << 6, // 11110101 1000____ and all larger leads with 1000____
+      OVERLONG_4     = 1 << 6, // 11110000 1000____
+      TWO_CONTS      = 1 << 7, // 10______ 10______
+      CARRY          = TOO_SHORT | TOO_LONG | TWO_CONTS,
+    };
+
+    /**
+     * @return pointer to the three 16 entry lookup tables used for UTF-8 validation: the error
+     *         classes indexed by the high nibble of the first byte of a pair, by the low nibble of
+     *         the first byte, and by the high nibble of the second byte
+     */
+    inline byte_t const* utf8Tables()
+    {
+      alignas(16) static byte_t const tables[48] = {
+        // high nibble of first byte
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+        // low nibble of first byte
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        // high nibble of second byte
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      };
+      return tables;
+    }
+
+    /**
+     * This function validates UTF-8 one code point at a time.
+     * @return true if [begin, end) is valid UTF-8, false otherwise
+     */
+    inline bool validateUtf8Scalar(byte_t const* begin, byte_t const* end)
+    {
+      while (begin != end)
+      {
+        byte_t lead = *begin;
+
+        if (lead < 0x80)
+        {
+          ++begin;
+
+          // skip runs of ASCII characters a word at a time
+          while (end - begin >= 8)
+          {
+            uint64_t word;
+            __builtin_memcpy(&word, begin, sizeof(word));
+
+            if ((word & 0x8080808080808080ull) != 0)
+              break;
+
+            begin += 8;
+          }
+          continue;
+        }
+
+        size_t count;
+
+        // 0x80 to 0xc1 are continuation bytes or overlong two byte sequences, everything from
+        // 0xf5 on would encode code points beyond U+10FFFF
+        if (lead < 0xc2)
+          return false;
+        else if (lead < 0xe0)
+          count = 1;
+        else if (lead < 0xf0)
+          count = 2;
+        else if (lead < 0xf5)
+          count = 3;
+        else
+          return false;
+
+        if (static_cast<size_t>(end - begin) <= count)
+          return false;
+
+        // the range of the first continuation byte catches overlong sequences, surrogates, and
+        // code points that are too large
+        byte_t first = 0x80;
+        byte_t last  = 0xbf;
+
+        if (lead == 0xe0)
+          first = 0xa0;
+        else if (lead == 0xed)
+          last = 0x9f;
+        else if (lead == 0xf0)
+          first = 0x90;
+        else if (lead == 0xf4)
+          last = 0x8f;
+
+        if (begin[1] < first || begin[1] > last)
+          return false;
+
+        for (size_t i = 2; i <= count; ++i)
+        {
+          if ((begin[i] & 0xc0) != 0x80)
+            return false;
+        }
+        begin += count + 1;
+      }
+      return true;
+    }
+
+#if defined(UTL_SIMD_AVX2)
+    /**
+     * This class validates UTF-8 32 bytes at a time using AVX2 instructions.
+     */
+    class Utf8Validator
+    {
+    public:
+      static size_t const BLOCK_SIZE = 32;
+
+      Utf8Validator()
+        : byte1_high_(load(utf8Tables() + 0)),
+          byte1_low_(load(utf8Tables() + 16)),
+          byte2_high_(load(utf8Tables() + 32)),
+          previous_(_mm256_setzero_si256()),
+          incomplete_(_mm256_setzero_si256()),
+          error_(_mm256_setzero_si256())
+      {
+      }
+
+      void check(byte_t const* block)
+      {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block));
+
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+          // an ASCII block is only erroneous if the previous one ended in the middle of a
+          // sequence
+          error_ = _mm256_or_si256(error_, incomplete_);
+        }
+        else
+        {
+          __m256i const nibble = _mm256_set1_epi8(0x0f);
+          __m256i shifted = _mm256_permute2x128_si256(previous_, input, 0x21);
+
+          __m256i previous1 = _mm256_alignr_epi8(input, shifted, 15);
+          __m256i previous2 = _mm256_alignr_epi8(input, shifted, 14);
+          __m256i previous3 = _mm256_alignr_epi8(input, shifted, 13);
+
+          __m256i high1 = _mm256_and_si256(_mm256_srli_epi16(previous1, 4), nibble);
+          __m256i low1  = _mm256_and_si256(previous1, nibble);
+          __m256i high2 = _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble);
+
+          __m256i special = _mm256_and_si256(_mm256_shuffle_epi8(byte1_high_, high1),
+                                             _mm256_shuffle_epi8(byte1_low_, low1));
+          special = _mm256_and_si256(special, _mm256_shuffle_epi8(byte2_high_, high2));
+
+          // third and fourth bytes of a sequence have to be continuation bytes, these are the
+          // only valid cases of two adjacent continuation bytes
+          __m256i third  = _mm256_subs_epu8(previous2, _mm256_set1_epi8(0xe0 - 0x80));
+          __m256i fourth = _mm256_subs_epu8(previous3, _mm256_set1_epi8(0xf0 - 0x80));
+          __m256i must   = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                            _mm256_set1_epi8(static_cast<char>(0x80)));
+
+          error_ = _mm256_or_si256(error_, _mm256_xor_si256(must, special));
+
+          // a block is incomplete if one of its last three bytes starts a sequence that is
+          // longer than the rest of the block
+          __m256i const maximum = _mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+
+          incomplete_ = _mm256_subs_epu8(input, maximum);
+        }
+        previous_ = input;
+      }
+
+      bool valid()
+      {
+        return _mm256_testz_si256(_mm256_or_si256(error_, incomplete_),
+                                  _mm256_or_si256(error_, incomplete_)) != 0;
+      }
+
+    private:
+      __m256i byte1_high_;
+      __m256i byte1_low_;
+      __m256i byte2_high_;
+
+      __m256i previous_;
+      __m256i incomplete_;
+      __m256i error_;
+
+      static __m256i load(byte_t const* table)
+      {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const*>(table)));
+      }
+    };
+#elif defined(UTL_SIMD_SSSE3)
+    /**
+     * This class validates UTF-8 16 bytes at a time using SSSE3 instructions.
+     */
+    class Utf8Validator
+    {
+    public:
+      static size_t const BLOCK_SIZE = 16;
+
+      Utf8Validator()
+        : byte1_high_(load(utf8Tables() + 0)),
+          byte1_low_(load(utf8Tables() + 16)),
+          byte2_high_(load(utf8Tables() + 32)),
+          previous_(_mm_setzero_si128()),
+          incomplete_(_mm_setzero_si128()),
+          error_(_mm_setzero_si128())
+      {
+      }
+
+      void check(byte_t const* block)
+      {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block));
+
+        if (_mm_movemask_epi8(input) == 0)
+        {
+          // an ASCII block is only erroneous if the previous one ended in the middle of a
+          // sequence
+          error_ = _mm_or_si128(error_, incomplete_);
+        }
+        else
+        {
+          __m128i const nibble = _mm_set1_epi8(0x0f);
+
+          __m128i previous1 = _mm_alignr_epi8(input, previous_, 15);
+          __m128i previous2 = _mm_alignr_epi8(input, previous_, 14);
+          __m128i previous3 = _mm_alignr_epi8(input, previous_, 13);
+
+          __m128i high1 = _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble);
+          __m128i low1  = _mm_and_si128(previous1, nibble);
+          __m128i high2 = _mm_and_si128(_mm_srli_epi16(input, 4), nibble);
+
+          __m128i special = _mm_and_si128(_mm_shuffle_epi8(byte1_high_, high1),
+                                          _mm_shuffle_epi8(byte1_low_, low1));
+          special = _mm_and_si128(special, _mm_shuffle_epi8(byte2_high_, high2));
+
+          // third and fourth bytes of a sequence have to be continuation bytes, these are the
+          // only valid cases of two adjacent continuation bytes
+          __m128i third  = _mm_subs_epu8(previous2, _mm_set1_epi8(0xe0 - 0x80));
+          __m128i fourth = _mm_subs_epu8(previous3, _mm_set1_epi8(0xf0 - 0x80));
+          __m128i must   = _mm_and_si128(_mm_or_si128(third, fourth),
+                                         _mm_set1_epi8(static_cast<char>(0x80)));
+
+          error_ = _mm_or_si128(error_, _mm_xor_si128(must, special));
+
+          // a block is incomplete if one of its last three bytes starts a sequence that is
+          // longer than the rest of the block
+          __m128i const maximum = _mm_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+
+          incomplete_ = _mm_subs_epu8(input, maximum);
+        }
+        previous_ = input;
+      }
+
+      bool valid()
+      {
+        __m128i error = _mm_or_si128(error_, incomplete_);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+      }
+
+    private:
+      __m128i byte1_high_;
+      __m128i byte1_low_;
+      __m128i byte2_high_;
+
+      __m128i previous_;
+      __m128i incomplete_;
+      __m128i error_;
+
+      static __m128i load(byte_t const* table)
+      {
+        return _mm_load_si128(reinterpret_cast<__m128i const*>(table));
+      }
+    };
+#endif
+  }
+
+
+  /**
+   * This function checks whether the given range contains valid UTF-8 as specified in RFC 3629,
+   * i.e., it rejects overlong encodings, surrogates, code points beyond U+10FFFF, and truncated
+   * sequences. With SSSE3 or AVX2 available the validation is branch free: every pair of adjacent
+   * bytes is classified by means of three nibble indexed tables (an approach described by Keiser
+   * and Lemire), so that whole blocks get checked at once. Pure ASCII blocks are skipped.
+   * @param begin begin of range to validate
+   * @param end end of range to validate
+   * @return true if the range is valid UTF-8, false otherwise
+   */
+  inline bool validateUtf8(byte_t const* begin, byte_t const* end)
+  {
+#if defined(UTL_SIMD_AVX2) || defined(UTL_SIMD_SSSE3)
+    size_t const size = impl::Utf8Validator::BLOCK_SIZE;
+    impl::Utf8Validator validator;
+
+    for ( ; static_cast<size_t>(end - begin) >= size; begin += size)
+      validator.check(begin);
+
+    if (begin != end)
+    {
+      // the tail is padded with zeros which are valid ASCII characters
+      byte_t block[size] = {};
+
+      copy(begin, end, block);
+      validator.check(block);
+    }
+    return validator.valid();
+#else
+    return impl::validateUtf8Scalar(begin, end);
+#endif
+  }
+
+  /**
+   * @copydoc validateUtf8(byte_t const*, byte_t const*)
+   */
+  inline bool validateUtf8(char const* begin, char const* end)
+  {
+    return validateUtf8(reinterpret_cast<byte_t const*>(begin),
+                        reinterpret_cast<byte_t const*>(end));
+  }
+}
+
+
+#endif
@@ -59,6 +59,19 @@ namespace utl
 
 namespace utl
 {
+  namespace impl
+  {
+    /**
+     * @return true if values of type T can be negative
+     */
+    template<typename T>
+    constexpr bool isSigned()
+    {
+      return static_cast<T>(-1) < static_cast<T>(0);
+    }
+  }
+
+
   /**
    * @param value1 first value
    * @param value2 second value
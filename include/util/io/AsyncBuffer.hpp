@@ -0,0 +1,598 @@
+// AsyncBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLASYNCBUFFER_HPP
+#define UTLASYNCBUFFER_HPP
+
+#include <pthread.h>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * The ways a producer can react to a full AsyncBuffer.
+   */
+  enum Backpressure
+  {
+    BACKPRESSURE_BLOCK,
+    BACKPRESSURE_SPIN,
+    BACKPRESSURE_DROP
+  };
+
+
+  /**
+   * This class implements the StreamBuffer interface by handing all data over to another
+   * StreamBuffer (the sink) on a dedicated consumer thread. The producer formats directly into
+   * a lock-free single-producer/single-consumer byte ring. Data becomes visible to the consumer
+   * when the producer flushes, or once the ring is full. The consumer puts everything into the
+   * sink in as few calls as possible, and flushes the sink whenever it caught up with the
+   * producer. Neither put nor flush ever perform I/O on the producing thread.
+   * If the ring is full, the producer waits for the consumer to make room, either blocking
+   * (BACKPRESSURE_BLOCK) or busy waiting (BACKPRESSURE_SPIN). With BACKPRESSURE_DROP the
+   * message currently being produced, i.e., everything put since the last flush, is dropped
+   * instead and accounted for in the drop counters. Data is only handed over on flush in this
+   * mode, so that the consumer never sees parts of a dropped message. Messages larger than the
+   * ring are always dropped.
+   * The buffer is to be used by a single thread, the sink must not be used by anyone else as
+   * long as the buffer exists. If the consumer thread cannot be started, the sink is written
+   * synchronously on flush instead.
+   */
+  class AsyncBuffer final: public StreamBuffer
+  {
+  public:
+    enum
+    {
+      CAPACITY = 1024 * 1024,
+    };
+
+    AsyncBuffer(StreamBuffer& sink,
+                Backpressure policy = BACKPRESSURE_BLOCK,
+                size_t capacity = CAPACITY);
+    ~AsyncBuffer();
+
+    AsyncBuffer(AsyncBuffer const&) = delete;
+    AsyncBuffer& operator =(AsyncBuffer const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+    void sync();
+
+    Backpressure policy() const;
+
+    size_t droppedMessages() const;
+    size_t droppedBytes() const;
+
+  private:
+    StreamBuffer* sink_;
+    Backpressure policy_;
+
+    byte_t* ring_;
+    size_t capacity_;
+
+    // the producer's part, the region [region_, end_) of the ring starts at position write_
+    byte_t* region_;
+    byte_t* current_;
+    byte_t* end_;
+    uint64_t write_;
+    uint64_t published_;
+    uint64_t head_cache_;
+
+    bool dropping_;
+    size_t dropped_messages_;
+    size_t dropped_bytes_;
+    byte_t discard_[64];
+
+    // the parts shared with the consumer, on cache lines of their own
+    alignas(64) uint64_t tail_;
+    bool producer_waiting_;
+
+    alignas(64) uint64_t head_;
+    uint64_t flushed_;
+    bool consumer_sleeping_;
+
+    alignas(64) bool stop_;
+    bool running_;
+
+    pthread_t thread_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t data_;
+    pthread_cond_t space_;
+
+    void overflow(byte_t element);
+    void nextRegion();
+
+    void publish(uint64_t position);
+    void drop(uint64_t position);
+
+    void waitHead(uint64_t position);
+    void waitFlushed(uint64_t position);
+    void wake(pthread_cond_t& condition, bool const& waiting);
+
+    uint64_t drain(uint64_t head, uint64_t tail);
+
+    static void* run(void* buffer);
+    void work();
+  };
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * This function tells the processor that it is in a busy waiting loop.
+     */
+    inline void relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    }
+  }
+
+
+  /**
+   * @param sink buffer to hand all data over to, it has to outlive the AsyncBuffer object
+   * @param policy way to react to a full ring
+   * @param capacity capacity of the ring, it is rounded up to a power of two
+   */
+  inline AsyncBuffer::AsyncBuffer(StreamBuffer& sink, Backpressure policy, size_t capacity)
+    : StreamBuffer(),
+      sink_(&sink),
+      policy_(policy),
+      ring_(nullptr),
+      capacity_(64),
+      region_(discard_),
+      current_(discard_),
+      end_(discard_),
+      write_(0),
+      published_(0),
+      head_cache_(0),
+      dropping_(false),
+      dropped_messages_(0),
+      dropped_bytes_(0),
+      tail_(0),
+      producer_waiting_(false),
+      head_(0),
+      flushed_(0),
+      consumer_sleeping_(false),
+      stop_(false),
+      running_(false),
+      thread_(),
+      mutex_(),
+      data_(),
+      space_()
+  {
+    while (capacity_ < capacity)
+      capacity_ *= 2;
+
+    ring_ = new byte_t[capacity_];
+
+    pthread_mutex_init(&mutex_, nullptr);
+    pthread_cond_init(&data_, nullptr);
+    pthread_cond_init(&space_, nullptr);
+
+    running_ = pthread_create(&thread_, nullptr, &AsyncBuffer::run, this) == 0;
+  }
+
+  /**
+   * The destructor hands over all data still buffered and waits for the consumer to put it
+   * into the sink and to flush the sink.
+   */
+  inline AsyncBuffer::~AsyncBuffer()
+  {
+    flush();
+
+    if (running_)
+    {
+      pthread_mutex_lock(&mutex_);
+      __atomic_store_n(&stop_, true, __ATOMIC_RELAXED);
+      pthread_cond_signal(&data_);
+      pthread_mutex_unlock(&mutex_);
+
+      pthread_join(thread_, nullptr);
+    }
+
+    pthread_cond_destroy(&space_);
+    pthread_cond_destroy(&data_);
+    pthread_mutex_destroy(&mutex_);
+
+    delete[] ring_;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void AsyncBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void AsyncBuffer::put(byte_t const* elements, size_t size)
+  {
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+
+      if (size == 0)
+        break;
+
+      nextRegion();
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void AsyncBuffer::fill(byte_t element, size_t count)
+  {
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+
+      if (count == 0)
+        break;
+
+      nextRegion();
+    }
+  }
+
+  /**
+   * This method makes all data put so far visible to the consumer, it never blocks. With
+   * BACKPRESSURE_DROP it ends a message, i.e., if the message had to be dropped it is counted
+   * and the next one starts out normally again.
+   */
+  inline void AsyncBuffer::flush()
+  {
+    if (dropping_)
+    {
+      dropped_bytes_ += current_ - discard_;
+      ++dropped_messages_;
+      dropping_ = false;
+
+      // the next put continues at the position last published
+      write_   = published_;
+      region_  = discard_;
+      current_ = discard_;
+      end_     = discard_;
+      return;
+    }
+
+    publish(write_ + (current_ - region_));
+  }
+
+  /**
+   * This method hands over all data put so far and waits until the consumer put it into the
+   * sink and flushed the sink.
+   */
+  inline void AsyncBuffer::sync()
+  {
+    flush();
+
+    if (running_)
+      waitFlushed(published_);
+  }
+
+  /**
+   * @return policy applied if the ring is full
+   */
+  inline Backpressure AsyncBuffer::policy() const
+  {
+    return policy_;
+  }
+
+  /**
+   * @return number of messages dropped because the ring was full
+   */
+  inline size_t AsyncBuffer::droppedMessages() const
+  {
+    return dropped_messages_;
+  }
+
+  /**
+   * @return number of bytes dropped because the ring was full
+   */
+  inline size_t AsyncBuffer::droppedBytes() const
+  {
+    return dropped_bytes_;
+  }
+
+  /**
+   * This method handles a put into an exhausted region.
+   * @param element byte to put into the buffer after switching to the next region
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void AsyncBuffer::overflow(byte_t element)
+  {
+    nextRegion();
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * This method makes the largest contiguous free part of the ring following the data put so
+   * far the region to put data into. If there is no free space, the policy is applied.
+   */
+  inline void AsyncBuffer::nextRegion()
+  {
+    if (dropping_)
+    {
+      dropped_bytes_ += current_ - discard_;
+      current_ = discard_;
+      return;
+    }
+
+    uint64_t position = write_ + (current_ - region_);
+    uint64_t limit = head_cache_ + capacity_;
+
+    while (position == limit)
+    {
+      head_cache_ = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+      limit = head_cache_ + capacity_;
+
+      if (position != limit)
+        break;
+
+      if (policy_ == BACKPRESSURE_DROP)
+      {
+        drop(position);
+        return;
+      }
+
+      // the consumer has to see what we have so far, the message may be larger than the ring
+      publish(position);
+      waitHead(position);
+    }
+
+    size_t offset = static_cast<size_t>(position & (capacity_ - 1));
+    size_t size = static_cast<size_t>(min(static_cast<uint64_t>(capacity_ - offset),
+                                          limit - position));
+    write_   = position;
+    region_  = ring_ + offset;
+    current_ = region_;
+    end_     = region_ + size;
+  }
+
+  /**
+   * This method makes everything up to the given position visible to the consumer and wakes it
+   * up if it is waiting for data.
+   * @param position position up to which the ring contains data
+   */
+  inline void AsyncBuffer::publish(uint64_t position)
+  {
+    if (position == published_)
+      return;
+
+    published_ = position;
+    __atomic_store_n(&tail_, position, __ATOMIC_RELEASE);
+
+    if (!running_)
+    {
+      // there is nobody to do it for us
+      head_ = drain(head_, position);
+      sink_->flush();
+      head_cache_ = head_;
+      return;
+    }
+
+    wake(data_, consumer_sleeping_);
+  }
+
+  /**
+   * This method drops the current message. The data put since the last flush is discarded,
+   * and so is everything put until the next flush.
+   * @param position position up to which data was put into the ring
+   */
+  inline void AsyncBuffer::drop(uint64_t position)
+  {
+    dropped_bytes_ += position - published_;
+    dropping_ = true;
+
+    region_  = discard_;
+    current_ = discard_;
+    end_     = discard_ + sizeof(discard_);
+  }
+
+  /**
+   * This method waits until the consumer took the data in front of the given position, so that
+   * there is room to put more data.
+   * @param position position the ring is filled up to
+   */
+  inline void AsyncBuffer::waitHead(uint64_t position)
+  {
+    if (policy_ == BACKPRESSURE_SPIN)
+    {
+      while (__atomic_load_n(&head_, __ATOMIC_ACQUIRE) + capacity_ <= position)
+        impl::relax();
+
+      return;
+    }
+
+    __atomic_store_n(&producer_waiting_, true, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&mutex_);
+
+    while (__atomic_load_n(&head_, __ATOMIC_ACQUIRE) + capacity_ <= position)
+      pthread_cond_wait(&space_, &mutex_);
+
+    pthread_mutex_unlock(&mutex_);
+
+    __atomic_store_n(&producer_waiting_, false, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * This method waits until the consumer flushed the sink after putting all data up to the
+   * given position into it.
+   * @param position position to wait for
+   */
+  inline void AsyncBuffer::waitFlushed(uint64_t position)
+  {
+    __atomic_store_n(&producer_waiting_, true, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&mutex_);
+
+    while (__atomic_load_n(&flushed_, __ATOMIC_ACQUIRE) < position)
+      pthread_cond_wait(&space_, &mutex_);
+
+    pthread_mutex_unlock(&mutex_);
+
+    __atomic_store_n(&producer_waiting_, false, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * This method wakes up the other side if it announced that it is waiting. The announcement
+   * and the check of the condition waited for are ordered by full fences on both sides, so
+   * that either the waiting side sees the new state or we see its announcement.
+   * @param condition condition variable the other side waits on
+   * @param waiting flag announcing that the other side is waiting
+   */
+  inline void AsyncBuffer::wake(pthread_cond_t& condition, bool const& waiting)
+  {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&waiting, __ATOMIC_RELAXED))
+    {
+      pthread_mutex_lock(&mutex_);
+      pthread_cond_broadcast(&condition);
+      pthread_mutex_unlock(&mutex_);
+    }
+  }
+
+  /**
+   * This method puts the data between the given positions into the sink, in at most two
+   * calls.
+   * @param head position of first byte to put
+   * @param tail position right after the last byte to put
+   * @return 'tail'
+   */
+  inline uint64_t AsyncBuffer::drain(uint64_t head, uint64_t tail)
+  {
+    while (head != tail)
+    {
+      size_t offset = static_cast<size_t>(head & (capacity_ - 1));
+      size_t size = static_cast<size_t>(min(static_cast<uint64_t>(capacity_ - offset),
+                                            tail - head));
+
+      sink_->put(ring_ + offset, size);
+      head += size;
+    }
+    return head;
+  }
+
+  /**
+   * This function is the entry point of the consumer thread.
+   * @param buffer pointer to the AsyncBuffer the thread works for
+   * @return nullptr
+   */
+  inline void* AsyncBuffer::run(void* buffer)
+  {
+    static_cast<AsyncBuffer*>(buffer)->work();
+    return nullptr;
+  }
+
+  /**
+   * This method hands the data published by the producer over to the sink until the buffer
+   * is destroyed.
+   */
+  inline void AsyncBuffer::work()
+  {
+    uint64_t head = 0;
+    uint64_t flushed = 0;
+
+    for (;;)
+    {
+      uint64_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+
+      if (head != tail)
+      {
+        head = drain(head, tail);
+
+        __atomic_store_n(&head_, head, __ATOMIC_RELEASE);
+        wake(space_, producer_waiting_);
+        continue;
+      }
+
+      // we caught up, now is the time to flush the sink
+      if (flushed != head)
+      {
+        sink_->flush();
+        flushed = head;
+
+        __atomic_store_n(&flushed_, flushed, __ATOMIC_RELEASE);
+        wake(space_, producer_waiting_);
+      }
+
+      __atomic_store_n(&consumer_sleeping_, true, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+      pthread_mutex_lock(&mutex_);
+
+      while (__atomic_load_n(&tail_, __ATOMIC_ACQUIRE) == head &&
+             !__atomic_load_n(&stop_, __ATOMIC_RELAXED))
+        pthread_cond_wait(&data_, &mutex_);
+
+      bool stop = __atomic_load_n(&stop_, __ATOMIC_RELAXED) &&
+                  __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) == head;
+
+      pthread_mutex_unlock(&mutex_);
+
+      __atomic_store_n(&consumer_sleeping_, false, __ATOMIC_RELAXED);
+
+      if (stop)
+        break;
+    }
+  }
+}
+
+
+#endif
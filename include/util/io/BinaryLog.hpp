@@ -0,0 +1,716 @@
+// BinaryLog.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLBINARYLOG_HPP
+#define UTLBINARYLOG_HPP
+
+#include "util/Config.hpp"
+#include "util/StringLength.hpp"
+#include "util/Util.hpp"
+#include "util/io/Format.hpp"
+#include "util/io/OutStream.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  template<typename BufferT, typename FormatT, typename ...ArgsT>
+  auto logBinary(BufferT& buffer, FormatT format, ArgsT const& ...args)
+    -> decltype(FormatT::value(), void());
+
+  template<typename BufferT>
+  byte_t const* decodeBinaryRecord(byte_t const* begin,
+                                   byte_t const* end,
+                                   BasicOutStream<BufferT>& stream);
+
+  template<typename BufferT>
+  byte_t const* decodeBinaryLog(byte_t const* begin,
+                                byte_t const* end,
+                                BasicOutStream<BufferT>& stream);
+
+
+  /**
+   * This class implements the StreamBuffer interface by decoding the binary log records put
+   * into it and printing them to an OutStream. Records may arrive in arbitrary pieces, data
+   * belonging to an incomplete record is kept until the rest of it arrives. Used as the sink
+   * of an AsyncBuffer, it moves all formatting to a background thread.
+   * Once a record with an unknown format ID is encountered, all further data is discarded.
+   */
+  class BinaryLogDecoder final: public StreamBuffer
+  {
+  public:
+    explicit BinaryLogDecoder(OutStream& stream);
+    ~BinaryLogDecoder();
+
+    BinaryLogDecoder(BinaryLogDecoder const&) = delete;
+    BinaryLogDecoder& operator =(BinaryLogDecoder const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void flush() override;
+
+    bool good() const;
+
+  private:
+    OutStream* stream_;
+
+    byte_t* pending_;
+    size_t size_;
+    size_t capacity_;
+
+    bool good_;
+  };
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * The types of arguments that can be recorded in binary form.
+     */
+    enum
+    {
+      BINARY_NONE,
+      BINARY_CHAR,
+      BINARY_UCHAR,
+      BINARY_SCHAR,
+      BINARY_USHORT,
+      BINARY_SSHORT,
+      BINARY_UINT,
+      BINARY_SINT,
+      BINARY_ULONG,
+      BINARY_SLONG,
+      BINARY_FLOAT,
+      BINARY_DOUBLE,
+      BINARY_POINTER,
+      BINARY_NULL,
+      BINARY_STRING,
+    };
+
+    /**
+     * This template maps an argument type to its binary type. Strings are recorded as their
+     * length followed by a copy of their contents, everything else as a copy of the value.
+     */
+    template<typename T>
+    struct BinaryType
+    {
+      static_assert(sizeof(T) == 0, "type cannot be recorded in a binary log");
+    };
+
+    template<> struct BinaryType<char>      { enum { value = BINARY_CHAR    }; };
+    template<> struct BinaryType<uchar_t>   { enum { value = BINARY_UCHAR   }; };
+    template<> struct BinaryType<schar_t>   { enum { value = BINARY_SCHAR   }; };
+    template<> struct BinaryType<ushort_t>  { enum { value = BINARY_USHORT  }; };
+    template<> struct BinaryType<sshort_t>  { enum { value = BINARY_SSHORT  }; };
+    template<> struct BinaryType<uint_t>    { enum { value = BINARY_UINT    }; };
+    template<> struct BinaryType<sint_t>    { enum { value = BINARY_SINT    }; };
+    template<> struct BinaryType<ulong_t>   { enum { value = BINARY_ULONG   }; };
+    template<> struct BinaryType<slong_t>   { enum { value = BINARY_SLONG   }; };
+    template<> struct BinaryType<float>     { enum { value = BINARY_FLOAT   }; };
+    template<> struct BinaryType<double>    { enum { value = BINARY_DOUBLE  }; };
+    template<> struct BinaryType<nullptr_t> { enum { value = BINARY_NULL    }; };
+    template<> struct BinaryType<char*>     { enum { value = BINARY_STRING  }; };
+    template<> struct BinaryType<char const*> { enum { value = BINARY_STRING }; };
+
+    template<size_t N> struct BinaryType<char[N]>       { enum { value = BINARY_STRING  }; };
+    template<typename T> struct BinaryType<T*>          { enum { value = BINARY_POINTER }; };
+    template<typename T> struct BinaryType<T const*>    { enum { value = BINARY_POINTER }; };
+
+    /**
+     * @return number of bytes an argument of the given binary type occupies in the fixed part
+     *         of a record, for strings that is the size of their length
+     */
+    constexpr size_t binarySize(uint8_t type)
+    {
+      return type == BINARY_CHAR || type == BINARY_UCHAR || type == BINARY_SCHAR ? 1 :
+             type == BINARY_USHORT || type == BINARY_SSHORT ? sizeof(ushort_t) :
+             type == BINARY_UINT || type == BINARY_SINT ? sizeof(uint_t) :
+             type == BINARY_ULONG || type == BINARY_SLONG ? sizeof(ulong_t) :
+             type == BINARY_FLOAT ? sizeof(float) :
+             type == BINARY_DOUBLE ? sizeof(double) :
+             type == BINARY_POINTER ? sizeof(void const*) :
+             type == BINARY_STRING ? sizeof(uint32_t) : 0;
+    }
+
+    /**
+     * @return true if the given binary type is an integer type
+     */
+    constexpr bool isBinaryInteger(uint8_t type)
+    {
+      return type >= BINARY_UCHAR && type <= BINARY_SLONG;
+    }
+
+    /**
+     * This template provides the binary types of the given argument types as an array that is
+     * usable at compile time. The array is terminated by BINARY_NONE.
+     */
+    template<typename ...ArgsT>
+    struct BinaryTypes
+    {
+      static constexpr uint8_t value[] = {BinaryType<ArgsT>::value..., BINARY_NONE};
+    };
+
+    template<typename ...ArgsT>
+    constexpr uint8_t BinaryTypes<ArgsT...>::value[];
+
+    /**
+     * @return sum of the sizes of the fixed parts of the given binary types
+     */
+    constexpr size_t binarySize(uint8_t const* types, size_t i)
+    {
+      return types[i] == BINARY_NONE ? 0 : binarySize(types[i]) + binarySize(types, i + 1);
+    }
+
+    /**
+     * @return true if all argument slots with a base specifier in the (well formed) format
+     *         string starting at 'i' refer to integer arguments
+     */
+    constexpr bool isValidBinaryFormat(char const* string, size_t i,
+                                       uint8_t const* types, size_t slot)
+    {
+      return string[i] == '\0' ? true :
+             (string[i] == '{' || string[i] == '}') && string[i + 1] == string[i] ?
+               isValidBinaryFormat(string, i + 2, types, slot) :
+             string[i] == '{' ?
+               (string[i + 1] == '}' || isBinaryInteger(types[slot])) &&
+               isValidBinaryFormat(string, i + (string[i + 1] == '}' ? 2 : 3), types, slot + 1) :
+             isValidBinaryFormat(string, i + 1, types, slot);
+    }
+
+
+    /**
+     * The metadata of a format used for binary logging.
+     */
+    struct BinaryFormat
+    {
+      char const* format;
+      uint8_t const* types;
+      size_t size;
+    };
+
+    /**
+     * The registry of all formats used for binary logging, indexed by format ID.
+     */
+    struct BinaryFormats
+    {
+      BinaryFormat* formats;
+      uint32_t count;
+      uint32_t capacity;
+    };
+
+    /**
+     * @return the registry of formats, it is constant initialized and so usable at any time
+     */
+    inline BinaryFormats& binaryFormats()
+    {
+      static BinaryFormats formats = {nullptr, 0, 0};
+      return formats;
+    }
+
+    /**
+     * This function adds a format to the registry. It is invoked during static initialization
+     * only, that is, before any other thread could look up a format.
+     * @return ID of the format
+     */
+    inline uint32_t registerBinaryFormat(char const* format, uint8_t const* types, size_t size)
+    {
+      BinaryFormats& formats = binaryFormats();
+
+      if (formats.count == formats.capacity)
+      {
+        uint32_t capacity = max(2 * formats.capacity, static_cast<uint32_t>(64));
+        BinaryFormat* array = new BinaryFormat[capacity];
+
+        for (uint32_t i = 0; i < formats.count; ++i)
+          array[i] = formats.formats[i];
+
+        delete[] formats.formats;
+        formats.formats  = array;
+        formats.capacity = capacity;
+      }
+
+      formats.formats[formats.count] = BinaryFormat{format, types, size};
+      return formats.count++;
+    }
+
+    /**
+     * This template assigns an ID to each combination of format and argument types. All of the
+     * metadata is known at compile time, the ID itself is assigned during static
+     * initialization, so that looking it up on the hot path is a plain load.
+     */
+    template<typename FormatT, typename ...ArgsT>
+    struct BinaryFormatId
+    {
+      static uint32_t const value;
+    };
+
+    template<typename FormatT, typename ...ArgsT>
+    uint32_t const BinaryFormatId<FormatT, ArgsT...>::value =
+      registerBinaryFormat(FormatT::value(),
+                           BinaryTypes<ArgsT...>::value,
+                           binarySize(BinaryTypes<ArgsT...>::value, 0));
+
+
+    /**
+     * This function copies the value of an argument into a record.
+     * @return pointer right after the copy
+     */
+    template<typename T>
+    inline byte_t* encodeBinary(byte_t* record, T const& value)
+    {
+      __builtin_memcpy(record, &value, sizeof(value));
+      return record + sizeof(value);
+    }
+
+    /**
+     * There is nothing to record about a null pointer besides its type.
+     * @return 'record'
+     */
+    inline byte_t* encodeBinary(byte_t* record, nullptr_t)
+    {
+      return record;
+    }
+
+    /**
+     * This function stores the length of a string argument in a record.
+     * @return pointer right after the length
+     */
+    inline byte_t* encodeBinary(byte_t* record, char const* string)
+    {
+      uint32_t length = static_cast<uint32_t>(lengthBytes(string));
+
+      __builtin_memcpy(record, &length, sizeof(length));
+      return record + sizeof(length);
+    }
+
+    /**
+     * @copydoc encodeBinary(byte_t*, char const*)
+     */
+    inline byte_t* encodeBinary(byte_t* record, char* string)
+    {
+      return encodeBinary(record, static_cast<char const*>(string));
+    }
+
+    /**
+     * These functions copy the fixed parts of all arguments into a record.
+     */
+    inline void encodeBinaryArgs(byte_t*)
+    {
+    }
+
+    template<typename ArgT, typename ...ArgsT>
+    inline void encodeBinaryArgs(byte_t* record, ArgT const& arg, ArgsT const& ...args)
+    {
+      encodeBinaryArgs(encodeBinary(record, arg), args...);
+    }
+
+    /**
+     * This function puts the contents of a string argument, for all other arguments it does
+     * nothing.
+     */
+    template<typename BufferT, typename T>
+    inline void putBinaryString(BufferT&, T const&)
+    {
+    }
+
+    /**
+     * @copydoc putBinaryString
+     */
+    template<typename BufferT>
+    inline void putBinaryString(BufferT& buffer, char const* string)
+    {
+      buffer.put(reinterpret_cast<byte_t const*>(string), lengthBytes(string));
+    }
+
+    /**
+     * @copydoc putBinaryString
+     */
+    template<typename BufferT>
+    inline void putBinaryString(BufferT& buffer, char* string)
+    {
+      putBinaryString(buffer, static_cast<char const*>(string));
+    }
+
+    /**
+     * These functions put the contents of all string arguments, which follow the fixed part
+     * of a record.
+     */
+    template<typename BufferT>
+    inline void putBinaryStrings(BufferT&)
+    {
+    }
+
+    template<typename BufferT, typename ArgT, typename ...ArgsT>
+    inline void putBinaryStrings(BufferT& buffer, ArgT const& arg, ArgsT const& ...args)
+    {
+      putBinaryString(buffer, arg);
+      putBinaryStrings(buffer, args...);
+    }
+
+
+    /**
+     * @return value of type T stored (unaligned) at 'data'
+     */
+    template<typename T>
+    inline T loadBinary(byte_t const* data)
+    {
+      T value;
+      __builtin_memcpy(&value, data, sizeof(value));
+      return value;
+    }
+
+    /**
+     * This function prints an integer argument stored at 'data', in the given base or, for a
+     * base of zero, just like operator << would.
+     */
+    template<typename T, typename BufferT>
+    inline void printBinaryInteger(BasicOutStream<BufferT>& stream, byte_t const* data,
+                                   uint8_t base)
+    {
+      if (base == 0)
+        stream << loadBinary<T>(data);
+      else
+        stream.writeInteger(loadBinary<T>(data), base);
+    }
+
+    /**
+     * This function prints an argument of the given binary type.
+     * @param data fixed part of the argument
+     * @param string contents of a string argument
+     * @param base base selected by the slot's specifier, zero if there is none
+     */
+    template<typename BufferT>
+    inline void printBinary(BasicOutStream<BufferT>& stream,
+                            uint8_t type,
+                            byte_t const* data,
+                            byte_t const* string,
+                            uint8_t base)
+    {
+      switch (type)
+      {
+      case BINARY_CHAR:
+        stream << loadBinary<char>(data);
+        break;
+      case BINARY_UCHAR:
+        printBinaryInteger<uchar_t>(stream, data, base);
+        break;
+      case BINARY_SCHAR:
+        printBinaryInteger<schar_t>(stream, data, base);
+        break;
+      case BINARY_USHORT:
+        printBinaryInteger<ushort_t>(stream, data, base);
+        break;
+      case BINARY_SSHORT:
+        printBinaryInteger<sshort_t>(stream, data, base);
+        break;
+      case BINARY_UINT:
+        printBinaryInteger<uint_t>(stream, data, base);
+        break;
+      case BINARY_SINT:
+        printBinaryInteger<sint_t>(stream, data, base);
+        break;
+      case BINARY_ULONG:
+        printBinaryInteger<ulong_t>(stream, data, base);
+        break;
+      case BINARY_SLONG:
+        printBinaryInteger<slong_t>(stream, data, base);
+        break;
+      case BINARY_FLOAT:
+        stream << loadBinary<float>(data);
+        break;
+      case BINARY_DOUBLE:
+        stream << loadBinary<double>(data);
+        break;
+      case BINARY_POINTER:
+        stream << loadBinary<void const*>(data);
+        break;
+      case BINARY_NULL:
+        stream << nullptr;
+        break;
+      case BINARY_STRING:
+        stream.write(reinterpret_cast<char const*>(string), loadBinary<uint32_t>(data));
+        break;
+      }
+    }
+  }
+
+
+  /**
+   * This function records a log statement in binary form: the ID of the format followed by
+   * copies of the arguments. Formatting is deferred until the record is decoded, see
+   * decodeBinaryRecord. The format string and the types of the arguments are checked at
+   * compile time, exactly as for format. They are registered before main runs, so the cost of
+   * a call is that of copying the arguments (and the contents of string arguments) into the
+   * buffer.
+   * Example:
+   *   utl::logBinary(buffer, UTL_FORMAT("id={} val={x}\n"), id, value);
+   * @param buffer buffer to put the record into
+   * @param format format string as created by UTL_FORMAT
+   * @param args arguments to record; integers, characters, floating point values, pointers,
+   *        and strings are supported
+   * @note records contain values in the machine's native representation, and format IDs are
+   *       only stable for a given executable, so logs have to be decoded by the program that
+   *       wrote them (e.g., on a background thread or by a separate run of it)
+   * @note the function must not be used during static initialization
+   */
+  template<typename BufferT, typename FormatT, typename ...ArgsT>
+  inline auto logBinary(BufferT& buffer, FormatT format, ArgsT const& ...args)
+    -> decltype(FormatT::value(), void())
+  {
+    (void)format;
+
+    typedef impl::BinaryTypes<ArgsT...> Types;
+
+    static_assert(impl::isValidFormat(FormatT::value(), 0),
+                  "malformed format string");
+    static_assert(!impl::isValidFormat(FormatT::value(), 0) ||
+                  impl::countSlots(FormatT::value(), 0) == sizeof...(ArgsT),
+                  "number of arguments does not match the number of slots in format string");
+    static_assert(!impl::isValidFormat(FormatT::value(), 0) ||
+                  impl::countSlots(FormatT::value(), 0) != sizeof...(ArgsT) ||
+                  impl::isValidBinaryFormat(FormatT::value(), 0, Types::value, 0),
+                  "base specifiers can only be used for integers");
+
+    uint32_t id = impl::BinaryFormatId<FormatT, ArgsT...>::value;
+    byte_t record[sizeof(id) + impl::binarySize(Types::value, 0)];
+
+    __builtin_memcpy(record, &id, sizeof(id));
+    impl::encodeBinaryArgs(record + sizeof(id), args...);
+
+    buffer.put(record, sizeof(record));
+    impl::putBinaryStrings(buffer, args...);
+  }
+
+  /**
+   * This function decodes a single binary log record and prints it, formatted just as format
+   * would have done.
+   * @param begin begin of the data to decode
+   * @param end end of the data to decode
+   * @param stream stream to print to
+   * @return pointer right after the record, 'begin' if the data does not contain a complete
+   *         record, or nullptr if the record has an unknown format ID
+   */
+  template<typename BufferT>
+  inline byte_t const* decodeBinaryRecord(byte_t const* begin,
+                                          byte_t const* end,
+                                          BasicOutStream<BufferT>& stream)
+  {
+    if (static_cast<size_t>(end - begin) < sizeof(uint32_t))
+      return begin;
+
+    uint32_t id = impl::loadBinary<uint32_t>(begin);
+    impl::BinaryFormats const& formats = impl::binaryFormats();
+
+    if (id >= formats.count)
+      return nullptr;
+
+    impl::BinaryFormat const& format = formats.formats[id];
+    byte_t const* data = begin + sizeof(id);
+
+    if (static_cast<size_t>(end - data) < format.size)
+      return begin;
+
+    // the contents of strings follow the fixed part
+    byte_t const* strings = data + format.size;
+    byte_t const* field = data;
+    size_t size = 0;
+
+    for (uint8_t const* types = format.types; *types != impl::BINARY_NONE; ++types)
+    {
+      if (*types == impl::BINARY_STRING)
+        size += impl::loadBinary<uint32_t>(field);
+
+      field += impl::binarySize(*types);
+    }
+
+    if (static_cast<size_t>(end - strings) < size)
+      return begin;
+
+    char const* string = format.format;
+    uint8_t const* types = format.types;
+
+    while (*string != '\0')
+    {
+      char const* span = string;
+
+      while (*string != '\0' && *string != '{' && *string != '}')
+        ++string;
+
+      if (string != span)
+        stream.write(span, string - span);
+
+      if (*string == '\0')
+        break;
+
+      // an escaped brace
+      if (string[1] == string[0])
+      {
+        stream.write(string, 1);
+        string += 2;
+        continue;
+      }
+
+      char specifier = string[1];
+      uint8_t base = specifier == '}' ? 0 : impl::specifierBase(specifier);
+
+      impl::printBinary(stream, *types, data, strings, base);
+
+      if (*types == impl::BINARY_STRING)
+        strings += impl::loadBinary<uint32_t>(data);
+
+      data += impl::binarySize(*types);
+      types++;
+      string += specifier == '}' ? 2 : 3;
+    }
+    return strings;
+  }
+
+  /**
+   * This function decodes and prints all complete binary log records in the given data.
+   * @param begin begin of the data to decode
+   * @param end end of the data to decode
+   * @param stream stream to print to
+   * @return pointer right after the last record decoded, or nullptr if a record with an
+   *         unknown format ID was encountered
+   */
+  template<typename BufferT>
+  inline byte_t const* decodeBinaryLog(byte_t const* begin,
+                                       byte_t const* end,
+                                       BasicOutStream<BufferT>& stream)
+  {
+    for (;;)
+    {
+      byte_t const* next = decodeBinaryRecord(begin, end, stream);
+
+      if (next == begin || next == nullptr)
+        return next;
+
+      begin = next;
+    }
+  }
+
+
+  /**
+   * @param stream stream to print the decoded records to, it has to outlive the decoder
+   */
+  inline BinaryLogDecoder::BinaryLogDecoder(OutStream& stream)
+    : StreamBuffer(),
+      stream_(&stream),
+      pending_(nullptr),
+      size_(0),
+      capacity_(0),
+      good_(true)
+  {
+  }
+
+  /**
+   * The destructor flushes the stream. Data of an incomplete record is lost.
+   */
+  inline BinaryLogDecoder::~BinaryLogDecoder()
+  {
+    flush();
+    delete[] pending_;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void BinaryLogDecoder::put(byte_t element)
+  {
+    put(&element, 1);
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void BinaryLogDecoder::put(byte_t const* elements, size_t size)
+  {
+    if (!good_)
+      return;
+
+    byte_t const* end = elements + size;
+
+    if (size_ == 0)
+    {
+      // the common case: decode directly from the data given, keep what is left
+      elements = decodeBinaryLog(elements, end, *stream_);
+
+      if (elements == nullptr)
+      {
+        good_ = false;
+        return;
+      }
+      size = end - elements;
+
+      if (size == 0)
+        return;
+    }
+
+    if (size_ + size > capacity_)
+    {
+      size_t capacity = max(2 * capacity_, size_ + size);
+      byte_t* pending = new byte_t[capacity];
+
+      if (size_ != 0)
+        __builtin_memcpy(pending, pending_, size_);
+
+      delete[] pending_;
+      pending_  = pending;
+      capacity_ = capacity;
+    }
+
+    __builtin_memcpy(pending_ + size_, elements, size);
+    size_ += size;
+
+    byte_t const* next = decodeBinaryLog(pending_, pending_ + size_, *stream_);
+
+    if (next == nullptr)
+    {
+      good_ = false;
+      size_ = 0;
+      return;
+    }
+
+    size_ -= next - pending_;
+    __builtin_memmove(pending_, next, size_);
+  }
+
+  /**
+   * This method flushes the stream the records are printed to.
+   */
+  inline void BinaryLogDecoder::flush()
+  {
+    stream_->flush();
+  }
+
+  /**
+   * @return true if all records could be decoded, false if one with an unknown format ID
+   *         was encountered
+   */
+  inline bool BinaryLogDecoder::good() const
+  {
+    return good_;
+  }
+}
+
+
+#endif
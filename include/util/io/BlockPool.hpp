@@ -0,0 +1,678 @@
+// BlockPool.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLBLOCKPOOL_HPP
+#define UTLBLOCKPOOL_HPP
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "util/Assert.hpp"
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+
+
+namespace utl
+{
+  /**
+   * This structure contains a snapshot of the statistics of a BlockPool.
+   */
+  struct BlockPoolStatistics
+  {
+    // allocations served from the calling thread's cache
+    size_t cache_hits;
+    // allocations served by fetching blocks from the shared depot
+    size_t depot_hits;
+    // allocations that had to go to the system allocator
+    size_t misses;
+    size_t releases;
+
+    // blocks currently allocated from the system, and the maximum thereof
+    size_t blocks;
+    size_t peak_blocks;
+    // blocks held in the depot and blocks given back to the system
+    size_t depot_blocks;
+    size_t trimmed_blocks;
+
+    // memory currently allocated from the system for blocks, in bytes
+    size_t footprint;
+  };
+
+
+  /**
+   * This class hands out memory blocks of a fixed size and recycles the ones released to it,
+   * so that buffers constantly growing and shrinking do not stress the general purpose
+   * allocator. It is safe to use from any number of threads.
+   * The design follows the magazine allocator: each thread caches released blocks in two
+   * magazines of its own, so that the common case of allocating and releasing a block is a
+   * few instructions without any synchronization. Only full and empty magazines are
+   * exchanged with a depot shared by all threads, which is a pair of lock-free stacks. Once
+   * the depot holds more than the trim threshold, surplus blocks are given back to the
+   * system.
+   * Each pool uses a pthread key for its thread caches, so the number of pools existing at a
+   * time is limited. All blocks handed out have to be released to the pool and no thread may
+   * use it anymore once it is destroyed.
+   */
+  class BlockPool
+  {
+  public:
+    enum
+    {
+      BLOCK_SIZE = 16 * 1024,
+      TRIM_THRESHOLD = 4 * 1024 * 1024,
+      MAGAZINE_SIZE = 16,
+    };
+
+    explicit BlockPool(size_t block_size = BLOCK_SIZE, size_t trim_threshold = TRIM_THRESHOLD);
+    ~BlockPool();
+
+    BlockPool(BlockPool const&) = delete;
+    BlockPool& operator =(BlockPool const&) = delete;
+
+    byte_t* allocate();
+    void release(byte_t* block);
+
+    void reserve(size_t count);
+    size_t trim();
+
+    size_t blockSize() const;
+    BlockPoolStatistics statistics() const;
+
+  private:
+    /**
+     * A magazine is a stack of blocks, it is exchanged with the depot as a whole.
+     */
+    struct Magazine
+    {
+      Magazine* next;
+      size_t count;
+      byte_t* blocks[MAGAZINE_SIZE];
+    };
+
+    /**
+     * The cache of a single thread, kept in a list of all caches for the statistics.
+     */
+    struct Cache
+    {
+      BlockPool* pool;
+      Cache* next;
+      Cache* previous;
+
+      Magazine* loaded;
+      Magazine* spare;
+
+      // the counters are written by the owning thread only
+      size_t cache_hits;
+      size_t depot_hits;
+      size_t misses;
+      size_t releases;
+    };
+
+    size_t block_size_;
+    size_t trim_blocks_;
+
+    pthread_key_t key_;
+    bool keyed_;
+
+    // the depot, stacks of full and empty magazines with a tag against ABA in the upper bits
+    alignas(64) uint64_t full_;
+    alignas(64) uint64_t empty_;
+    size_t depot_blocks_;
+
+    alignas(64) size_t blocks_;
+    size_t peak_blocks_;
+    size_t trimmed_blocks_;
+    // misses of threads without a cache of their own
+    size_t uncached_misses_;
+
+    // the list of thread caches and the counters of threads that exited already
+    mutable pthread_mutex_t mutex_;
+    Cache* caches_;
+    BlockPoolStatistics retired_;
+
+    Cache* cache();
+    Cache* createCache();
+    static void destroyCache(void* cache);
+    void retire(Cache* cache);
+
+    byte_t* allocateSlow(Cache* cache);
+    void releaseSlow(Cache* cache, byte_t* block);
+
+    byte_t* allocateSystem();
+    void releaseSystem(byte_t* block);
+
+    Magazine* newMagazine();
+    void deposit(Magazine* magazine);
+    void freeBlocks(Magazine* magazine);
+
+    static void push(uint64_t& stack, Magazine* magazine);
+    static Magazine* pop(uint64_t& stack);
+
+    static void increment(size_t& counter);
+  };
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    uint64_t const BLOCKPOOL_POINTER_MASK = (static_cast<uint64_t>(1) << 48) - 1;
+    uint64_t const BLOCKPOOL_TAG = static_cast<uint64_t>(1) << 48;
+  }
+
+
+  /**
+   * @param block_size size of the blocks handed out
+   * @param trim_threshold number of bytes the depot may hold before blocks are given back to
+   *        the system
+   */
+  inline BlockPool::BlockPool(size_t block_size, size_t trim_threshold)
+    : block_size_(max(block_size, sizeof(void*))),
+      trim_blocks_(max(trim_threshold / block_size_, static_cast<size_t>(MAGAZINE_SIZE))),
+      key_(),
+      keyed_(pthread_key_create(&key_, &destroyCache) == 0),
+      full_(0),
+      empty_(0),
+      depot_blocks_(0),
+      blocks_(0),
+      peak_blocks_(0),
+      trimmed_blocks_(0),
+      uncached_misses_(0),
+      mutex_(),
+      caches_(nullptr),
+      retired_()
+  {
+    pthread_mutex_init(&mutex_, nullptr);
+  }
+
+  /**
+   * The destructor frees all blocks cached by the pool, in the depot as well as in the caches
+   * of all threads.
+   */
+  inline BlockPool::~BlockPool()
+  {
+    // the caches of threads exiting later on are not destroyed through the key anymore
+    if (keyed_)
+      pthread_key_delete(key_);
+
+    while (caches_ != nullptr)
+    {
+      Cache* cache = caches_;
+      caches_ = cache->next;
+
+      freeBlocks(cache->loaded);
+      freeBlocks(cache->spare);
+
+      delete cache->loaded;
+      delete cache->spare;
+      delete cache;
+    }
+
+    for (Magazine* magazine = pop(full_); magazine != nullptr; magazine = pop(full_))
+    {
+      freeBlocks(magazine);
+      delete magazine;
+    }
+
+    for (Magazine* magazine = pop(empty_); magazine != nullptr; magazine = pop(empty_))
+      delete magazine;
+
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  /**
+   * @return a block of blockSize() bytes, a recycled one if available
+   */
+  inline byte_t* BlockPool::allocate()
+  {
+    Cache* cache = keyed_ ? static_cast<Cache*>(pthread_getspecific(key_)) : nullptr;
+
+    if (__builtin_expect(cache != nullptr && cache->loaded->count > 0, 1))
+    {
+      increment(cache->cache_hits);
+      return cache->loaded->blocks[--cache->loaded->count];
+    }
+    return allocateSlow(cache);
+  }
+
+  /**
+   * @param block block previously handed out by this pool, possibly to another thread
+   */
+  inline void BlockPool::release(byte_t* block)
+  {
+    Cache* cache = keyed_ ? static_cast<Cache*>(pthread_getspecific(key_)) : nullptr;
+
+    if (__builtin_expect(cache != nullptr && cache->loaded->count < MAGAZINE_SIZE, 1))
+    {
+      increment(cache->releases);
+      cache->loaded->blocks[cache->loaded->count++] = block;
+      return;
+    }
+    releaseSlow(cache, block);
+  }
+
+  /**
+   * This method allocates blocks up front and puts them into the depot, so that later
+   * allocations do not have to go to the system. Reserving more than the trim threshold
+   * permits is pointless, the surplus is given back as soon as blocks get released.
+   * @param count number of blocks to allocate
+   */
+  inline void BlockPool::reserve(size_t count)
+  {
+    while (count > 0)
+    {
+      Magazine* magazine = newMagazine();
+
+      while (magazine->count < MAGAZINE_SIZE && count > 0)
+      {
+        magazine->blocks[magazine->count++] = allocateSystem();
+        --count;
+      }
+
+      __atomic_add_fetch(&depot_blocks_, magazine->count, __ATOMIC_RELAXED);
+      push(full_, magazine);
+    }
+  }
+
+  /**
+   * This method gives all blocks in the depot back to the system. Blocks cached by threads
+   * are not affected.
+   * @return number of blocks given back
+   */
+  inline size_t BlockPool::trim()
+  {
+    size_t trimmed = 0;
+
+    for (Magazine* magazine = pop(full_); magazine != nullptr; magazine = pop(full_))
+    {
+      __atomic_sub_fetch(&depot_blocks_, magazine->count, __ATOMIC_RELAXED);
+
+      trimmed += magazine->count;
+      freeBlocks(magazine);
+      push(empty_, magazine);
+    }
+    return trimmed;
+  }
+
+  /**
+   * @return size of the blocks handed out
+   */
+  inline size_t BlockPool::blockSize() const
+  {
+    return block_size_;
+  }
+
+  /**
+   * @return the statistics of the pool, the counters of threads still running may be
+   *         slightly out of date
+   */
+  inline BlockPoolStatistics BlockPool::statistics() const
+  {
+    pthread_mutex_lock(&mutex_);
+
+    BlockPoolStatistics statistics = retired_;
+
+    for (Cache* cache = caches_; cache != nullptr; cache = cache->next)
+    {
+      statistics.cache_hits += __atomic_load_n(&cache->cache_hits, __ATOMIC_RELAXED);
+      statistics.depot_hits += __atomic_load_n(&cache->depot_hits, __ATOMIC_RELAXED);
+      statistics.misses     += __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+      statistics.releases   += __atomic_load_n(&cache->releases, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&mutex_);
+
+    statistics.misses        += __atomic_load_n(&uncached_misses_, __ATOMIC_RELAXED);
+    statistics.blocks         = __atomic_load_n(&blocks_, __ATOMIC_RELAXED);
+    statistics.peak_blocks    = __atomic_load_n(&peak_blocks_, __ATOMIC_RELAXED);
+    statistics.depot_blocks   = __atomic_load_n(&depot_blocks_, __ATOMIC_RELAXED);
+    statistics.trimmed_blocks = __atomic_load_n(&trimmed_blocks_, __ATOMIC_RELAXED);
+    statistics.footprint      = statistics.blocks * block_size_;
+    return statistics;
+  }
+
+  /**
+   * @return the cache of the calling thread, nullptr if none could be set up
+   */
+  inline BlockPool::Cache* BlockPool::cache()
+  {
+    if (!keyed_)
+      return nullptr;
+
+    Cache* cache = static_cast<Cache*>(pthread_getspecific(key_));
+    return cache != nullptr ? cache : createCache();
+  }
+
+  /**
+   * @return a new cache for the calling thread, nullptr if it could not be registered
+   */
+  inline BlockPool::Cache* BlockPool::createCache()
+  {
+    Cache* cache = new Cache();
+
+    cache->pool   = this;
+    cache->loaded = newMagazine();
+    cache->spare  = newMagazine();
+
+    if (pthread_setspecific(key_, cache) != 0)
+    {
+      push(empty_, cache->loaded);
+      push(empty_, cache->spare);
+      delete cache;
+      return nullptr;
+    }
+
+    pthread_mutex_lock(&mutex_);
+
+    cache->next = caches_;
+    if (caches_ != nullptr)
+      caches_->previous = cache;
+    caches_ = cache;
+
+    pthread_mutex_unlock(&mutex_);
+    return cache;
+  }
+
+  /**
+   * This function is invoked for the cache of each exiting thread.
+   * @param cache cache of the exiting thread
+   */
+  inline void BlockPool::destroyCache(void* cache)
+  {
+    Cache* thread_cache = static_cast<Cache*>(cache);
+    thread_cache->pool->retire(thread_cache);
+  }
+
+  /**
+   * This method hands the blocks of a cache over to the depot and destroys it.
+   * @param cache cache of a thread that exited
+   */
+  inline void BlockPool::retire(Cache* cache)
+  {
+    pthread_mutex_lock(&mutex_);
+
+    if (cache->previous != nullptr)
+      cache->previous->next = cache->next;
+    else
+      caches_ = cache->next;
+
+    if (cache->next != nullptr)
+      cache->next->previous = cache->previous;
+
+    retired_.cache_hits += cache->cache_hits;
+    retired_.depot_hits += cache->depot_hits;
+    retired_.misses     += cache->misses;
+    retired_.releases   += cache->releases;
+
+    pthread_mutex_unlock(&mutex_);
+
+    deposit(cache->loaded);
+    deposit(cache->spare);
+    delete cache;
+  }
+
+  /**
+   * This method handles an allocation the loaded magazine cannot serve.
+   * @param cache cache of the calling thread, nullptr if it has none yet
+   * @return a block of blockSize() bytes
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline byte_t* BlockPool::allocateSlow(Cache* cache)
+  {
+    if (cache == nullptr)
+    {
+      cache = this->cache();
+
+      // without a cache of our own, all blocks come from the system
+      if (cache == nullptr)
+      {
+        __atomic_add_fetch(&uncached_misses_, 1, __ATOMIC_RELAXED);
+        return allocateSystem();
+      }
+
+      if (cache->loaded->count > 0)
+      {
+        increment(cache->cache_hits);
+        return cache->loaded->blocks[--cache->loaded->count];
+      }
+    }
+
+    Magazine* magazine = cache->loaded;
+
+    if (cache->spare->count > 0)
+    {
+      cache->loaded = cache->spare;
+      cache->spare  = magazine;
+
+      increment(cache->cache_hits);
+      return cache->loaded->blocks[--cache->loaded->count];
+    }
+
+    Magazine* full = pop(full_);
+
+    if (full != nullptr)
+    {
+      __atomic_sub_fetch(&depot_blocks_, full->count, __ATOMIC_RELAXED);
+
+      // both magazines are empty, give one of them back
+      push(empty_, cache->spare);
+      cache->spare  = magazine;
+      cache->loaded = full;
+
+      increment(cache->depot_hits);
+      return cache->loaded->blocks[--cache->loaded->count];
+    }
+
+    increment(cache->misses);
+    return allocateSystem();
+  }
+
+  /**
+   * This method handles a release the loaded magazine cannot take anymore.
+   * @param cache cache of the calling thread, nullptr if it has none yet
+   * @param block block to release
+   */
+  __attribute__((noinline))
+  inline void BlockPool::releaseSlow(Cache* cache, byte_t* block)
+  {
+    if (cache == nullptr)
+    {
+      cache = this->cache();
+
+      if (cache == nullptr)
+      {
+        releaseSystem(block);
+        return;
+      }
+    }
+
+    increment(cache->releases);
+
+    if (cache->loaded->count < MAGAZINE_SIZE)
+    {
+      cache->loaded->blocks[cache->loaded->count++] = block;
+      return;
+    }
+
+    Magazine* magazine = cache->loaded;
+
+    if (cache->spare->count < MAGAZINE_SIZE)
+    {
+      cache->loaded = cache->spare;
+      cache->spare  = magazine;
+    }
+    else
+    {
+      // both magazines are full, hand one of them to the depot
+      Magazine* empty = pop(empty_);
+
+      deposit(cache->spare);
+      cache->spare  = magazine;
+      cache->loaded = empty != nullptr ? empty : newMagazine();
+    }
+
+    cache->loaded->blocks[cache->loaded->count++] = block;
+  }
+
+  /**
+   * @return a block newly allocated from the system
+   */
+  inline byte_t* BlockPool::allocateSystem()
+  {
+    byte_t* block = new byte_t[block_size_];
+
+    size_t blocks = __atomic_add_fetch(&blocks_, 1, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&peak_blocks_, __ATOMIC_RELAXED);
+
+    while (blocks > peak &&
+           !__atomic_compare_exchange_n(&peak_blocks_, &peak, blocks, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    return block;
+  }
+
+  /**
+   * @param block block to give back to the system
+   */
+  inline void BlockPool::releaseSystem(byte_t* block)
+  {
+    __atomic_sub_fetch(&blocks_, 1, __ATOMIC_RELAXED);
+    delete[] block;
+  }
+
+  /**
+   * @return an empty magazine, a recycled one if available
+   */
+  inline BlockPool::Magazine* BlockPool::newMagazine()
+  {
+    Magazine* magazine = pop(empty_);
+
+    if (magazine == nullptr)
+    {
+      magazine = new Magazine;
+      magazine->next = nullptr;
+    }
+
+    magazine->count = 0;
+    return magazine;
+  }
+
+  /**
+   * This method puts a magazine into the depot. If the depot grows beyond the trim threshold
+   * the magazine's blocks are given back to the system instead.
+   * @param magazine magazine to put into the depot, full, empty, or anything in between
+   */
+  inline void BlockPool::deposit(Magazine* magazine)
+  {
+    if (magazine->count == 0)
+    {
+      push(empty_, magazine);
+      return;
+    }
+
+    size_t blocks = __atomic_load_n(&depot_blocks_, __ATOMIC_RELAXED);
+
+    if (blocks + magazine->count > trim_blocks_)
+    {
+      __atomic_add_fetch(&trimmed_blocks_, magazine->count, __ATOMIC_RELAXED);
+
+      freeBlocks(magazine);
+      push(empty_, magazine);
+      return;
+    }
+
+    __atomic_add_fetch(&depot_blocks_, magazine->count, __ATOMIC_RELAXED);
+    push(full_, magazine);
+  }
+
+  /**
+   * @param magazine magazine whose blocks to give back to the system, it is empty afterwards
+   */
+  inline void BlockPool::freeBlocks(Magazine* magazine)
+  {
+    for (size_t i = 0; i < magazine->count; ++i)
+      releaseSystem(magazine->blocks[i]);
+
+    magazine->count = 0;
+  }
+
+  /**
+   * @param stack stack to push the magazine onto
+   * @param magazine magazine to push
+   */
+  inline void BlockPool::push(uint64_t& stack, Magazine* magazine)
+  {
+    uint64_t pointer = reinterpret_cast<uintptr_t>(magazine);
+    uint64_t head = __atomic_load_n(&stack, __ATOMIC_RELAXED);
+    uint64_t next;
+
+    ASSERTOP(pointer & ~impl::BLOCKPOOL_POINTER_MASK, eq, 0);
+
+    do
+    {
+      Magazine* top = reinterpret_cast<Magazine*>(head & impl::BLOCKPOOL_POINTER_MASK);
+      __atomic_store_n(&magazine->next, top, __ATOMIC_RELAXED);
+
+      next = pointer | ((head & ~impl::BLOCKPOOL_POINTER_MASK) + impl::BLOCKPOOL_TAG);
+    }
+    while (!__atomic_compare_exchange_n(&stack, &head, next, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  }
+
+  /**
+   * Magazines are never freed while the pool exists, so reading the link of a magazine that
+   * got popped concurrently is harmless; the tag makes the exchange fail in that case.
+   * @param stack stack to pop a magazine from
+   * @return the magazine at the top of the stack, nullptr if it is empty
+   */
+  inline BlockPool::Magazine* BlockPool::pop(uint64_t& stack)
+  {
+    uint64_t head = __atomic_load_n(&stack, __ATOMIC_ACQUIRE);
+
+    for (;;)
+    {
+      Magazine* top = reinterpret_cast<Magazine*>(head & impl::BLOCKPOOL_POINTER_MASK);
+
+      if (top == nullptr)
+        return nullptr;
+
+      uint64_t pointer = reinterpret_cast<uintptr_t>(__atomic_load_n(&top->next,
+                                                                     __ATOMIC_RELAXED));
+      uint64_t next = pointer | ((head & ~impl::BLOCKPOOL_POINTER_MASK) + impl::BLOCKPOOL_TAG);
+
+      if (__atomic_compare_exchange_n(&stack, &head, next, true,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+        return top;
+    }
+  }
+
+  /**
+   * @param counter counter written by the calling thread only, but read by others
+   */
+  inline void BlockPool::increment(size_t& counter)
+  {
+    __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  }
+}
+
+
+#endif
@@ -0,0 +1,614 @@
+// ByteSlice.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLBYTESLICE_HPP
+#define UTLBYTESLICE_HPP
+
+#include <sys/uio.h>
+
+#include "util/Assert.hpp"
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/BlockPool.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * The header at the start of a reference counted block, the block's data follows it.
+     */
+    struct SliceBlock
+    {
+      BlockPool* pool;
+      size_t references;
+    };
+
+    SliceBlock* createSliceBlock(BlockPool& pool);
+    void referenceSliceBlock(SliceBlock* block);
+    void releaseSliceBlock(SliceBlock* block);
+  }
+
+
+  /**
+   * This class is a read-only view of a range of bytes in a reference counted block taken
+   * from a BlockPool. Copies and subslices share the block, no data is copied; the block is
+   * released to its pool once the last slice referring to it is gone. Slices may be copied
+   * and destroyed concurrently by different threads.
+   */
+  class ByteSlice
+  {
+  public:
+    ByteSlice();
+    ByteSlice(impl::SliceBlock* block, byte_t const* data, size_t size);
+    ByteSlice(ByteSlice const& other);
+    ByteSlice(ByteSlice&& other);
+    ~ByteSlice();
+
+    ByteSlice& operator =(ByteSlice const& other);
+    ByteSlice& operator =(ByteSlice&& other);
+
+    void swap(ByteSlice& other);
+
+    byte_t const* data() const;
+    size_t size() const;
+    bool empty() const;
+
+    byte_t const* begin() const;
+    byte_t const* end() const;
+
+    ByteSlice subslice(size_t offset, size_t size) const;
+
+    void writeTo(StreamBuffer& buffer) const;
+
+  private:
+    friend class ByteRope;
+
+    impl::SliceBlock* block_;
+    byte_t const* data_;
+    size_t size_;
+  };
+
+
+  /**
+   * This class is a sequence of slices that is treated as one range of bytes. Concatenating
+   * ropes or slices only adds references to the blocks involved, no data is copied.
+   */
+  class ByteRope
+  {
+  public:
+    ByteRope();
+    ByteRope(ByteSlice const& slice);
+    ByteRope(ByteRope const& other);
+    ByteRope(ByteRope&& other);
+    ~ByteRope();
+
+    ByteRope& operator =(ByteRope const& other);
+    ByteRope& operator =(ByteRope&& other);
+
+    void swap(ByteRope& other);
+
+    void append(ByteSlice const& slice);
+    void append(ByteRope const& rope);
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+
+    size_t slices() const;
+    ByteSlice const& operator [](size_t index) const;
+
+    ByteRope subrope(size_t offset, size_t size) const;
+
+    size_t exportVector(iovec* vector, size_t count) const;
+    void writeTo(StreamBuffer& buffer) const;
+
+  private:
+    ByteSlice* slices_;
+    size_t count_;
+    size_t capacity_;
+    size_t size_;
+
+    void grow();
+  };
+
+
+  ByteRope concat(ByteRope const& first, ByteRope const& second);
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * @param pool pool to take the block from
+     * @return a new block with a single reference
+     */
+    inline SliceBlock* createSliceBlock(BlockPool& pool)
+    {
+      ASSERT(pool.blockSize() > sizeof(SliceBlock));
+
+      SliceBlock* block = reinterpret_cast<SliceBlock*>(pool.allocate());
+
+      block->pool = &pool;
+      block->references = 1;
+      return block;
+    }
+
+    /**
+     * @param block block to add a reference to
+     */
+    inline void referenceSliceBlock(SliceBlock* block)
+    {
+      __atomic_add_fetch(&block->references, 1, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @param block block to drop a reference from, it is released to its pool with the last
+     */
+    inline void releaseSliceBlock(SliceBlock* block)
+    {
+      if (__atomic_sub_fetch(&block->references, 1, __ATOMIC_ACQ_REL) == 0)
+        block->pool->release(reinterpret_cast<byte_t*>(block));
+    }
+  }
+
+
+  /**
+   * The default constructor creates an empty slice.
+   */
+  inline ByteSlice::ByteSlice()
+    : block_(nullptr),
+      data_(nullptr),
+      size_(0)
+  {
+  }
+
+  /**
+   * @param block block the data is in, the slice takes over one reference to it
+   * @param data pointer to the first byte of the slice
+   * @param size number of bytes in the slice
+   */
+  inline ByteSlice::ByteSlice(impl::SliceBlock* block, byte_t const* data, size_t size)
+    : block_(block),
+      data_(data),
+      size_(size)
+  {
+  }
+
+  /**
+   * @param other slice to share the block of
+   */
+  inline ByteSlice::ByteSlice(ByteSlice const& other)
+    : block_(other.block_),
+      data_(other.data_),
+      size_(other.size_)
+  {
+    if (block_ != nullptr)
+      impl::referenceSliceBlock(block_);
+  }
+
+  /**
+   * @param other slice to take over the reference of, it is empty afterwards
+   */
+  inline ByteSlice::ByteSlice(ByteSlice&& other)
+    : block_(other.block_),
+      data_(other.data_),
+      size_(other.size_)
+  {
+    other.block_ = nullptr;
+    other.data_  = nullptr;
+    other.size_  = 0;
+  }
+
+  /**
+   * The destructor drops the reference to the block.
+   */
+  inline ByteSlice::~ByteSlice()
+  {
+    if (block_ != nullptr)
+      impl::releaseSliceBlock(block_);
+  }
+
+  /**
+   * @param other slice to share the block of
+   * @return this slice
+   */
+  inline ByteSlice& ByteSlice::operator =(ByteSlice const& other)
+  {
+    ByteSlice copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  /**
+   * @param other slice to take over the reference of
+   * @return this slice
+   */
+  inline ByteSlice& ByteSlice::operator =(ByteSlice&& other)
+  {
+    swap(other);
+    return *this;
+  }
+
+  /**
+   * @param other slice to exchange the contents with
+   */
+  inline void ByteSlice::swap(ByteSlice& other)
+  {
+    impl::SliceBlock* block = block_;
+    byte_t const* data = data_;
+    size_t size = size_;
+
+    block_ = other.block_;
+    data_  = other.data_;
+    size_  = other.size_;
+
+    other.block_ = block;
+    other.data_  = data;
+    other.size_  = size;
+  }
+
+  /**
+   * @return pointer to the first byte of the slice
+   */
+  inline byte_t const* ByteSlice::data() const
+  {
+    return data_;
+  }
+
+  /**
+   * @return number of bytes in the slice
+   */
+  inline size_t ByteSlice::size() const
+  {
+    return size_;
+  }
+
+  /**
+   * @return true if the slice contains no data, false otherwise
+   */
+  inline bool ByteSlice::empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * @return pointer to the first byte of the slice
+   */
+  inline byte_t const* ByteSlice::begin() const
+  {
+    return data_;
+  }
+
+  /**
+   * @return pointer past the last byte of the slice
+   */
+  inline byte_t const* ByteSlice::end() const
+  {
+    return data_ + size_;
+  }
+
+  /**
+   * @param offset offset of the subslice within this slice, at most size()
+   * @param size maximum number of bytes in the subslice
+   * @return slice of the given part of this slice, sharing the block
+   */
+  inline ByteSlice ByteSlice::subslice(size_t offset, size_t size) const
+  {
+    ASSERT(offset <= size_);
+
+    size = min(size, size_ - offset);
+
+    if (size == 0)
+      return ByteSlice();
+
+    impl::referenceSliceBlock(block_);
+    return ByteSlice(block_, data_ + offset, size);
+  }
+
+  /**
+   * @param buffer buffer to put the contents of the slice into
+   */
+  inline void ByteSlice::writeTo(StreamBuffer& buffer) const
+  {
+    buffer.put(data_, size_);
+  }
+
+
+  /**
+   * The default constructor creates an empty rope.
+   */
+  inline ByteRope::ByteRope()
+    : slices_(nullptr),
+      count_(0),
+      capacity_(0),
+      size_(0)
+  {
+  }
+
+  /**
+   * @param slice slice the rope consists of
+   */
+  inline ByteRope::ByteRope(ByteSlice const& slice)
+    : ByteRope()
+  {
+    append(slice);
+  }
+
+  /**
+   * @param other rope to share the slices of
+   */
+  inline ByteRope::ByteRope(ByteRope const& other)
+    : ByteRope()
+  {
+    append(other);
+  }
+
+  /**
+   * @param other rope to take over the slices of, it is empty afterwards
+   */
+  inline ByteRope::ByteRope(ByteRope&& other)
+    : ByteRope()
+  {
+    swap(other);
+  }
+
+  /**
+   * The destructor drops the references to all blocks.
+   */
+  inline ByteRope::~ByteRope()
+  {
+    delete[] slices_;
+  }
+
+  /**
+   * @param other rope to share the slices of
+   * @return this rope
+   */
+  inline ByteRope& ByteRope::operator =(ByteRope const& other)
+  {
+    ByteRope copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  /**
+   * @param other rope to take over the slices of
+   * @return this rope
+   */
+  inline ByteRope& ByteRope::operator =(ByteRope&& other)
+  {
+    swap(other);
+    return *this;
+  }
+
+  /**
+   * @param other rope to exchange the contents with
+   */
+  inline void ByteRope::swap(ByteRope& other)
+  {
+    ByteSlice* slices = slices_;
+    size_t count = count_;
+    size_t capacity = capacity_;
+    size_t size = size_;
+
+    slices_   = other.slices_;
+    count_    = other.count_;
+    capacity_ = other.capacity_;
+    size_     = other.size_;
+
+    other.slices_   = slices;
+    other.count_    = count;
+    other.capacity_ = capacity;
+    other.size_     = size;
+  }
+
+  /**
+   * This method appends a slice to the rope. If it directly follows the last slice in the
+   * same block, the two are merged.
+   * @param slice slice to append
+   */
+  inline void ByteRope::append(ByteSlice const& slice)
+  {
+    if (slice.empty())
+      return;
+
+    size_ += slice.size();
+
+    if (count_ > 0)
+    {
+      ByteSlice& last = slices_[count_ - 1];
+
+      if (last.block_ == slice.block_ && last.end() == slice.begin())
+      {
+        last.size_ += slice.size();
+        return;
+      }
+    }
+
+    if (count_ == capacity_)
+    {
+      // the slice may be one of ours, which growing would move
+      ByteSlice copy(slice);
+
+      grow();
+      slices_[count_++] = copy;
+      return;
+    }
+
+    slices_[count_++] = slice;
+  }
+
+  /**
+   * @param rope rope to append the slices of
+   */
+  inline void ByteRope::append(ByteRope const& rope)
+  {
+    // growing would move the slices we are appending
+    if (&rope == this)
+    {
+      ByteRope copy(rope);
+      append(copy);
+      return;
+    }
+
+    for (size_t i = 0; i < rope.count_; ++i)
+      append(rope.slices_[i]);
+  }
+
+  /**
+   * This method drops all slices.
+   */
+  inline void ByteRope::clear()
+  {
+    for (size_t i = 0; i < count_; ++i)
+      slices_[i] = ByteSlice();
+
+    count_ = 0;
+    size_  = 0;
+  }
+
+  /**
+   * @return number of bytes in the rope
+   */
+  inline size_t ByteRope::size() const
+  {
+    return size_;
+  }
+
+  /**
+   * @return true if the rope contains no data, false otherwise
+   */
+  inline bool ByteRope::empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * @return number of slices the rope consists of
+   */
+  inline size_t ByteRope::slices() const
+  {
+    return count_;
+  }
+
+  /**
+   * @param index index of a slice, less than slices()
+   * @return the slice at the given index
+   */
+  inline ByteSlice const& ByteRope::operator [](size_t index) const
+  {
+    ASSERT(index < count_);
+    return slices_[index];
+  }
+
+  /**
+   * @param offset offset of the subrope within this rope, at most size()
+   * @param size maximum number of bytes in the subrope
+   * @return rope of the given part of this rope, sharing the blocks
+   */
+  inline ByteRope ByteRope::subrope(size_t offset, size_t size) const
+  {
+    ASSERT(offset <= size_);
+
+    ByteRope rope;
+
+    for (size_t i = 0; i < count_ && size > 0; ++i)
+    {
+      size_t length = slices_[i].size();
+
+      if (offset >= length)
+      {
+        offset -= length;
+        continue;
+      }
+
+      ByteSlice slice = slices_[i].subslice(offset, size);
+
+      size  -= slice.size();
+      offset = 0;
+
+      rope.append(slice);
+    }
+    return rope;
+  }
+
+  /**
+   * @param vector array to store the description of the slices in
+   * @param count number of entries in 'vector'
+   * @return number of entries used, all of them if the rope has more slices
+   */
+  inline size_t ByteRope::exportVector(iovec* vector, size_t count) const
+  {
+    count = min(count, count_);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      vector[i].iov_base = const_cast<byte_t*>(slices_[i].data());
+      vector[i].iov_len  = slices_[i].size();
+    }
+    return count;
+  }
+
+  /**
+   * @param buffer buffer to put the contents of the rope into, one range per slice
+   */
+  inline void ByteRope::writeTo(StreamBuffer& buffer) const
+  {
+    for (size_t i = 0; i < count_; ++i)
+      slices_[i].writeTo(buffer);
+  }
+
+  /**
+   * This method doubles the capacity of the slice array.
+   */
+  inline void ByteRope::grow()
+  {
+    size_t capacity = max(capacity_ * 2, static_cast<size_t>(4));
+    ByteSlice* slices = new ByteSlice[capacity];
+
+    for (size_t i = 0; i < count_; ++i)
+      slices[i].swap(slices_[i]);
+
+    delete[] slices_;
+
+    slices_   = slices;
+    capacity_ = capacity;
+  }
+
+
+  /**
+   * @param first rope to make up the beginning
+   * @param second rope to follow it
+   * @return rope of the contents of both, sharing their blocks
+   */
+  inline ByteRope concat(ByteRope const& first, ByteRope const& second)
+  {
+    ByteRope rope(first);
+    rope.append(second);
+    return rope;
+  }
+}
+
+
+#endif
@@ -0,0 +1,392 @@
+// ChainBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCHAINBUFFER_HPP
+#define UTLCHAINBUFFER_HPP
+
+#include <sys/uio.h>
+
+#include "util/Assert.hpp"
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/BlockPool.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the StreamBuffer interface for a growable region of memory. Data is
+   * stored in a chain of fixed size blocks taken from a BlockPool, a new block is linked in
+   * whenever the last one is full. Data once written is never moved, so that messages of any
+   * size can be built in memory at a constant cost per byte.
+   * The contents can be exported as an iovec array to be handed to writev or sendmsg without
+   * copying, and dropped from the front as they got written. The blocks of one chain can be
+   * appended to another one without copying any data.
+   */
+  class ChainBuffer final: public StreamBuffer
+  {
+  public:
+    explicit ChainBuffer(BlockPool& pool);
+    ~ChainBuffer();
+
+    ChainBuffer(ChainBuffer const&) = delete;
+    ChainBuffer& operator =(ChainBuffer const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+    void splice(ChainBuffer& other);
+    void consume(size_t size);
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+
+    size_t blocks() const;
+    size_t exportVector(iovec* vector, size_t count) const;
+
+  private:
+    /**
+     * The header at the start of each block, the block's data follows it.
+     */
+    struct Block
+    {
+      Block* next;
+      byte_t* begin;
+      byte_t* end;
+    };
+
+    BlockPool* pool_;
+
+    Block* head_;
+    Block* tail_;
+    size_t blocks_;
+
+    // the size of the data in all blocks but the last one
+    size_t size_;
+
+    // the free part of the last block
+    byte_t* current_;
+    byte_t* end_;
+
+    static byte_t* data(Block* block);
+
+    void append();
+    void overflow(byte_t element);
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param pool pool to take blocks from, it has to outlive the ChainBuffer object and its
+   *        blocks have to be larger than the header stored in each of them
+   */
+  inline ChainBuffer::ChainBuffer(BlockPool& pool)
+    : StreamBuffer(),
+      pool_(&pool),
+      head_(nullptr),
+      tail_(nullptr),
+      blocks_(0),
+      size_(0),
+      current_(nullptr),
+      end_(nullptr)
+  {
+    ASSERT(pool.blockSize() > sizeof(Block));
+  }
+
+  /**
+   * The destructor returns all blocks to the pool.
+   */
+  inline ChainBuffer::~ChainBuffer()
+  {
+    clear();
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void ChainBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void ChainBuffer::put(byte_t const* elements, size_t size)
+  {
+    while (size > 0)
+    {
+      if (current_ == end_)
+        append();
+
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void ChainBuffer::fill(byte_t element, size_t count)
+  {
+    while (count > 0)
+    {
+      if (current_ == end_)
+        append();
+
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+    }
+  }
+
+  /**
+   * All data stays in memory, so there is nothing to flush.
+   */
+  inline void ChainBuffer::flush()
+  {
+  }
+
+  /**
+   * This method appends the contents of another chain by linking its blocks into this one.
+   * No data is copied, 'other' is empty afterwards. The free space left in the last block of
+   * this chain is not used anymore.
+   * @param other chain to move the contents of, it has to use the same pool and must not be
+   *        this chain itself
+   */
+  inline void ChainBuffer::splice(ChainBuffer& other)
+  {
+    ASSERT(&other != this);
+    ASSERTOP(pool_, eq, other.pool_);
+
+    if (other.head_ == nullptr)
+      return;
+
+    if (tail_ != nullptr)
+    {
+      tail_->end  = current_;
+      tail_->next = other.head_;
+      size_ += current_ - tail_->begin;
+    }
+    else
+      head_ = other.head_;
+
+    tail_    = other.tail_;
+    blocks_ += other.blocks_;
+    size_   += other.size_;
+    current_ = other.current_;
+    end_     = other.end_;
+
+    other.head_    = nullptr;
+    other.tail_    = nullptr;
+    other.blocks_  = 0;
+    other.size_    = 0;
+    other.current_ = nullptr;
+    other.end_     = nullptr;
+  }
+
+  /**
+   * This method drops data from the front of the chain, e.g., after it got written. Blocks
+   * that became empty are returned to the pool, except for the last one.
+   * @param size number of bytes to drop, at most size()
+   */
+  inline void ChainBuffer::consume(size_t size)
+  {
+    while (size > 0 && head_ != nullptr)
+    {
+      if (head_ == tail_)
+      {
+        size = min(size, static_cast<size_t>(current_ - head_->begin));
+        head_->begin += size;
+
+        // nothing left, start over at the beginning of the block
+        if (head_->begin == current_)
+        {
+          head_->begin = data(head_);
+          current_ = head_->begin;
+        }
+        return;
+      }
+
+      size_t available = head_->end - head_->begin;
+
+      if (size < available)
+      {
+        head_->begin += size;
+        size_ -= size;
+        return;
+      }
+
+      Block* next = head_->next;
+
+      pool_->release(reinterpret_cast<byte_t*>(head_));
+      head_ = next;
+
+      --blocks_;
+      size_ -= available;
+      size  -= available;
+    }
+  }
+
+  /**
+   * This method drops all data and returns all blocks to the pool.
+   */
+  inline void ChainBuffer::clear()
+  {
+    while (head_ != nullptr)
+    {
+      Block* next = head_->next;
+      pool_->release(reinterpret_cast<byte_t*>(head_));
+      head_ = next;
+    }
+
+    tail_    = nullptr;
+    blocks_  = 0;
+    size_    = 0;
+    current_ = nullptr;
+    end_     = nullptr;
+  }
+
+  /**
+   * @return number of bytes in the chain
+   */
+  inline size_t ChainBuffer::size() const
+  {
+    return tail_ != nullptr ? size_ + (current_ - tail_->begin) : 0;
+  }
+
+  /**
+   * @return true if the chain contains no data, false otherwise
+   */
+  inline bool ChainBuffer::empty() const
+  {
+    return size() == 0;
+  }
+
+  /**
+   * @return number of blocks in the chain, i.e., the maximum number of iovec entries required
+   *         to export its contents
+   */
+  inline size_t ChainBuffer::blocks() const
+  {
+    return blocks_;
+  }
+
+  /**
+   * This method describes the contents of the chain as an array of iovec structures, one for
+   * each non-empty block, that refer to the data directly. They stay valid until the chain is
+   * modified by anything but a put.
+   * @param vector array to store the description in
+   * @param count number of entries in 'vector'
+   * @return number of entries used, all of them if the chain has more blocks
+   */
+  inline size_t ChainBuffer::exportVector(iovec* vector, size_t count) const
+  {
+    size_t used = 0;
+
+    for (Block* block = head_; block != nullptr && used < count; block = block->next)
+    {
+      byte_t* end = block == tail_ ? current_ : block->end;
+
+      if (end != block->begin)
+      {
+        vector[used].iov_base = block->begin;
+        vector[used].iov_len  = end - block->begin;
+        ++used;
+      }
+    }
+    return used;
+  }
+
+  /**
+   * @param block some block
+   * @return pointer to the start of the data area of the block
+   */
+  inline byte_t* ChainBuffer::data(Block* block)
+  {
+    return reinterpret_cast<byte_t*>(block + 1);
+  }
+
+  /**
+   * This method links a new block to the end of the chain.
+   */
+  inline void ChainBuffer::append()
+  {
+    Block* block = reinterpret_cast<Block*>(pool_->allocate());
+
+    block->next  = nullptr;
+    block->begin = data(block);
+    block->end   = block->begin;
+
+    if (tail_ != nullptr)
+    {
+      tail_->end  = current_;
+      tail_->next = block;
+      size_ += current_ - tail_->begin;
+    }
+    else
+      head_ = block;
+
+    tail_ = block;
+    ++blocks_;
+
+    current_ = block->begin;
+    end_     = reinterpret_cast<byte_t*>(block) + pool_->blockSize();
+  }
+
+  /**
+   * This method handles a put into a full block.
+   * @param element byte to put into the buffer after appending a block
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void ChainBuffer::overflow(byte_t element)
+  {
+    append();
+
+    *current_ = element;
+    current_++;
+  }
+}
+
+
+#endif
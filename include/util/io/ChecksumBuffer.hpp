@@ -0,0 +1,215 @@
+// ChecksumBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCHECKSUMBUFFER_HPP
+#define UTLCHECKSUMBUFFER_HPP
+
+#include "util/Checksum.hpp"
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the StreamBuffer interface by passing all bytes on to another
+   * buffer while calculating their CRC-32C. Bytes are collected in a small buffer of its own,
+   * so that the checksum is calculated over larger ranges and the buffer passed to gets
+   * larger pieces as well; large ranges are passed on directly.
+   * The class is final, so that calls through a ChecksumBuffer (as made by a BasicOutStream
+   * for this buffer type) are not virtual.
+   */
+  class ChecksumBuffer final: public StreamBuffer
+  {
+  public:
+    enum
+    {
+      BUFFER_SIZE = 4096,
+    };
+
+    explicit ChecksumBuffer(StreamBuffer& buffer);
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+    uint32_t checksum() const;
+    size_t size() const;
+    void reset();
+
+  private:
+    StreamBuffer* buffer_;
+
+    uint32_t crc_;
+    size_t size_;
+
+    byte_t* current_;
+    byte_t data_[BUFFER_SIZE];
+
+    void drain();
+    void overflow(byte_t element);
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param buffer buffer to pass all bytes on to
+   */
+  inline ChecksumBuffer::ChecksumBuffer(StreamBuffer& buffer)
+    : StreamBuffer(),
+      buffer_(&buffer),
+      crc_(0),
+      size_(0),
+      current_(data_)
+  {
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void ChecksumBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == data_ + BUFFER_SIZE, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void ChecksumBuffer::put(byte_t const* elements, size_t size)
+  {
+    size_t available = data_ + BUFFER_SIZE - current_;
+
+    if (size <= available)
+    {
+      __builtin_memcpy(current_, elements, size);
+      current_ += size;
+      return;
+    }
+
+    drain();
+
+    crc_   = crc32c(elements, size, crc_);
+    size_ += size;
+
+    buffer_->put(elements, size);
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void ChecksumBuffer::fill(byte_t element, size_t count)
+  {
+    while (count > 0)
+    {
+      if (current_ == data_ + BUFFER_SIZE)
+        drain();
+
+      size_t available = data_ + BUFFER_SIZE - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::flush
+   */
+  inline void ChecksumBuffer::flush()
+  {
+    drain();
+    buffer_->flush();
+  }
+
+  /**
+   * @return CRC-32C of all bytes put into the buffer since its creation or the last reset
+   */
+  inline uint32_t ChecksumBuffer::checksum() const
+  {
+    return crc32c(data_, current_ - data_, crc_);
+  }
+
+  /**
+   * @return number of bytes put into the buffer since its creation or the last reset
+   */
+  inline size_t ChecksumBuffer::size() const
+  {
+    return size_ + (current_ - data_);
+  }
+
+  /**
+   * This method starts a new checksum, e.g., for the next record. Bytes not passed on yet
+   * are passed on first.
+   */
+  inline void ChecksumBuffer::reset()
+  {
+    drain();
+
+    crc_  = 0;
+    size_ = 0;
+  }
+
+  /**
+   * This method accounts for the collected bytes and passes them on.
+   */
+  inline void ChecksumBuffer::drain()
+  {
+    size_t size = current_ - data_;
+
+    if (size > 0)
+    {
+      crc_   = crc32c(data_, size, crc_);
+      size_ += size;
+
+      buffer_->put(data_, size);
+      current_ = data_;
+    }
+  }
+
+  /**
+   * This method handles a put into the full buffer.
+   * @param element byte to put into the buffer after passing its contents on
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void ChecksumBuffer::overflow(byte_t element)
+  {
+    drain();
+
+    *current_ = element;
+    current_++;
+  }
+}
+
+
+#endif
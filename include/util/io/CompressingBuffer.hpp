@@ -0,0 +1,573 @@
+// CompressingBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCOMPRESSINGBUFFER_HPP
+#define UTLCOMPRESSINGBUFFER_HPP
+
+#include "util/Checksum.hpp"
+#include "util/Compress.hpp"
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the StreamBuffer interface by compressing all bytes put into it
+   * and passing the result on to another buffer. The output is a frame of the following
+   * form, all numbers are little endian:
+   * - the magic bytes "ulz1" and one byte holding the binary logarithm of the block size
+   * - any number of blocks, each consisting of
+   *   - a 32 bit header, the size of the block's data with the top bit set if it is stored
+   *     uncompressed, never zero
+   *   - the CRC-32C of the uncompressed data, 32 bit
+   *   - the data, as compressed by a BlockCompressor
+   * - a 32 bit zero marking the end of the frame
+   * Each flush ends the current block, so flushing often costs compression ratio. finish
+   * ends the frame, anything put afterwards starts a new one.
+   */
+  class CompressingBuffer final: public StreamBuffer
+  {
+  public:
+    enum
+    {
+      BLOCK_SIZE = 64 * 1024,
+      MIN_BLOCK_SIZE = 1024,
+      MAX_BLOCK_SIZE = 4 * 1024 * 1024,
+    };
+
+    explicit CompressingBuffer(StreamBuffer& buffer,
+                               size_t block_size = BLOCK_SIZE,
+                               size_t depth = BlockCompressor::DEPTH);
+    ~CompressingBuffer();
+
+    CompressingBuffer(CompressingBuffer const&) = delete;
+    CompressingBuffer& operator =(CompressingBuffer const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+    void finish();
+
+    size_t size() const;
+    size_t compressedSize() const;
+
+  private:
+    StreamBuffer* buffer_;
+    BlockCompressor compressor_;
+
+    size_t shift_;
+
+    byte_t* block_;
+    byte_t* current_;
+    byte_t* end_;
+    byte_t* output_;
+
+    size_t size_;
+    size_t compressed_size_;
+    bool started_;
+
+    void start();
+    void compress();
+    void overflow(byte_t element);
+  };
+
+
+  /**
+   * This class implements the StreamBuffer interface by decompressing the frames produced by
+   * a CompressingBuffer and passing the result on to another buffer. The data may arrive in
+   * arbitrary pieces. Once corrupt data is encountered, all further data is discarded.
+   */
+  class DecompressingBuffer final: public StreamBuffer
+  {
+  public:
+    explicit DecompressingBuffer(StreamBuffer& buffer);
+    ~DecompressingBuffer();
+
+    DecompressingBuffer(DecompressingBuffer const&) = delete;
+    DecompressingBuffer& operator =(DecompressingBuffer const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void flush() override;
+
+    bool good() const;
+    bool finished() const;
+
+  private:
+    /**
+     * The part of a frame expected next.
+     */
+    enum State
+    {
+      STATE_FRAME,
+      STATE_BLOCK,
+      STATE_DATA,
+    };
+
+    StreamBuffer* buffer_;
+
+    State state_;
+    bool good_;
+
+    // the block size of the current frame, and the one the buffers are large enough for
+    size_t block_size_;
+    size_t capacity_;
+    uint32_t header_;
+
+    // the data of the part expected next, collected until complete
+    byte_t* input_;
+    size_t size_;
+    size_t expected_;
+
+    byte_t* output_;
+
+    void process();
+  };
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    byte_t const COMPRESS_MAGIC[] = {'u', 'l', 'z', '1'};
+
+    enum
+    {
+      COMPRESS_FRAME_HEADER = 5,
+      COMPRESS_BLOCK_HEADER = 4,
+      COMPRESS_CHECKSUM     = 4,
+    };
+
+    uint32_t const COMPRESS_STORED = 0x80000000;
+
+    /**
+     * @param data pointer to store the value at
+     * @param value value to store in little endian byte order
+     */
+    inline void storeLittle32(byte_t* data, uint32_t value)
+    {
+      data[0] = static_cast<byte_t>(value);
+      data[1] = static_cast<byte_t>(value >> 8);
+      data[2] = static_cast<byte_t>(value >> 16);
+      data[3] = static_cast<byte_t>(value >> 24);
+    }
+  }
+
+
+  /**
+   * @param buffer buffer to pass the compressed data on to
+   * @param block_size amount of data compressed at a time, rounded up to a power of two
+   *        between MIN_BLOCK_SIZE and MAX_BLOCK_SIZE
+   * @param depth search depth of the match finder, higher values compress better but slower
+   */
+  inline CompressingBuffer::CompressingBuffer(StreamBuffer& buffer,
+                                              size_t block_size,
+                                              size_t depth)
+    : StreamBuffer(),
+      buffer_(&buffer),
+      compressor_(depth),
+      shift_(0),
+      block_(nullptr),
+      current_(nullptr),
+      end_(nullptr),
+      output_(nullptr),
+      size_(0),
+      compressed_size_(0),
+      started_(false)
+  {
+    block_size = min(max(block_size, static_cast<size_t>(MIN_BLOCK_SIZE)),
+                     static_cast<size_t>(MAX_BLOCK_SIZE));
+
+    while ((static_cast<size_t>(1) << shift_) < block_size)
+      ++shift_;
+
+    block_size = static_cast<size_t>(1) << shift_;
+
+    block_   = new byte_t[block_size];
+    current_ = block_;
+    end_     = block_ + block_size;
+    output_  = new byte_t[impl::COMPRESS_BLOCK_HEADER + impl::COMPRESS_CHECKSUM +
+                          compressBound(block_size)];
+  }
+
+  /**
+   * The destructor finishes the frame, the buffer passed to has to be still alive.
+   */
+  inline CompressingBuffer::~CompressingBuffer()
+  {
+    if (started_ || current_ != block_)
+      finish();
+
+    delete[] output_;
+    delete[] block_;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void CompressingBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void CompressingBuffer::put(byte_t const* elements, size_t size)
+  {
+    while (size > 0)
+    {
+      if (current_ == end_)
+        compress();
+
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void CompressingBuffer::fill(byte_t element, size_t count)
+  {
+    while (count > 0)
+    {
+      if (current_ == end_)
+        compress();
+
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+    }
+  }
+
+  /**
+   * This method compresses the data put so far into a block of its own and flushes the
+   * buffer passed to.
+   */
+  inline void CompressingBuffer::flush()
+  {
+    compress();
+    buffer_->flush();
+  }
+
+  /**
+   * This method compresses the remaining data and ends the frame.
+   */
+  inline void CompressingBuffer::finish()
+  {
+    if (!started_)
+      start();
+
+    compress();
+
+    byte_t end[impl::COMPRESS_BLOCK_HEADER] = {};
+
+    buffer_->put(end, sizeof(end));
+    buffer_->flush();
+
+    compressed_size_ += sizeof(end);
+    started_ = false;
+  }
+
+  /**
+   * @return number of bytes put into the buffer
+   */
+  inline size_t CompressingBuffer::size() const
+  {
+    return size_ + (current_ - block_);
+  }
+
+  /**
+   * @return number of bytes passed on so far, including all headers
+   */
+  inline size_t CompressingBuffer::compressedSize() const
+  {
+    return compressed_size_;
+  }
+
+  /**
+   * This method passes the header of a new frame on to the buffer.
+   */
+  inline void CompressingBuffer::start()
+  {
+    byte_t header[impl::COMPRESS_FRAME_HEADER] = {};
+
+    __builtin_memcpy(header, impl::COMPRESS_MAGIC, sizeof(impl::COMPRESS_MAGIC));
+    header[4] = static_cast<byte_t>(shift_);
+
+    buffer_->put(header, sizeof(header));
+
+    compressed_size_ += sizeof(header);
+    started_ = true;
+  }
+
+  /**
+   * This method compresses the data collected as a block, and passes it on to the buffer,
+   * preceded by the frame header if it is the first block of a frame.
+   */
+  inline void CompressingBuffer::compress()
+  {
+    if (current_ == block_)
+      return;
+
+    if (!started_)
+      start();
+
+    size_t size = current_ - block_;
+    byte_t* data = output_ + impl::COMPRESS_BLOCK_HEADER + impl::COMPRESS_CHECKSUM;
+    byte_t* end = compressor_.compress(block_, current_, data);
+
+    uint32_t header = static_cast<uint32_t>(end - data);
+
+    // data that does not compress is stored as it is
+    if (end - data >= static_cast<ptrdiff_t>(size))
+    {
+      __builtin_memcpy(data, block_, size);
+
+      end    = data + size;
+      header = static_cast<uint32_t>(size) | impl::COMPRESS_STORED;
+    }
+
+    impl::storeLittle32(output_, header);
+    impl::storeLittle32(output_ + impl::COMPRESS_BLOCK_HEADER, crc32c(block_, size));
+
+    buffer_->put(output_, end - output_);
+
+    size_            += size;
+    compressed_size_ += end - output_;
+    current_ = block_;
+  }
+
+  /**
+   * This method handles a put into the full block.
+   * @param element byte to put into the buffer after compressing the block
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void CompressingBuffer::overflow(byte_t element)
+  {
+    compress();
+
+    *current_ = element;
+    current_++;
+  }
+
+
+  /**
+   * @param buffer buffer to pass the decompressed data on to
+   */
+  inline DecompressingBuffer::DecompressingBuffer(StreamBuffer& buffer)
+    : StreamBuffer(),
+      buffer_(&buffer),
+      state_(STATE_FRAME),
+      good_(true),
+      block_size_(0),
+      capacity_(0),
+      header_(0),
+      input_(new byte_t[impl::COMPRESS_FRAME_HEADER]),
+      size_(0),
+      expected_(impl::COMPRESS_FRAME_HEADER),
+      output_(nullptr)
+  {
+  }
+
+  /**
+   * The destructor frees the buffers.
+   */
+  inline DecompressingBuffer::~DecompressingBuffer()
+  {
+    delete[] output_;
+    delete[] input_;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void DecompressingBuffer::put(byte_t element)
+  {
+    put(&element, 1);
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void DecompressingBuffer::put(byte_t const* elements, size_t size)
+  {
+    while (size > 0 && good_)
+    {
+      size_t count = min(size, expected_ - size_);
+
+      __builtin_memcpy(input_ + size_, elements, count);
+      size_    += count;
+      elements += count;
+      size     -= count;
+
+      if (size_ == expected_)
+        process();
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::flush
+   */
+  inline void DecompressingBuffer::flush()
+  {
+    buffer_->flush();
+  }
+
+  /**
+   * @return true if all data so far was valid, false otherwise
+   */
+  inline bool DecompressingBuffer::good() const
+  {
+    return good_;
+  }
+
+  /**
+   * @return true if the data so far ended with a complete frame, false otherwise
+   */
+  inline bool DecompressingBuffer::finished() const
+  {
+    return good_ && state_ == STATE_FRAME && size_ == 0 && block_size_ != 0;
+  }
+
+  /**
+   * This method handles a part of the frame once it is complete.
+   */
+  inline void DecompressingBuffer::process()
+  {
+    size_ = 0;
+
+    switch (state_)
+    {
+    case STATE_FRAME:
+    {
+      size_t shift = input_[4];
+
+      // the shift is read from the input, it has to be checked before shifting by it
+      if (__builtin_memcmp(input_, impl::COMPRESS_MAGIC, sizeof(impl::COMPRESS_MAGIC)) != 0 ||
+          shift < static_cast<size_t>(__builtin_ctz(CompressingBuffer::MIN_BLOCK_SIZE)) ||
+          shift > static_cast<size_t>(__builtin_ctz(CompressingBuffer::MAX_BLOCK_SIZE)))
+      {
+        good_ = false;
+        return;
+      }
+
+      block_size_ = static_cast<size_t>(1) << shift;
+
+      // the buffers of an earlier frame might be large enough already, the blocks of this one
+      // are still checked against its own block size
+      if (capacity_ < block_size_)
+      {
+        capacity_ = block_size_;
+
+        delete[] input_;
+        delete[] output_;
+        input_  = nullptr;
+        output_ = nullptr;
+
+        input_  = new byte_t[impl::COMPRESS_CHECKSUM + compressBound(capacity_)];
+        output_ = new byte_t[capacity_];
+      }
+
+      state_    = STATE_BLOCK;
+      expected_ = impl::COMPRESS_BLOCK_HEADER;
+      break;
+    }
+
+    case STATE_BLOCK:
+    {
+      header_ = impl::loadLittle32(input_);
+
+      if (header_ == 0)
+      {
+        state_    = STATE_FRAME;
+        expected_ = impl::COMPRESS_FRAME_HEADER;
+        break;
+      }
+
+      size_t size = header_ & ~impl::COMPRESS_STORED;
+      size_t limit = header_ & impl::COMPRESS_STORED ? block_size_ : compressBound(block_size_);
+
+      if (size > limit)
+      {
+        good_ = false;
+        return;
+      }
+
+      state_    = STATE_DATA;
+      expected_ = impl::COMPRESS_CHECKSUM + size;
+      break;
+    }
+
+    case STATE_DATA:
+    {
+      uint32_t crc = impl::loadLittle32(input_);
+
+      byte_t const* data = input_ + impl::COMPRESS_CHECKSUM;
+      byte_t const* end  = input_ + expected_;
+
+      if (!(header_ & impl::COMPRESS_STORED))
+      {
+        end  = decompressBlock(data, end, output_, output_ + block_size_);
+        data = output_;
+      }
+
+      if (end == nullptr || crc32c(data, end - data) != crc)
+      {
+        good_ = false;
+        return;
+      }
+
+      buffer_->put(data, end - data);
+
+      state_    = STATE_BLOCK;
+      expected_ = impl::COMPRESS_BLOCK_HEADER;
+      break;
+    }
+    }
+  }
+}
+
+
+#endif
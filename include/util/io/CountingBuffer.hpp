@@ -0,0 +1,135 @@
+// CountingBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCOUNTINGBUFFER_HPP
+#define UTLCOUNTINGBUFFER_HPP
+
+#include "util/Config.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the StreamBuffer interface by only counting the bytes put into it. It
+   * can be used for measuring the exact size of some output before actually producing it, e.g.,
+   * for allocating memory for it only once:
+   * @code
+   * CountingBuffer counter;
+   * BasicOutStream<CountingBuffer> measure(counter);
+   * measure << ...;
+   * // allocate counter.size() bytes and print the same values again
+   * @endcode
+   * A BasicOutStream for this buffer type does not generate the digits of integers at all, but
+   * calculates their number instead. The class is final, so that these calls get inlined.
+   */
+  class CountingBuffer final: public StreamBuffer
+  {
+  public:
+    CountingBuffer();
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+    void add(size_t count);
+
+    size_t size() const;
+    void reset();
+
+  private:
+    size_t size_;
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * The default constructor creates a buffer with a count of zero.
+   */
+  inline CountingBuffer::CountingBuffer()
+    : StreamBuffer(),
+      size_(0)
+  {
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void CountingBuffer::put(byte_t)
+  {
+    ++size_;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void CountingBuffer::put(byte_t const*, size_t size)
+  {
+    size_ += size;
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void CountingBuffer::fill(byte_t, size_t count)
+  {
+    size_ += count;
+  }
+
+  /**
+   * @copydoc StreamBuffer::flush
+   */
+  inline void CountingBuffer::flush()
+  {
+  }
+
+  /**
+   * This method accounts for the given number of bytes without any bytes being put, it is used
+   * by formatting code knowing the size of its output up front.
+   * @param count number of bytes to add to the count
+   */
+  inline void CountingBuffer::add(size_t count)
+  {
+    size_ += count;
+  }
+
+  /**
+   * @return number of bytes put into the buffer since its creation or the last reset
+   */
+  inline size_t CountingBuffer::size() const
+  {
+    return size_;
+  }
+
+  /**
+   * This method resets the count to zero.
+   */
+  inline void CountingBuffer::reset()
+  {
+    size_ = 0;
+  }
+}
+
+
+#endif
@@ -0,0 +1,221 @@
+// CsvWriter.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLCSVWRITER_HPP
+#define UTLCSVWRITER_HPP
+
+#include "util/Config.hpp"
+#include "util/FormatFloat.hpp"
+#include "util/FormatInteger.hpp"
+#include "util/NumberBase.hpp"
+#include "util/StringLength.hpp"
+#include "util/Tokenizer.hpp"
+#include "util/io/OutStream.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class template writes records of comma separated values (RFC 4180) to a stream. A
+   * field is quoted only if it contains the separator, a quote, or a line break; quotes within
+   * it are doubled then. Fields are checked for these characters 64 bytes at a time by means
+   * of a DelimiterSet, a field that needs no quoting is handed to the stream in a single call.
+   * Records are terminated by a single newline.
+   * @param BufferT type of buffer the stream prints to
+   */
+  template<typename BufferT>
+  class BasicCsvWriter
+  {
+  public:
+    BasicCsvWriter(BasicOutStream<BufferT>& stream, char separator = ',');
+
+    void field(char const* string, size_t length);
+    void field(char const* string);
+
+    void field(sint_t value);
+    void field(uint_t value);
+    void field(slong_t value);
+    void field(ulong_t value);
+
+    void field(double value);
+
+    void endRecord();
+
+  private:
+    BasicOutStream<BufferT>* stream_;
+
+    // the characters that require a field to be quoted
+    DelimiterSet specials_;
+    char separator_;
+
+    // no field was written in the current record yet
+    bool first_;
+
+    template<typename T>
+    void writeInteger(T value);
+  };
+
+  typedef BasicCsvWriter<StreamBuffer> CsvWriter;
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * @param separator character separating the fields of a record
+     * @return set of the characters that require a field to be quoted
+     */
+    inline DelimiterSet csvSpecials(char separator)
+    {
+      char const specials[] = {separator, '"', '\n', '\r'};
+      return DelimiterSet(specials, sizeof(specials));
+    }
+  }
+
+
+  /**
+   * @param stream stream to write to
+   * @param separator character to separate the fields of a record with
+   */
+  template<typename BufferT>
+  inline BasicCsvWriter<BufferT>::BasicCsvWriter(BasicOutStream<BufferT>& stream, char separator)
+    : stream_(&stream),
+      specials_(impl::csvSpecials(separator)),
+      separator_(separator),
+      first_(true)
+  {
+  }
+
+  /**
+   * @param string characters of the field, need not be zero terminated
+   * @param length number of characters of the field
+   */
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(char const* string, size_t length)
+  {
+    if (!first_)
+      stream_->write(&separator_, 1);
+
+    first_ = false;
+
+    byte_t const* begin = reinterpret_cast<byte_t const*>(string);
+    byte_t const* end   = begin + length;
+    byte_t const* next  = specials_.find(begin, end);
+
+    if (next == end)
+    {
+      stream_->write(string, length);
+      return;
+    }
+
+    stream_->write("\"", 1);
+
+    // there is no quote in front of the first special character
+    for (;;)
+    {
+      byte_t const* quote = static_cast<byte_t const*>(__builtin_memchr(next, '"', end - next));
+
+      if (quote == nullptr)
+        break;
+
+      // the quote ends this run and starts the next one, which doubles it
+      stream_->write(reinterpret_cast<char const*>(begin), quote + 1 - begin);
+
+      begin = quote;
+      next  = quote + 1;
+    }
+
+    stream_->write(reinterpret_cast<char const*>(begin), end - begin);
+    stream_->write("\"", 1);
+  }
+
+  /**
+   * @param string zero terminated field
+   */
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(char const* string)
+  {
+    field(string, lengthBytes(string));
+  }
+
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(sint_t value)
+  {
+    writeInteger(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(uint_t value)
+  {
+    writeInteger(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(slong_t value)
+  {
+    writeInteger(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(ulong_t value)
+  {
+    writeInteger(value);
+  }
+
+  /**
+   * @param value value to write in its shortest form
+   */
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::field(double value)
+  {
+    char buffer[MAX_FLOAT_CHARACTERS];
+    char* end = formatShortest(value, buffer);
+
+    field(buffer, end - buffer);
+  }
+
+  /**
+   * This method terminates the current record, the next field starts a new one.
+   */
+  template<typename BufferT>
+  inline void BasicCsvWriter<BufferT>::endRecord()
+  {
+    stream_->write("\n", 1);
+    first_ = true;
+  }
+
+  /**
+   * @param value integer to write in decimal, regardless of the stream's settings; it is
+   *        quoted like any other field should the separator be a digit or a minus sign
+   */
+  template<typename BufferT>
+  template<typename T>
+  inline void BasicCsvWriter<BufferT>::writeInteger(T value)
+  {
+    char buffer[MAX_INTEGER_CHARACTERS];
+    char* end = formatInteger(value, buffer, BASE_DECIMAL, 0);
+
+    field(buffer, end - buffer);
+  }
+}
+
+
+#endif
@@ -0,0 +1,550 @@
+// FdBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLFDBUFFER_HPP
+#define UTLFDBUFFER_HPP
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * The ways an FdBuffer can write to its file descriptor.
+   */
+  enum FdMode
+  {
+    FD_BUFFERED,
+    FD_DIRECT
+  };
+
+
+  /**
+   * This class implements the StreamBuffer interface for a file descriptor. Output is collected
+   * in a list of large, aligned chunks that are allocated as needed. Once all chunks are filled
+   * they are written using a single writev call, so the number of system calls is the number of
+   * bytes written divided by chunk_size * chunk_count. Payloads of at least a chunk's size are
+   * not copied but handed to writev along with the chunks filled so far.
+   * Interrupted and partial writes are continued. Any other error is recorded, and all further
+   * output is discarded.
+   * In direct mode the file descriptor is switched to O_DIRECT, so that the data bypasses the
+   * page cache, which is what one wants for large log files. Only blocks of DIRECT_ALIGNMENT
+   * bytes are written that way. An explicit flush writes a trailing partial block with O_DIRECT
+   * temporarily disabled and moves the file offset back to the start of that block, so that
+   * the block gets written again once it is complete. The file descriptor must not be written
+   * to by other means in that case. As O_DIRECT also requires aligned file offsets, direct mode
+   * is only used if the current offset of the file descriptor is a multiple of
+   * DIRECT_ALIGNMENT.
+   * The file descriptor is not owned by the buffer, everything buffered is written on
+   * destruction. O_DIRECT is disabled again at that point.
+   */
+  class FdBuffer final: public StreamBuffer
+  {
+  public:
+    enum
+    {
+      CHUNK_SIZE       = 64 * 1024,
+      CHUNK_COUNT      = 16,
+      MAX_CHUNKS       = 64,
+      DIRECT_ALIGNMENT = 4096,
+    };
+
+    FdBuffer(int fd,
+             FdMode mode = FD_BUFFERED,
+             size_t chunk_size = CHUNK_SIZE,
+             size_t chunk_count = CHUNK_COUNT);
+    ~FdBuffer();
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+    FdMode mode() const;
+
+    bool good() const;
+    int error() const;
+
+    size_t syscalls() const;
+    size_t written() const;
+
+  private:
+    int fd_;
+    FdMode mode_;
+
+    size_t chunk_size_;
+    size_t chunk_count_;
+
+    byte_t* chunks_[MAX_CHUNKS];
+    size_t chunk_;
+
+    byte_t* current_;
+    byte_t* end_;
+
+    byte_t discard_[64];
+
+    int error_;
+    size_t syscalls_;
+    size_t written_;
+
+    bool allocate(size_t index);
+    void reset();
+
+    void overflow(byte_t element);
+    void nextChunk();
+
+    void writeOut(byte_t const* extra, size_t size, bool rewind);
+    bool writeTail(byte_t const* begin, size_t size, bool rewind);
+    bool writeAll(iovec* vector, int count, bool direct);
+
+    bool setDirect(bool direct);
+  };
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * This function advances an array of I/O vectors past the given number of bytes, as
+     * required for continuing after a partial write.
+     * @param vector (in/out) first I/O vector, afterwards the first one not completely written
+     * @param count (in/out) number of I/O vectors in 'vector'
+     * @param written number of bytes written, at most the sum of all I/O vector lengths
+     */
+    inline void advanceVector(iovec*& vector, int& count, size_t written)
+    {
+      while (count != 0 && written >= vector->iov_len)
+      {
+        written -= vector->iov_len;
+        ++vector;
+        --count;
+      }
+
+      if (written != 0)
+      {
+        vector->iov_base = static_cast<byte_t*>(vector->iov_base) + written;
+        vector->iov_len -= written;
+      }
+    }
+  }
+
+
+  /**
+   * @param fd file descriptor to write to, it has to stay valid for the lifetime of the buffer
+   * @param mode FD_DIRECT to write using O_DIRECT, if the file descriptor does not support it
+   *        or its current offset is not aligned, the buffer falls back to FD_BUFFERED
+   * @param chunk_size size of a single chunk, it is rounded up to a multiple of
+   *        DIRECT_ALIGNMENT
+   * @param chunk_count number of chunks to fill before writing them, at most MAX_CHUNKS
+   */
+  inline FdBuffer::FdBuffer(int fd, FdMode mode, size_t chunk_size, size_t chunk_count)
+    : StreamBuffer(),
+      fd_(fd),
+      mode_(FD_BUFFERED),
+      chunk_size_(max(chunk_size + DIRECT_ALIGNMENT - 1, static_cast<size_t>(DIRECT_ALIGNMENT))
+                  & ~static_cast<size_t>(DIRECT_ALIGNMENT - 1)),
+      chunk_count_(min(max(chunk_count, static_cast<size_t>(1)),
+                       static_cast<size_t>(MAX_CHUNKS))),
+      chunk_(0),
+      current_(nullptr),
+      end_(nullptr),
+      error_(0),
+      syscalls_(0),
+      written_(0)
+  {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i)
+      chunks_[i] = nullptr;
+
+    if (!allocate(0))
+      error_ = ENOMEM;
+
+    // every write would fail with EINVAL otherwise
+    off_t offset = mode == FD_DIRECT ? lseek(fd_, 0, SEEK_CUR) : -1;
+
+    if (offset >= 0 && offset % DIRECT_ALIGNMENT == 0 && setDirect(true))
+      mode_ = FD_DIRECT;
+
+    reset();
+  }
+
+  /**
+   * The destructor writes all data still buffered.
+   */
+  inline FdBuffer::~FdBuffer()
+  {
+    writeOut(nullptr, 0, false);
+
+    if (mode_ == FD_DIRECT)
+      setDirect(false);
+
+    for (size_t i = 0; i < MAX_CHUNKS; ++i)
+      free(chunks_[i]);
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void FdBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void FdBuffer::put(byte_t const* elements, size_t size)
+  {
+    // O_DIRECT requires aligned memory, so only buffered mode can write payloads in place
+    if (size >= chunk_size_ && mode_ == FD_BUFFERED)
+    {
+      writeOut(elements, size, true);
+      return;
+    }
+
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+
+      if (size == 0)
+        break;
+
+      nextChunk();
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void FdBuffer::fill(byte_t element, size_t count)
+  {
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+
+      if (count == 0)
+        break;
+
+      nextChunk();
+    }
+  }
+
+  /**
+   * This method writes all buffered data to the file descriptor.
+   */
+  inline void FdBuffer::flush()
+  {
+    writeOut(nullptr, 0, true);
+  }
+
+  /**
+   * @return mode the buffer operates in
+   */
+  inline FdMode FdBuffer::mode() const
+  {
+    return mode_;
+  }
+
+  /**
+   * @return true if no error occurred so far, false otherwise
+   */
+  inline bool FdBuffer::good() const
+  {
+    return error_ == 0;
+  }
+
+  /**
+   * @return errno value of the first error that occurred or zero if there was none
+   */
+  inline int FdBuffer::error() const
+  {
+    return error_;
+  }
+
+  /**
+   * @return number of write system calls issued so far
+   */
+  inline size_t FdBuffer::syscalls() const
+  {
+    return syscalls_;
+  }
+
+  /**
+   * @return number of bytes written to the file descriptor so far, in direct mode trailing
+   *         partial blocks are counted every time they are written
+   */
+  inline size_t FdBuffer::written() const
+  {
+    return written_;
+  }
+
+  /**
+   * @param index index of the chunk to allocate
+   * @return true if the chunk could be allocated, false if not, in which case the chunk count
+   *         is limited to the chunks allocated so far
+   */
+  inline bool FdBuffer::allocate(size_t index)
+  {
+    void* memory;
+
+    if (posix_memalign(&memory, DIRECT_ALIGNMENT, chunk_size_) != 0)
+    {
+      chunk_count_ = index;
+      return false;
+    }
+
+    chunks_[index] = static_cast<byte_t*>(memory);
+    return true;
+  }
+
+  /**
+   * This method makes the first chunk the current one. After an error, output goes to a small
+   * scratch area instead and is discarded.
+   */
+  inline void FdBuffer::reset()
+  {
+    chunk_ = 0;
+
+    if (error_ != 0)
+    {
+      current_ = discard_;
+      end_     = discard_ + sizeof(discard_);
+      return;
+    }
+
+    current_ = chunks_[0];
+    end_     = chunks_[0] + chunk_size_;
+  }
+
+  /**
+   * This method handles a put into a full chunk.
+   * @param element byte to put into the buffer after switching to the next chunk
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void FdBuffer::overflow(byte_t element)
+  {
+    nextChunk();
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * This method makes the next chunk the current one, allocating it if necessary. If all
+   * chunks are filled, they are written out first.
+   */
+  inline void FdBuffer::nextChunk()
+  {
+    size_t next = chunk_ + 1;
+
+    if (error_ == 0 && next < chunk_count_ && (chunks_[next] != nullptr || allocate(next)))
+    {
+      chunk_   = next;
+      current_ = chunks_[next];
+      end_     = current_ + chunk_size_;
+      return;
+    }
+
+    writeOut(nullptr, 0, true);
+  }
+
+  /**
+   * This method writes the filled chunks followed by the given range and makes the first
+   * chunk the current one afterwards.
+   * @param extra range to write after the chunks, may be nullptr if 'size' is zero
+   * @param size number of bytes in 'extra'
+   * @param rewind in direct mode, true to write a trailing partial block in a way that lets
+   *        the buffer continue with aligned writes, false if the buffer is about to be
+   *        destroyed
+   */
+  inline void FdBuffer::writeOut(byte_t const* extra, size_t size, bool rewind)
+  {
+    if (error_ == 0)
+    {
+      iovec vector[MAX_CHUNKS + 1];
+      int count = 0;
+
+      for (size_t i = 0; i < chunk_; ++i)
+      {
+        vector[count].iov_base = chunks_[i];
+        vector[count].iov_len  = chunk_size_;
+        ++count;
+      }
+
+      size_t last = current_ - chunks_[chunk_];
+      size_t tail = mode_ == FD_DIRECT ? last % DIRECT_ALIGNMENT : 0;
+
+      if (last != tail)
+      {
+        vector[count].iov_base = chunks_[chunk_];
+        vector[count].iov_len  = last - tail;
+        ++count;
+      }
+
+      if (size != 0)
+      {
+        vector[count].iov_base = const_cast<byte_t*>(extra);
+        vector[count].iov_len  = size;
+        ++count;
+      }
+
+      if (writeAll(vector, count, mode_ == FD_DIRECT) && tail != 0)
+      {
+        byte_t* begin = current_ - tail;
+
+        if (writeTail(begin, tail, rewind) && rewind)
+        {
+          // the tail is written again along with the data following it
+          __builtin_memmove(chunks_[0], begin, tail);
+
+          reset();
+          current_ += tail;
+          return;
+        }
+      }
+    }
+
+    reset();
+  }
+
+  /**
+   * This method writes a trailing partial block in direct mode, which requires O_DIRECT to be
+   * disabled temporarily.
+   * @param begin begin of partial block
+   * @param size size of partial block
+   * @param rewind true to move the file offset back to the start of the block and to enable
+   *        O_DIRECT again afterwards
+   * @return true on success, false on error
+   */
+  inline bool FdBuffer::writeTail(byte_t const* begin, size_t size, bool rewind)
+  {
+    iovec vector = {const_cast<byte_t*>(begin), size};
+
+    if (!setDirect(false))
+    {
+      error_ = errno;
+      return false;
+    }
+
+    if (!writeAll(&vector, 1, false))
+      return false;
+
+    if (rewind && (lseek(fd_, -static_cast<off_t>(size), SEEK_CUR) < 0 || !setDirect(true)))
+    {
+      error_ = errno;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * This method writes all the given I/O vectors, continuing after interruptions and partial
+   * writes. With O_DIRECT the continuation has to start at an aligned buffer and file offset,
+   * so the partial block of a partial write is rewound and written again, the same way a
+   * trailing partial block is handled by writeTail.
+   * @param vector array of I/O vectors to write, it gets modified, with 'direct' the base and
+   *        length of each vector must be multiples of DIRECT_ALIGNMENT
+   * @param count number of I/O vectors in 'vector'
+   * @param direct true if O_DIRECT is enabled for the file descriptor
+   * @return true on success, false on error
+   */
+  inline bool FdBuffer::writeAll(iovec* vector, int count, bool direct)
+  {
+    while (count != 0)
+    {
+      ssize_t result = writev(fd_, vector, count);
+      ++syscalls_;
+
+      if (result < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        error_ = errno;
+        return false;
+      }
+
+      if (result == 0)
+      {
+        error_ = EIO;
+        return false;
+      }
+
+      size_t partial = direct ? static_cast<size_t>(result) % DIRECT_ALIGNMENT : 0;
+
+      if (partial != 0 && lseek(fd_, -static_cast<off_t>(partial), SEEK_CUR) < 0)
+      {
+        error_ = errno;
+        return false;
+      }
+
+      written_ += result;
+      impl::advanceVector(vector, count, result - partial);
+    }
+    return true;
+  }
+
+  /**
+   * @param direct true to enable O_DIRECT for the file descriptor, false to disable it
+   * @return true on success, false on error
+   */
+  inline bool FdBuffer::setDirect(bool direct)
+  {
+    int flags = fcntl(fd_, F_GETFL);
+
+    if (flags < 0)
+      return false;
+
+    flags = direct ? flags | O_DIRECT : flags & ~O_DIRECT;
+    return fcntl(fd_, F_SETFL, flags) == 0;
+  }
+}
+
+
+#endif
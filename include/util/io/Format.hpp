@@ -0,0 +1,295 @@
+// Format.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLFORMAT_HPP
+#define UTLFORMAT_HPP
+
+#include "util/Config.hpp"
+#include "util/NumberBase.hpp"
+#include "util/io/OutStream.hpp"
+
+
+/**
+ * This macro turns a string literal into a format usable with utl::format. The string is
+ * wrapped in a distinct type, so that it can be inspected at compile time.
+ * @param string string literal containing the format
+ */
+#define UTL_FORMAT(string)                                                                        \
+  ([]()                                                                                           \
+  {                                                                                               \
+    struct Format                                                                                 \
+    {                                                                                             \
+      static constexpr char const* value() { return string; }                                     \
+    };                                                                                            \
+    return Format();                                                                              \
+  }())
+
+
+namespace utl
+{
+  template<typename BufferT, typename FormatT, typename ...ArgsT>
+  auto format(BasicOutStream<BufferT>& stream, FormatT format, ArgsT const& ...args)
+    -> decltype(FormatT::value(), void());
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * This template tells whether the given type is an integer type that can be printed in
+     * an arbitrary base.
+     */
+    template<typename T>
+    struct IsInteger
+    {
+      static bool const value = false;
+    };
+
+    template<> struct IsInteger<uchar_t>  { static bool const value = true; };
+    template<> struct IsInteger<schar_t>  { static bool const value = true; };
+    template<> struct IsInteger<ushort_t> { static bool const value = true; };
+    template<> struct IsInteger<sshort_t> { static bool const value = true; };
+    template<> struct IsInteger<uint_t>   { static bool const value = true; };
+    template<> struct IsInteger<sint_t>   { static bool const value = true; };
+    template<> struct IsInteger<ulong_t>  { static bool const value = true; };
+    template<> struct IsInteger<slong_t>  { static bool const value = true; };
+
+    /**
+     * The kinds of segments a format string consists of. Every segment starts with a span of
+     * literal characters that is followed by the end of the string, an escaped brace, or an
+     * argument slot.
+     */
+    enum
+    {
+      SEGMENT_END,
+      SEGMENT_ESCAPE,
+      SEGMENT_SLOT
+    };
+
+    template<int Kind>
+    struct Segment
+    {
+    };
+
+    template<char C>
+    struct Specifier
+    {
+    };
+
+    /**
+     * @return true if 'c' is a valid specifier of an argument slot
+     */
+    constexpr bool isSpecifier(char c)
+    {
+      return c == 'b' || c == 'o' || c == 'd' || c == 'x';
+    }
+
+    /**
+     * @return the base selected by the given specifier
+     */
+    constexpr uint8_t specifierBase(char c)
+    {
+      return c == 'b' ? BASE_BINARY :
+             c == 'o' ? BASE_OCTAL :
+             c == 'x' ? BASE_HEXADECIMAL : BASE_DECIMAL;
+    }
+
+    /**
+     * @return true if the format string starting at 'i' is well formed, i.e., all braces are
+     *         either escaped by doubling them or form a slot "{}", "{b}", "{o}", "{d}", or "{x}"
+     */
+    constexpr bool isValidFormat(char const* string, size_t i)
+    {
+      return string[i] == '\0' ? true :
+             string[i] == '{' ?
+               (string[i + 1] == '{' || string[i + 1] == '}' ? isValidFormat(string, i + 2) :
+                isSpecifier(string[i + 1]) && string[i + 2] == '}' ? isValidFormat(string, i + 3) :
+                false) :
+             string[i] == '}' ? string[i + 1] == '}' && isValidFormat(string, i + 2) :
+             isValidFormat(string, i + 1);
+    }
+
+    /**
+     * @return number of argument slots in the (well formed) format string starting at 'i'
+     */
+    constexpr size_t countSlots(char const* string, size_t i)
+    {
+      return string[i] == '\0' ? 0 :
+             string[i] == '{' && string[i + 1] == '{' ? countSlots(string, i + 2) :
+             string[i] == '}' && string[i + 1] == '}' ? countSlots(string, i + 2) :
+             string[i] == '{' ? 1 + countSlots(string, i + 1) :
+             countSlots(string, i + 1);
+    }
+
+    /**
+     * @return position of the first brace or the terminating zero at or after 'i'
+     */
+    constexpr size_t spanEnd(char const* string, size_t i)
+    {
+      return string[i] == '\0' || string[i] == '{' || string[i] == '}' ? i :
+             spanEnd(string, i + 1);
+    }
+
+    /**
+     * @return the kind of segment that ends at position 'i'
+     */
+    constexpr int segmentKind(char const* string, size_t i)
+    {
+      return string[i] == '\0' ? SEGMENT_END :
+             string[i + 1] == string[i] ? SEGMENT_ESCAPE : SEGMENT_SLOT;
+    }
+
+
+    template<typename FormatT, size_t Position, typename BufferT, typename ...ArgsT>
+    void formatSegments(BasicOutStream<BufferT>& stream, ArgsT const& ...args);
+
+    /**
+     * This function writes the literal characters [Begin, End) of the format string in one go.
+     */
+    template<typename FormatT, size_t Begin, size_t End, typename BufferT>
+    inline void formatSpan(BasicOutStream<BufferT>& stream)
+    {
+      if (End > Begin)
+        stream.write(FormatT::value() + Begin, End - Begin);
+    }
+
+    /**
+     * This function prints an argument for a slot without specifier, just like operator <<
+     * would.
+     */
+    template<typename BufferT, typename ArgT>
+    inline void formatArgument(BasicOutStream<BufferT>& stream, ArgT const& arg, Specifier<'}'>)
+    {
+      stream << arg;
+    }
+
+    /**
+     * This function prints an integer argument in the base given by the slot's specifier,
+     * regardless of the base set for the stream.
+     */
+    template<typename BufferT, typename ArgT, char SpecifierC>
+    inline void formatArgument(BasicOutStream<BufferT>& stream,
+                               ArgT const& arg,
+                               Specifier<SpecifierC>)
+    {
+      static_assert(IsInteger<ArgT>::value, "base specifiers can only be used for integers");
+
+      stream.writeInteger(arg, specifierBase(SpecifierC));
+    }
+
+    /**
+     * This function handles the end of the format string.
+     */
+    template<typename FormatT, size_t Position, size_t End, typename BufferT, typename ...ArgsT>
+    inline void formatSegment(BasicOutStream<BufferT>& stream, Segment<SEGMENT_END>,
+                              ArgsT const& ...)
+    {
+      // superfluous arguments have been diagnosed by format already
+      formatSpan<FormatT, Position, End>(stream);
+    }
+
+    /**
+     * This function handles an escaped brace, which is printed along with the preceding span.
+     */
+    template<typename FormatT, size_t Position, size_t End, typename BufferT, typename ...ArgsT>
+    inline void formatSegment(BasicOutStream<BufferT>& stream, Segment<SEGMENT_ESCAPE>,
+                              ArgsT const& ...args)
+    {
+      formatSpan<FormatT, Position, End + 1>(stream);
+      formatSegments<FormatT, End + 2>(stream, args...);
+    }
+
+    /**
+     * This function handles an argument slot.
+     */
+    template<typename FormatT, size_t Position, size_t End, typename BufferT,
+             typename ArgT, typename ...ArgsT>
+    inline void formatSegment(BasicOutStream<BufferT>& stream, Segment<SEGMENT_SLOT>,
+                              ArgT const& arg, ArgsT const& ...args)
+    {
+      constexpr char specifier = FormatT::value()[End + 1];
+
+      formatSpan<FormatT, Position, End>(stream);
+      formatArgument(stream, arg, Specifier<specifier>());
+      formatSegments<FormatT, End + (specifier == '}' ? 2 : 3)>(stream, args...);
+    }
+
+    /**
+     * This function handles an argument slot without an argument left for it.
+     */
+    template<typename FormatT, size_t Position, size_t End, typename BufferT>
+    inline void formatSegment(BasicOutStream<BufferT>& stream, Segment<SEGMENT_SLOT>)
+    {
+      // missing arguments have been diagnosed by format already
+    }
+
+    /**
+     * This function prints the segment of the format string starting at 'Position' and,
+     * recursively, all following ones. All positions are known at compile time.
+     */
+    template<typename FormatT, size_t Position, typename BufferT, typename ...ArgsT>
+    inline void formatSegments(BasicOutStream<BufferT>& stream, ArgsT const& ...args)
+    {
+      constexpr size_t end  = spanEnd(FormatT::value(), Position);
+      constexpr int    kind = isValidFormat(FormatT::value(), 0) ?
+                              segmentKind(FormatT::value(), end) : SEGMENT_END;
+
+      formatSegment<FormatT, Position, end>(stream, Segment<kind>(), args...);
+    }
+  }
+
+
+  /**
+   * This function prints the given arguments according to a format string that is parsed at
+   * compile time. The format string is split into literal spans, each of which is printed
+   * with a single write, and argument slots. A slot is written as "{}" to print the argument
+   * the way operator << would, or as "{b}", "{o}", "{d}", or "{x}" to print an integer in
+   * binary, octal, decimal, or hexadecimal, respectively. Literal braces are written as "{{"
+   * and "}}". Malformed format strings and a number of arguments not matching the number of
+   * slots are reported at compile time.
+   * Example:
+   *   utl::format(stream, UTL_FORMAT("id={} val={x}\n"), id, value);
+   * @param stream stream to print to
+   * @param format format string as created by UTL_FORMAT
+   * @param args arguments to print
+   * @note the format string is inspected by recursive constexpr functions, so its length is
+   *       limited by the compiler's constexpr recursion depth (512 by default for g++)
+   * @note the function only takes part in overload resolution for format types, so that other
+   *       functions named format remain usable for streams
+   */
+  template<typename BufferT, typename FormatT, typename ...ArgsT>
+  inline auto format(BasicOutStream<BufferT>& stream, FormatT format, ArgsT const& ...args)
+    -> decltype(FormatT::value(), void())
+  {
+    (void)format;
+
+    static_assert(impl::isValidFormat(FormatT::value(), 0),
+                  "malformed format string");
+    static_assert(!impl::isValidFormat(FormatT::value(), 0) ||
+                  impl::countSlots(FormatT::value(), 0) == sizeof...(ArgsT),
+                  "number of arguments does not match the number of slots in format string");
+
+    impl::formatSegments<FormatT, 0>(stream, args...);
+  }
+}
+
+
+#endif
@@ -0,0 +1,387 @@
+// InStream.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLINSTREAM_HPP
+#define UTLINSTREAM_HPP
+
+#include "util/Config.hpp"
+#include "util/NumberBase.hpp"
+#include "util/Parse.hpp"
+#include "util/io/InStreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class can be used for reading various values, it is the counterpart of OutStream.
+   * Numbers are read in the base set (decimal by default) and may be preceded by whitespace.
+   * Once a read failed, because the input does not contain a valid number, the number does not
+   * fit into the requested type, or the end of the input is reached, the stream stays in the
+   * failed state and all further reads fail until clear is invoked.
+   */
+  class InStream
+  {
+  public:
+    InStream(InStreamBuffer& buffer);
+
+    bool read(char& value);
+    bool read(uchar_t& value);
+    bool read(schar_t& value);
+
+    bool read(ushort_t& value);
+    bool read(sshort_t& value);
+
+    bool read(uint_t& value);
+    bool read(sint_t& value);
+
+    bool read(ulong_t& value);
+    bool read(slong_t& value);
+
+    void setBase(uint8_t base);
+
+    bool good() const;
+    ParseStatus status() const;
+
+    void clear();
+
+  private:
+    /**
+     * The maximum number of characters of a number we have to look at when it spans multiple
+     * windows of the buffer: a sign and one more digit than the longest 64 bit value (leading
+     * zeros are dropped beforehand).
+     */
+    static size_t const MAX_CHARACTERS = 1 + 64 + 1;
+
+    InStreamBuffer* buffer_;
+
+    uint8_t base_;
+    ParseStatus status_;
+
+    bool skipWhitespace();
+
+    template<typename T>
+    bool readValue(T& value);
+
+    template<typename T>
+    bool readValueSlow(T& value);
+  };
+
+
+  InStream& bin(InStream& stream);
+  InStream& oct(InStream& stream);
+  InStream& dec(InStream& stream);
+  InStream& hex(InStream& stream);
+
+  template<typename T>
+  InStream& operator >> (InStream& stream, T& value);
+}
+
+
+namespace utl
+{
+  /**
+   * @param buffer buffer to read from
+   */
+  inline InStream::InStream(InStreamBuffer& buffer)
+    : buffer_(&buffer),
+      base_(BASE_DECIMAL),
+      status_(PARSE_SUCCESS)
+  {
+  }
+
+  /**
+   * @param value (out) the next character, whitespace is not skipped
+   * @return true on success, false if the stream is in failed state or the end is reached
+   */
+  inline bool InStream::read(char& value)
+  {
+    if (status_ != PARSE_SUCCESS)
+      return false;
+
+    if (!buffer_->fill())
+    {
+      status_ = PARSE_INVALID;
+      return false;
+    }
+
+    value = static_cast<char>(*buffer_->begin());
+    buffer_->consume(1);
+    return true;
+  }
+
+  inline bool InStream::read(uchar_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(schar_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(ushort_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(sshort_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(uint_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(sint_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(ulong_t& value)
+  {
+    return readValue(value);
+  }
+
+  inline bool InStream::read(slong_t& value)
+  {
+    return readValue(value);
+  }
+
+  /**
+   * @param base new base to set
+   */
+  inline void InStream::setBase(uint8_t base)
+  {
+    if (BASE_MIN < base && base < BASE_MAX)
+      base_ = base;
+  }
+
+  /**
+   * @return true if the stream is not in failed state, false otherwise
+   */
+  inline bool InStream::good() const
+  {
+    return status_ == PARSE_SUCCESS;
+  }
+
+  /**
+   * @return status of the last read, PARSE_INVALID is also used if the end of input is reached
+   */
+  inline ParseStatus InStream::status() const
+  {
+    return status_;
+  }
+
+  /**
+   * This method resets the stream from failed state.
+   */
+  inline void InStream::clear()
+  {
+    status_ = PARSE_SUCCESS;
+  }
+
+  /**
+   * This method skips all whitespace characters.
+   * @return true if there is data left afterwards, false if the end of input is reached
+   */
+  inline bool InStream::skipWhitespace()
+  {
+    while (buffer_->fill())
+    {
+      byte_t const* begin = buffer_->begin();
+      byte_t const* end   = buffer_->end();
+      byte_t const* it    = begin;
+
+      while (it != end && (*it == ' ' || (*it >= '\t' && *it <= '\r')))
+        ++it;
+
+      buffer_->consume(it - begin);
+
+      if (it != end)
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * @param value (out) the value read, in case of an overflow it is saturated
+   * @return true on success, false otherwise
+   */
+  template<typename T>
+  bool InStream::readValue(T& value)
+  {
+    if (status_ != PARSE_SUCCESS)
+      return false;
+
+    if (!skipWhitespace())
+    {
+      status_ = PARSE_INVALID;
+      return false;
+    }
+
+    char const* begin = reinterpret_cast<char const*>(buffer_->begin());
+    char const* end   = reinterpret_cast<char const*>(buffer_->end());
+
+    ParseResult<T> result = parse<T>(begin, end, base_);
+
+    // in the common case the number ends within the window and we are done, otherwise it might
+    // continue in the next one (which includes a window holding nothing but a sign)
+    if (result.end == end || (result.status == PARSE_INVALID && end - begin == 1))
+      return readValueSlow(value);
+
+    buffer_->consume(result.end - begin);
+
+    if (result.status != PARSE_INVALID)
+      value = result.value;
+
+    status_ = result.status;
+    return status_ == PARSE_SUCCESS;
+  }
+
+  /**
+   * This method reads a number that spans multiple windows of the buffer by collecting its
+   * characters first.
+   * @see readValue
+   */
+  template<typename T>
+  bool InStream::readValueSlow(T& value)
+  {
+    char characters[MAX_CHARACTERS];
+    size_t count = 0;
+    bool   first = true;
+    bool   zero  = false;
+    bool   done  = false;
+
+    while (!done && buffer_->fill())
+    {
+      byte_t const* begin = buffer_->begin();
+      byte_t const* end   = buffer_->end();
+      byte_t const* it    = begin;
+
+      for ( ; it != end; ++it)
+      {
+        char c = static_cast<char>(*it);
+
+        if (first && (c == '+' || c == '-'))
+        {
+          characters[count++] = c;
+          first = false;
+          continue;
+        }
+
+        first = false;
+
+        if (digitValue(c) >= base_)
+        {
+          done = true;
+          break;
+        }
+
+        // leading zeros do not change the value, dropping them bounds the number of characters
+        // to keep
+        if (c == '0' && (count == 0 || (count == 1 && digitValue(characters[0]) >= base_)))
+        {
+          zero = true;
+          continue;
+        }
+
+        if (count < MAX_CHARACTERS)
+          characters[count++] = c;
+      }
+      buffer_->consume(it - begin);
+    }
+
+    if (zero && (count == 0 || digitValue(characters[count - 1]) >= base_))
+      characters[count++] = '0';
+
+    ParseResult<T> result = parse<T>(characters, characters + count, base_);
+
+    if (result.status != PARSE_INVALID)
+      value = result.value;
+
+    status_ = result.status;
+    return status_ == PARSE_SUCCESS;
+  }
+
+  /**
+   * This manipulator can be used for setting binary input.
+   */
+  inline InStream& bin(InStream& stream)
+  {
+    stream.setBase(BASE_BINARY);
+    return stream;
+  }
+
+  /**
+   * This manipulator can be used for setting octal input.
+   */
+  inline InStream& oct(InStream& stream)
+  {
+    stream.setBase(BASE_OCTAL);
+    return stream;
+  }
+
+  /**
+   * This manipulator can be used for setting decimal input.
+   */
+  inline InStream& dec(InStream& stream)
+  {
+    stream.setBase(BASE_DECIMAL);
+    return stream;
+  }
+
+  /**
+   * This manipulator can be used for setting hexadecimal input.
+   */
+  inline InStream& hex(InStream& stream)
+  {
+    stream.setBase(BASE_HEXADECIMAL);
+    return stream;
+  }
+
+  /**
+   * This is the overloaded version of operator >> for reading a value from a buffer.
+   * @param stream stream to read value from
+   * @param value (out) value read
+   * @return stream that was supplied
+   */
+  template<typename T>
+  inline InStream& operator >> (InStream& stream, T& value)
+  {
+    stream.read(value);
+    return stream;
+  }
+
+  /**
+   * This is the specialization of operator >> for invoking a manipulator function on the given
+   * stream.
+   * @param stream stream to invoke manipulator on
+   * @param manipulator manipulator to invoke
+   * @return stream that was supplied
+   */
+  inline InStream& operator >> (InStream& stream, InStream& (*manipulator)(InStream&))
+  {
+    return (*manipulator)(stream);
+  }
+}
+
+
+#endif
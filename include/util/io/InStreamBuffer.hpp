@@ -0,0 +1,147 @@
+// InStreamBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLINSTREAMBUFFER_HPP
+#define UTLINSTREAMBUFFER_HPP
+
+#include "util/Config.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class represents the source of data read by an InStream. The data currently available
+   * is exposed as a contiguous window of memory that can be read directly. Once the window is
+   * consumed, underflow is invoked to provide the next one. The base class simply serves a fixed
+   * region of memory, derived classes reading data from other sources override underflow.
+   */
+  class InStreamBuffer
+  {
+  public:
+    InStreamBuffer(byte_t const* begin, byte_t const* end);
+    InStreamBuffer(InStreamBuffer&&) = default;
+    InStreamBuffer(InStreamBuffer const&) = delete;
+
+    virtual ~InStreamBuffer() = default;
+
+    InStreamBuffer& operator =(InStreamBuffer&&) = default;
+    InStreamBuffer& operator =(InStreamBuffer const&) = delete;
+
+    byte_t const* begin() const;
+    byte_t const* end() const;
+
+    void consume(size_t count);
+    bool fill();
+
+  protected:
+    InStreamBuffer();
+
+    void setWindow(byte_t const* begin, byte_t const* end);
+
+    virtual bool underflow();
+
+  private:
+    byte_t const* current_;
+    byte_t const* end_;
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param begin begin of memory region to read from
+   * @param end end of memory region to read from
+   */
+  inline InStreamBuffer::InStreamBuffer(byte_t const* begin, byte_t const* end)
+    : current_(begin),
+      end_(end)
+  {
+  }
+
+  /**
+   * This constructor creates a buffer with an empty window, derived classes provide the data
+   * in underflow.
+   */
+  inline InStreamBuffer::InStreamBuffer()
+    : current_(nullptr),
+      end_(nullptr)
+  {
+  }
+
+  /**
+   * @return begin of the data currently available
+   */
+  inline byte_t const* InStreamBuffer::begin() const
+  {
+    return current_;
+  }
+
+  /**
+   * @return end of the data currently available
+   */
+  inline byte_t const* InStreamBuffer::end() const
+  {
+    return end_;
+  }
+
+  /**
+   * @param count number of bytes to remove from the front of the window, must not exceed the
+   *        number of bytes available
+   */
+  inline void InStreamBuffer::consume(size_t count)
+  {
+    current_ += count;
+  }
+
+  /**
+   * This method makes sure that data is available, if possible.
+   * @return true if the window contains at least one byte, false if the end of input is reached
+   */
+  inline bool InStreamBuffer::fill()
+  {
+    if (current_ != end_)
+      return true;
+
+    return underflow() && current_ != end_;
+  }
+
+  /**
+   * @param begin begin of the new window
+   * @param end end of the new window
+   */
+  inline void InStreamBuffer::setWindow(byte_t const* begin, byte_t const* end)
+  {
+    current_ = begin;
+    end_     = end;
+  }
+
+  /**
+   * This method is invoked once the window got consumed completely. Implementations set the
+   * next window using setWindow.
+   * @return true if more data is available, false if the end of input is reached
+   */
+  inline bool InStreamBuffer::underflow()
+  {
+    return false;
+  }
+}
+
+
+#endif
@@ -0,0 +1,1093 @@
+// IoUringBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLIOURINGBUFFER_HPP
+#define UTLIOURINGBUFFER_HPP
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * The ways an IoUringBuffer can perform its writes.
+   */
+  enum AsyncBackend
+  {
+    ASYNC_URING,
+    ASYNC_THREAD
+  };
+
+
+  namespace impl
+  {
+    /**
+     * This class is a minimal wrapper around an io_uring instance, as far as it is required for
+     * submitting writes and reaping their completions from a single thread.
+     */
+    class IoUring
+    {
+    public:
+      IoUring();
+      ~IoUring();
+
+      IoUring(IoUring const&) = delete;
+      IoUring& operator =(IoUring const&) = delete;
+
+      bool setup(unsigned int entries);
+      bool supports(unsigned int opcode) const;
+
+      bool registerBuffers(iovec const* vectors, unsigned int count);
+      bool registerFile(int fd);
+
+      io_uring_sqe* prepare();
+      int submit();
+      int wait();
+
+      io_uring_cqe const* peek() const;
+      void advance();
+
+    private:
+      int fd_;
+
+      void* sq_ring_;
+      size_t sq_ring_size_;
+
+      void* cq_ring_;
+      size_t cq_ring_size_;
+
+      io_uring_sqe* sqes_;
+      size_t sqes_size_;
+
+      unsigned int* sq_tail_;
+      unsigned int* sq_mask_;
+      unsigned int* sq_array_;
+
+      unsigned int* cq_head_;
+      unsigned int* cq_tail_;
+      unsigned int* cq_mask_;
+      io_uring_cqe* cqes_;
+
+      unsigned int pending_;
+      unsigned int unsubmitted_;
+
+      int enter(unsigned int wait);
+    };
+  }
+
+
+  /**
+   * This class implements the StreamBuffer interface for a file descriptor without ever
+   * blocking on the write itself. Output is collected in a ring of chunks. A filled chunk is
+   * submitted to an io_uring and the buffer continues with the next chunk right away, a chunk
+   * is reused once the completion of its write arrived. The chunks are registered with the
+   * ring as fixed buffers and the file descriptor as a fixed file, so that the kernel does not
+   * have to map them for every write. Writes to seekable files are issued at explicit offsets
+   * and may be in flight concurrently, writes to other descriptors (pipes, sockets, files
+   * opened with O_APPEND) are issued one at a time, in order.
+   * If no io_uring can be created or it lacks the required operations (the kernel is too old
+   * or io_uring is disabled) the writes are performed by a worker thread instead.
+   * Partial writes are continued, interrupted ones are retried. Any other error is recorded,
+   * and all further output is discarded. Should the completions of the writes in flight become
+   * unavailable, their chunks are never reused (nor freed) as the kernel may still read them.
+   * Putting data only blocks if all chunks are still being written, i.e., if the descriptor
+   * cannot keep up in the long run. flush hands the current chunk over without waiting for it
+   * to be written, sync waits for all writes and makes the data durable.
+   * The file descriptor is not owned by the buffer, on destruction all data is written and the
+   * file offset is set to the end of the data.
+   */
+  class IoUringBuffer final: public StreamBuffer
+  {
+  public:
+    enum
+    {
+      CHUNK_SIZE      = 64 * 1024,
+      CHUNK_COUNT     = 8,
+      MAX_CHUNKS      = 64,
+      CHUNK_ALIGNMENT = 4096,
+    };
+
+    IoUringBuffer(int fd,
+                  AsyncBackend backend = ASYNC_URING,
+                  size_t chunk_size = CHUNK_SIZE,
+                  size_t chunk_count = CHUNK_COUNT);
+    ~IoUringBuffer();
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+    bool sync();
+
+    AsyncBackend backend() const;
+
+    bool good() const;
+    int error() const;
+
+    size_t submissions() const;
+    size_t written() const;
+
+  private:
+    enum ChunkState
+    {
+      CHUNK_FREE,
+      CHUNK_READY,
+      CHUNK_BUSY,
+    };
+
+    struct Chunk
+    {
+      byte_t* begin;
+      size_t size;
+      size_t done;
+      off_t offset;
+      ChunkState state;
+    };
+
+    int fd_;
+    AsyncBackend backend_;
+
+    size_t chunk_size_;
+    size_t chunk_count_;
+
+    byte_t* memory_;
+    Chunk chunks_[MAX_CHUNKS];
+    size_t chunk_;
+
+    byte_t* current_;
+    byte_t* end_;
+
+    byte_t discard_[64];
+
+    int error_;
+    size_t submissions_;
+    size_t written_;
+
+    impl::IoUring ring_;
+    bool fixed_buffers_;
+    bool fixed_file_;
+    bool seekable_;
+    off_t offset_;
+    size_t next_;
+    size_t in_flight_;
+    bool detached_;
+
+    pthread_t thread_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t work_;
+    pthread_cond_t done_;
+    bool stop_;
+
+    bool setupUring();
+    bool setupThread();
+
+    void setError(int error);
+    void discard();
+
+    void overflow(byte_t element);
+    void nextChunk();
+    void advance();
+
+    void waitFree(size_t index);
+    void waitAll();
+
+    void dispatch();
+    void submit(size_t index);
+    void reap(bool wait);
+    void complete(size_t index, int result);
+
+    static void* run(void* buffer);
+    void work();
+  };
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * The default constructor creates an object without an io_uring, setup has to be called.
+     */
+    inline IoUring::IoUring()
+      : fd_(-1),
+        sq_ring_(MAP_FAILED),
+        sq_ring_size_(0),
+        cq_ring_(MAP_FAILED),
+        cq_ring_size_(0),
+        sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+        sqes_size_(0),
+        sq_tail_(nullptr),
+        sq_mask_(nullptr),
+        sq_array_(nullptr),
+        cq_head_(nullptr),
+        cq_tail_(nullptr),
+        cq_mask_(nullptr),
+        cqes_(nullptr),
+        pending_(0),
+        unsubmitted_(0)
+    {
+    }
+
+    /**
+     * The destructor unmaps the rings and closes the io_uring, which cancels all pending
+     * requests and drops registered buffers and files.
+     */
+    inline IoUring::~IoUring()
+    {
+      if (sqes_ != MAP_FAILED)
+        munmap(sqes_, sqes_size_);
+
+      if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+        munmap(cq_ring_, cq_ring_size_);
+
+      if (sq_ring_ != MAP_FAILED)
+        munmap(sq_ring_, sq_ring_size_);
+
+      if (fd_ >= 0)
+        close(fd_);
+    }
+
+    /**
+     * @param entries minimum number of entries of the submission queue
+     * @return true if the io_uring was created, false if not
+     */
+    inline bool IoUring::setup(unsigned int entries)
+    {
+      io_uring_params params;
+      __builtin_memset(&params, 0, sizeof(params));
+
+      fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+
+      if (fd_ < 0)
+        return false;
+
+      sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+      cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      sqes_size_    = params.sq_entries * sizeof(io_uring_sqe);
+
+      if (params.features & IORING_FEAT_SINGLE_MMAP)
+      {
+        sq_ring_size_ = max(sq_ring_size_, cq_ring_size_);
+        cq_ring_size_ = sq_ring_size_;
+      }
+
+      sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+
+      if (sq_ring_ == MAP_FAILED)
+        return false;
+
+      if (params.features & IORING_FEAT_SINGLE_MMAP)
+        cq_ring_ = sq_ring_;
+      else
+      {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+
+        if (cq_ring_ == MAP_FAILED)
+          return false;
+      }
+
+      void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+
+      if (sqes == MAP_FAILED)
+        return false;
+
+      byte_t* sq = static_cast<byte_t*>(sq_ring_);
+      byte_t* cq = static_cast<byte_t*>(cq_ring_);
+
+      sqes_     = static_cast<io_uring_sqe*>(sqes);
+      sq_tail_  = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+      sq_mask_  = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+      sq_array_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+      cq_head_  = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+      cq_tail_  = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+      cq_mask_  = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+      cqes_     = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+      return true;
+    }
+
+    /**
+     * @param opcode IORING_OP_* value of the operation to check for
+     * @return true if the kernel supports the operation, false if not or if it is too old to
+     *         be asked (which is the case for kernels before 5.6, which lack IORING_OP_WRITE)
+     */
+    inline bool IoUring::supports(unsigned int opcode) const
+    {
+      enum
+      {
+        MAX_OPS = 256,
+      };
+
+      union
+      {
+        io_uring_probe probe;
+        byte_t memory[sizeof(io_uring_probe) + MAX_OPS * sizeof(io_uring_probe_op)];
+      } probe;
+
+      __builtin_memset(&probe, 0, sizeof(probe));
+
+      if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, &probe, MAX_OPS) != 0)
+        return false;
+
+      return opcode <= probe.probe.last_op &&
+             (probe.probe.ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    /**
+     * @param vectors memory regions to register as fixed buffers
+     * @param count number of regions
+     * @return true on success, false on error
+     */
+    inline bool IoUring::registerBuffers(iovec const* vectors, unsigned int count)
+    {
+      return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, vectors, count) == 0;
+    }
+
+    /**
+     * @param fd file descriptor to register as fixed file with index zero
+     * @return true on success, false on error
+     */
+    inline bool IoUring::registerFile(int fd)
+    {
+      return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES, &fd, 1) == 0;
+    }
+
+    /**
+     * @return a cleared submission queue entry to fill in, it is handed to the kernel by the
+     *         next call to submit
+     * @note the caller has to make sure that there is a free entry, i.e., that it never has
+     *       more requests in flight than the submission queue has entries
+     */
+    inline io_uring_sqe* IoUring::prepare()
+    {
+      // the tail is only ever written by us, the kernel only reads it
+      unsigned int tail  = *sq_tail_ + pending_;
+      unsigned int index = tail & *sq_mask_;
+
+      io_uring_sqe* sqe = &sqes_[index];
+      __builtin_memset(sqe, 0, sizeof(*sqe));
+
+      sq_array_[index] = index;
+      ++pending_;
+      return sqe;
+    }
+
+    /**
+     * This function hands all prepared entries to the kernel without waiting for any of them.
+     * Entries the kernel cannot take right now stay queued and are handed over again by the
+     * next call to submit or wait.
+     * @return zero on success, a negative errno value on error, in which case the entries are
+     *         queued nonetheless (they are visible to the kernel once the tail is published)
+     */
+    inline int IoUring::submit()
+    {
+      __atomic_store_n(sq_tail_, *sq_tail_ + pending_, __ATOMIC_RELEASE);
+
+      unsubmitted_ += pending_;
+      pending_ = 0;
+
+      int result = enter(0);
+
+      if (result == -EINTR || result == -EAGAIN || result == -EBUSY)
+        return 0;
+
+      return result < 0 ? result : 0;
+    }
+
+    /**
+     * This function blocks until at least one completion is available.
+     * @return zero on success, a negative errno value on error
+     */
+    inline int IoUring::wait()
+    {
+      for (;;)
+      {
+        int result = enter(1);
+
+        if (result != -EINTR)
+          return result < 0 ? result : 0;
+      }
+    }
+
+    /**
+     * @return the oldest completion not yet consumed or nullptr if there is none
+     */
+    inline io_uring_cqe const* IoUring::peek() const
+    {
+      unsigned int head = *cq_head_;
+
+      if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+        return nullptr;
+
+      return &cqes_[head & *cq_mask_];
+    }
+
+    /**
+     * This function consumes the completion returned by the last call to peek.
+     */
+    inline void IoUring::advance()
+    {
+      __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * This function submits all entries not yet taken by the kernel.
+     * @param wait number of completions to wait for
+     * @return number of entries submitted or a negative errno value on error
+     */
+    inline int IoUring::enter(unsigned int wait)
+    {
+      unsigned int flags = wait != 0 ? IORING_ENTER_GETEVENTS : 0;
+      long result = syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait, flags, nullptr, 0);
+
+      if (result < 0)
+        return -errno;
+
+      unsubmitted_ -= static_cast<unsigned int>(result);
+      return static_cast<int>(result);
+    }
+  }
+
+
+  /**
+   * @param fd file descriptor to write to, it has to stay valid for the lifetime of the buffer
+   * @param backend ASYNC_URING to use an io_uring if possible (and a worker thread otherwise),
+   *        ASYNC_THREAD to always use a worker thread
+   * @param chunk_size size of a single chunk, it is rounded up to a multiple of
+   *        CHUNK_ALIGNMENT
+   * @param chunk_count number of chunks, at least two and at most MAX_CHUNKS
+   */
+  inline IoUringBuffer::IoUringBuffer(int fd,
+                                      AsyncBackend backend,
+                                      size_t chunk_size,
+                                      size_t chunk_count)
+    : StreamBuffer(),
+      fd_(fd),
+      backend_(backend),
+      chunk_size_(max(chunk_size + CHUNK_ALIGNMENT - 1, static_cast<size_t>(CHUNK_ALIGNMENT))
+                  & ~static_cast<size_t>(CHUNK_ALIGNMENT - 1)),
+      chunk_count_(min(max(chunk_count, static_cast<size_t>(2)),
+                       static_cast<size_t>(MAX_CHUNKS))),
+      memory_(nullptr),
+      chunk_(0),
+      current_(nullptr),
+      end_(nullptr),
+      error_(0),
+      submissions_(0),
+      written_(0),
+      ring_(),
+      fixed_buffers_(false),
+      fixed_file_(false),
+      seekable_(false),
+      offset_(-1),
+      next_(0),
+      in_flight_(0),
+      detached_(false),
+      thread_(),
+      mutex_(),
+      work_(),
+      done_(),
+      stop_(false)
+  {
+    void* memory;
+
+    if (posix_memalign(&memory, CHUNK_ALIGNMENT, chunk_size_ * chunk_count_) != 0)
+    {
+      setError(ENOMEM);
+      backend_ = ASYNC_URING;
+      discard();
+      return;
+    }
+
+    memory_ = static_cast<byte_t*>(memory);
+
+    for (size_t i = 0; i < chunk_count_; ++i)
+    {
+      Chunk chunk = {memory_ + i * chunk_size_, 0, 0, -1, CHUNK_FREE};
+      chunks_[i] = chunk;
+    }
+
+    if (backend_ != ASYNC_URING || !setupUring())
+    {
+      backend_ = ASYNC_THREAD;
+
+      if (!setupThread())
+      {
+        // without a worker there is nothing to wait for
+        backend_ = ASYNC_URING;
+        discard();
+        return;
+      }
+    }
+
+    current_ = chunks_[0].begin;
+    end_     = current_ + chunk_size_;
+  }
+
+  /**
+   * The destructor writes all buffered data and waits for all writes to finish.
+   */
+  inline IoUringBuffer::~IoUringBuffer()
+  {
+    flush();
+    waitAll();
+
+    if (backend_ == ASYNC_URING)
+    {
+      // writes were issued at explicit offsets, the file offset has not moved
+      if (seekable_ && memory_ != nullptr)
+        lseek(fd_, offset_, SEEK_SET);
+    }
+    else
+    {
+      pthread_mutex_lock(&mutex_);
+      stop_ = true;
+      pthread_cond_signal(&work_);
+      pthread_mutex_unlock(&mutex_);
+
+      pthread_join(thread_, nullptr);
+
+      pthread_cond_destroy(&done_);
+      pthread_cond_destroy(&work_);
+      pthread_mutex_destroy(&mutex_);
+    }
+
+    // chunks of writes whose completion could not be learned may still be read by the kernel
+    if (!detached_)
+      free(memory_);
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void IoUringBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void IoUringBuffer::put(byte_t const* elements, size_t size)
+  {
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+
+      if (size == 0)
+        break;
+
+      nextChunk();
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void IoUringBuffer::fill(byte_t element, size_t count)
+  {
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+
+      if (count == 0)
+        break;
+
+      nextChunk();
+    }
+  }
+
+  /**
+   * This method hands the data buffered so far over to be written, without waiting for the
+   * write to happen. It only blocks if no chunk is free to continue with.
+   */
+  inline void IoUringBuffer::flush()
+  {
+    if (error() != 0)
+    {
+      discard();
+      return;
+    }
+
+    if (current_ != chunks_[chunk_].begin)
+      advance();
+    else if (backend_ == ASYNC_URING)
+      reap(false);
+  }
+
+  /**
+   * This method writes all data buffered so far, waits for all writes to finish, and makes
+   * the data durable by means of fdatasync.
+   * @return true if all data was written successfully, false otherwise
+   */
+  inline bool IoUringBuffer::sync()
+  {
+    flush();
+    waitAll();
+
+    if (error() == 0)
+    {
+      int result;
+
+      do
+      {
+        result = fdatasync(fd_);
+      }
+      while (result < 0 && errno == EINTR);
+
+      // descriptors that cannot be synchronized (like pipes) have nothing to make durable
+      if (result < 0 && errno != EINVAL)
+        setError(errno);
+    }
+    return good();
+  }
+
+  /**
+   * @return backend used for writing
+   */
+  inline AsyncBackend IoUringBuffer::backend() const
+  {
+    return backend_;
+  }
+
+  /**
+   * @return true if no error occurred so far, false otherwise
+   */
+  inline bool IoUringBuffer::good() const
+  {
+    return error() == 0;
+  }
+
+  /**
+   * @return errno value of the first error that occurred or zero if there was none
+   */
+  inline int IoUringBuffer::error() const
+  {
+    return __atomic_load_n(&error_, __ATOMIC_ACQUIRE);
+  }
+
+  /**
+   * @return number of writes submitted so far, including the continuations of partial ones
+   */
+  inline size_t IoUringBuffer::submissions() const
+  {
+    return __atomic_load_n(&submissions_, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * @return number of bytes written so far
+   */
+  inline size_t IoUringBuffer::written() const
+  {
+    return __atomic_load_n(&written_, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * @return true if the io_uring could be set up, false otherwise
+   */
+  inline bool IoUringBuffer::setupUring()
+  {
+    if (!ring_.setup(static_cast<unsigned int>(chunk_count_)))
+      return false;
+
+    // writes from buffers that could not be registered need IORING_OP_WRITE, which is younger
+    // than io_uring itself
+    if (!ring_.supports(IORING_OP_WRITE))
+      return false;
+
+    iovec vectors[MAX_CHUNKS];
+
+    for (size_t i = 0; i < chunk_count_; ++i)
+    {
+      vectors[i].iov_base = chunks_[i].begin;
+      vectors[i].iov_len  = chunk_size_;
+    }
+
+    // both are optimizations, the writes work without them (e.g., if the amount of memory
+    // that may be locked is too small for the buffers)
+    fixed_buffers_ = ring_.registerBuffers(vectors, static_cast<unsigned int>(chunk_count_));
+    fixed_file_    = ring_.registerFile(fd_);
+
+    int flags = fcntl(fd_, F_GETFL);
+    offset_   = lseek(fd_, 0, SEEK_CUR);
+    seekable_ = flags >= 0 && !(flags & O_APPEND) && offset_ >= 0;
+    return true;
+  }
+
+  /**
+   * @return true if the worker thread could be started, false otherwise
+   */
+  inline bool IoUringBuffer::setupThread()
+  {
+    pthread_mutex_init(&mutex_, nullptr);
+    pthread_cond_init(&work_, nullptr);
+    pthread_cond_init(&done_, nullptr);
+
+    int result = pthread_create(&thread_, nullptr, &IoUringBuffer::run, this);
+
+    if (result != 0)
+    {
+      pthread_cond_destroy(&done_);
+      pthread_cond_destroy(&work_);
+      pthread_mutex_destroy(&mutex_);
+
+      setError(result);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @param error errno value to record, only the first error is kept
+   */
+  inline void IoUringBuffer::setError(int error)
+  {
+    int expected = 0;
+    __atomic_compare_exchange_n(&error_, &expected, error, false,
+                                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * This method makes all further output go to a small scratch area, it is used once an error
+   * occurred.
+   */
+  inline void IoUringBuffer::discard()
+  {
+    current_ = discard_;
+    end_     = discard_ + sizeof(discard_);
+  }
+
+  /**
+   * This method handles a put into a full chunk.
+   * @param element byte to put into the buffer after switching to the next chunk
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void IoUringBuffer::overflow(byte_t element)
+  {
+    nextChunk();
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * This method hands over the current chunk, which is full, and continues with the next one.
+   */
+  inline void IoUringBuffer::nextChunk()
+  {
+    if (error() != 0)
+    {
+      discard();
+      return;
+    }
+
+    advance();
+  }
+
+  /**
+   * This method hands over the current chunk, which must not be empty, to be written and makes
+   * the next chunk the current one once it is free.
+   */
+  inline void IoUringBuffer::advance()
+  {
+    Chunk& chunk = chunks_[chunk_];
+
+    chunk.size   = current_ - chunk.begin;
+    chunk.done   = 0;
+    chunk.offset = seekable_ ? offset_ : -1;
+
+    offset_ += seekable_ ? chunk.size : 0;
+
+    if (backend_ == ASYNC_URING)
+    {
+      chunk.state = CHUNK_READY;
+      dispatch();
+    }
+    else
+    {
+      pthread_mutex_lock(&mutex_);
+      chunk.state = CHUNK_READY;
+      pthread_cond_signal(&work_);
+      pthread_mutex_unlock(&mutex_);
+    }
+
+    chunk_ = (chunk_ + 1) % chunk_count_;
+    waitFree(chunk_);
+
+    if (detached_)
+    {
+      discard();
+      return;
+    }
+
+    current_ = chunks_[chunk_].begin;
+    end_     = current_ + chunk_size_;
+  }
+
+  /**
+   * @param index index of chunk to wait for until its write finished, or until the completions
+   *        of the writes in flight cannot be learned anymore
+   */
+  inline void IoUringBuffer::waitFree(size_t index)
+  {
+    if (backend_ == ASYNC_URING)
+    {
+      while (chunks_[index].state != CHUNK_FREE && !detached_)
+        reap(true);
+    }
+    else
+    {
+      pthread_mutex_lock(&mutex_);
+
+      while (chunks_[index].state != CHUNK_FREE)
+        pthread_cond_wait(&done_, &mutex_);
+
+      pthread_mutex_unlock(&mutex_);
+    }
+  }
+
+  /**
+   * This method waits until all writes finished.
+   */
+  inline void IoUringBuffer::waitAll()
+  {
+    if (memory_ == nullptr)
+      return;
+
+    for (size_t i = 0; i < chunk_count_; ++i)
+      waitFree(i);
+  }
+
+  /**
+   * This method submits the chunks ready to be written, in order. Writes to descriptors
+   * without a file offset to write at are issued one at a time.
+   */
+  inline void IoUringBuffer::dispatch()
+  {
+    while (chunks_[next_].state == CHUNK_READY && (seekable_ || in_flight_ == 0))
+    {
+      if (error() != 0)
+        chunks_[next_].state = CHUNK_FREE;
+      else
+      {
+        chunks_[next_].state = CHUNK_BUSY;
+        ++in_flight_;
+        submit(next_);
+      }
+
+      next_ = (next_ + 1) % chunk_count_;
+    }
+  }
+
+  /**
+   * This method submits a write of the remainder of the given chunk.
+   * @param index index of chunk to write
+   */
+  inline void IoUringBuffer::submit(size_t index)
+  {
+    Chunk const& chunk = chunks_[index];
+    io_uring_sqe* sqe = ring_.prepare();
+
+    sqe->opcode    = fixed_buffers_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->flags     = fixed_file_ ? IOSQE_FIXED_FILE : 0;
+    sqe->fd        = fixed_file_ ? 0 : fd_;
+    sqe->addr      = reinterpret_cast<uintptr_t>(chunk.begin + chunk.done);
+    sqe->len       = static_cast<uint32_t>(chunk.size - chunk.done);
+    sqe->off       = chunk.offset < 0 ? static_cast<uint64_t>(-1) : chunk.offset + chunk.done;
+    sqe->buf_index = static_cast<uint16_t>(index);
+    sqe->user_data = index;
+
+    __atomic_fetch_add(&submissions_, 1, __ATOMIC_RELAXED);
+
+    // the entry cannot be taken back once the tail is published, so on failure the chunk stays
+    // busy and the entry is handed over again by the next wait, which reports persisting errors
+    ring_.submit();
+  }
+
+  /**
+   * This method processes the completions available.
+   * @param wait true to block until there is at least one completion, false to return
+   *        immediately
+   */
+  inline void IoUringBuffer::reap(bool wait)
+  {
+    io_uring_cqe const* cqe = ring_.peek();
+
+    if (cqe == nullptr && wait)
+    {
+      int result = ring_.wait();
+
+      if (result < 0)
+      {
+        // we cannot learn about the requests in flight anymore, but the kernel may still be
+        // reading their chunks, so those stay busy and all further output is discarded
+        setError(-result);
+        detached_ = true;
+        discard();
+        return;
+      }
+
+      cqe = ring_.peek();
+    }
+
+    for ( ; cqe != nullptr; cqe = ring_.peek())
+    {
+      size_t index = static_cast<size_t>(cqe->user_data);
+      int result = cqe->res;
+
+      ring_.advance();
+      complete(index, result);
+    }
+
+    dispatch();
+  }
+
+  /**
+   * This method handles the result of a write of the given chunk.
+   * @param index index of the chunk written
+   * @param result number of bytes written or negative errno value
+   */
+  inline void IoUringBuffer::complete(size_t index, int result)
+  {
+    Chunk& chunk = chunks_[index];
+
+    if (result == -EINTR || result == -EAGAIN)
+    {
+      submit(index);
+      return;
+    }
+
+    if (result > 0)
+    {
+      __atomic_fetch_add(&written_, static_cast<size_t>(result), __ATOMIC_RELAXED);
+      chunk.done += result;
+
+      if (chunk.done < chunk.size)
+      {
+        submit(index);
+        return;
+      }
+    }
+    else
+      setError(result < 0 ? -result : EIO);
+
+    chunk.state = CHUNK_FREE;
+    --in_flight_;
+  }
+
+  /**
+   * This function is the entry point of the worker thread.
+   * @param buffer pointer to the IoUringBuffer the thread works for
+   * @return nullptr
+   */
+  inline void* IoUringBuffer::run(void* buffer)
+  {
+    static_cast<IoUringBuffer*>(buffer)->work();
+    return nullptr;
+  }
+
+  /**
+   * This method writes the chunks handed over, in order, until the buffer is destroyed.
+   */
+  inline void IoUringBuffer::work()
+  {
+    size_t index = 0;
+
+    pthread_mutex_lock(&mutex_);
+
+    for (;;)
+    {
+      Chunk& chunk = chunks_[index];
+
+      while (chunk.state != CHUNK_READY && !stop_)
+        pthread_cond_wait(&work_, &mutex_);
+
+      if (chunk.state != CHUNK_READY)
+        break;
+
+      chunk.state = CHUNK_BUSY;
+      pthread_mutex_unlock(&mutex_);
+
+      while (error() == 0 && chunk.done < chunk.size)
+      {
+        ssize_t result = write(fd_, chunk.begin + chunk.done, chunk.size - chunk.done);
+        __atomic_fetch_add(&submissions_, 1, __ATOMIC_RELAXED);
+
+        if (result < 0 && errno == EINTR)
+          continue;
+
+        if (result <= 0)
+        {
+          setError(result < 0 ? errno : EIO);
+          break;
+        }
+
+        __atomic_fetch_add(&written_, static_cast<size_t>(result), __ATOMIC_RELAXED);
+        chunk.done += result;
+      }
+
+      pthread_mutex_lock(&mutex_);
+      chunk.state = CHUNK_FREE;
+      pthread_cond_broadcast(&done_);
+
+      index = (index + 1) % chunk_count_;
+    }
+
+    pthread_mutex_unlock(&mutex_);
+  }
+}
+
+
+#endif
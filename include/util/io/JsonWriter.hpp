@@ -0,0 +1,508 @@
+// JsonWriter.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLJSONWRITER_HPP
+#define UTLJSONWRITER_HPP
+
+#include "util/Assert.hpp"
+#include "util/Bits.hpp"
+#include "util/Config.hpp"
+#include "util/Encode.hpp"
+#include "util/FormatFloat.hpp"
+#include "util/FormatInteger.hpp"
+#include "util/NumberBase.hpp"
+#include "util/Simd.hpp"
+#include "util/StringLength.hpp"
+#include "util/io/OutStream.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class template writes JSON to a stream as it goes, no document is ever built up in
+   * memory. Containers are opened and closed explicitly, the writer takes care of separators
+   * and of escaping strings. Runs of string characters that need no escaping are found with
+   * vector instructions and handed to the stream in a single call each.
+   * Strings are expected to be UTF-8 and are written as they are, apart from quotes,
+   * backslashes, and control characters. Values at the top level are not separated, so that a
+   * caller can write one document per line by printing a newline after each.
+   * @param BufferT type of buffer the stream prints to
+   */
+  template<typename BufferT>
+  class BasicJsonWriter
+  {
+  public:
+    enum
+    {
+      MAX_DEPTH = 64,
+    };
+
+    BasicJsonWriter(BasicOutStream<BufferT>& stream);
+
+    void beginObject();
+    void endObject();
+
+    void beginArray();
+    void endArray();
+
+    void key(char const* string, size_t length);
+    void key(char const* string);
+
+    void value(char const* string, size_t length);
+    void value(char const* string);
+
+    void value(bool value);
+    void value(nullptr_t value);
+
+    void value(sint_t value);
+    void value(uint_t value);
+    void value(slong_t value);
+    void value(ulong_t value);
+
+    void value(double value);
+
+    size_t depth() const;
+
+  private:
+    BasicOutStream<BufferT>* stream_;
+
+    // bit i is set if the container at depth i + 1 is an object
+    uint64_t objects_;
+    size_t depth_;
+
+    // no value was written in the current container yet
+    bool first_;
+    // a key was written and its value is still missing
+    bool key_;
+
+    bool separate();
+
+    void begin(char open, bool object);
+    void end(char close, bool object);
+
+    void writeString(char const* string, size_t length, bool separator,
+                     char const* suffix, size_t suffix_length);
+
+    template<typename T>
+    void writeInteger(T value);
+  };
+
+  typedef BasicJsonWriter<StreamBuffer> JsonWriter;
+}
+
+
+namespace utl
+{
+  namespace impl
+  {
+    /**
+     * This function finds the first byte in a string that cannot be part of a JSON string as it
+     * is: a quote, a backslash, or a control character.
+     * @param begin begin of range to search
+     * @param end end of range to search
+     * @return pointer to the first byte to escape, 'end' if there is none
+     */
+    inline byte_t const* findJsonEscape(byte_t const* begin, byte_t const* end)
+    {
+#if defined(UTL_SIMD_AVX2)
+      size_t const VECTOR = 32;
+
+      __m256i const quote     = _mm256_set1_epi8('"');
+      __m256i const backslash = _mm256_set1_epi8('\\');
+      __m256i const control   = _mm256_set1_epi8(0x1f);
+
+      auto classify = [&](byte_t const* block) -> uint32_t
+      {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block));
+
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(input, quote),
+                                          _mm256_cmpeq_epi8(input, backslash));
+        special = _mm256_or_si256(special,
+                                  _mm256_cmpeq_epi8(_mm256_min_epu8(input, control), input));
+
+        return static_cast<uint32_t>(_mm256_movemask_epi8(special));
+      };
+#elif defined(UTL_SIMD_SSE2)
+      size_t const VECTOR = 16;
+
+      __m128i const quote     = _mm_set1_epi8('"');
+      __m128i const backslash = _mm_set1_epi8('\\');
+      __m128i const control   = _mm_set1_epi8(0x1f);
+
+      auto classify = [&](byte_t const* block) -> uint32_t
+      {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block));
+
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(input, quote),
+                                       _mm_cmpeq_epi8(input, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(input, control), input));
+
+        return static_cast<uint32_t>(_mm_movemask_epi8(special));
+      };
+#endif
+#if defined(UTL_SIMD_AVX2) || defined(UTL_SIMD_SSE2)
+      if (static_cast<size_t>(end - begin) >= VECTOR)
+      {
+        for ( ; static_cast<size_t>(end - begin) >= VECTOR; begin += VECTOR)
+        {
+          uint32_t mask = classify(begin);
+
+          if (mask != 0)
+            return begin + countTrailingZeros(mask);
+        }
+
+        // the last vector overlaps with bytes already known to need no escaping
+        if (begin != end)
+        {
+          uint32_t mask = classify(end - VECTOR);
+          return mask != 0 ? end - VECTOR + countTrailingZeros(mask) : end;
+        }
+        return end;
+      }
+#endif
+      for ( ; begin != end; ++begin)
+      {
+        if (*begin == '"' || *begin == '\\' || *begin < 0x20)
+          break;
+      }
+      return begin;
+    }
+
+    /**
+     * @param c character to escape, as found by findJsonEscape
+     * @param destination pointer to at least six characters to write the escape sequence to
+     * @return number of characters written
+     */
+    inline size_t escapeJson(byte_t c, char* destination)
+    {
+      destination[0] = '\\';
+
+      switch (c)
+      {
+      case '"':
+      case '\\':
+        destination[1] = static_cast<char>(c);
+        return 2;
+
+      case '\b':
+        destination[1] = 'b';
+        return 2;
+
+      case '\f':
+        destination[1] = 'f';
+        return 2;
+
+      case '\n':
+        destination[1] = 'n';
+        return 2;
+
+      case '\r':
+        destination[1] = 'r';
+        return 2;
+
+      case '\t':
+        destination[1] = 't';
+        return 2;
+
+      default:
+        destination[1] = 'u';
+        destination[2] = '0';
+        destination[3] = '0';
+        destination[4] = HEX_DIGITS[c >> 4];
+        destination[5] = HEX_DIGITS[c & 0x0f];
+        return 6;
+      }
+    }
+  }
+
+
+  /**
+   * @param stream stream to write to
+   */
+  template<typename BufferT>
+  inline BasicJsonWriter<BufferT>::BasicJsonWriter(BasicOutStream<BufferT>& stream)
+    : stream_(&stream),
+      objects_(0),
+      depth_(0),
+      first_(true),
+      key_(false)
+  {
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::beginObject()
+  {
+    begin('{', true);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::endObject()
+  {
+    end('}', true);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::beginArray()
+  {
+    begin('[', false);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::endArray()
+  {
+    end(']', false);
+  }
+
+  /**
+   * This method writes the key of the next member of the current object, the member's value
+   * has to follow.
+   * @param string characters of the key, need not be zero terminated
+   * @param length number of characters of the key
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::key(char const* string, size_t length)
+  {
+    ASSERT(depth_ > 0 && (objects_ >> (depth_ - 1) & 1) != 0);
+    ASSERT(!key_);
+
+    bool separator = !first_;
+    first_ = false;
+
+    writeString(string, length, separator, "\":", 2);
+    key_ = true;
+  }
+
+  /**
+   * @param string zero terminated key
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::key(char const* string)
+  {
+    key(string, lengthBytes(string));
+  }
+
+  /**
+   * @param string characters of the string to write, need not be zero terminated
+   * @param length number of characters to write
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(char const* string, size_t length)
+  {
+    writeString(string, length, separate(), "\"", 1);
+  }
+
+  /**
+   * @param string zero terminated string to write
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(char const* string)
+  {
+    value(string, lengthBytes(string));
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(bool value)
+  {
+    size_t separator = separate() ? 1 : 0;
+
+    if (value)
+      stream_->write(",true" + 1 - separator, 4 + separator);
+    else
+      stream_->write(",false" + 1 - separator, 5 + separator);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(nullptr_t)
+  {
+    size_t separator = separate() ? 1 : 0;
+    stream_->write(",null" + 1 - separator, 4 + separator);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(sint_t value)
+  {
+    writeInteger(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(uint_t value)
+  {
+    writeInteger(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(slong_t value)
+  {
+    writeInteger(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(ulong_t value)
+  {
+    writeInteger(value);
+  }
+
+  /**
+   * @param value value to write in its shortest form, JSON has no representation of infinity
+   *        and NaN, so that they are written as null
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::value(double value)
+  {
+    if (!__builtin_isfinite(value))
+    {
+      this->value(nullptr);
+      return;
+    }
+
+    size_t separator = separate() ? 1 : 0;
+
+    char buffer[1 + MAX_FLOAT_CHARACTERS];
+    buffer[0] = ',';
+    char* end = formatShortest(value, buffer + 1);
+
+    stream_->write(buffer + 1 - separator, end - buffer - 1 + separator);
+  }
+
+  /**
+   * @return number of containers currently open
+   */
+  template<typename BufferT>
+  inline size_t BasicJsonWriter<BufferT>::depth() const
+  {
+    return depth_;
+  }
+
+  /**
+   * This method is invoked in front of each value. Within an object, the separator was already
+   * written along with the value's key.
+   * @return true if a separator has to be written in front of the value, false if not
+   */
+  template<typename BufferT>
+  inline bool BasicJsonWriter<BufferT>::separate()
+  {
+    if (key_)
+    {
+      key_ = false;
+      return false;
+    }
+
+    ASSERT(depth_ == 0 || (objects_ >> (depth_ - 1) & 1) == 0);
+
+    bool separator = !first_ && depth_ > 0;
+    first_ = false;
+    return separator;
+  }
+
+  /**
+   * @param open character opening the container
+   * @param object true if the container is an object, false if it is an array
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::begin(char open, bool object)
+  {
+    ASSERT(depth_ < MAX_DEPTH);
+
+    size_t separator = separate() ? 1 : 0;
+    char characters[] = {',', open};
+
+    stream_->write(characters + 1 - separator, 1 + separator);
+
+    if (object)
+      objects_ |= static_cast<uint64_t>(1) << depth_;
+    else
+      objects_ &= ~(static_cast<uint64_t>(1) << depth_);
+
+    depth_++;
+    first_ = true;
+  }
+
+  /**
+   * @param close character closing the container
+   * @param object true if the container is an object, false if it is an array
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::end(char close, bool object)
+  {
+    ASSERT(depth_ > 0 && !key_);
+
+    depth_--;
+    ASSERT(((objects_ >> depth_ & 1) != 0) == object);
+
+    stream_->write(&close, 1);
+    first_ = false;
+  }
+
+  /**
+   * This method writes a quoted and escaped string. Runs of characters that need no escaping
+   * are written as they are.
+   * @param string characters to write
+   * @param length number of characters to write
+   * @param separator true to write a separator in front of the string
+   * @param suffix characters to write after the string, starting with the closing quote
+   * @param suffix_length number of characters in 'suffix'
+   */
+  template<typename BufferT>
+  inline void BasicJsonWriter<BufferT>::writeString(char const* string, size_t length,
+                                                    bool separator,
+                                                    char const* suffix, size_t suffix_length)
+  {
+    byte_t const* begin = reinterpret_cast<byte_t const*>(string);
+    byte_t const* end   = begin + length;
+
+    stream_->write(separator ? ",\"" : "\"", separator ? 2 : 1);
+
+    for (;;)
+    {
+      byte_t const* next = impl::findJsonEscape(begin, end);
+
+      if (next != begin)
+        stream_->write(reinterpret_cast<char const*>(begin), next - begin);
+
+      if (next == end)
+        break;
+
+      char escape[6];
+      stream_->write(escape, impl::escapeJson(*next, escape));
+
+      begin = next + 1;
+    }
+
+    stream_->write(suffix, suffix_length);
+  }
+
+  /**
+   * @param value integer to write in decimal, regardless of the stream's settings
+   */
+  template<typename BufferT>
+  template<typename T>
+  inline void BasicJsonWriter<BufferT>::writeInteger(T value)
+  {
+    size_t separator = separate() ? 1 : 0;
+
+    char buffer[1 + MAX_INTEGER_CHARACTERS];
+    buffer[0] = ',';
+    char* end = formatInteger(value, buffer + 1, BASE_DECIMAL, 0);
+
+    stream_->write(buffer + 1 - separator, end - buffer - 1 + separator);
+  }
+}
+
+
+#endif
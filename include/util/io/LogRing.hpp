@@ -0,0 +1,561 @@
+// LogRing.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLLOGRING_HPP
+#define UTLLOGRING_HPP
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class is a ring of fixed size records shared by many producing threads and written
+   * out to a StreamBuffer (the sink) by a single consumer thread. A producer reserves a record
+   * with a single atomic increment, formats directly into it, and commits it by storing its
+   * sequence number into the record header. The consumer puts the records into the sink
+   * strictly in the order they were reserved, and flushes the sink whenever it caught up.
+   * Producers do not use the ring directly but through a LogRingBuffer object each.
+   * If the ring is full, producers block until the consumer made room. A record that was
+   * reserved but not yet committed holds up the records following it, so producers should
+   * flush their LogRingBuffer at the end of each message.
+   * If the consumer thread cannot be started, records are written to the sink synchronously
+   * when they are committed.
+   */
+  class LogRing
+  {
+  public:
+    enum
+    {
+      RECORD_SIZE  = 256,
+      RECORD_COUNT = 4096,
+    };
+
+    LogRing(StreamBuffer& sink,
+            size_t record_size = RECORD_SIZE,
+            size_t record_count = RECORD_COUNT);
+    ~LogRing();
+
+    LogRing(LogRing const&) = delete;
+    LogRing& operator =(LogRing const&) = delete;
+
+    void sync();
+
+    size_t recordSize() const;
+    uint64_t records() const;
+
+  private:
+    friend class LogRingBuffer;
+
+    /**
+     * The header in front of the data of each record.
+     */
+    struct Header
+    {
+      uint64_t committed;
+      uint64_t size;
+    };
+
+    StreamBuffer* sink_;
+
+    byte_t* memory_;
+    byte_t* records_;
+    size_t record_size_;
+    size_t record_count_;
+
+    // written by the producers
+    alignas(64) uint64_t reserved_;
+    uint32_t waiting_;
+
+    // written by the consumer
+    alignas(64) uint64_t head_;
+    uint64_t flushed_;
+    bool consumer_sleeping_;
+
+    alignas(64) bool stop_;
+    bool running_;
+
+    pthread_t thread_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t data_;
+    pthread_cond_t space_;
+
+    Header* header(uint64_t sequence) const;
+    byte_t* data(uint64_t sequence) const;
+    size_t capacity() const;
+
+    uint64_t reserve();
+    void commit(uint64_t sequence, size_t size);
+
+    bool committed(uint64_t sequence) const;
+    void wait(uint64_t const& position, uint64_t value);
+    void wakeProducers();
+
+    static void* run(void* ring);
+    void work();
+  };
+
+
+  /**
+   * This class implements the StreamBuffer interface on top of a LogRing. Each producing
+   * thread uses an object of its own. A record is reserved on the first put after a flush, and
+   * committed by the next flush. Data not fitting into a single record is spread over several
+   * ones, which may then be interleaved with records of other threads.
+   */
+  class LogRingBuffer final: public StreamBuffer
+  {
+  public:
+    explicit LogRingBuffer(LogRing& ring);
+    ~LogRingBuffer();
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+  private:
+    LogRing* ring_;
+    uint64_t sequence_;
+    byte_t* record_;
+    byte_t* current_;
+    byte_t* end_;
+
+    void nextRecord();
+    void overflow(byte_t element);
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param sink buffer to write all records to, it has to outlive the LogRing object
+   * @param record_size size of each record, including a small header, it is rounded up to a
+   *        multiple of the cache line size
+   * @param record_count number of records in the ring, it is rounded up to a power of two
+   */
+  inline LogRing::LogRing(StreamBuffer& sink, size_t record_size, size_t record_count)
+    : sink_(&sink),
+      memory_(nullptr),
+      records_(nullptr),
+      record_size_(roundUp(max(record_size, 2 * sizeof(Header)), 64)),
+      record_count_(2),
+      reserved_(0),
+      waiting_(0),
+      head_(0),
+      flushed_(0),
+      consumer_sleeping_(false),
+      stop_(false),
+      running_(false),
+      thread_(),
+      mutex_(),
+      data_(),
+      space_()
+  {
+    while (record_count_ < record_count)
+      record_count_ *= 2;
+
+    // records on cache lines of their own, so that producers do not get in each other's way
+    memory_  = new byte_t[record_size_ * record_count_ + 63];
+    records_ = roundUp(memory_, 64);
+
+    for (uint64_t i = 0; i < record_count_; ++i)
+    {
+      header(i)->committed = 0;
+      header(i)->size = 0;
+    }
+
+    pthread_mutex_init(&mutex_, nullptr);
+    pthread_cond_init(&data_, nullptr);
+    pthread_cond_init(&space_, nullptr);
+
+    running_ = pthread_create(&thread_, nullptr, &LogRing::run, this) == 0;
+  }
+
+  /**
+   * The destructor waits for all committed records to be written and the sink to be flushed.
+   * All LogRingBuffer objects using the ring have to be destroyed before.
+   */
+  inline LogRing::~LogRing()
+  {
+    if (running_)
+    {
+      pthread_mutex_lock(&mutex_);
+      __atomic_store_n(&stop_, true, __ATOMIC_RELAXED);
+      pthread_cond_signal(&data_);
+      pthread_mutex_unlock(&mutex_);
+
+      pthread_join(thread_, nullptr);
+    }
+
+    pthread_cond_destroy(&space_);
+    pthread_cond_destroy(&data_);
+    pthread_mutex_destroy(&mutex_);
+
+    delete[] memory_;
+  }
+
+  /**
+   * This method waits until all records reserved so far are committed and written, and the
+   * sink is flushed. The calling thread has to flush its own LogRingBuffer before.
+   */
+  inline void LogRing::sync()
+  {
+    if (running_)
+      wait(flushed_, __atomic_load_n(&reserved_, __ATOMIC_RELAXED));
+  }
+
+  /**
+   * @return size of a record, including its header
+   */
+  inline size_t LogRing::recordSize() const
+  {
+    return record_size_;
+  }
+
+  /**
+   * @return number of records written to the sink so far
+   */
+  inline uint64_t LogRing::records() const
+  {
+    return __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  }
+
+  /**
+   * @param sequence sequence number of a record
+   * @return header of the record with the given sequence number
+   */
+  inline LogRing::Header* LogRing::header(uint64_t sequence) const
+  {
+    size_t index = static_cast<size_t>(sequence & (record_count_ - 1));
+    return reinterpret_cast<Header*>(records_ + index * record_size_);
+  }
+
+  /**
+   * @param sequence sequence number of a record
+   * @return pointer to the data of the record with the given sequence number
+   */
+  inline byte_t* LogRing::data(uint64_t sequence) const
+  {
+    return reinterpret_cast<byte_t*>(header(sequence) + 1);
+  }
+
+  /**
+   * @return number of bytes of data a record can hold
+   */
+  inline size_t LogRing::capacity() const
+  {
+    return record_size_ - sizeof(Header);
+  }
+
+  /**
+   * This method reserves the next record, waiting for it to become free if necessary.
+   * @return sequence number of the reserved record
+   */
+  inline uint64_t LogRing::reserve()
+  {
+    uint64_t sequence = __atomic_fetch_add(&reserved_, 1, __ATOMIC_RELAXED);
+
+    // the record is free once the consumer wrote the one using it a lap earlier
+    if (running_ && sequence >= record_count_)
+      wait(head_, sequence - record_count_ + 1);
+
+    return sequence;
+  }
+
+  /**
+   * This method commits a record, making it available to the consumer.
+   * @param sequence sequence number of the record
+   * @param size number of bytes of data in the record
+   */
+  inline void LogRing::commit(uint64_t sequence, size_t size)
+  {
+    if (!running_)
+    {
+      pthread_mutex_lock(&mutex_);
+      sink_->put(data(sequence), size);
+      sink_->flush();
+      pthread_mutex_unlock(&mutex_);
+      return;
+    }
+
+    Header* header = this->header(sequence);
+    header->size = size;
+    __atomic_store_n(&header->committed, sequence + 1, __ATOMIC_RELEASE);
+
+    // either the consumer sees the commit or we see that it went to sleep
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&consumer_sleeping_, __ATOMIC_RELAXED))
+    {
+      pthread_mutex_lock(&mutex_);
+      pthread_cond_signal(&data_);
+      pthread_mutex_unlock(&mutex_);
+    }
+  }
+
+  /**
+   * @param sequence sequence number of a record
+   * @return true if the record with the given sequence number is committed
+   */
+  inline bool LogRing::committed(uint64_t sequence) const
+  {
+    return __atomic_load_n(&header(sequence)->committed, __ATOMIC_ACQUIRE) == sequence + 1;
+  }
+
+  /**
+   * This method blocks until a position maintained by the consumer reached the given value.
+   * @param position position to wait for
+   * @param value value to wait for
+   */
+  inline void LogRing::wait(uint64_t const& position, uint64_t value)
+  {
+    if (__atomic_load_n(&position, __ATOMIC_ACQUIRE) >= value)
+      return;
+
+    __atomic_fetch_add(&waiting_, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&mutex_);
+
+    while (__atomic_load_n(&position, __ATOMIC_ACQUIRE) < value)
+      pthread_cond_wait(&space_, &mutex_);
+
+    pthread_mutex_unlock(&mutex_);
+
+    __atomic_fetch_sub(&waiting_, 1, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * This method wakes up all producers blocked in wait, if there are any.
+   */
+  inline void LogRing::wakeProducers()
+  {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&waiting_, __ATOMIC_RELAXED) != 0)
+    {
+      pthread_mutex_lock(&mutex_);
+      pthread_cond_broadcast(&space_);
+      pthread_mutex_unlock(&mutex_);
+    }
+  }
+
+  /**
+   * This function is the entry point of the consumer thread.
+   * @param ring pointer to the LogRing the thread works for
+   * @return nullptr
+   */
+  inline void* LogRing::run(void* ring)
+  {
+    static_cast<LogRing*>(ring)->work();
+    return nullptr;
+  }
+
+  /**
+   * This method writes the committed records to the sink until the ring is destroyed.
+   */
+  inline void LogRing::work()
+  {
+    uint64_t head = 0;
+    uint64_t flushed = 0;
+
+    // records are freed in batches, waking up blocked producers for each one is expensive
+    uint64_t batch = max(record_count_ / 8, static_cast<size_t>(1));
+
+    for (;;)
+    {
+      if (committed(head))
+      {
+        do
+        {
+          sink_->put(data(head), static_cast<size_t>(header(head)->size));
+          ++head;
+        } while (committed(head) && (head & (batch - 1)) != 0);
+
+        __atomic_store_n(&head_, head, __ATOMIC_RELEASE);
+        wakeProducers();
+        continue;
+      }
+
+      // give producers a chance to commit more before flushing the sink and going to sleep
+      for (int i = 0; i < 16 && !committed(head); ++i)
+        sched_yield();
+
+      if (committed(head))
+        continue;
+
+      // we caught up (or wait for a record still being formatted), flush the sink
+      if (flushed != head)
+      {
+        sink_->flush();
+        flushed = head;
+
+        __atomic_store_n(&flushed_, flushed, __ATOMIC_RELEASE);
+        wakeProducers();
+      }
+
+      __atomic_store_n(&consumer_sleeping_, true, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+      pthread_mutex_lock(&mutex_);
+
+      while (!committed(head) && !__atomic_load_n(&stop_, __ATOMIC_RELAXED))
+        pthread_cond_wait(&data_, &mutex_);
+
+      bool stop = !committed(head);
+
+      pthread_mutex_unlock(&mutex_);
+
+      __atomic_store_n(&consumer_sleeping_, false, __ATOMIC_RELAXED);
+
+      if (stop)
+        break;
+    }
+  }
+
+
+  /**
+   * @param ring ring to write records to, it has to outlive the LogRingBuffer object
+   */
+  inline LogRingBuffer::LogRingBuffer(LogRing& ring)
+    : StreamBuffer(),
+      ring_(&ring),
+      sequence_(0),
+      record_(nullptr),
+      current_(nullptr),
+      end_(nullptr)
+  {
+  }
+
+  /**
+   * The destructor commits the current record, if any.
+   */
+  inline LogRingBuffer::~LogRingBuffer()
+  {
+    flush();
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void LogRingBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void LogRingBuffer::put(byte_t const* elements, size_t size)
+  {
+    while (size > 0)
+    {
+      if (current_ == end_)
+        nextRecord();
+
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void LogRingBuffer::fill(byte_t element, size_t count)
+  {
+    while (count > 0)
+    {
+      if (current_ == end_)
+        nextRecord();
+
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+    }
+  }
+
+  /**
+   * This method commits the current record, so that the consumer writes it out. It never
+   * blocks.
+   */
+  inline void LogRingBuffer::flush()
+  {
+    if (record_ == nullptr)
+      return;
+
+    ring_->commit(sequence_, current_ - record_);
+
+    record_  = nullptr;
+    current_ = nullptr;
+    end_     = nullptr;
+  }
+
+  /**
+   * This method commits the current record, if any, and reserves the next one.
+   */
+  inline void LogRingBuffer::nextRecord()
+  {
+    flush();
+
+    sequence_ = ring_->reserve();
+    record_   = ring_->data(sequence_);
+    current_  = record_;
+    end_      = record_ + ring_->capacity();
+  }
+
+  /**
+   * This method handles a put into a full (or no) record.
+   * @param element byte to put into the buffer after reserving a record
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void LogRingBuffer::overflow(byte_t element)
+  {
+    nextRecord();
+
+    *current_ = element;
+    current_++;
+  }
+}
+
+
+#endif
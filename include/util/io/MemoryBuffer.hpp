@@ -21,6 +21,8 @@
 #define UTLMEMORYBUFFER_HPP
 
 #include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Algorithm.hpp"
 #include "util/io/StreamBuffer.hpp"
 
 
@@ -46,13 +48,15 @@ namespace utl
 
 
   /**
-   * This class implements the StreamBuffer interface for a region of memory.
+   * This class implements the StreamBuffer interface for a region of memory. The class is final,
+   * so that calls through a MemoryBuffer (as made by a BasicOutStream for this buffer type) are
+   * not virtual and can be inlined.
    * @see StreamBuffer
    * @todo think about exposing the BufferSize parameter
    * @todo remove WriterT parameter once we got rid of flush functionality
    */
   template<size_t BufferSize, typename WriterT>
-  class MemoryBuffer: public StreamBuffer
+  class MemoryBuffer final: public StreamBuffer
   {
   public:
     MemoryBuffer(WriterT const& writer);
@@ -60,6 +64,8 @@ namespace utl
     virtual void put(byte_t value) override;
     virtual void put(byte_t const* range, size_t size) override;
 
+    virtual void fill(byte_t element, size_t count) override;
+
     virtual void flush() override;
 
     byte_t const* buffer() const;
@@ -73,6 +79,8 @@ namespace utl
     byte_t* const end_;
 
     byte_t* current_;
+
+    void overflow(byte_t element);
   };
 }
 
@@ -99,8 +107,11 @@ namespace utl
   template<size_t BufferSize, typename WriterT>
   inline void MemoryBuffer<BufferSize, WriterT>::put(byte_t element)
   {
-    if (current_ == end_)
-      flush();
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
 
     *current_ = element;
     current_++;
@@ -112,7 +123,53 @@ namespace utl
   template<size_t BufferSize, typename WriterT>
   inline void MemoryBuffer<BufferSize, WriterT>::put(byte_t const* elements, size_t size)
   {
-    // @todo implement me!
+    // payloads at least as large as the buffer itself are not staged but handed to the writer
+    // directly, after the data buffered so far
+    if (size >= BufferSize)
+    {
+      if (current_ != begin_)
+        flush();
+
+      writer_(elements, size);
+      return;
+    }
+
+    size_t available = end_ - current_;
+
+    // fill up the buffer and flush it, the remainder is guaranteed to fit afterwards
+    if (size > available)
+    {
+      copy(elements, elements + available, current_);
+      current_ = end_;
+      flush();
+
+      elements += available;
+      size     -= available;
+    }
+
+    current_ = copy(elements, elements + size, current_);
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  template<size_t BufferSize, typename WriterT>
+  inline void MemoryBuffer<BufferSize, WriterT>::fill(byte_t element, size_t count)
+  {
+    for (;;)
+    {
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+
+      if (count == 0)
+        break;
+
+      flush();
+    }
   }
 
   /**
@@ -127,6 +184,21 @@ namespace utl
     current_ = begin_;
   }
 
+  /**
+   * This method handles a put into a full buffer. It is kept out of line, so that the common
+   * path of put stays small enough to be inlined everywhere.
+   * @param element byte to put into the buffer after flushing it
+   */
+  template<size_t BufferSize, typename WriterT>
+  __attribute__((noinline))
+  void MemoryBuffer<BufferSize, WriterT>::overflow(byte_t element)
+  {
+    flush();
+
+    *current_ = element;
+    current_++;
+  }
+
   /**
    * @return pointer to buffer memory
    */
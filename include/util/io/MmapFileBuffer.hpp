@@ -0,0 +1,377 @@
+// MmapFileBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLMMAPFILEBUFFER_HPP
+#define UTLMMAPFILEBUFFER_HPP
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the StreamBuffer interface for a file by writing directly into a
+   * shared memory mapping of it, so that no write system calls are required at all. Output
+   * starts at the current offset of the file descriptor. Whenever the mapping is exhausted, the
+   * file is extended using ftruncate and the mapping is enlarged using mremap, by 'growth' bytes
+   * (or more, for larger payloads) at a time. The kernel is told that the mapping is accessed
+   * sequentially and, where supported, the new pages are faulted in right away.
+   * Once closed (at the latest on destruction), the file is truncated to the end of the data
+   * written and the file offset is set to it.
+   * Errors (e.g., a descriptor that cannot be mapped or a full disk on growing) are recorded,
+   * and all further output is discarded.
+   * @note as with any mapping of a file, a process writing to it receives SIGBUS if the file is
+   *       truncated by someone else at the same time
+   */
+  class MmapFileBuffer final: public StreamBuffer
+  {
+  public:
+    enum
+    {
+      GROWTH = 64 * 1024 * 1024,
+    };
+
+    MmapFileBuffer(int fd, size_t growth = GROWTH);
+    ~MmapFileBuffer();
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+    bool sync();
+    bool close();
+
+    size_t size() const;
+
+    bool good() const;
+    int error() const;
+
+  private:
+    int fd_;
+    size_t growth_;
+
+    byte_t* mapping_;
+    size_t mapped_;
+    off_t offset_;
+    off_t file_size_;
+    size_t start_;
+
+    byte_t* current_;
+    byte_t* end_;
+
+    size_t position_;
+    bool discarding_;
+    byte_t discard_[64];
+
+    int error_;
+    bool closed_;
+
+    size_t position() const;
+
+    bool reserve(size_t size);
+    void discard(int error);
+
+    void overflow(byte_t element);
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param fd file descriptor of a file opened for reading and writing, it has to stay valid
+   *        until the buffer is closed
+   * @param growth number of bytes to extend the file and the mapping by at a time, it is
+   *        rounded up to a multiple of the page size
+   */
+  inline MmapFileBuffer::MmapFileBuffer(int fd, size_t growth)
+    : StreamBuffer(),
+      fd_(fd),
+      growth_(0),
+      mapping_(nullptr),
+      mapped_(0),
+      offset_(0),
+      file_size_(0),
+      start_(0),
+      current_(nullptr),
+      end_(nullptr),
+      position_(0),
+      discarding_(false),
+      error_(0),
+      closed_(false)
+  {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    growth_ = (max(growth, page) + page - 1) & ~(page - 1);
+
+    struct stat status;
+    off_t offset = lseek(fd_, 0, SEEK_CUR);
+
+    if (offset < 0 || fstat(fd_, &status) != 0)
+    {
+      discard(errno);
+      return;
+    }
+
+    // mappings have to start at a page boundary
+    offset_    = offset & ~static_cast<off_t>(page - 1);
+    file_size_ = status.st_size;
+    start_     = static_cast<size_t>(offset - offset_);
+    position_  = start_;
+
+    // the file is left the way it was if it cannot be mapped after extending it
+    if (!reserve(0) && file_size_ != status.st_size && ftruncate(fd_, status.st_size) != 0)
+      discard(errno);
+  }
+
+  /**
+   * The destructor closes the buffer.
+   */
+  inline MmapFileBuffer::~MmapFileBuffer()
+  {
+    close();
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void MmapFileBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void MmapFileBuffer::put(byte_t const* elements, size_t size)
+  {
+    if (__builtin_expect(size > static_cast<size_t>(end_ - current_), 0) && !reserve(size))
+      return;
+
+    __builtin_memcpy(current_, elements, size);
+    current_ += size;
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void MmapFileBuffer::fill(byte_t element, size_t count)
+  {
+    if (__builtin_expect(count > static_cast<size_t>(end_ - current_), 0) && !reserve(count))
+      return;
+
+    __builtin_memset(current_, element, count);
+    current_ += count;
+  }
+
+  /**
+   * The data is part of the file as soon as it is put into the buffer, so there is nothing to
+   * flush.
+   * @see sync
+   */
+  inline void MmapFileBuffer::flush()
+  {
+  }
+
+  /**
+   * This method makes the data written so far durable by means of msync.
+   * @return true if no error occurred so far, false otherwise
+   */
+  inline bool MmapFileBuffer::sync()
+  {
+    if (!closed_ && mapping_ != nullptr && msync(mapping_, mapped_, MS_SYNC) != 0)
+      discard(errno);
+
+    return good();
+  }
+
+  /**
+   * This method unmaps the file, truncates it to the end of the data written, and sets the
+   * file offset to the end. Output put into the buffer afterwards is discarded.
+   * @return true if no error occurred so far, false otherwise
+   */
+  inline bool MmapFileBuffer::close()
+  {
+    if (closed_)
+      return good();
+
+    closed_ = true;
+
+    if (mapping_ == nullptr)
+      return good();
+
+    off_t end = offset_ + static_cast<off_t>(position());
+
+    discard(0);
+
+    munmap(mapping_, mapped_);
+    mapping_ = nullptr;
+
+    if (ftruncate(fd_, end) != 0 || lseek(fd_, end, SEEK_SET) < 0)
+      discard(errno);
+
+    return good();
+  }
+
+  /**
+   * @return number of bytes written into the file so far
+   */
+  inline size_t MmapFileBuffer::size() const
+  {
+    return position() - start_;
+  }
+
+  /**
+   * @return true if no error occurred so far, false otherwise
+   */
+  inline bool MmapFileBuffer::good() const
+  {
+    return error_ == 0;
+  }
+
+  /**
+   * @return errno value of the first error that occurred or zero if there was none
+   */
+  inline int MmapFileBuffer::error() const
+  {
+    return error_;
+  }
+
+  /**
+   * @return offset of the end of the data written relative to the start of the mapping
+   */
+  inline size_t MmapFileBuffer::position() const
+  {
+    if (discarding_)
+      return position_;
+
+    if (mapping_ == nullptr)
+      return start_;
+
+    return current_ - mapping_;
+  }
+
+  /**
+   * This method makes sure there is room for at least the given number of bytes, by extending
+   * the file and the mapping if necessary.
+   * @param size number of bytes to make room for
+   * @return true if there is room, false if output is discarded
+   */
+  inline bool MmapFileBuffer::reserve(size_t size)
+  {
+    if (error_ != 0 || closed_)
+    {
+      discard(0);
+      return false;
+    }
+
+    size_t position = mapping_ != nullptr ? current_ - mapping_ : start_;
+    size_t needed   = position + size;
+    size_t mapped   = mapped_ + growth_;
+
+    if (needed > mapped)
+      mapped = (needed + growth_ - 1) / growth_ * growth_;
+
+    // the file has to cover the whole mapping, accessing pages beyond its end raises SIGBUS
+    off_t end = offset_ + static_cast<off_t>(mapped);
+
+    if (end > file_size_)
+    {
+      if (ftruncate(fd_, end) != 0)
+      {
+        discard(errno);
+        return false;
+      }
+      file_size_ = end;
+    }
+
+    void* mapping;
+
+    if (mapping_ == nullptr)
+      mapping = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset_);
+    else
+      mapping = mremap(mapping_, mapped_, mapped, MREMAP_MAYMOVE);
+
+    if (mapping == MAP_FAILED)
+    {
+      discard(errno);
+      return false;
+    }
+
+    madvise(mapping, mapped, MADV_SEQUENTIAL);
+#ifdef MADV_POPULATE_WRITE
+    // faulting in the new pages in one go is cheaper than taking a fault for each of them
+    madvise(static_cast<byte_t*>(mapping) + mapped_, mapped - mapped_, MADV_POPULATE_WRITE);
+#endif
+
+    mapping_ = static_cast<byte_t*>(mapping);
+    mapped_  = mapped;
+    current_ = mapping_ + position;
+    end_     = mapping_ + mapped_;
+    return true;
+  }
+
+  /**
+   * This method makes all further output go to a small scratch area.
+   * @param error errno value to record, zero for none (only the first error is kept)
+   */
+  inline void MmapFileBuffer::discard(int error)
+  {
+    position_   = position();
+    discarding_ = true;
+
+    if (error_ == 0)
+      error_ = error;
+
+    current_ = discard_;
+    end_     = discard_ + sizeof(discard_);
+  }
+
+  /**
+   * This method handles a put into a full mapping.
+   * @param element byte to put into the buffer after making room for it
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void MmapFileBuffer::overflow(byte_t element)
+  {
+    reserve(1);
+
+    *current_ = element;
+    current_++;
+  }
+}
+
+
+#endif
@@ -21,25 +21,56 @@
 #define UTLOUTSTREAM_HPP
 
 #include <type/Types.hpp>
-#include <type/Traits.hpp>
 
 #include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/Encode.hpp"
+#include "util/FormatFloat.hpp"
+#include "util/FormatInteger.hpp"
+#include "util/NumberBase.hpp"
+#include "util/StringLength.hpp"
+#include "util/io/CountingBuffer.hpp"
 #include "util/io/StreamBuffer.hpp"
 
 
 namespace utl
 {
   /**
-   * This class can be used for printing out various values.
-   * @todo think about adding support for floating point values
+   * The ways values can be aligned within the width set for them.
+   */
+  enum Alignment
+  {
+    ALIGN_LEFT,
+    ALIGN_RIGHT
+  };
+
+  /**
+   * The textual encodings byte ranges can be printed in.
+   */
+  enum Encoding
+  {
+    ENCODING_HEX,
+    ENCODING_BASE64
+  };
+
+
+  /**
+   * This class template can be used for printing out various values. The buffer type is known
+   * statically, so that calls into it are not virtual and can be inlined, provided the buffer
+   * class (or the methods used) is final. Printing a character into a MemoryBuffer, for
+   * instance, boils down to a capacity check and a pointer increment.
+   * The type-erased form, writing into an arbitrary StreamBuffer by means of virtual calls, is
+   * available as OutStream.
+   * @param BufferT type of buffer to print to, it has to provide the interface of StreamBuffer
    * @todo add support for printing bools
    * @todo think about removing flush functionality or at least creating a derived class that
    *       provides it
    */
-  class OutStream
+  template<typename BufferT>
+  class BasicOutStream
   {
   public:
-    OutStream(StreamBuffer& buffer);
+    BasicOutStream(BufferT& buffer);
 
     void print(char const* value);
     void print(void const* value);
@@ -57,303 +88,473 @@ namespace utl
     void print(ulong_t value);
     void print(slong_t value);
 
+    void print(float value);
+    void print(double value);
+
     void print(nullptr_t value);
 
+    void write(char const* string, size_t length);
+
+    template<typename T>
+    void writeInteger(T value, uint8_t base);
+
+    void writeEncoded(byte_t const* data, size_t size, Encoding encoding);
+
     void setBase(uint8_t base);
     void setFixed(bool fixed);
 
+    void setFloatFormat(FloatFormat format);
+    void setPrecision(uint8_t precision);
+
+    void setWidth(size_t width);
+    void setFill(char fill);
+    void setAlignment(Alignment alignment);
+
     void flush();
 
   private:
-    StreamBuffer* buffer_;
+    BufferT* buffer_;
 
     uint8_t base_;
     bool fixed_;
 
-    template<typename T>
-    void printSignedValue(T value);
+    FloatFormat format_;
+    uint8_t precision_;
 
-    template<typename T>
-    void printUnsignedValue(T value);
+    size_t width_;
+    char fill_;
+    Alignment alignment_;
 
-    template<typename T>
-    void printUnsignedValueImpl(T value);
+    size_t padBefore(size_t length);
+    void padAfter(size_t padding);
 
-    void printChar(char c);
-  };
+    void printPadded(char const* string, size_t length);
 
+    template<typename T>
+    void printInteger(T value);
 
-  OutStream& bin(OutStream& stream);
-  OutStream& oct(OutStream& stream);
-  OutStream& dec(OutStream& stream);
-  OutStream& hex(OutStream& stream);
-  OutStream& fix(OutStream& stream);
-  OutStream& var(OutStream& stream);
+    void printFloat(double value);
 
-  OutStream& flush(OutStream& stream);
+    void printChar(char c);
+  };
 
-  template<typename T>
-  OutStream& operator << (OutStream& stream, T value);
+  typedef BasicOutStream<StreamBuffer> OutStream;
+
+
+  template<typename BufferT>
+  BasicOutStream<BufferT>& bin(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& oct(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& dec(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& hex(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& fix(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& var(BasicOutStream<BufferT>& stream);
+
+  template<typename BufferT>
+  BasicOutStream<BufferT>& gen(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& sci(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& fxp(BasicOutStream<BufferT>& stream);
+
+  struct Precision;
+  Precision precision(uint8_t precision);
+
+  template<typename BufferT>
+  BasicOutStream<BufferT>& left(BasicOutStream<BufferT>& stream);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& right(BasicOutStream<BufferT>& stream);
+
+  struct Width;
+  Width width(size_t width);
+
+  struct Fill;
+  Fill fill(char fill);
+
+  struct EncodedBytes;
+  EncodedBytes hexBytes(void const* data, size_t size);
+  EncodedBytes base64Bytes(void const* data, size_t size);
+
+  template<typename BufferT>
+  BasicOutStream<BufferT>& flush(BasicOutStream<BufferT>& stream);
+
+  template<typename BufferT, typename T>
+  BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, T value);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, Precision precision);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, Width width);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, Fill fill);
+  template<typename BufferT>
+  BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, EncodedBytes bytes);
 }
 
 
 namespace utl
 {
-  /**
-   * This template calculates the greatest power to Base that can be stored within the given
-   * datatype T.
-   * E.g.
-   *   - Base = 10, T is 16 bit unsigned value -> GreatestPower::X = 10000 = 10^4 because
-   *     100000 = 10^5 would cause the datatype to overflow
-   *   - Base = 2,  T is 32 bit signed value   -> GreatestPower::X = 1073741824 = 2^30 because
-   *     2147483648 = 2^31 would be one above the maximum value the type may store
-   * @param T datatype to store value in
-   * @param Base
-   */
-  template<typename T, unsigned long Base>
-  struct GreatestPower
+  namespace impl
   {
     /**
-     * @note though Value should also be of type T we cannot change this, because g++ cannot find
-     *       the template specialication in that case and recurses like 500 times and cancels
-     * @todo it would be nice, however, to find a way to make Value of type T anyway
+     * This function formats an integer into a local buffer and hands the result to the given
+     * stream buffer in a single call.
+     * @see formatInteger
      */
-    template<unsigned long Value = Base,
-             unsigned long Max   = sizeof(T) * 8,
-             unsigned long I     = Max - 1>
-    struct IncreasePower
+    template<typename BufferT, typename T>
+    inline void putInteger(BufferT& buffer, T value, uint8_t base, size_t width)
     {
-      static T const X1   = static_cast<T>(Value);
-      static T const X2   = static_cast<T>(X1 * Base);
-      static T const Stop = X2 / Base != X1 ? 0 : I - 1;
+      char characters[MAX_INTEGER_CHARACTERS];
+      char* end = formatInteger(value, characters, base, width);
 
-      static T const X = Stop != 0 ? IncreasePower<X2, Max, Stop>::X : X1;
-    };
+      buffer.put(reinterpret_cast<byte_t const*>(characters), end - characters);
+    }
 
     /**
-     * This specialication cancels the recursion that will occur in the IncreasePower template.
+     * This overload of putInteger only accounts for the characters the integer takes, they are
+     * calculated from the number of digits and never generated.
      */
-    template<unsigned long Value,
-             unsigned long Max>
-    struct IncreasePower<Value, Max, 0>
+    template<typename T>
+    inline void putInteger(CountingBuffer& buffer, T value, uint8_t base, size_t width)
     {
-      static T const X = 0;
-    };
+      buffer.add(integerLength(value, base, width));
+    }
 
-    static T const X = IncreasePower<>::X;
-  };
+    /**
+     * The number of bytes encoded into a local buffer at a time. It is a multiple of three, so
+     * that only the last chunk of base64 output is padded.
+     */
+    size_t const ENCODE_CHUNK = 768;
 
-  template<typename T>
-  T getGreatestPower(uint8_t base)
-  {
-    switch(base)
+    /**
+     * This function encodes a byte range into a local buffer, chunk by chunk, and hands each
+     * chunk to the given stream buffer in a single call.
+     * @see hexEncode
+     * @see base64Encode
+     */
+    template<typename BufferT>
+    inline void putEncoded(BufferT& buffer, byte_t const* data, size_t size, Encoding encoding)
     {
-    case 2:
-      return GreatestPower<T, 2>::X;
-
-    case 3:
-      return GreatestPower<T, 3>::X;
-
-    case 4:
-      return GreatestPower<T, 4>::X;
-
-    case 5:
-      return GreatestPower<T, 5>::X;
-
-    case 6:
-      return GreatestPower<T, 6>::X;
-
-    case 7:
-      return GreatestPower<T, 7>::X;
-
-    case 8:
-      return GreatestPower<T, 8>::X;
-
-    case 9:
-      return GreatestPower<T, 9>::X;
-
-    case 10:
-      return GreatestPower<T, 10>::X;
-
-    case 11:
-      return GreatestPower<T, 11>::X;
-
-    case 12:
-      return GreatestPower<T, 12>::X;
+      char characters[2 * ENCODE_CHUNK];
 
-    case 13:
-      return GreatestPower<T, 13>::X;
+      while (size > 0)
+      {
+        size_t count = min(size, ENCODE_CHUNK);
+        char* end;
 
-    case 14:
-      return GreatestPower<T, 14>::X;
+        if (encoding == ENCODING_HEX)
+          end = hexEncode(data, data + count, characters);
+        else
+          end = base64Encode(data, data + count, characters);
 
-    case 15:
-      return GreatestPower<T, 15>::X;
+        buffer.put(reinterpret_cast<byte_t const*>(characters), end - characters);
 
-    case 16:
-      return GreatestPower<T, 16>::X;
+        data += count;
+        size -= count;
+      }
     }
-    return 0;
-  }
 
-  inline char makeDigit(char c)
-  {
-    if (c <= 9)
-      return c + '0';
-    else
-      return c - 10 + 'A';
+    /**
+     * This overload of putEncoded only accounts for the characters the encoded range takes.
+     */
+    inline void putEncoded(CountingBuffer& buffer,
+                           byte_t const*,
+                           size_t size,
+                           Encoding encoding)
+    {
+      if (encoding == ENCODING_HEX)
+        buffer.add(hexEncodedLength(size));
+      else
+        buffer.add(base64EncodedLength(size));
+    }
   }
 
-  enum
-  {
-    BASE_MIN         = 1,
-    BASE_BINARY      = 2,
-    BASE_OCTAL       = 8,
-    BASE_DECIMAL     = 10,
-    BASE_HEXADECIMAL = 16,
-    BASE_MAX         = 17
-  };
-
 
   /**
    * @param buffer buffer to be used
    */
-  inline OutStream::OutStream(StreamBuffer& buffer)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>::BasicOutStream(BufferT& buffer)
     : buffer_(&buffer),
       base_(BASE_DECIMAL),
-      fixed_(false)
+      fixed_(false),
+      format_(FLOAT_SHORTEST),
+      precision_(6),
+      width_(0),
+      fill_(' '),
+      alignment_(ALIGN_RIGHT)
   {
   }
 
-  inline void OutStream::print(char const* value)
+  /**
+   * @param value zero terminated string to print, it is handed to the buffer as a whole
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(char const* value)
   {
-    for ( ; *value != '\0'; ++value)
-      print(*value);
+    printPadded(value, lengthBytes(value));
   }
 
-  inline void OutStream::print(void const* value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(void const* value)
   {
-    printUnsignedValue(reinterpret_cast<byte_t const*>(value) -
-                       reinterpret_cast<byte_t const*>(0));
+    printInteger(static_cast<ulong_t>(reinterpret_cast<byte_t const*>(value) -
+                                      reinterpret_cast<byte_t const*>(0)));
   }
 
-  inline void OutStream::print(char value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(char value)
   {
     printChar(value);
   }
 
-  inline void OutStream::print(uchar_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(uchar_t value)
   {
-    printUnsignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(schar_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(schar_t value)
   {
-    printSignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(ushort_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(ushort_t value)
   {
-    printUnsignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(sshort_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(sshort_t value)
   {
-    printSignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(uint_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(uint_t value)
   {
-    printUnsignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(sint_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(sint_t value)
   {
-    printSignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(ulong_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(ulong_t value)
   {
-    printUnsignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(slong_t value)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(slong_t value)
   {
-    printSignedValue(value);
+    printInteger(value);
   }
 
-  inline void OutStream::print(nullptr_t value)
+  /**
+   * @param value value to print, in the shortest form that reads back as the same float value
+   *        unless scientific or fixed point notation is set
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(float value)
   {
-    // @todo introduce printString or something similar
-    printChar('n');
-    printChar('u');
-    printChar('l');
-    printChar('l');
+    if (format_ != FLOAT_SHORTEST)
+    {
+      printFloat(value);
+      return;
+    }
+
+    char buffer[MAX_FLOAT_CHARACTERS];
+    char* end = formatShortest(value, buffer);
+
+    printPadded(buffer, end - buffer);
   }
 
-  template<typename T>
-  void OutStream::printSignedValue(T value)
+  /**
+   * @param value value to print
+   * @see BasicOutStream::setFloatFormat
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(double value)
   {
-    if (value < 0)
-    {
-      printChar('-');
-      value *= -1;
-    }
-    printUnsignedValue(value);
+    printFloat(value);
+  }
+
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::print(nullptr_t)
+  {
+    print("null");
+  }
+
+  /**
+   * This method prints the given characters as they are, handing them to the buffer in a
+   * single call.
+   * @param string characters to print, need not be zero terminated
+   * @param length number of characters to print
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::write(char const* string, size_t length)
+  {
+    buffer_->put(reinterpret_cast<byte_t const*>(string), length);
   }
 
   /**
+   * This method prints an integer in the given base, regardless of the stream's settings, in
+   * the same way write prints characters.
    * @param value value to print
+   * @param base base to use, has to be between BASE_MIN and BASE_MAX (exclusive)
    */
+  template<typename BufferT>
   template<typename T>
-  inline void OutStream::printUnsignedValue(T value)
+  inline void BasicOutStream<BufferT>::writeInteger(T value, uint8_t base)
   {
-    typedef typename typ::MakeUnsigned<T>::Type Type1;
-    typedef typename typ::RemoveConst<Type1>::Type Type2;
+    impl::putInteger(*buffer_, value, base, 0);
+  }
 
-    printUnsignedValueImpl<Type2>(value);
+  /**
+   * This method prints a byte range in the given encoding, regardless of the stream's settings,
+   * in the same way write prints characters. Up to ENCODE_CHUNK bytes are converted and handed
+   * to the buffer at once.
+   * @param data pointer to the bytes to print
+   * @param size number of bytes to print
+   * @param encoding encoding to print the bytes in
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::writeEncoded(byte_t const* data,
+                                                    size_t size,
+                                                    Encoding encoding)
+  {
+    impl::putEncoded(*buffer_, data, size, encoding);
   }
 
-  template<typename T>
-  void OutStream::printUnsignedValueImpl(T value)
+  /**
+   * This method handles the padding in front of a value, if any. It resets the width, so that
+   * it only applies to a single value.
+   * @param length number of characters the value to print has
+   * @return number of fill characters to print after the value
+   */
+  template<typename BufferT>
+  inline size_t BasicOutStream<BufferT>::padBefore(size_t length)
   {
-    if (!fixed_ && value == 0)
+    if (__builtin_expect(width_ <= length, 1))
     {
-      printChar('0');
-      return;
+      width_ = 0;
+      return 0;
     }
 
-    bool print = fixed_;
+    size_t padding = width_ - length;
+    width_ = 0;
 
-    for (T power = getGreatestPower<T>(base_); power >= 1; power /= base_)
-    {
-      T div = value / power;
-      T mod = value % power;
+    if (alignment_ == ALIGN_LEFT)
+      return padding;
 
-      print = print || div > 0;
+    buffer_->fill(fill_, padding);
+    return 0;
+  }
 
-      if (print)
-      {
-        printChar(makeDigit(static_cast<char>(div)));
+  /**
+   * @param padding number of fill characters to print after a value, as returned by padBefore
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::padAfter(size_t padding)
+  {
+    if (padding != 0)
+      buffer_->fill(fill_, padding);
+  }
 
-        value = mod;
-      }
+  /**
+   * This method prints the given characters, padded according to the current width.
+   * @param string characters to print
+   * @param length number of characters to print
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::printPadded(char const* string, size_t length)
+  {
+    size_t padding = padBefore(length);
+    buffer_->put(reinterpret_cast<byte_t const*>(string), length);
+    padAfter(padding);
+  }
+
+  /**
+   * This method formats the given value into a local buffer and hands the result to the stream
+   * buffer in a single call. With fixed width enabled, the value is padded with zeros to the
+   * number of digits of the greatest value of the unsigned counterpart of T. If a width is
+   * set, the length of the result is calculated from the number of digits up front, so that
+   * the padding in front of it can be printed first. A CountingBuffer only gets that length.
+   * @param value value to print
+   */
+  template<typename BufferT>
+  template<typename T>
+  inline void BasicOutStream<BufferT>::printInteger(T value)
+  {
+    size_t width = fixed_ ? maxDigits<T>(base_) : 0;
+    size_t padding = 0;
+
+    if (width_ != 0)
+      padding = padBefore(integerLength(value, base_, width));
+
+    impl::putInteger(*buffer_, value, base_, width);
+    padAfter(padding);
+  }
+
+  /**
+   * This method formats the given value in the current notation into a local buffer and hands
+   * the result to the stream buffer in a single call.
+   * @param value value to print
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::printFloat(double value)
+  {
+    char buffer[MAX_FLOAT_CHARACTERS];
+    char* end;
+
+    switch (format_)
+    {
+    case FLOAT_SCIENTIFIC:
+      end = formatScientific(value, buffer, precision_);
+      break;
+
+    case FLOAT_FIXED:
+      end = formatFixed(value, buffer, precision_);
+      break;
+
+    default:
+      end = formatShortest(value, buffer);
+      break;
     }
+
+    printPadded(buffer, end - buffer);
   }
 
   /**
    * This helper method prints out a single character.
    * @param c character to print
    */
-  inline void OutStream::printChar(char c)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::printChar(char c)
   {
+    if (__builtin_expect(width_ != 0, 0))
+    {
+      printPadded(&c, 1);
+      return;
+    }
+
     buffer_->put(c);
   }
 
   /**
    * @param base new base to set
    */
-  inline void OutStream::setBase(uint8_t base)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setBase(uint8_t base)
   {
     if (BASE_MIN < base && base < BASE_MAX)
       base_ = base;
@@ -363,15 +564,70 @@ namespace utl
    * @param fixed true to make all output have fixed width according to data type, false to make it
    *        variable according to value
    */
-  inline void OutStream::setFixed(bool fixed)
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setFixed(bool fixed)
   {
     fixed_ = fixed;
   }
 
+  /**
+   * @param format notation to print floating point values in: FLOAT_SHORTEST (the default)
+   *        prints the fewest digits that read back as the same value, FLOAT_SCIENTIFIC and
+   *        FLOAT_FIXED print as many fractional digits as the precision says
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setFloatFormat(FloatFormat format)
+  {
+    format_ = format;
+  }
+
+  /**
+   * @param precision number of fractional digits to print floating point values with in
+   *        scientific and fixed point notation, values above MAX_FLOAT_PRECISION are reduced to
+   *        it
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setPrecision(uint8_t precision)
+  {
+    precision_ = min<uint8_t>(precision, MAX_FLOAT_PRECISION);
+  }
+
+  /**
+   * @param width minimum number of characters to print the next value with, shorter values
+   *        are padded with the fill character; the width is reset after printing a value
+   * @note the width applies to all values printed by one of the print methods, but not to
+   *       characters written by write
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setWidth(size_t width)
+  {
+    width_ = width;
+  }
+
+  /**
+   * @param fill character to pad values with, a space by default
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setFill(char fill)
+  {
+    fill_ = fill;
+  }
+
+  /**
+   * @param alignment ALIGN_RIGHT (the default) to put the padding in front of values, or
+   *        ALIGN_LEFT to put it after them
+   */
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::setAlignment(Alignment alignment)
+  {
+    alignment_ = alignment;
+  }
+
   /**
    *
    */
-  inline void OutStream::flush()
+  template<typename BufferT>
+  inline void BasicOutStream<BufferT>::flush()
   {
     buffer_->flush();
   }
@@ -379,7 +635,8 @@ namespace utl
   /**
    * This manipulator can be used for setting binary output.
    */
-  inline OutStream& bin(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& bin(BasicOutStream<BufferT>& stream)
   {
     stream.setBase(BASE_BINARY);
     return stream;
@@ -388,7 +645,8 @@ namespace utl
   /**
    * This manipulator can be used for setting octal output.
    */
-  inline OutStream& oct(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& oct(BasicOutStream<BufferT>& stream)
   {
     stream.setBase(BASE_OCTAL);
     return stream;
@@ -397,7 +655,8 @@ namespace utl
   /**
    * This manipulator can be used for setting decimal output.
    */
-  inline OutStream& dec(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& dec(BasicOutStream<BufferT>& stream)
   {
     stream.setBase(BASE_DECIMAL);
     return stream;
@@ -406,7 +665,8 @@ namespace utl
   /**
    * This manipulator can be used for setting hexadecimal output.
    */
-  inline OutStream& hex(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& hex(BasicOutStream<BufferT>& stream)
   {
     stream.setBase(BASE_HEXADECIMAL);
     return stream;
@@ -414,9 +674,10 @@ namespace utl
 
   /**
    * This manipulator can be used for setting fixed output width.
-   * @see OutStream::setFixed
+   * @see BasicOutStream::setFixed
    */
-  inline OutStream& fix(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& fix(BasicOutStream<BufferT>& stream)
   {
     stream.setFixed(true);
     return stream;
@@ -424,18 +685,176 @@ namespace utl
 
   /**
    * This manipulator can be used for setting variable output width.
-   * @see OutStream::setFixed
+   * @see BasicOutStream::setFixed
    */
-  inline OutStream& var(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& var(BasicOutStream<BufferT>& stream)
   {
     stream.setFixed(false);
     return stream;
   }
 
+  /**
+   * This manipulator can be used for printing floating point values in their shortest form.
+   * @see BasicOutStream::setFloatFormat
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& gen(BasicOutStream<BufferT>& stream)
+  {
+    stream.setFloatFormat(FLOAT_SHORTEST);
+    return stream;
+  }
+
+  /**
+   * This manipulator can be used for printing floating point values in scientific notation.
+   * @see BasicOutStream::setFloatFormat
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& sci(BasicOutStream<BufferT>& stream)
+  {
+    stream.setFloatFormat(FLOAT_SCIENTIFIC);
+    return stream;
+  }
+
+  /**
+   * This manipulator can be used for printing floating point values in fixed point notation.
+   * @see BasicOutStream::setFloatFormat
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& fxp(BasicOutStream<BufferT>& stream)
+  {
+    stream.setFloatFormat(FLOAT_FIXED);
+    return stream;
+  }
+
+  /**
+   * Objects of this type carry a precision to set on a stream.
+   * @see precision
+   */
+  struct Precision
+  {
+    uint8_t value;
+  };
+
+  /**
+   * This function creates a manipulator for setting the precision floating point values are
+   * printed with, e.g., stream << sci << precision(3) << 1500.0 prints 1.500e+03.
+   * @param precision number of fractional digits
+   * @see BasicOutStream::setPrecision
+   */
+  inline Precision precision(uint8_t precision)
+  {
+    Precision result = {precision};
+    return result;
+  }
+
+  /**
+   * This manipulator can be used for aligning values to the left within their width.
+   * @see BasicOutStream::setAlignment
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& left(BasicOutStream<BufferT>& stream)
+  {
+    stream.setAlignment(ALIGN_LEFT);
+    return stream;
+  }
+
+  /**
+   * This manipulator can be used for aligning values to the right within their width.
+   * @see BasicOutStream::setAlignment
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& right(BasicOutStream<BufferT>& stream)
+  {
+    stream.setAlignment(ALIGN_RIGHT);
+    return stream;
+  }
+
+  /**
+   * Objects of this type carry a width to set on a stream.
+   * @see width
+   */
+  struct Width
+  {
+    size_t value;
+  };
+
+  /**
+   * This function creates a manipulator for setting the width of the next value printed,
+   * e.g., stream << width(5) << 42 prints "   42".
+   * @param width minimum number of characters
+   * @see BasicOutStream::setWidth
+   */
+  inline Width width(size_t width)
+  {
+    Width result = {width};
+    return result;
+  }
+
+  /**
+   * Objects of this type carry a fill character to set on a stream.
+   * @see fill
+   */
+  struct Fill
+  {
+    char value;
+  };
+
+  /**
+   * This function creates a manipulator for setting the character values are padded with,
+   * e.g., stream << fill('.') << left << width(5) << 42 prints "42...".
+   * @param fill character to pad with
+   * @see BasicOutStream::setFill
+   */
+  inline Fill fill(char fill)
+  {
+    Fill result = {fill};
+    return result;
+  }
+
+  /**
+   * Objects of this type carry a byte range to print in some encoding.
+   * @see hexBytes
+   * @see base64Bytes
+   */
+  struct EncodedBytes
+  {
+    byte_t const* data;
+    size_t size;
+    Encoding encoding;
+  };
+
+  /**
+   * This function creates a manipulator for printing a byte range as lower case hexadecimal
+   * digits, e.g., stream << hexBytes("\x01\xab", 2) prints "01ab".
+   * @param data pointer to the bytes to print
+   * @param size number of bytes to print
+   * @see BasicOutStream::writeEncoded
+   */
+  inline EncodedBytes hexBytes(void const* data, size_t size)
+  {
+    EncodedBytes result = {static_cast<byte_t const*>(data), size, ENCODING_HEX};
+    return result;
+  }
+
+  /**
+   * This function creates a manipulator for printing a byte range in padded base64, e.g.,
+   * stream << base64Bytes("utl", 3) prints "dXRs".
+   * @param data pointer to the bytes to print
+   * @param size number of bytes to print
+   * @see BasicOutStream::writeEncoded
+   */
+  inline EncodedBytes base64Bytes(void const* data, size_t size)
+  {
+    EncodedBytes result = {static_cast<byte_t const*>(data), size, ENCODING_BASE64};
+    return result;
+  }
+
   /**
    *
    */
-  inline OutStream& flushl(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& flushl(BasicOutStream<BufferT>& stream)
   {
     stream.print('\n');
     stream.flush();
@@ -445,7 +864,8 @@ namespace utl
   /**
    *
    */
-  inline OutStream& flush(OutStream& stream)
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& flush(BasicOutStream<BufferT>& stream)
   {
     stream.flush();
     return stream;
@@ -457,13 +877,65 @@ namespace utl
    * @param value value to print
    * @return stream that was supplied
    */
-  template<typename T>
-  inline OutStream& operator << (OutStream& stream, T value)
+  template<typename BufferT, typename T>
+  inline BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, T value)
   {
     stream.print(value);
     return stream;
   }
 
+  /**
+   * This is the overload of operator << for setting the precision of the given stream.
+   * @param stream stream to set the precision of
+   * @param precision precision to set
+   * @return stream that was supplied
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, Precision precision)
+  {
+    stream.setPrecision(precision.value);
+    return stream;
+  }
+
+  /**
+   * This is the overload of operator << for setting the width of the next value printed.
+   * @param stream stream to set the width of
+   * @param width width to set
+   * @return stream that was supplied
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, Width width)
+  {
+    stream.setWidth(width.value);
+    return stream;
+  }
+
+  /**
+   * This is the overload of operator << for setting the fill character of the given stream.
+   * @param stream stream to set the fill character of
+   * @param fill fill character to set
+   * @return stream that was supplied
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, Fill fill)
+  {
+    stream.setFill(fill.value);
+    return stream;
+  }
+
+  /**
+   * This is the overload of operator << for printing an encoded byte range.
+   * @param stream stream to print the bytes to
+   * @param bytes bytes to print, along with their encoding
+   * @return stream that was supplied
+   */
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream, EncodedBytes bytes)
+  {
+    stream.writeEncoded(bytes.data, bytes.size, bytes.encoding);
+    return stream;
+  }
+
   /**
    * This is the specialization of operator << for invoking a manipulator function on the given
    * stream.
@@ -471,7 +943,10 @@ namespace utl
    * @param manipulator manipulator to invoke
    * @return stream that was supplied
    */
-  inline OutStream& operator << (OutStream& stream, OutStream& (*manipulator)(OutStream&))
+  template<typename BufferT>
+  inline BasicOutStream<BufferT>& operator << (BasicOutStream<BufferT>& stream,
+                                               BasicOutStream<BufferT>& (*manipulator)
+                                                 (BasicOutStream<BufferT>&))
   {
     return (*manipulator)(stream);
   }
@@ -0,0 +1,225 @@
+// SliceBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLSLICEBUFFER_HPP
+#define UTLSLICEBUFFER_HPP
+
+#include "util/Config.hpp"
+#include "util/Util.hpp"
+#include "util/io/BlockPool.hpp"
+#include "util/io/ByteSlice.hpp"
+#include "util/io/StreamBuffer.hpp"
+
+
+namespace utl
+{
+  /**
+   * This class implements the StreamBuffer interface on top of reference counted blocks from
+   * a BlockPool. Whatever got written can be taken out as a ByteRope without copying, to be
+   * handed to any number of consumers, e.g., a network sink, a file sink, and a checksum.
+   * Writing continues in the same block after the data taken out; a block is released to
+   * the pool once neither the buffer nor any slice refers to it anymore.
+   */
+  class SliceBuffer final: public StreamBuffer
+  {
+  public:
+    explicit SliceBuffer(BlockPool& pool);
+    ~SliceBuffer();
+
+    SliceBuffer(SliceBuffer const&) = delete;
+    SliceBuffer& operator =(SliceBuffer const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void fill(byte_t element, size_t count) override;
+
+    virtual void flush() override;
+
+    ByteRope take();
+    size_t size() const;
+
+  private:
+    BlockPool* pool_;
+
+    // the data written to blocks filled up already
+    ByteRope filled_;
+
+    // the block written to, the data not taken out yet, and its free part
+    impl::SliceBlock* block_;
+    byte_t* begin_;
+    byte_t* current_;
+    byte_t* end_;
+
+    void append();
+    void overflow(byte_t element);
+  };
+}
+
+
+namespace utl
+{
+  /**
+   * @param pool pool to take blocks from, it has to outlive the SliceBuffer object and all
+   *        slices taken out of it
+   */
+  inline SliceBuffer::SliceBuffer(BlockPool& pool)
+    : StreamBuffer(),
+      pool_(&pool),
+      filled_(),
+      block_(nullptr),
+      begin_(nullptr),
+      current_(nullptr),
+      end_(nullptr)
+  {
+  }
+
+  /**
+   * The destructor drops the reference to the block written to. Data not taken out is lost.
+   */
+  inline SliceBuffer::~SliceBuffer()
+  {
+    if (block_ != nullptr)
+      impl::releaseSliceBlock(block_);
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void SliceBuffer::put(byte_t element)
+  {
+    if (__builtin_expect(current_ == end_, 0))
+    {
+      overflow(element);
+      return;
+    }
+
+    *current_ = element;
+    current_++;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void SliceBuffer::put(byte_t const* elements, size_t size)
+  {
+    while (size > 0)
+    {
+      if (current_ == end_)
+        append();
+
+      size_t available = end_ - current_;
+      size_t count = min(size, available);
+
+      __builtin_memcpy(current_, elements, count);
+      current_ += count;
+      elements += count;
+      size     -= count;
+    }
+  }
+
+  /**
+   * @copydoc StreamBuffer::fill
+   */
+  inline void SliceBuffer::fill(byte_t element, size_t count)
+  {
+    while (count > 0)
+    {
+      if (current_ == end_)
+        append();
+
+      size_t available = end_ - current_;
+      size_t size = min(count, available);
+
+      __builtin_memset(current_, element, size);
+      current_ += size;
+      count    -= size;
+    }
+  }
+
+  /**
+   * All data stays in memory until it is taken out, so there is nothing to flush.
+   */
+  inline void SliceBuffer::flush()
+  {
+  }
+
+  /**
+   * @return rope of all data written since the last call, sharing the blocks with the buffer
+   */
+  inline ByteRope SliceBuffer::take()
+  {
+    ByteRope rope;
+    rope.swap(filled_);
+
+    if (current_ != begin_)
+    {
+      impl::referenceSliceBlock(block_);
+      rope.append(ByteSlice(block_, begin_, current_ - begin_));
+
+      begin_ = current_;
+    }
+    return rope;
+  }
+
+  /**
+   * @return number of bytes written and not taken out yet
+   */
+  inline size_t SliceBuffer::size() const
+  {
+    return filled_.size() + (current_ - begin_);
+  }
+
+  /**
+   * This method continues writing in a new block. The reference to the full block is handed
+   * over to the slice of its remaining data.
+   */
+  inline void SliceBuffer::append()
+  {
+    if (block_ != nullptr)
+    {
+      if (current_ != begin_)
+        filled_.append(ByteSlice(block_, begin_, current_ - begin_));
+      else
+        impl::releaseSliceBlock(block_);
+    }
+
+    block_   = impl::createSliceBlock(*pool_);
+    begin_   = reinterpret_cast<byte_t*>(block_ + 1);
+    current_ = begin_;
+    end_     = reinterpret_cast<byte_t*>(block_) + pool_->blockSize();
+  }
+
+  /**
+   * This method handles a put into a full block.
+   * @param element byte to put into the buffer after starting a new block
+   * @see MemoryBuffer::overflow
+   */
+  __attribute__((noinline))
+  inline void SliceBuffer::overflow(byte_t element)
+  {
+    append();
+
+    *current_ = element;
+    current_++;
+  }
+}
+
+
+#endif
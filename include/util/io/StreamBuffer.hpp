@@ -47,6 +47,8 @@ namespace utl
     virtual void put(byte_t element) = 0;
     virtual void put(byte_t const* elements, size_t size) = 0;
 
+    virtual void fill(byte_t element, size_t count);
+
     virtual void flush() = 0;
   };
 }
@@ -68,6 +70,23 @@ namespace utl
   {
   }
 
+  /**
+   * This method puts the given byte into the buffer 'count' times. The default implementation
+   * puts blocks of copies of the byte, derived classes may provide a more efficient one.
+   * @param element byte to put into the buffer
+   * @param count number of times to put 'element'
+   */
+  inline void StreamBuffer::fill(byte_t element, size_t count)
+  {
+    byte_t block[64];
+    __builtin_memset(block, element, sizeof(block));
+
+    for ( ; count > sizeof(block); count -= sizeof(block))
+      put(block, sizeof(block));
+
+    put(block, count);
+  }
+
   /**
    * This method forces a flush of the buffer contents.
    */
@@ -0,0 +1,43 @@
+// Bench.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <iostream>
+
+#include "BenchSearch.hpp"
+#include "BenchTokenizer.hpp"
+#include "BenchText.hpp"
+#include "BenchParse.hpp"
+#include "BenchStream.hpp"
+#include "BenchIo.hpp"
+#include "BenchLog.hpp"
+
+
+int main()
+{
+  std::cout << "Running Benchmarks...\n";
+
+  bench::benchSearch();
+  bench::benchTokenizer();
+  bench::benchText();
+  bench::benchParse();
+  bench::benchStream();
+  bench::benchIo();
+  bench::benchLog();
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Bench.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLBENCHBENCH_HPP
+#define UTLBENCHBENCH_HPP
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <type/Types.hpp>
+
+
+namespace bench
+{
+  /**
+   * This function prevents the compiler from optimizing away the computation of 'value'.
+   */
+  template<typename T>
+  inline void keep(T const& value)
+  {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  /**
+   * @param functor functor to measure
+   * @param repetitions number of times to run 'functor'
+   * @return the fastest wall clock time (in seconds) of one invocation of 'functor'
+   */
+  template<typename FunctorT>
+  double measure(FunctorT const& functor, unsigned int repetitions = 5)
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    double best = 0.0;
+
+    for (unsigned int i = 0; i < repetitions; ++i)
+    {
+      Clock::time_point start = Clock::now();
+      functor();
+      Clock::time_point stop = Clock::now();
+
+      double seconds = std::chrono::duration<double>(stop - start).count();
+
+      if (i == 0 || seconds < best)
+        best = seconds;
+    }
+    return best;
+  }
+
+  /**
+   * @param name name of the benchmark
+   * @param seconds time one run took
+   * @param bytes number of bytes processed in one run
+   */
+  inline void report(char const* name, double seconds, double bytes)
+  {
+    std::cout << "  " << std::left << std::setw(44) << name << std::right
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << seconds * 1000.0 << " ms"
+              << std::setw(10) << bytes / seconds / 1e9 << " GB/s\n";
+  }
+
+  /**
+   * @param size approximate size of the log to create
+   * @return synthetic log data
+   */
+  inline std::vector<byte_t> createLog(size_t size)
+  {
+    static char const* const words[] = {
+      "INFO", "DEBUG", "connection", "established", "request", "served", "in", "ms",
+      "peer", "session", "closed", "user", "login", "cache", "hit", "miss",
+    };
+
+    std::vector<byte_t> log;
+    unsigned int state = 1;
+
+    log.reserve(size + 256);
+
+    while (log.size() < size)
+    {
+      for (int i = 0; i < 10; ++i)
+      {
+        state = state * 1103515245 + 12345;
+
+        for (char const* word = words[(state >> 16) % 16]; *word != '\0'; ++word)
+          log.push_back(*word);
+
+        log.push_back(' ');
+      }
+      log.push_back('\n');
+    }
+    return log;
+  }
+}
+
+
+#endif
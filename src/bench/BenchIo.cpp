@@ -0,0 +1,450 @@
+// BenchIo.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <util/io/AsyncBuffer.hpp>
+#include <util/io/ChainBuffer.hpp>
+#include <util/io/CompressingBuffer.hpp>
+#include <util/io/CountingBuffer.hpp>
+#include <util/io/FdBuffer.hpp>
+#include <util/io/IoUringBuffer.hpp>
+#include <util/io/MemoryBuffer.hpp>
+#include <util/io/MmapFileBuffer.hpp>
+
+#include "Bench.hpp"
+#include "BenchIo.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * This writer writes to a file descriptor with one system call per buffer, the way it is
+     * typically done for a MemoryBuffer.
+     */
+    struct FdWriter
+    {
+      int fd;
+      size_t* syscalls;
+
+      bool operator()(byte_t const* buffer, size_t size) const
+      {
+        while (size != 0)
+        {
+          ssize_t result = write(fd, buffer, size);
+          ++*syscalls;
+
+          if (result < 0)
+            return false;
+
+          buffer += result;
+          size   -= result;
+        }
+        return true;
+      }
+    };
+
+
+    /**
+     * This class appends everything put into it to a vector.
+     */
+    class VectorBuffer: public utl::StreamBuffer
+    {
+    public:
+      explicit VectorBuffer(std::vector<byte_t>& data)
+        : data_(&data)
+      {
+      }
+
+      virtual void put(byte_t element) override
+      {
+        data_->push_back(element);
+      }
+
+      virtual void put(byte_t const* elements, size_t size) override
+      {
+        data_->insert(data_->end(), elements, elements + size);
+      }
+
+      virtual void flush() override
+      {
+      }
+
+    private:
+      std::vector<byte_t>* data_;
+    };
+
+
+    /**
+     * This function puts the given log into the given buffer line by line.
+     */
+    template<typename BufferT>
+    void putLines(BufferT& buffer, std::vector<byte_t> const& log)
+    {
+      byte_t const* begin = log.data();
+      byte_t const* end   = begin + log.size();
+
+      for (byte_t const* line = begin; line != end; )
+      {
+        byte_t const* next = line;
+
+        while (*next++ != '\n')
+          ;
+
+        buffer.put(line, next - line);
+        line = next;
+      }
+      buffer.flush();
+    }
+
+    /**
+     * This function puts the given log into the given buffer line by line and flushes the
+     * buffer after every 1000 lines, the way a service logging requests would.
+     * @return the longest time (in seconds) a single flush took
+     */
+    template<typename BufferT>
+    double putLinesFlushing(BufferT& buffer, std::vector<byte_t> const& log)
+    {
+      typedef std::chrono::steady_clock Clock;
+
+      byte_t const* begin = log.data();
+      byte_t const* end   = begin + log.size();
+
+      double longest = 0.0;
+      size_t lines = 0;
+
+      for (byte_t const* line = begin; line != end; )
+      {
+        byte_t const* next = line;
+
+        while (*next++ != '\n')
+          ;
+
+        buffer.put(line, next - line);
+        line = next;
+
+        if (++lines % 1000 == 0)
+        {
+          Clock::time_point start = Clock::now();
+          buffer.flush();
+          Clock::time_point stop = Clock::now();
+
+          longest = std::max(longest, std::chrono::duration<double>(stop - start).count());
+        }
+      }
+      buffer.flush();
+      return longest;
+    }
+
+    /**
+     * This function puts the given log into a ChainBuffer line by line and writes out the
+     * chain with writev after every 1000 lines.
+     */
+    void putLinesChained(utl::ChainBuffer& buffer, int fd, std::vector<byte_t> const& log)
+    {
+      byte_t const* begin = log.data();
+      byte_t const* end   = begin + log.size();
+
+      size_t lines = 0;
+      iovec vector[64];
+
+      for (byte_t const* line = begin; line != end; )
+      {
+        byte_t const* next = line;
+
+        while (*next++ != '\n')
+          ;
+
+        buffer.put(line, next - line);
+        line = next;
+
+        if (++lines % 1000 == 0 || line == end)
+        {
+          while (!buffer.empty())
+          {
+            size_t count = buffer.exportVector(vector, 64);
+            ssize_t written = writev(fd, vector, static_cast<int>(count));
+
+            if (written <= 0)
+              return;
+
+            buffer.consume(written);
+          }
+        }
+      }
+    }
+
+    /**
+     * @param name name of the benchmark
+     * @param seconds longest time a single operation took
+     */
+    void reportLatency(char const* name, double seconds)
+    {
+      std::cout << "  " << std::left << std::setw(44) << name << std::right
+                << std::fixed << std::setprecision(3)
+                << std::setw(10) << seconds * 1e6 << " us\n";
+    }
+
+    /**
+     * @param name name of the benchmark
+     * @param compressed size of the compressed data
+     * @param bytes size of the uncompressed data
+     */
+    void reportRatio(char const* name, size_t compressed, size_t bytes)
+    {
+      std::cout << "  " << std::left << std::setw(44) << name << std::right
+                << std::fixed << std::setprecision(3)
+                << std::setw(10) << 100.0 * compressed / bytes << " %\n";
+    }
+
+    /**
+     * @param name name of the benchmark
+     * @param syscalls number of system calls issued in one run
+     * @param bytes number of bytes written in one run
+     */
+    void reportSyscalls(char const* name, size_t syscalls, size_t bytes)
+    {
+      std::cout << "  " << std::left << std::setw(44) << name << std::right
+                << std::fixed << std::setprecision(3)
+                << std::setw(10) << syscalls / (bytes / 1e6) << " syscalls/MB\n";
+    }
+  }
+
+
+  void benchIo()
+  {
+    std::vector<byte_t> log = createLog(256 * 1024 * 1024);
+
+    int null = open("/dev/null", O_WRONLY);
+
+    size_t memory_syscalls = 0;
+    size_t fd_syscalls     = 0;
+
+    double memory_time = measure([&]()
+    {
+      memory_syscalls = 0;
+
+      utl::MemoryBuffer<4096, FdWriter> buffer(FdWriter{null, &memory_syscalls});
+      putLines(buffer, log);
+    });
+
+    double fd_time = measure([&]()
+    {
+      utl::FdBuffer buffer(null);
+      putLines(buffer, log);
+
+      fd_syscalls = buffer.syscalls();
+    });
+
+    utl::BlockPool pool;
+    double chain_time = measure([&]()
+    {
+      utl::ChainBuffer buffer(pool);
+      putLinesChained(buffer, null, log);
+    });
+
+    utl::BlockPoolStatistics statistics = pool.statistics();
+    size_t allocations = statistics.cache_hits + statistics.depot_hits + statistics.misses;
+
+    // compression is measured on a smaller log, to keep the run time in bounds
+    std::vector<byte_t> part = createLog(64 * 1024 * 1024);
+    std::vector<byte_t> compressed;
+
+    size_t fast_size     = 0;
+    size_t default_size  = 0;
+    size_t thorough_size = 0;
+
+    double fast_time = measure([&]()
+    {
+      utl::CountingBuffer counter;
+      utl::CompressingBuffer buffer(counter, 64 * 1024, 1);
+      putLines(buffer, part);
+      buffer.finish();
+
+      fast_size = counter.size();
+    }, 3);
+
+    double default_time = measure([&]()
+    {
+      compressed.clear();
+
+      VectorBuffer sink(compressed);
+      utl::CompressingBuffer buffer(sink);
+      putLines(buffer, part);
+      buffer.finish();
+
+      default_size = compressed.size();
+    }, 3);
+
+    double thorough_time = measure([&]()
+    {
+      utl::CountingBuffer counter;
+      utl::CompressingBuffer buffer(counter, 64 * 1024, 64);
+      putLines(buffer, part);
+      buffer.finish();
+
+      thorough_size = counter.size();
+    }, 3);
+
+    double decompress_time = measure([&]()
+    {
+      utl::CountingBuffer counter;
+      utl::DecompressingBuffer buffer(counter);
+      buffer.put(compressed.data(), compressed.size());
+    }, 3);
+
+    close(null);
+
+    char path[] = "/tmp/libutil_benchXXXXXX";
+    int file = mkstemp(path);
+
+    size_t buffered_syscalls = 0;
+    size_t direct_syscalls   = 0;
+
+    double buffered_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::FdBuffer buffer(file);
+      putLines(buffer, log);
+      fdatasync(file);
+
+      buffered_syscalls = buffer.syscalls();
+    }, 3);
+
+    double direct_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::FdBuffer buffer(file, utl::FD_DIRECT);
+      putLines(buffer, log);
+      fdatasync(file);
+
+      direct_syscalls = buffer.syscalls();
+    }, 3);
+
+    double mmap_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::MmapFileBuffer buffer(file);
+      putLines(buffer, log);
+      buffer.close();
+      fdatasync(file);
+    }, 3);
+
+    size_t uring_syscalls = 0;
+    double uring_latency  = 0.0;
+    double thread_latency = 0.0;
+    double async_latency  = 0.0;
+    double fd_latency     = 0.0;
+
+    double uring_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::IoUringBuffer buffer(file);
+      uring_latency = putLinesFlushing(buffer, log);
+      buffer.sync();
+
+      uring_syscalls = buffer.submissions();
+    }, 3);
+
+    double thread_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::IoUringBuffer buffer(file, utl::ASYNC_THREAD);
+      thread_latency = putLinesFlushing(buffer, log);
+      buffer.sync();
+    }, 3);
+
+    double async_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::FdBuffer sink(file);
+      utl::AsyncBuffer buffer(sink);
+      async_latency = putLinesFlushing(buffer, log);
+      buffer.sync();
+      fdatasync(file);
+    }, 3);
+
+    double flushing_time = measure([&]()
+    {
+      ftruncate(file, 0);
+      lseek(file, 0, SEEK_SET);
+
+      utl::FdBuffer buffer(file);
+      fd_latency = putLinesFlushing(buffer, log);
+      fdatasync(file);
+    }, 3);
+
+    close(file);
+    unlink(path);
+
+    report("write lines to /dev/null (MemoryBuffer)", memory_time, log.size());
+    report("write lines to /dev/null (FdBuffer)", fd_time, log.size());
+    report("write lines to /dev/null (ChainBuffer)", chain_time, log.size());
+    report("write lines to file (FdBuffer)", buffered_time, log.size());
+    report("write lines to file (FdBuffer, O_DIRECT)", direct_time, log.size());
+    report("write lines to file (MmapFileBuffer)", mmap_time, log.size());
+    report("flush lines to file (FdBuffer)", flushing_time, log.size());
+    report("flush lines to file (IoUringBuffer)", uring_time, log.size());
+    report("flush lines to file (IoUringBuffer, thread)", thread_time, log.size());
+    report("flush lines to file (AsyncBuffer)", async_time, log.size());
+
+    report("compress lines (CompressingBuffer, depth 1)", fast_time, part.size());
+    report("compress lines (CompressingBuffer)", default_time, part.size());
+    report("compress lines (CompressingBuffer, depth 64)", thorough_time, part.size());
+    report("decompress (DecompressingBuffer)", decompress_time, part.size());
+
+    reportLatency("longest flush (FdBuffer)", fd_latency);
+    reportLatency("longest flush (IoUringBuffer)", uring_latency);
+    reportLatency("longest flush (IoUringBuffer, thread)", thread_latency);
+    reportLatency("longest flush (AsyncBuffer)", async_latency);
+
+    reportSyscalls("write lines (MemoryBuffer)", memory_syscalls, log.size());
+    reportSyscalls("write lines (FdBuffer)", fd_syscalls, log.size());
+    reportSyscalls("write lines (FdBuffer, O_DIRECT)", direct_syscalls, log.size());
+    reportSyscalls("flush lines (IoUringBuffer, submissions)", uring_syscalls, log.size());
+
+    reportRatio("compressed size (depth 1)", fast_size, part.size());
+    reportRatio("compressed size", default_size, part.size());
+    reportRatio("compressed size (depth 64)", thorough_size, part.size());
+
+    std::cout << "  " << std::left << std::setw(44) << "block pool hit rate (ChainBuffer)"
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << 100.0 * (allocations - statistics.misses) / allocations
+              << " %\n";
+  }
+}
@@ -0,0 +1,157 @@
+// BenchLog.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <util/io/FdBuffer.hpp>
+#include <util/io/LogRing.hpp>
+
+#include "Bench.hpp"
+#include "BenchLog.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * This buffer serializes all producers on a mutex in front of a shared buffer, the way a
+     * shared OutStream is typically protected.
+     */
+    class LockedBuffer
+    {
+    public:
+      explicit LockedBuffer(utl::StreamBuffer& buffer)
+        : buffer_(&buffer)
+      {
+      }
+
+      void write(byte_t const* line, size_t size)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_->put(line, size);
+      }
+
+    private:
+      utl::StreamBuffer* buffer_;
+      std::mutex mutex_;
+    };
+
+
+    /**
+     * This function runs 'producer' on 'threads' threads, passing each one its share of the
+     * lines of the given log.
+     */
+    template<typename ProducerT>
+    void produce(std::vector<byte_t> const& log, size_t threads, ProducerT const& producer)
+    {
+      std::vector<std::thread> workers;
+
+      byte_t const* begin = log.data();
+      byte_t const* end   = begin + log.size();
+
+      for (size_t i = 0; i < threads; ++i)
+      {
+        byte_t const* last = log.data() + log.size() * (i + 1) / threads;
+
+        while (last != end && last[-1] != '\n')
+          ++last;
+
+        workers.emplace_back(producer, begin, last);
+        begin = last;
+      }
+
+      for (std::thread& worker : workers)
+        worker.join();
+    }
+
+    /**
+     * This function calls 'functor' for each line in [begin, end).
+     */
+    template<typename FunctorT>
+    void forEachLine(byte_t const* begin, byte_t const* end, FunctorT&& functor)
+    {
+      for (byte_t const* line = begin; line != end; )
+      {
+        byte_t const* next = line;
+
+        while (*next++ != '\n')
+          ;
+
+        functor(line, next - line);
+        line = next;
+      }
+    }
+  }
+
+
+  void benchLog()
+  {
+    std::vector<byte_t> log = createLog(64 * 1024 * 1024);
+
+    int null = open("/dev/null", O_WRONLY);
+
+    for (size_t threads = 1; threads <= 64; threads *= 2)
+    {
+      double locked_time = measure([&]()
+      {
+        utl::FdBuffer sink(null);
+        LockedBuffer buffer(sink);
+
+        produce(log, threads, [&](byte_t const* begin, byte_t const* end)
+        {
+          forEachLine(begin, end, [&](byte_t const* line, size_t size)
+          {
+            buffer.write(line, size);
+          });
+        });
+      }, 3);
+
+      double ring_time = measure([&]()
+      {
+        utl::FdBuffer sink(null);
+        utl::LogRing ring(sink);
+
+        produce(log, threads, [&](byte_t const* begin, byte_t const* end)
+        {
+          utl::LogRingBuffer buffer(ring);
+
+          forEachLine(begin, end, [&](byte_t const* line, size_t size)
+          {
+            buffer.put(line, size);
+            buffer.flush();
+          });
+        });
+      }, 3);
+
+      std::string locked = "log lines, " + std::to_string(threads) + " threads (mutex)";
+      std::string ring   = "log lines, " + std::to_string(threads) + " threads (LogRing)";
+
+      report(locked.c_str(), locked_time, log.size());
+      report(ring.c_str(), ring_time, log.size());
+    }
+
+    close(null);
+  }
+}
@@ -0,0 +1,156 @@
+// BenchParse.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <cstdlib>
+
+#include <util/Parse.hpp>
+#include <util/io/InStream.hpp>
+
+#include "Bench.hpp"
+#include "BenchParse.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * @return 'count' comma separated random numbers of up to 'digits' digits in the given base
+     */
+    std::vector<char> createNumbers(size_t count, size_t digits, uint8_t base)
+    {
+      std::vector<char> numbers;
+      uint64_t state = 1;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+
+        size_t length = 1 + (state >> 32) % digits;
+
+        for (size_t j = 0; j < length; ++j)
+          numbers.push_back("0123456789abcdef"[(state >> (j * 4 % 32)) % base]);
+
+        numbers.push_back(',');
+      }
+      return numbers;
+    }
+
+    /**
+     * @return sum of all numbers, parsed one digit at a time
+     */
+    uint64_t sumNaive(char const* begin, char const* end)
+    {
+      uint64_t sum = 0;
+
+      while (begin != end)
+      {
+        uint64_t value = 0;
+
+        for ( ; *begin >= '0' && *begin <= '9'; ++begin)
+          value = value * 10 + (*begin - '0');
+
+        sum += value;
+        ++begin;
+      }
+      return sum;
+    }
+
+    /**
+     * @return sum of all numbers, parsed using strtoull
+     */
+    uint64_t sumStrtoull(char const* begin, char const* end, int base)
+    {
+      uint64_t sum = 0;
+
+      while (begin != end)
+      {
+        char* next;
+        sum += std::strtoull(begin, &next, base);
+        begin = next + 1;
+      }
+      return sum;
+    }
+
+    /**
+     * @return sum of all numbers, parsed using utl::parse
+     */
+    uint64_t sumParse(char const* begin, char const* end, uint8_t base)
+    {
+      uint64_t sum = 0;
+
+      while (begin != end)
+      {
+        utl::ParseResult<uint64_t> result = utl::parse<uint64_t>(begin, end, base);
+        sum += result.value;
+        begin = result.end + 1;
+      }
+      return sum;
+    }
+
+    /**
+     * @return sum of all numbers, read using utl::InStream
+     */
+    uint64_t sumInStream(char const* begin, char const* end)
+    {
+      utl::InStreamBuffer buffer(reinterpret_cast<byte_t const*>(begin),
+                                 reinterpret_cast<byte_t const*>(end));
+      utl::InStream stream(buffer);
+
+      uint64_t sum = 0;
+      ulong_t value;
+      char comma;
+
+      while (stream.read(value) && stream.read(comma))
+        sum += value;
+
+      return sum;
+    }
+  }
+
+
+  void benchParse()
+  {
+    std::vector<char> decimal = createNumbers(10000000, 19, 10);
+    std::vector<char> hex     = createNumbers(10000000, 16, 16);
+
+    char const* begin = decimal.data();
+    char const* end   = begin + decimal.size();
+
+    char const* hex_begin = hex.data();
+    char const* hex_end   = hex_begin + hex.size();
+
+    double naive = measure([&]() { keep(sumNaive(begin, end)); });
+    double strtoull = measure([&]() { keep(sumStrtoull(begin, end, 10)); });
+    double parse = measure([&]() { keep(sumParse(begin, end, utl::BASE_DECIMAL)); });
+    double stream = measure([&]() { keep(sumInStream(begin, end)); });
+    double hex_strtoull = measure([&]() { keep(sumStrtoull(hex_begin, hex_end, 16)); });
+    double hex_parse = measure([&]()
+    {
+      keep(sumParse(hex_begin, hex_end, utl::BASE_HEXADECIMAL));
+    });
+
+    report("parse decimal (digit by digit)", naive, decimal.size());
+    report("parse decimal (strtoull)", strtoull, decimal.size());
+    report("parse decimal (utl::parse)", parse, decimal.size());
+    report("parse decimal (utl::InStream)", stream, decimal.size());
+    report("parse hexadecimal (strtoull)", hex_strtoull, hex.size());
+    report("parse hexadecimal (utl::parse)", hex_parse, hex.size());
+  }
+}
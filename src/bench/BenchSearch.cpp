@@ -0,0 +1,111 @@
+// BenchSearch.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <vector>
+
+#include <util/Search.hpp>
+#include <util/AhoCorasick.hpp>
+
+#include "Bench.hpp"
+#include "BenchSearch.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * @return pointer to first occurrence of the needle in the haystack, found naively
+     */
+    byte_t const* searchNaive(byte_t const* begin, byte_t const* end,
+                              byte_t const* needle, size_t length)
+    {
+      for ( ; static_cast<size_t>(end - begin) >= length; ++begin)
+      {
+        size_t i = 0;
+
+        while (i < length && begin[i] == needle[i])
+          ++i;
+
+        if (i == length)
+          return begin;
+      }
+      return end;
+    }
+  }
+
+
+  void benchSearch()
+  {
+    std::vector<byte_t> log = createLog(64 * 1024 * 1024);
+
+    byte_t const* begin = log.data();
+    byte_t const* end   = begin + log.size();
+
+    static char const* const tokens[] = {"timeout", "connection refused", "ERROR", "segfault"};
+    size_t lengths[] = {7, 18, 5, 8};
+
+    for (int i = 0; i < 4; ++i)
+    {
+      byte_t const* needle = reinterpret_cast<byte_t const*>(tokens[i]);
+
+      double naive = measure([&]() { keep(searchNaive(begin, end, needle, lengths[i])); });
+      double fast  = measure([&]() { keep(utl::search(begin, end, needle, needle + lengths[i])); });
+
+      std::string name = std::string("search '") + tokens[i] + "'";
+      report((name + " (naive)").c_str(), naive, log.size());
+      report((name + " (utl::search)").c_str(), fast, log.size());
+    }
+
+    // a pathological case for the candidate filter
+    std::vector<byte_t> as(16 * 1024 * 1024, 'a');
+    std::vector<byte_t> needle(64, 'a');
+    needle[31] = 'b';
+
+    byte_t const* as_begin = as.data();
+    byte_t const* as_end   = as_begin + as.size();
+
+    double naive = measure([&]() { keep(searchNaive(as_begin, as_end, needle.data(), needle.size())); });
+    double fast  = measure([&]() { keep(utl::search(as_begin, as_end, needle.data(),
+                                                    needle.data() + needle.size())); });
+
+    report("search 'a^31ba^32' in 'a^n' (naive)", naive, as.size());
+    report("search 'a^31ba^32' in 'a^n' (utl::search)", fast, as.size());
+
+    // multiple patterns at once
+    utl::AhoCorasick automaton(reinterpret_cast<byte_t const* const*>(tokens), lengths, 4);
+
+    double multi_naive = measure([&]()
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        byte_t const* needle = reinterpret_cast<byte_t const*>(tokens[i]);
+        keep(searchNaive(begin, end, needle, lengths[i]));
+      }
+    });
+    double multi_fast = measure([&]()
+    {
+      size_t pattern;
+      keep(automaton.find(begin, end, pattern));
+    });
+
+    report("search 4 patterns (naive)", multi_naive, log.size());
+    report("search 4 patterns (utl::AhoCorasick)", multi_fast, log.size());
+  }
+}
@@ -0,0 +1,403 @@
+// BenchStream.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include <util/FormatFloat.hpp>
+#include <util/io/BinaryLog.hpp>
+#include <util/io/CountingBuffer.hpp>
+#include <util/io/CsvWriter.hpp>
+#include <util/io/Format.hpp>
+#include <util/io/JsonWriter.hpp>
+#include <util/io/MemoryBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "Bench.hpp"
+#include "BenchStream.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * This writer only counts the bytes it is handed.
+     */
+    struct CountingWriter
+    {
+      size_t* count;
+
+      bool operator()(byte_t const* buffer, size_t size) const
+      {
+        keep(buffer);
+        *count += size;
+        return true;
+      }
+    };
+
+    typedef utl::MemoryBuffer<4096, CountingWriter> Buffer;
+
+
+    /**
+     * This function formats the numbers [0, count) separated by spaces into the given stream.
+     */
+    template<typename StreamT>
+    void formatIntegers(StreamT& stream, uint32_t count)
+    {
+      for (uint32_t i = 0; i < count; ++i)
+        stream << i << ' ';
+
+      stream.flush();
+    }
+
+    /**
+     * This function prints 'count' records by chaining operator << calls.
+     */
+    template<typename StreamT>
+    void printRecords(StreamT& stream, uint32_t count)
+    {
+      for (uint32_t i = 0; i < count; ++i)
+        stream << "id=" << i << " val=" << utl::hex << i * 2654435761u << utl::dec << '\n';
+
+      stream.flush();
+    }
+
+    /**
+     * This function prints 'count' records using a compile time format string.
+     */
+    template<typename StreamT>
+    void formatRecords(StreamT& stream, uint32_t count)
+    {
+      for (uint32_t i = 0; i < count; ++i)
+        utl::format(stream, UTL_FORMAT("id={} val={x}\n"), i, i * 2654435761u);
+
+      stream.flush();
+    }
+
+    /**
+     * This function records 'count' records in binary form, deferring their formatting.
+     */
+    template<typename BufferT>
+    void logRecords(BufferT& buffer, uint32_t count)
+    {
+      for (uint32_t i = 0; i < count; ++i)
+        utl::logBinary(buffer, UTL_FORMAT("id={} val={x}\n"), i, i * 2654435761u);
+
+      buffer.flush();
+    }
+
+    /**
+     * This function prints a quoted JSON string one character at a time.
+     */
+    template<typename StreamT>
+    void printJsonString(StreamT& stream, char const* string, size_t length)
+    {
+      stream << '"';
+
+      for (size_t i = 0; i < length; ++i)
+      {
+        char c = string[i];
+
+        if (c == '"' || c == '\\')
+          stream << '\\' << c;
+        else if (static_cast<byte_t>(c) < 0x20)
+        {
+          stream << "\\u00" << utl::hex << utl::fix << static_cast<uchar_t>(c);
+          stream << utl::var << utl::dec;
+        }
+        else
+          stream << c;
+      }
+
+      stream << '"';
+    }
+
+    /**
+     * This function prints a CSV field one character at a time, quoting it if necessary.
+     */
+    template<typename StreamT>
+    void printCsvField(StreamT& stream, char const* string, size_t length)
+    {
+      bool quote = false;
+
+      for (size_t i = 0; i < length; ++i)
+        quote |= string[i] == ',' || string[i] == '"' || string[i] == '\n' || string[i] == '\r';
+
+      if (quote)
+        stream << '"';
+
+      for (size_t i = 0; i < length; ++i)
+      {
+        if (string[i] == '"')
+          stream << '"';
+
+        stream << string[i];
+      }
+
+      if (quote)
+        stream << '"';
+    }
+
+    /**
+     * @return the lines of the given log, without their newlines
+     */
+    std::vector<std::pair<char const*, size_t>> splitLines(std::vector<byte_t> const& log)
+    {
+      std::vector<std::pair<char const*, size_t>> lines;
+      char const* begin = reinterpret_cast<char const*>(log.data());
+      char const* end   = begin + log.size();
+
+      for (char const* line = begin; line != end; )
+      {
+        char const* next = std::find(line, end, '\n');
+
+        lines.push_back(std::make_pair(line, static_cast<size_t>(next - line)));
+        line = next != end ? next + 1 : end;
+      }
+      return lines;
+    }
+
+    /**
+     * @return 'count' doubles of varying magnitude and precision
+     */
+    std::vector<double> createDoubles(size_t count)
+    {
+      std::vector<double> values;
+      uint64_t state = 1;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+
+        // roughly half the values have few digits, the others need all 17
+        double value = static_cast<double>(state >> 11) / (1ull << (state % 60));
+
+        if (state & 1)
+          value = static_cast<double>(state % 100000) / 1000.0;
+
+        values.push_back(value);
+      }
+      return values;
+    }
+  }
+
+
+  void benchStream()
+  {
+    uint32_t const count = 100000000;
+
+    size_t static_bytes  = 0;
+    size_t virtual_bytes = 0;
+
+    double static_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&static_bytes});
+      utl::BasicOutStream<Buffer> stream(buffer);
+
+      formatIntegers(stream, count);
+    }, 1);
+
+    double virtual_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&virtual_bytes});
+      utl::OutStream stream(buffer);
+
+      formatIntegers(stream, count);
+    }, 1);
+
+    size_t print_bytes  = 0;
+    size_t format_bytes = 0;
+
+    double print_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&print_bytes});
+      utl::OutStream stream(buffer);
+
+      printRecords(stream, count / 10);
+    }, 1);
+
+    double format_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&format_bytes});
+      utl::OutStream stream(buffer);
+
+      formatRecords(stream, count / 10);
+    }, 1);
+
+    size_t measure_bytes = 0;
+
+    double measure_time = measure([&]()
+    {
+      utl::CountingBuffer counter;
+      utl::BasicOutStream<utl::CountingBuffer> stream(counter);
+
+      formatRecords(stream, count / 10);
+      measure_bytes = counter.size();
+    }, 1);
+
+    size_t log_bytes = 0;
+
+    double log_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&log_bytes});
+
+      logRecords(buffer, count / 10);
+    }, 1);
+
+    std::vector<byte_t> payload = createLog(16 * 1024 * 1024);
+
+    size_t dump_byte_bytes = 0;
+    size_t dump_bulk_bytes = 0;
+
+    double dump_byte_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&dump_byte_bytes});
+      utl::OutStream stream(buffer);
+
+      stream << utl::hex << utl::fix;
+
+      for (byte_t value : payload)
+        stream << value;
+
+      stream.flush();
+    }, 1);
+
+    double dump_bulk_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&dump_bulk_bytes});
+      utl::OutStream stream(buffer);
+
+      stream << utl::hexBytes(payload.data(), payload.size());
+      stream.flush();
+    }, 1);
+
+    std::vector<std::pair<char const*, size_t>> lines = splitLines(payload);
+
+    size_t json_byte_bytes = 0;
+    size_t json_bulk_bytes = 0;
+    size_t csv_byte_bytes  = 0;
+    size_t csv_bulk_bytes  = 0;
+
+    double json_byte_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&json_byte_bytes});
+      utl::OutStream stream(buffer);
+
+      for (size_t i = 0; i < lines.size(); ++i)
+      {
+        stream << "{\"n\":" << i << ",\"line\":";
+        printJsonString(stream, lines[i].first, lines[i].second);
+        stream << "}\n";
+      }
+      stream.flush();
+    }, 1);
+
+    double json_bulk_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&json_bulk_bytes});
+      utl::OutStream stream(buffer);
+      utl::JsonWriter writer(stream);
+
+      for (size_t i = 0; i < lines.size(); ++i)
+      {
+        writer.beginObject();
+        writer.key("n", 1);
+        writer.value(i);
+        writer.key("line", 4);
+        writer.value(lines[i].first, lines[i].second);
+        writer.endObject();
+        stream << '\n';
+      }
+      stream.flush();
+    }, 1);
+
+    double csv_byte_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&csv_byte_bytes});
+      utl::OutStream stream(buffer);
+
+      for (size_t i = 0; i < lines.size(); ++i)
+      {
+        stream << i << ',';
+        printCsvField(stream, lines[i].first, lines[i].second);
+        stream << '\n';
+      }
+      stream.flush();
+    }, 1);
+
+    double csv_bulk_time = measure([&]()
+    {
+      Buffer buffer(CountingWriter{&csv_bulk_bytes});
+      utl::OutStream stream(buffer);
+      utl::CsvWriter writer(stream);
+
+      for (size_t i = 0; i < lines.size(); ++i)
+      {
+        writer.field(i);
+        writer.field(lines[i].first, lines[i].second);
+        writer.endRecord();
+      }
+      stream.flush();
+    }, 1);
+
+    std::vector<double> doubles = createDoubles(10000000);
+
+    size_t snprintf_bytes = 0;
+    size_t shortest_bytes = 0;
+
+    double snprintf_time = measure([&]()
+    {
+      char string[32];
+      snprintf_bytes = 0;
+
+      for (double value : doubles)
+        snprintf_bytes += std::snprintf(string, sizeof(string), "%.17g", value);
+
+      keep(string);
+    });
+
+    double shortest_time = measure([&]()
+    {
+      char string[utl::MAX_FLOAT_CHARACTERS];
+      shortest_bytes = 0;
+
+      for (double value : doubles)
+        shortest_bytes += utl::formatShortest(value, string) - string;
+
+      keep(string);
+    });
+
+    report("format integers (BasicOutStream)", static_time, static_bytes);
+    report("format integers (OutStream)", virtual_time, virtual_bytes);
+    report("print records (OutStream <<)", print_time, print_bytes);
+    report("print records (utl::format)", format_time, format_bytes);
+    report("measure records (CountingBuffer)", measure_time, measure_bytes);
+    report("log records (utl::logBinary)", log_time, log_bytes);
+    report("hex dump bytes (OutStream per byte)", dump_byte_time, dump_byte_bytes);
+    report("hex dump bytes (utl::hexBytes)", dump_bulk_time, dump_bulk_bytes);
+    report("JSON records (OutStream per byte)", json_byte_time, json_byte_bytes);
+    report("JSON records (utl::JsonWriter)", json_bulk_time, json_bulk_bytes);
+    report("CSV records (OutStream per byte)", csv_byte_time, csv_byte_bytes);
+    report("CSV records (utl::CsvWriter)", csv_bulk_time, csv_bulk_bytes);
+    report("format doubles (snprintf %.17g)", snprintf_time, snprintf_bytes);
+    report("format doubles (utl::formatShortest)", shortest_time, shortest_bytes);
+  }
+}
@@ -0,0 +1,153 @@
+// BenchText.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/Ascii.hpp>
+#include <util/Checksum.hpp>
+#include <util/Encode.hpp>
+#include <util/Utf8.hpp>
+
+#include "Bench.hpp"
+#include "BenchText.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * @return the given log with every 'e' replaced by a multi byte sequence
+     */
+    std::vector<byte_t> createText(std::vector<byte_t> const& log)
+    {
+      static byte_t const sequences[][4] = {
+        {0xc3, 0xa4}, {0xe2, 0x82, 0xac}, {0xf0, 0x9d, 0x84, 0x9e},
+      };
+      static size_t const lengths[] = {2, 3, 4};
+
+      std::vector<byte_t> text;
+      text.reserve(log.size() * 2);
+
+      for (size_t i = 0; i < log.size(); ++i)
+      {
+        if (log[i] == 'e')
+        {
+          size_t index = i % 3;
+          text.insert(text.end(), sequences[index], sequences[index] + lengths[index]);
+        }
+        else
+          text.push_back(log[i]);
+      }
+      return text;
+    }
+
+    /**
+     * This function converts a range to lower case byte by byte.
+     * @return the last byte written
+     */
+    size_t toLowerScalar(byte_t const* begin, byte_t const* end, byte_t* destination)
+    {
+      for ( ; begin != end; ++begin, ++destination)
+        *destination = *begin >= 'A' && *begin <= 'Z' ? *begin + ('a' - 'A') : *begin;
+
+      return destination[-1];
+    }
+  }
+
+
+  void benchText()
+  {
+    std::vector<byte_t> log  = createLog(64 * 1024 * 1024);
+    std::vector<byte_t> text = createText(log);
+    std::vector<byte_t> output(log.size());
+
+    byte_t const* begin = log.data();
+    byte_t const* end   = begin + log.size();
+
+    byte_t const* text_begin = text.data();
+    byte_t const* text_end   = text_begin + text.size();
+
+    double ascii_scalar = measure([&]() { keep(utl::impl::isAsciiScalar(begin, end)); });
+    double ascii = measure([&]() { keep(utl::isAscii(begin, end)); });
+    double utf8_ascii_scalar = measure([&]() { keep(utl::impl::validateUtf8Scalar(begin, end)); });
+    double utf8_ascii = measure([&]() { keep(utl::validateUtf8(begin, end)); });
+    double utf8_scalar = measure([&]()
+    {
+      keep(utl::impl::validateUtf8Scalar(text_begin, text_end));
+    });
+    double utf8 = measure([&]() { keep(utl::validateUtf8(text_begin, text_end)); });
+    double lower_scalar = measure([&]() { keep(toLowerScalar(begin, end, output.data())); });
+    double lower = measure([&]() { keep(*(utl::toLower(begin, end, output.data()) - 1)); });
+    double crc_table = measure([&]()
+    {
+      keep(utl::impl::crc32cSoftware(0, begin, log.size()));
+    });
+    double crc = measure([&]() { keep(utl::crc32c(begin, log.size())); });
+    double hash = measure([&]() { keep(utl::hash64(begin, log.size())); });
+
+    std::vector<char> hex(utl::hexEncodedLength(log.size()));
+    std::vector<char> base64(utl::base64EncodedLength(log.size()));
+    char* hex_end    = hex.data() + hex.size();
+    char* base64_end = base64.data() + base64.size();
+
+    double hex_scalar = measure([&]()
+    {
+      keep(utl::impl::hexEncodeScalar(begin, end, hex.data()));
+    });
+    double hex_encode = measure([&]() { keep(utl::hexEncode(begin, end, hex.data())); });
+    double hex_decode = measure([&]()
+    {
+      keep(utl::hexDecode(hex.data(), hex_end, output.data()));
+    });
+    double base64_scalar = measure([&]()
+    {
+      keep(utl::impl::base64EncodeScalar(begin, end, base64.data()));
+    });
+    double base64_encode = measure([&]()
+    {
+      keep(utl::base64Encode(begin, end, base64.data()));
+    });
+    double base64_decode_scalar = measure([&]()
+    {
+      keep(utl::impl::base64DecodeScalar(base64.data(), base64_end, output.data()));
+    });
+    double base64_decode = measure([&]()
+    {
+      keep(utl::base64Decode(base64.data(), base64_end, output.data()));
+    });
+
+    report("isAscii (scalar)", ascii_scalar, log.size());
+    report("isAscii", ascii, log.size());
+    report("validateUtf8 ASCII (scalar)", utf8_ascii_scalar, log.size());
+    report("validateUtf8 ASCII", utf8_ascii, log.size());
+    report("validateUtf8 mixed (scalar)", utf8_scalar, text.size());
+    report("validateUtf8 mixed", utf8, text.size());
+    report("toLower (byte wise)", lower_scalar, log.size());
+    report("toLower", lower, log.size());
+    report("crc32c (slicing-by-8)", crc_table, log.size());
+    report("crc32c", crc, log.size());
+    report("hash64", hash, log.size());
+    report("hexEncode (scalar)", hex_scalar, log.size());
+    report("hexEncode", hex_encode, log.size());
+    report("hexDecode", hex_decode, log.size());
+    report("base64Encode (scalar)", base64_scalar, log.size());
+    report("base64Encode", base64_encode, log.size());
+    report("base64Decode (scalar)", base64_decode_scalar, log.size());
+    report("base64Decode", base64_decode, log.size());
+  }
+}
@@ -0,0 +1,87 @@
+// BenchTokenizer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/Algorithm.hpp>
+#include <util/Tokenizer.hpp>
+
+#include "Bench.hpp"
+#include "BenchTokenizer.hpp"
+
+
+namespace bench
+{
+  namespace
+  {
+    /**
+     * @return sum of the lengths of all tokens separated by 'delimiter', found using utl::find
+     */
+    size_t splitFind(byte_t const* begin, byte_t const* end, byte_t delimiter)
+    {
+      size_t total = 0;
+
+      for (;;)
+      {
+        byte_t const* it = utl::find(begin, end, delimiter);
+        total += it - begin;
+
+        if (it == end)
+          return total;
+
+        begin = it + 1;
+      }
+    }
+
+    /**
+     * @return sum of the lengths of all tokens, found using the Tokenizer
+     */
+    size_t splitTokenizer(byte_t const* begin, byte_t const* end,
+                          utl::DelimiterSet const& delimiters)
+    {
+      utl::Tokenizer tokenizer(begin, end, delimiters);
+      size_t total = 0;
+
+      for (auto it = tokenizer.begin(); it != tokenizer.end(); ++it)
+        total += it->length;
+
+      return total;
+    }
+  }
+
+
+  void benchTokenizer()
+  {
+    std::vector<byte_t> log = createLog(64 * 1024 * 1024);
+
+    byte_t const* begin = log.data();
+    byte_t const* end   = begin + log.size();
+
+    utl::DelimiterSet lines("\n", 1);
+    utl::DelimiterSet words(" \n", 2);
+
+    double find_lines = measure([&]() { keep(splitFind(begin, end, '\n')); });
+    double tokenize_lines = measure([&]() { keep(splitTokenizer(begin, end, lines)); });
+    double find_words = measure([&]() { keep(splitFind(begin, end, ' ')); });
+    double tokenize_words = measure([&]() { keep(splitTokenizer(begin, end, words)); });
+
+    report("split lines (utl::find)", find_lines, log.size());
+    report("split lines (utl::Tokenizer)", tokenize_lines, log.size());
+    report("split words (utl::find)", find_words, log.size());
+    report("split words and lines (utl::Tokenizer)", tokenize_words, log.size());
+  }
+}
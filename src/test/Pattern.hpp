@@ -0,0 +1,130 @@
+// Pattern.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLTESTPATTERN_HPP
+#define UTLTESTPATTERN_HPP
+
+#include <unistd.h>
+
+#include <util/Util.hpp>
+
+
+namespace test
+{
+  byte_t pattern(size_t position);
+
+  template<typename BufferT>
+  void putPattern(BufferT& buffer, size_t begin, size_t end, bool flush = false);
+
+  bool matches(byte_t const* data, size_t size, size_t position = 0);
+  bool matchesFile(int fd, size_t size, size_t position = 0);
+}
+
+
+namespace test
+{
+  /**
+   * @param position position within the test pattern
+   * @return byte at the given position of the test pattern, the pattern does not repeat
+   *         within typical buffer or block sizes
+   */
+  inline byte_t pattern(size_t position)
+  {
+    return static_cast<byte_t>(position * 7 + position / 251);
+  }
+
+  /**
+   * This function puts the test pattern from 'begin' to 'end' into the given buffer, in turns
+   * as a single byte, as a small piece, and as a piece larger than a typical chunk.
+   * @param buffer StreamBuffer to put the pattern into
+   * @param begin position of the first byte of the pattern to put
+   * @param end position past the last byte of the pattern to put
+   * @param flush true to flush the buffer every now and then
+   */
+  template<typename BufferT>
+  void putPattern(BufferT& buffer, size_t begin, size_t end, bool flush)
+  {
+    size_t const large = 70000;
+    byte_t* piece = new byte_t[large + 1000];
+
+    for (size_t step = 0; begin < end; ++step)
+    {
+      size_t length = step % 3 == 0 ? 1 : step % 3 == 1 ? 37 + step % 601 : large + step % 1000;
+      length = utl::min(length, end - begin);
+
+      for (size_t i = 0; i < length; ++i)
+        piece[i] = pattern(begin + i);
+
+      if (length == 1)
+        buffer.put(piece[0]);
+      else
+        buffer.put(piece, length);
+
+      begin += length;
+
+      if (flush && step % 5 == 4)
+        buffer.flush();
+    }
+
+    delete[] piece;
+  }
+
+  /**
+   * @param data data to check
+   * @param size number of bytes in 'data'
+   * @param position position within the test pattern 'data' is expected to start at
+   * @return true if 'data' contains the test pattern starting at 'position'
+   */
+  inline bool matches(byte_t const* data, size_t size, size_t position)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (data[i] != pattern(position + i))
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * @param fd file descriptor to read from, starting at its current offset (it may be a pipe)
+   * @param size number of bytes to read
+   * @param position position within the test pattern the data is expected to start at
+   * @return true if the 'size' bytes read from 'fd' contain the test pattern starting at
+   *         'position'
+   */
+  inline bool matchesFile(int fd, size_t size, size_t position)
+  {
+    byte_t data[4096];
+
+    while (size != 0)
+    {
+      ssize_t result = read(fd, data, utl::min(sizeof(data), size));
+
+      if (result <= 0 || !matches(data, static_cast<size_t>(result), position))
+        return false;
+
+      position += result;
+      size     -= result;
+    }
+    return true;
+  }
+}
+
+
+#endif
@@ -0,0 +1,48 @@
+// Random.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLTESTRANDOM_HPP
+#define UTLTESTRANDOM_HPP
+
+#include <util/Config.hpp>
+
+
+namespace test
+{
+  uint64_t random(uint64_t& state);
+}
+
+
+namespace test
+{
+  /**
+   * A simple linear congruential generator, we want reproducible results.
+   * @param state (in/out) state of the generator, any value is a valid seed
+   * @return next pseudo random number, with the upper half of the state folded into the lower
+   *         one, the low bits of the state alone are not very random
+   */
+  inline uint64_t random(uint64_t& state)
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return state ^ (state >> 32);
+  }
+}
+
+
+#endif
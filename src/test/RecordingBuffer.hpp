@@ -0,0 +1,197 @@
+// RecordingBuffer.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLTESTRECORDINGBUFFER_HPP
+#define UTLTESTRECORDINGBUFFER_HPP
+
+#include <sched.h>
+
+#include <util/Util.hpp>
+#include <util/io/StreamBuffer.hpp>
+
+
+namespace test
+{
+  /**
+   * This class is a StreamBuffer for tests that records everything put into it, up to a fixed
+   * capacity. Puts can be held back until the buffer is opened, to simulate a slow sink.
+   */
+  class RecordingBuffer: public utl::StreamBuffer
+  {
+  public:
+    RecordingBuffer(size_t capacity, bool open = true);
+    ~RecordingBuffer();
+
+    RecordingBuffer(RecordingBuffer const&) = delete;
+    RecordingBuffer& operator =(RecordingBuffer const&) = delete;
+
+    virtual void put(byte_t element) override;
+    virtual void put(byte_t const* elements, size_t size) override;
+
+    virtual void flush() override;
+
+    void open();
+    void clear();
+
+    byte_t* data();
+    byte_t const* data() const;
+    size_t size() const;
+    size_t puts() const;
+    size_t flushes() const;
+
+    bool equals(char const* string) const;
+
+  private:
+    byte_t* data_;
+    size_t capacity_;
+    size_t size_;
+    size_t puts_;
+    size_t flushes_;
+    bool open_;
+  };
+}
+
+
+namespace test
+{
+  /**
+   * @param capacity maximum number of bytes to record, everything beyond is dropped
+   * @param open false to hold back all puts until open is called
+   */
+  inline RecordingBuffer::RecordingBuffer(size_t capacity, bool open)
+    : data_(new byte_t[capacity]),
+      capacity_(capacity),
+      size_(0),
+      puts_(0),
+      flushes_(0),
+      open_(open)
+  {
+  }
+
+  /**
+   * The destructor frees the recorded data.
+   */
+  inline RecordingBuffer::~RecordingBuffer()
+  {
+    delete[] data_;
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void RecordingBuffer::put(byte_t element)
+  {
+    put(&element, 1);
+  }
+
+  /**
+   * @copydoc StreamBuffer::put
+   */
+  inline void RecordingBuffer::put(byte_t const* elements, size_t size)
+  {
+    while (!__atomic_load_n(&open_, __ATOMIC_ACQUIRE))
+      sched_yield();
+
+    size = utl::min(size, capacity_ - size_);
+
+    __builtin_memcpy(data_ + size_, elements, size);
+    size_ += size;
+    puts_++;
+  }
+
+  /**
+   * This method only counts the flushes.
+   */
+  inline void RecordingBuffer::flush()
+  {
+    ++flushes_;
+  }
+
+  /**
+   * This method lets puts held back continue, it may be called from any thread.
+   */
+  inline void RecordingBuffer::open()
+  {
+    __atomic_store_n(&open_, true, __ATOMIC_RELEASE);
+  }
+
+  /**
+   * This method drops everything recorded so far.
+   */
+  inline void RecordingBuffer::clear()
+  {
+    size_    = 0;
+    puts_    = 0;
+    flushes_ = 0;
+  }
+
+  /**
+   * @return data recorded so far, it may be modified (e.g., to corrupt it on purpose)
+   */
+  inline byte_t* RecordingBuffer::data()
+  {
+    return data_;
+  }
+
+  /**
+   * @return data recorded so far
+   */
+  inline byte_t const* RecordingBuffer::data() const
+  {
+    return data_;
+  }
+
+  /**
+   * @return number of bytes recorded so far
+   */
+  inline size_t RecordingBuffer::size() const
+  {
+    return size_;
+  }
+
+  /**
+   * @return number of puts so far, each byte put individually counts as one
+   */
+  inline size_t RecordingBuffer::puts() const
+  {
+    return puts_;
+  }
+
+  /**
+   * @return number of flushes so far
+   */
+  inline size_t RecordingBuffer::flushes() const
+  {
+    return flushes_;
+  }
+
+  /**
+   * @param string zero terminated string to compare with
+   * @return true if the data recorded equals the given string
+   */
+  inline bool RecordingBuffer::equals(char const* string) const
+  {
+    size_t length = __builtin_strlen(string);
+
+    return size_ == length && __builtin_memcmp(data_, string, length) == 0;
+  }
+}
+
+
+#endif
@@ -0,0 +1,129 @@
+// TempFile.hpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef UTLTESTTEMPFILE_HPP
+#define UTLTESTTEMPFILE_HPP
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <util/Config.hpp>
+
+
+namespace test
+{
+  /**
+   * This class represents a temporary file that is removed on destruction, along with an open
+   * file descriptor for it.
+   */
+  class TempFile
+  {
+  public:
+    TempFile();
+    ~TempFile();
+
+    TempFile(TempFile const&) = delete;
+    TempFile& operator =(TempFile const&) = delete;
+
+    int fd() const;
+    char const* path() const;
+
+    off_t size() const;
+    size_t read(byte_t* buffer, size_t size) const;
+
+  private:
+    char path_[32];
+    int fd_;
+  };
+}
+
+
+namespace test
+{
+  /**
+   * The default constructor creates an empty file, opened for reading and writing.
+   */
+  inline TempFile::TempFile()
+    : fd_(-1)
+  {
+    char const path[] = "/tmp/libutil_testXXXXXX";
+
+    __builtin_memcpy(path_, path, sizeof(path));
+    fd_ = mkstemp(path_);
+  }
+
+  /**
+   * The destructor closes and removes the file.
+   */
+  inline TempFile::~TempFile()
+  {
+    close(fd_);
+    unlink(path_);
+  }
+
+  /**
+   * @return file descriptor of the file
+   */
+  inline int TempFile::fd() const
+  {
+    return fd_;
+  }
+
+  /**
+   * @return path of the file, for opening it another time
+   */
+  inline char const* TempFile::path() const
+  {
+    return path_;
+  }
+
+  /**
+   * @return size of the file or -1 on error
+   */
+  inline off_t TempFile::size() const
+  {
+    struct stat status;
+    return fstat(fd_, &status) == 0 ? status.st_size : -1;
+  }
+
+  /**
+   * @param buffer buffer to read into
+   * @param size maximum number of bytes to read
+   * @return number of bytes read from the start of the file into 'buffer'
+   */
+  inline size_t TempFile::read(byte_t* buffer, size_t size) const
+  {
+    size_t total = 0;
+
+    while (total < size)
+    {
+      ssize_t result = pread(fd_, buffer + total, size - total, total);
+
+      if (result <= 0)
+        break;
+
+      total += result;
+    }
+    return total;
+  }
+}
+
+
+#endif
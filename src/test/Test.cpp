@@ -27,6 +27,30 @@
 #include "TestString.hpp"
 #include "TestAlgorithm.hpp"
 #include "TestOutStream.hpp"
+#include "TestStringInterner.hpp"
+#include "TestSearch.hpp"
+#include "TestTokenizer.hpp"
+#include "TestAscii.hpp"
+#include "TestUtf8.hpp"
+#include "TestParse.hpp"
+#include "TestInStream.hpp"
+#include "TestFormatInteger.hpp"
+#include "TestFormatFloat.hpp"
+#include "TestFormat.hpp"
+#include "TestFdBuffer.hpp"
+#include "TestIoUringBuffer.hpp"
+#include "TestMmapFileBuffer.hpp"
+#include "TestAsyncBuffer.hpp"
+#include "TestLogRing.hpp"
+#include "TestBinaryLog.hpp"
+#include "TestChainBuffer.hpp"
+#include "TestBlockPool.hpp"
+#include "TestByteSlice.hpp"
+#include "TestChecksum.hpp"
+#include "TestCompress.hpp"
+#include "TestEncode.hpp"
+#include "TestJsonWriter.hpp"
+#include "TestCsvWriter.hpp"
 
 
 int main()
@@ -39,6 +63,30 @@ int main()
   suite.add(tst::createTestCase<test::TestString>());
   suite.add(tst::createTestCase<test::TestAlgorithm>());
   suite.add(tst::createTestCase<test::TestOutStream>());
+  suite.add(tst::createTestCase<test::TestStringInterner>());
+  suite.add(tst::createTestCase<test::TestSearch>());
+  suite.add(tst::createTestCase<test::TestTokenizer>());
+  suite.add(tst::createTestCase<test::TestAscii>());
+  suite.add(tst::createTestCase<test::TestUtf8>());
+  suite.add(tst::createTestCase<test::TestParse>());
+  suite.add(tst::createTestCase<test::TestInStream>());
+  suite.add(tst::createTestCase<test::TestFormatInteger>());
+  suite.add(tst::createTestCase<test::TestFormatFloat>());
+  suite.add(tst::createTestCase<test::TestFormat>());
+  suite.add(tst::createTestCase<test::TestFdBuffer>());
+  suite.add(tst::createTestCase<test::TestIoUringBuffer>());
+  suite.add(tst::createTestCase<test::TestMmapFileBuffer>());
+  suite.add(tst::createTestCase<test::TestAsyncBuffer>());
+  suite.add(tst::createTestCase<test::TestLogRing>());
+  suite.add(tst::createTestCase<test::TestBinaryLog>());
+  suite.add(tst::createTestCase<test::TestChainBuffer>());
+  suite.add(tst::createTestCase<test::TestBlockPool>());
+  suite.add(tst::createTestCase<test::TestByteSlice>());
+  suite.add(tst::createTestCase<test::TestChecksum>());
+  suite.add(tst::createTestCase<test::TestCompress>());
+  suite.add(tst::createTestCase<test::TestEncode>());
+  suite.add(tst::createTestCase<test::TestJsonWriter>());
+  suite.add(tst::createTestCase<test::TestCsvWriter>());
 
   std::cout << "Running Tests...\n";
 
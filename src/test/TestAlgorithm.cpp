@@ -254,7 +254,29 @@ namespace test
   void TestAlgorithm::testCopy3(tst::TestResult& result)
   {
     // test optimized version of copy
-    // @todo implement me!
-    //ASSERTM(false, "implement me!");
+    static byte_t source[1024];
+    static byte_t destination[1024];
+
+    for (size_t i = 0; i < sizeof(source); ++i)
+      source[i] = static_cast<byte_t>(i * 7);
+
+    // all combinations of alignments and some lengths around the block size, the end pointer
+    // returned must be correct no matter whether the end is aligned or not
+    for (size_t offset = 0; offset < 130; offset += 3)
+    {
+      for (size_t length = 250; length < 520; length += 1)
+      {
+        utl::fill(destination, destination + sizeof(destination), 0);
+
+        byte_t const* begin = source + offset;
+        byte_t* end = utl::copy(begin, begin + length, destination + 1);
+
+        TESTASSERTOP(end, eq, destination + 1 + length);
+        TESTASSERTOP(destination[0], eq, 0);
+        TESTASSERTOP(destination[1], eq, source[offset]);
+        TESTASSERTOP(destination[length], eq, source[offset + length - 1]);
+        TESTASSERTOP(destination[length + 1], eq, 0);
+      }
+    }
   }
 }
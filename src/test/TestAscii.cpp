@@ -0,0 +1,107 @@
+// TestAscii.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/Ascii.hpp>
+
+#include "TestAscii.hpp"
+
+
+namespace test
+{
+  TestAscii::TestAscii()
+    : tst::TestCase<TestAscii>(*this, "TestAscii")
+  {
+    add(&TestAscii::testIsAscii);
+    add(&TestAscii::testToLower);
+    add(&TestAscii::testToUpper);
+  }
+
+  void TestAscii::testIsAscii(tst::TestResult& result)
+  {
+    byte_t buffer[200];
+
+    for (size_t i = 0; i < sizeof(buffer); ++i)
+      buffer[i] = static_cast<byte_t>(i % 128);
+
+    TESTASSERT(utl::isAscii(buffer, buffer));
+    TESTASSERT(utl::isAscii(buffer, buffer + sizeof(buffer)));
+
+    // a single non-ASCII byte has to be found at any position and for any range length
+    for (size_t i = 0; i < sizeof(buffer); ++i)
+    {
+      byte_t old = buffer[i];
+      buffer[i] = 0x80 | old;
+
+      TESTASSERT(!utl::isAscii(buffer, buffer + sizeof(buffer)));
+      TESTASSERT(!utl::isAscii(buffer + i, buffer + i + 1));
+      TESTASSERT(utl::isAscii(buffer, buffer + i));
+      TESTASSERT(utl::isAscii(buffer + i + 1, buffer + sizeof(buffer)));
+
+      buffer[i] = old;
+    }
+
+    char const* string = "abc\xc3\xa4";
+    TESTASSERT(utl::isAscii(string, string + 3));
+    TESTASSERT(!utl::isAscii(string, string + 5));
+  }
+
+  void TestAscii::testToLower(tst::TestResult& result)
+  {
+    char const* string = "Hello WORLD, this is A Test of @[`{ \xc3\x84 and 0123456789 - ZAZ";
+    char const* expect = "hello world, this is a test of @[`{ \xc3\x84 and 0123456789 - zaz";
+    char buffer[100];
+
+    size_t length = utl::length(string);
+    char* end = utl::toLower(string, string + length, buffer);
+
+    *end = '\0';
+
+    TESTASSERTOP(end, eq, buffer + length);
+    TESTASSERTOP(utl::compare(buffer, expect), eq, 0);
+
+    // in place conversion
+    utl::copy(string, string + length, buffer);
+    utl::toLower(buffer, buffer + length, buffer);
+
+    TESTASSERTOP(utl::compare(buffer, expect), eq, 0);
+  }
+
+  void TestAscii::testToUpper(tst::TestResult& result)
+  {
+    byte_t input[256];
+    byte_t output[256];
+
+    for (size_t i = 0; i < 256; ++i)
+      input[i] = static_cast<byte_t>(i);
+
+    // all byte values at all offsets relative to a vector
+    for (size_t offset = 0; offset < 32; ++offset)
+    {
+      byte_t* end = utl::toUpper(input + offset, input + 256, output);
+      TESTASSERTOP(end, eq, output + 256 - offset);
+
+      for (size_t i = offset; i < 256; ++i)
+      {
+        byte_t expected = i >= 'a' && i <= 'z' ? static_cast<byte_t>(i - 'a' + 'A') : input[i];
+        TESTASSERTOP(output[i - offset], eq, expected);
+      }
+    }
+  }
+}
@@ -0,0 +1,139 @@
+// TestAsyncBuffer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/io/AsyncBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "Pattern.hpp"
+#include "RecordingBuffer.hpp"
+#include "TestAsyncBuffer.hpp"
+
+
+namespace test
+{
+  TestAsyncBuffer::TestAsyncBuffer()
+    : tst::TestCase<TestAsyncBuffer>(*this, "TestAsyncBuffer")
+  {
+    add(&TestAsyncBuffer::testOrder);
+    add(&TestAsyncBuffer::testDrop);
+    add(&TestAsyncBuffer::testSync);
+  }
+
+  void TestAsyncBuffer::testOrder(tst::TestResult& result)
+  {
+    utl::Backpressure const policies[] = {utl::BACKPRESSURE_BLOCK, utl::BACKPRESSURE_SPIN};
+
+    for (utl::Backpressure policy : policies)
+    {
+      size_t const size = 300000;
+      RecordingBuffer sink(size);
+
+      {
+        utl::AsyncBuffer buffer(sink, policy, 500);
+
+        TESTASSERTOP(buffer.policy(), eq, policy);
+
+        putPattern(buffer, 0, size, true);
+      }
+
+      // everything arrives in order, even though the ring wrapped around many times
+      TESTASSERTOP(sink.size(), eq, size);
+      TESTASSERT(matches(sink.data(), size));
+      TESTASSERTOP(sink.flushes(), le, size);
+      TESTASSERT(sink.flushes() > 0);
+    }
+  }
+
+  void TestAsyncBuffer::testDrop(tst::TestResult& result)
+  {
+    size_t const count = 50;
+    size_t const length = 100;
+
+    // the sink does not take anything for now, so the ring fills up
+    RecordingBuffer sink(count * length, false);
+    utl::AsyncBuffer buffer(sink, utl::BACKPRESSURE_DROP, 1024);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      buffer.fill(static_cast<byte_t>(i), length / 2);
+      buffer.fill(static_cast<byte_t>(i), length - length / 2);
+      buffer.flush();
+    }
+
+    sink.open();
+    buffer.sync();
+
+    TESTASSERTOP(buffer.droppedMessages(), le, count);
+    TESTASSERT(buffer.droppedMessages() > 0);
+    TESTASSERTOP(buffer.droppedBytes(), eq, buffer.droppedMessages() * length);
+
+    // the messages that made it are complete and in order
+    TESTASSERTOP(sink.size() % length, eq, 0);
+    TESTASSERTOP(sink.size() / length + buffer.droppedMessages(), eq, count);
+
+    byte_t const* data = sink.data();
+    size_t previous = 0;
+
+    for (size_t i = 0; i < sink.size(); i += length)
+    {
+      TESTASSERT(i == 0 || data[i] > previous);
+      previous = data[i];
+
+      for (size_t j = 1; j < length; ++j)
+        TESTASSERTOP(data[i + j], eq, data[i]);
+    }
+
+    // with room available again, messages go through, except those larger than the ring
+    size_t delivered = sink.size();
+    size_t dropped = buffer.droppedMessages();
+
+    buffer.fill('x', 2000);
+    buffer.flush();
+    buffer.fill('y', 10);
+    buffer.sync();
+
+    TESTASSERTOP(buffer.droppedMessages(), eq, dropped + 1);
+    TESTASSERTOP(sink.size(), eq, delivered + 10);
+    TESTASSERTOP(sink.data()[delivered], eq, 'y');
+  }
+
+  void TestAsyncBuffer::testSync(tst::TestResult& result)
+  {
+    RecordingBuffer sink(64);
+    utl::AsyncBuffer buffer(sink);
+    utl::BasicOutStream<utl::AsyncBuffer> stream(buffer);
+
+    stream << "value: " << 42;
+    buffer.sync();
+
+    TESTASSERTOP(sink.size(), eq, 9);
+    TESTASSERTOP(sink.flushes(), eq, 1);
+    TESTASSERT(__builtin_memcmp(sink.data(), "value: 42", 9) == 0);
+
+    // nothing new to hand over, the sink is not flushed again
+    buffer.sync();
+    TESTASSERTOP(sink.flushes(), eq, 1);
+
+    stream << utl::width(4) << 7 << utl::flush;
+    buffer.sync();
+
+    TESTASSERTOP(sink.size(), eq, 13);
+    TESTASSERTOP(sink.flushes(), eq, 2);
+  }
+}
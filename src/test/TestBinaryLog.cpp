@@ -0,0 +1,261 @@
+// TestBinaryLog.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/io/AsyncBuffer.hpp>
+#include <util/io/BinaryLog.hpp>
+
+#include "TestBinaryLog.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * This class is a buffer remembering everything put into it, followed by a terminating
+     * zero.
+     */
+    class StringBuffer final: public utl::StreamBuffer
+    {
+    public:
+      StringBuffer()
+        : StreamBuffer(),
+          length_(0)
+      {
+        data_[0] = 0;
+      }
+
+      virtual void put(byte_t value) override
+      {
+        put(&value, 1);
+      }
+
+      virtual void put(byte_t const* range, size_t size) override
+      {
+        for (size_t i = 0; i < size; ++i)
+          data_[length_++] = range[i];
+
+        data_[length_] = 0;
+      }
+
+      virtual void flush() override
+      {
+      }
+
+      byte_t const* data() const
+      {
+        return data_;
+      }
+
+      char const* string() const
+      {
+        return reinterpret_cast<char const*>(data_);
+      }
+
+      size_t length() const
+      {
+        return length_;
+      }
+
+    private:
+      byte_t data_[1024];
+      size_t length_;
+    };
+
+
+    /**
+     * This functor records log statements in binary form.
+     */
+    template<typename BufferT>
+    struct BinaryLogger
+    {
+      BufferT* buffer;
+
+      template<typename FormatT, typename ...ArgsT>
+      void operator ()(FormatT format, ArgsT const& ...args) const
+      {
+        utl::logBinary(*buffer, format, args...);
+      }
+    };
+
+    /**
+     * This functor formats log statements right away.
+     */
+    struct TextLogger
+    {
+      utl::OutStream* stream;
+
+      template<typename FormatT, typename ...ArgsT>
+      void operator ()(FormatT format, ArgsT const& ...args) const
+      {
+        utl::format(*stream, format, args...);
+      }
+    };
+
+
+    int counter = 0;
+
+    /**
+     * This function logs a couple of statements using all supported types.
+     */
+    template<typename LoggerT>
+    void logStatements(LoggerT const& log)
+    {
+      char name[] = "bar";
+      char const* text = "some text";
+      log(UTL_FORMAT("id={} val={x}\n"), 42, 0xbeeful);
+      log(UTL_FORMAT("{} {} {} {}\n"), 'c', -1.5, "foo", name);
+      log(UTL_FORMAT("{{{b}}} {o} {d}\n"), static_cast<ushort_t>(5), static_cast<sshort_t>(-8),
+          static_cast<slong_t>(-10));
+      log(UTL_FORMAT("{}|{}|{}|{}\n"), static_cast<uchar_t>(98), static_cast<schar_t>(-98),
+          2.5f, nullptr);
+      log(UTL_FORMAT("{} {x} {}\n"), text, 255u, "");
+      log(UTL_FORMAT("{}\n"), static_cast<void const*>(&counter));
+      log(UTL_FORMAT("no arguments\n"));
+    }
+
+    /**
+     * @return true if the binary records in [begin, end) decode to the same text as the
+     *         statements formatted right away
+     */
+    bool decodesCorrectly(byte_t const* begin, byte_t const* end)
+    {
+      StringBuffer expected;
+      utl::OutStream expected_stream(expected);
+
+      logStatements(TextLogger{&expected_stream});
+
+      StringBuffer actual;
+      utl::OutStream actual_stream(actual);
+
+      if (utl::decodeBinaryLog(begin, end, actual_stream) != end)
+        return false;
+
+      return utl::compare(actual.string(), expected.string()) == 0;
+    }
+  }
+
+
+  TestBinaryLog::TestBinaryLog()
+    : tst::TestCase<TestBinaryLog>(*this, "TestBinaryLog")
+  {
+    add(&TestBinaryLog::testRoundTrip);
+    add(&TestBinaryLog::testPieces);
+    add(&TestBinaryLog::testUnknown);
+    add(&TestBinaryLog::testAsync);
+  }
+
+  void TestBinaryLog::testRoundTrip(tst::TestResult& result)
+  {
+    StringBuffer binary;
+    logStatements(BinaryLogger<StringBuffer>{&binary});
+
+    byte_t const* begin = binary.data();
+    byte_t const* end   = begin + binary.length();
+
+    TESTASSERT(decodesCorrectly(begin, end));
+
+    // the first record consists of the format ID, an int, and an unsigned long
+    StringBuffer text;
+    utl::OutStream stream(text);
+    size_t size = sizeof(uint32_t) + sizeof(int) + sizeof(ulong_t);
+
+    TESTASSERT(utl::decodeBinaryRecord(begin, begin + size - 1, stream) == begin);
+    TESTASSERTOP(text.length(), eq, 0);
+    TESTASSERT(utl::decodeBinaryRecord(begin, end, stream) == begin + size);
+    TESTASSERT(utl::compare(text.string(), "id=42 val=BEEF\n") == 0);
+  }
+
+  void TestBinaryLog::testPieces(tst::TestResult& result)
+  {
+    StringBuffer binary;
+    logStatements(BinaryLogger<StringBuffer>{&binary});
+
+    StringBuffer expected;
+    utl::OutStream expected_stream(expected);
+
+    logStatements(TextLogger{&expected_stream});
+
+    size_t const sizes[] = {1, 3, 7, 1000};
+
+    for (size_t size : sizes)
+    {
+      StringBuffer text;
+      utl::OutStream stream(text);
+
+      {
+        utl::BinaryLogDecoder decoder(stream);
+
+        for (size_t i = 0; i < binary.length(); i += size)
+          decoder.put(binary.data() + i, utl::min(size, binary.length() - i));
+
+        TESTASSERT(decoder.good());
+      }
+
+      TESTASSERT(utl::compare(text.string(), expected.string()) == 0);
+    }
+  }
+
+  void TestBinaryLog::testUnknown(tst::TestResult& result)
+  {
+    StringBuffer text;
+    utl::OutStream stream(text);
+
+    byte_t const record[] = {0xff, 0xff, 0xff, 0xff, 'x'};
+
+    TESTASSERT(utl::decodeBinaryRecord(record, record + sizeof(record), stream) == nullptr);
+
+    utl::BinaryLogDecoder decoder(stream);
+    decoder.put(record, sizeof(record));
+    TESTASSERT(!decoder.good());
+
+    // everything following is discarded
+    StringBuffer binary;
+    logStatements(BinaryLogger<StringBuffer>{&binary});
+
+    decoder.put(binary.data(), binary.length());
+    TESTASSERT(!decoder.good());
+    TESTASSERTOP(text.length(), eq, 0);
+  }
+
+  void TestBinaryLog::testAsync(tst::TestResult& result)
+  {
+    StringBuffer expected;
+    utl::OutStream expected_stream(expected);
+
+    logStatements(TextLogger{&expected_stream});
+
+    StringBuffer text;
+    utl::OutStream stream(text);
+    utl::BinaryLogDecoder decoder(stream);
+
+    {
+      // formatting happens on the consumer thread, records arrive in pieces
+      utl::AsyncBuffer buffer(decoder, utl::BACKPRESSURE_BLOCK, 64);
+
+      logStatements(BinaryLogger<utl::AsyncBuffer>{&buffer});
+      buffer.sync();
+
+      TESTASSERT(utl::compare(text.string(), expected.string()) == 0);
+    }
+
+    TESTASSERT(decoder.good());
+  }
+}
@@ -29,6 +29,8 @@ namespace test
   {
     add(&TestBits::testRotateLeft1);
     add(&TestBits::testRotateRight1);
+    add(&TestBits::testCountLeadingZeros);
+    add(&TestBits::testCountTrailingZeros);
   }
 
   void TestBits::testRotateLeft1(tst::TestResult& result)
@@ -44,6 +46,10 @@ namespace test
     TESTASSERTOP((utl::rotateLeft<uint32_t, 20>(7, 2)), eq, 28);
     TESTASSERTOP((utl::rotateLeft<uint32_t, 20>(7, 2)), eq, 28);
     TESTASSERTOP((utl::rotateLeft<uint32_t, 20>(1 << 19, 1)), eq, 1);
+
+    TESTASSERTOP((utl::rotateLeft<uint32_t, 32>(0x80000001, 1)), eq, 3);
+    TESTASSERTOP((utl::rotateLeft<uint64_t, 64>(0x8000000000000001, 0)), eq, 0x8000000000000001);
+    TESTASSERTOP((utl::rotateLeft<uint64_t, 64>(0x8000000000000001, 4)), eq, 0x18);
   }
 
   void TestBits::testRotateRight1(tst::TestResult& result)
@@ -53,5 +59,26 @@ namespace test
 
     TESTASSERTOP((utl::rotateRight<uint32_t, 19>(1, 1)), eq, 1 << 18);
     TESTASSERTOP((utl::rotateRight<uint32_t, 19>(1, 2)), eq, 1 << 17);
+
+    TESTASSERTOP((utl::rotateRight<uint64_t, 64>(3, 1)), eq, 0x8000000000000001);
+    TESTASSERTOP((utl::rotateRight<uint64_t, 64>(0x18, 4)), eq, 0x8000000000000001);
+  }
+
+  void TestBits::testCountLeadingZeros(tst::TestResult& result)
+  {
+    TESTASSERTOP(utl::countLeadingZeros<uint8_t>(1), eq, 7);
+    TESTASSERTOP(utl::countLeadingZeros<uint8_t>(0x80), eq, 0);
+    TESTASSERTOP(utl::countLeadingZeros<uint16_t>(0xff), eq, 8);
+    TESTASSERTOP(utl::countLeadingZeros<uint32_t>(1), eq, 31);
+    TESTASSERTOP(utl::countLeadingZeros<uint64_t>(1), eq, 63);
+    TESTASSERTOP(utl::countLeadingZeros<uint64_t>(0xffffffffffffffff), eq, 0);
+  }
+
+  void TestBits::testCountTrailingZeros(tst::TestResult& result)
+  {
+    TESTASSERTOP(utl::countTrailingZeros<uint8_t>(1), eq, 0);
+    TESTASSERTOP(utl::countTrailingZeros<uint8_t>(0x80), eq, 7);
+    TESTASSERTOP(utl::countTrailingZeros<uint32_t>(0x100), eq, 8);
+    TESTASSERTOP(utl::countTrailingZeros<uint64_t>(0x8000000000000000), eq, 63);
   }
 }
@@ -35,6 +35,9 @@ namespace test
 
     void testRotateLeft1(tst::TestResult& result);
     void testRotateRight1(tst::TestResult& result);
+
+    void testCountLeadingZeros(tst::TestResult& result);
+    void testCountTrailingZeros(tst::TestResult& result);
   };
 }
 
@@ -0,0 +1,223 @@
+// TestBlockPool.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <pthread.h>
+
+#include <util/io/BlockPool.hpp>
+
+#include "TestBlockPool.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    size_t const BLOCK_SIZE = 128;
+    size_t const THREADS    = 6;
+    size_t const ROUNDS     = 2000;
+
+    /**
+     * This structure describes the work of a thread using a pool.
+     */
+    struct Worker
+    {
+      utl::BlockPool* pool;
+      size_t id;
+      bool corrupted;
+    };
+
+    /**
+     * This function repeatedly allocates batches of blocks of varying size, marks them, and
+     * releases them again after checking that no other thread touched them.
+     */
+    void* work(void* argument)
+    {
+      Worker* worker = static_cast<Worker*>(argument);
+      byte_t* blocks[100];
+
+      for (size_t i = 0; i < ROUNDS; ++i)
+      {
+        size_t count = 1 + (i * 37 + worker->id) % 100;
+        byte_t mark = static_cast<byte_t>(worker->id * 31 + i);
+
+        for (size_t j = 0; j < count; ++j)
+        {
+          blocks[j] = worker->pool->allocate();
+          __builtin_memset(blocks[j], mark, BLOCK_SIZE);
+        }
+
+        for (size_t j = 0; j < count; ++j)
+        {
+          if (blocks[j][0] != mark || blocks[j][BLOCK_SIZE - 1] != mark)
+            worker->corrupted = true;
+
+          worker->pool->release(blocks[j]);
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * This function allocates and releases a single block.
+     */
+    void* allocateOne(void* argument)
+    {
+      utl::BlockPool* pool = static_cast<utl::BlockPool*>(argument);
+      pool->release(pool->allocate());
+      return nullptr;
+    }
+  }
+
+
+  TestBlockPool::TestBlockPool()
+    : tst::TestCase<TestBlockPool>(*this, "TestBlockPool")
+  {
+    add(&TestBlockPool::testRecycle);
+    add(&TestBlockPool::testThreads);
+    add(&TestBlockPool::testTrim);
+    add(&TestBlockPool::testReserve);
+  }
+
+  void TestBlockPool::testRecycle(tst::TestResult& result)
+  {
+    utl::BlockPool pool(BLOCK_SIZE);
+    byte_t* blocks[200];
+
+    TESTASSERTOP(pool.blockSize(), eq, BLOCK_SIZE);
+
+    for (size_t i = 0; i < 200; ++i)
+      blocks[i] = pool.allocate();
+
+    utl::BlockPoolStatistics statistics = pool.statistics();
+
+    TESTASSERTOP(statistics.misses, eq, 200);
+    TESTASSERTOP(statistics.blocks, eq, 200);
+    TESTASSERTOP(statistics.footprint, eq, 200 * BLOCK_SIZE);
+
+    for (size_t i = 0; i < 200; ++i)
+      pool.release(blocks[i]);
+
+    // all blocks are recycled, nothing new is allocated
+    for (size_t round = 0; round < 10; ++round)
+    {
+      for (size_t i = 0; i < 200; ++i)
+        blocks[i] = pool.allocate();
+
+      for (size_t i = 0; i < 200; ++i)
+        pool.release(blocks[200 - i - 1]);
+    }
+
+    statistics = pool.statistics();
+
+    TESTASSERTOP(statistics.misses, eq, 200);
+    TESTASSERTOP(statistics.blocks, eq, 200);
+    TESTASSERTOP(statistics.peak_blocks, eq, 200);
+    TESTASSERTOP(statistics.releases, eq, 11 * 200);
+    TESTASSERTOP(statistics.cache_hits + statistics.depot_hits, eq, 10 * 200);
+    TESTASSERT(statistics.cache_hits > statistics.depot_hits);
+  }
+
+  void TestBlockPool::testThreads(tst::TestResult& result)
+  {
+    utl::BlockPool pool(BLOCK_SIZE);
+
+    pthread_t threads[THREADS];
+    Worker workers[THREADS];
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+      workers[i].pool = &pool;
+      workers[i].id = i;
+      workers[i].corrupted = false;
+
+      TESTASSERTOP(pthread_create(&threads[i], nullptr, &work, &workers[i]), eq, 0);
+    }
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+      pthread_join(threads[i], nullptr);
+      TESTASSERT(!workers[i].corrupted);
+    }
+
+    // the exited threads handed their caches over to the depot
+    utl::BlockPoolStatistics statistics = pool.statistics();
+    size_t allocations = statistics.cache_hits + statistics.depot_hits + statistics.misses;
+
+    TESTASSERTOP(allocations, eq, statistics.releases);
+    TESTASSERTOP(statistics.blocks, eq, statistics.depot_blocks);
+    TESTASSERTOP(statistics.peak_blocks, le, THREADS * (100 + 2 * utl::BlockPool::MAGAZINE_SIZE));
+    TESTASSERT(statistics.misses < allocations / 100);
+  }
+
+  void TestBlockPool::testTrim(tst::TestResult& result)
+  {
+    size_t const count = 1000;
+    size_t const threshold = 100 * BLOCK_SIZE;
+
+    utl::BlockPool pool(BLOCK_SIZE, threshold);
+    byte_t* blocks[count];
+
+    for (size_t i = 0; i < count; ++i)
+      blocks[i] = pool.allocate();
+
+    for (size_t i = 0; i < count; ++i)
+      pool.release(blocks[i]);
+
+    // the depot stays below the threshold, the rest got back to the system
+    utl::BlockPoolStatistics statistics = pool.statistics();
+
+    TESTASSERTOP(statistics.depot_blocks, le, 100);
+    TESTASSERTOP(statistics.blocks, le, 100 + 2 * utl::BlockPool::MAGAZINE_SIZE);
+    TESTASSERTOP(statistics.blocks + statistics.trimmed_blocks, eq, count);
+    TESTASSERTOP(statistics.peak_blocks, eq, count);
+
+    size_t depot = statistics.depot_blocks;
+
+    TESTASSERTOP(pool.trim(), eq, depot);
+
+    statistics = pool.statistics();
+
+    TESTASSERTOP(statistics.depot_blocks, eq, 0);
+    TESTASSERTOP(statistics.blocks, le, 2 * utl::BlockPool::MAGAZINE_SIZE);
+  }
+
+  void TestBlockPool::testReserve(tst::TestResult& result)
+  {
+    utl::BlockPool pool(BLOCK_SIZE);
+
+    pool.reserve(100);
+
+    utl::BlockPoolStatistics statistics = pool.statistics();
+
+    TESTASSERTOP(statistics.blocks, eq, 100);
+    TESTASSERTOP(statistics.depot_blocks, eq, 100);
+
+    // another thread gets its block from the depot, not from the system
+    pthread_t thread;
+
+    TESTASSERTOP(pthread_create(&thread, nullptr, &allocateOne, &pool), eq, 0);
+    pthread_join(thread, nullptr);
+
+    statistics = pool.statistics();
+
+    TESTASSERTOP(statistics.misses, eq, 0);
+    TESTASSERTOP(statistics.depot_hits, eq, 1);
+    TESTASSERTOP(statistics.blocks, eq, 100);
+  }
+}
@@ -0,0 +1,326 @@
+// TestByteSlice.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <pthread.h>
+
+#include <util/io/ByteSlice.hpp>
+#include <util/io/OutStream.hpp>
+#include <util/io/SliceBuffer.hpp>
+
+#include "Pattern.hpp"
+#include "RecordingBuffer.hpp"
+#include "TestByteSlice.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    size_t const BLOCK_SIZE = 128;
+    size_t const THREADS    = 4;
+
+    /**
+     * @return true if the contents of the rope match the test pattern starting at 'position'
+     */
+    bool matches(utl::ByteRope const& rope, size_t position)
+    {
+      for (size_t i = 0; i < rope.slices(); ++i)
+      {
+        for (byte_t const* data = rope[i].begin(); data != rope[i].end(); ++data)
+        {
+          if (*data != pattern(position++))
+            return false;
+        }
+      }
+      return true;
+    }
+
+    /**
+     * @return number of blocks handed out by the pool and not released yet
+     */
+    size_t outstanding(utl::BlockPool const& pool)
+    {
+      utl::BlockPoolStatistics statistics = pool.statistics();
+      return statistics.cache_hits + statistics.depot_hits + statistics.misses -
+             statistics.releases;
+    }
+
+    /**
+     * This structure describes the work of a consuming thread.
+     */
+    struct Consumer
+    {
+      utl::ByteRope rope;
+      size_t position;
+      bool intact;
+    };
+
+    /**
+     * This function checks the rope it got handed and drops it.
+     */
+    void* consume(void* argument)
+    {
+      Consumer* consumer = static_cast<Consumer*>(argument);
+
+      // each consumer looks at a different part
+      utl::ByteRope part = consumer->rope.subrope(consumer->position, 1000);
+
+      consumer->intact = matches(part, consumer->position);
+      consumer->rope.clear();
+      return nullptr;
+    }
+  }
+
+
+  TestByteSlice::TestByteSlice()
+    : tst::TestCase<TestByteSlice>(*this, "TestByteSlice")
+  {
+    add(&TestByteSlice::testSlice);
+    add(&TestByteSlice::testRope);
+    add(&TestByteSlice::testBuffer);
+    add(&TestByteSlice::testThreads);
+  }
+
+  void TestByteSlice::testSlice(tst::TestResult& result)
+  {
+    utl::BlockPool pool(BLOCK_SIZE);
+
+    {
+      utl::ByteSlice empty;
+
+      TESTASSERT(empty.empty());
+      TESTASSERT(empty.subslice(0, 10).empty());
+    }
+
+    utl::ByteSlice slice;
+
+    {
+      utl::SliceBuffer buffer(pool);
+      utl::BasicOutStream<utl::SliceBuffer> stream(buffer);
+
+      stream << "Hello, World!";
+
+      utl::ByteRope rope = buffer.take();
+
+      TESTASSERTOP(rope.slices(), eq, 1);
+      TESTASSERTOP(rope.size(), eq, 13);
+
+      slice = rope[0];
+    }
+
+    // the slice keeps the block alive, the buffer and the rope are gone
+    TESTASSERTOP(outstanding(pool), eq, 1);
+    TESTASSERTOP(slice.size(), eq, 13);
+    TESTASSERT(__builtin_memcmp(slice.data(), "Hello, World!", 13) == 0);
+
+    utl::ByteSlice world = slice.subslice(7, 5);
+    utl::ByteSlice tail = slice.subslice(7, 100);
+    utl::ByteSlice none = slice.subslice(13, 1);
+
+    TESTASSERTOP(world.size(), eq, 5);
+    TESTASSERT(world.data() == slice.data() + 7);
+    TESTASSERT(__builtin_memcmp(world.data(), "World", 5) == 0);
+    TESTASSERTOP(tail.size(), eq, 6);
+    TESTASSERT(none.empty());
+
+    slice = utl::ByteSlice();
+    tail = utl::ByteSlice();
+
+    TESTASSERTOP(outstanding(pool), eq, 1);
+
+    utl::ByteSlice copy(world);
+    utl::ByteSlice moved(static_cast<utl::ByteSlice&&>(world));
+
+    TESTASSERT(world.empty());
+    TESTASSERT(copy.data() == moved.data());
+
+    copy = moved;
+    moved = utl::ByteSlice();
+    TESTASSERTOP(outstanding(pool), eq, 1);
+
+    // the last reference is gone, the block is back in the pool
+    copy = utl::ByteSlice();
+    TESTASSERTOP(outstanding(pool), eq, 0);
+  }
+
+  void TestByteSlice::testRope(tst::TestResult& result)
+  {
+    size_t const size = 1000;
+
+    utl::BlockPool pool(BLOCK_SIZE);
+    utl::SliceBuffer buffer(pool);
+
+    for (size_t i = 0; i < size; ++i)
+      buffer.put(pattern(i));
+
+    utl::ByteRope rope = buffer.take();
+
+    TESTASSERTOP(rope.size(), eq, size);
+    TESTASSERT(rope.slices() > 1);
+    TESTASSERT(matches(rope, 0));
+
+    // pieces of a rope are ropes sharing the blocks
+    utl::ByteRope first = rope.subrope(0, 300);
+    utl::ByteRope second = rope.subrope(300, 1000);
+    utl::ByteRope middle = rope.subrope(250, 100);
+
+    TESTASSERTOP(first.size(), eq, 300);
+    TESTASSERTOP(second.size(), eq, size - 300);
+    TESTASSERTOP(middle.size(), eq, 100);
+    TESTASSERT(matches(second, 300));
+    TESTASSERT(matches(middle, 250));
+    TESTASSERT(rope.subrope(size, 1).empty());
+
+    // adjacent pieces of the same block are merged again
+    utl::ByteRope joined = utl::concat(first, second);
+
+    TESTASSERTOP(joined.size(), eq, size);
+    TESTASSERTOP(joined.slices(), eq, rope.slices());
+    TESTASSERT(matches(joined, 0));
+
+    utl::ByteRope twice(middle);
+    twice.append(twice);
+
+    TESTASSERTOP(twice.size(), eq, 200);
+    TESTASSERT(matches(twice.subrope(100, 100), 250));
+
+    utl::ByteRope pair = utl::concat(middle[0], rope[0]);
+    TESTASSERTOP(pair.size(), eq, middle[0].size() + rope[0].size());
+
+    // a slice of the rope itself must survive the rope growing while it is appended
+    utl::ByteRope repeated(first);
+    size_t length = first[0].size();
+
+    for (size_t i = 0; i < 64; ++i)
+      repeated.append(repeated[0]);
+
+    TESTASSERTOP(repeated.size(), eq, first.size() + 64 * length);
+
+    for (size_t i = 0; i < 64; ++i)
+      TESTASSERT(matches(repeated.subrope(first.size() + i * length, length), 0));
+
+    iovec vector[64];
+    size_t count = rope.exportVector(vector, 64);
+    size_t total = 0;
+
+    TESTASSERTOP(count, eq, rope.slices());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      TESTASSERT(vector[i].iov_base == rope[i].data());
+      total += vector[i].iov_len;
+    }
+    TESTASSERTOP(total, eq, size);
+    TESTASSERTOP(rope.exportVector(vector, 1), eq, 1);
+
+    RecordingBuffer sink(size);
+    rope.writeTo(sink);
+
+    TESTASSERTOP(sink.size(), eq, size);
+    TESTASSERTOP(sink.puts(), eq, rope.slices());
+
+    TESTASSERT(matches(sink.data(), size));
+  }
+
+  void TestByteSlice::testBuffer(tst::TestResult& result)
+  {
+    utl::BlockPool pool(BLOCK_SIZE);
+
+    {
+      utl::SliceBuffer buffer(pool);
+
+      TESTASSERT(buffer.take().empty());
+
+      buffer.put(reinterpret_cast<byte_t const*>("first"), 5);
+      TESTASSERTOP(buffer.size(), eq, 5);
+
+      utl::ByteRope first = buffer.take();
+
+      TESTASSERTOP(buffer.size(), eq, 0);
+      TESTASSERT(buffer.take().empty());
+
+      // writing continues in the same block, behind the data taken out
+      buffer.fill('x', 10);
+      utl::ByteRope second = buffer.take();
+
+      TESTASSERTOP(first.size(), eq, 5);
+      TESTASSERTOP(second.size(), eq, 10);
+      TESTASSERT(second[0].data() == first[0].data() + 5);
+      TESTASSERT(__builtin_memcmp(first[0].data(), "first", 5) == 0);
+      TESTASSERTOP(outstanding(pool), eq, 1);
+
+      // data spanning several blocks
+      buffer.fill('y', 5 * BLOCK_SIZE);
+      TESTASSERTOP(buffer.size(), eq, 5 * BLOCK_SIZE);
+
+      utl::ByteRope third = buffer.take();
+
+      TESTASSERTOP(third.size(), eq, 5 * BLOCK_SIZE);
+      TESTASSERT(third.slices() > 5);
+
+      for (size_t i = 0; i < third.slices(); ++i)
+      {
+        for (byte_t const* data = third[i].begin(); data != third[i].end(); ++data)
+          TESTASSERTOP(*data, eq, 'y');
+      }
+    }
+
+    TESTASSERTOP(outstanding(pool), eq, 0);
+  }
+
+  void TestByteSlice::testThreads(tst::TestResult& result)
+  {
+    size_t const size = 10000;
+
+    utl::BlockPool pool(BLOCK_SIZE);
+
+    {
+      utl::SliceBuffer buffer(pool);
+
+      for (size_t i = 0; i < size; ++i)
+        buffer.put(pattern(i));
+
+      utl::ByteRope rope = buffer.take();
+
+      pthread_t threads[THREADS];
+      Consumer consumers[THREADS];
+
+      for (size_t i = 0; i < THREADS; ++i)
+      {
+        consumers[i].rope = rope;
+        consumers[i].position = i * 2000;
+        consumers[i].intact = false;
+      }
+
+      rope.clear();
+
+      for (size_t i = 0; i < THREADS; ++i)
+        TESTASSERTOP(pthread_create(&threads[i], nullptr, &consume, &consumers[i]), eq, 0);
+
+      for (size_t i = 0; i < THREADS; ++i)
+      {
+        pthread_join(threads[i], nullptr);
+        TESTASSERT(consumers[i].intact);
+      }
+    }
+
+    // the last consumer to drop a block released it, whichever thread it was
+    TESTASSERTOP(outstanding(pool), eq, 0);
+  }
+}
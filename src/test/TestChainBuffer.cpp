@@ -0,0 +1,233 @@
+// TestChainBuffer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <util/io/ChainBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "Pattern.hpp"
+#include "TempFile.hpp"
+#include "TestChainBuffer.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    size_t const BLOCK_SIZE = 256;
+
+    /**
+     * This function gathers the exported contents of a ChainBuffer and compares them against
+     * the test pattern starting at the given position.
+     * @return true if the contents match, false otherwise
+     */
+    bool matches(utl::ChainBuffer const& buffer, size_t position)
+    {
+      iovec vector[256];
+      size_t count = buffer.exportVector(vector, 256);
+      size_t size = 0;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        byte_t const* data = static_cast<byte_t const*>(vector[i].iov_base);
+
+        for (size_t j = 0; j < vector[i].iov_len; ++j)
+        {
+          if (data[j] != pattern(position + size + j))
+            return false;
+        }
+        size += vector[i].iov_len;
+      }
+      return size == buffer.size();
+    }
+  }
+
+
+  TestChainBuffer::TestChainBuffer()
+    : tst::TestCase<TestChainBuffer>(*this, "TestChainBuffer")
+  {
+    add(&TestChainBuffer::testGrowth);
+    add(&TestChainBuffer::testExport);
+    add(&TestChainBuffer::testSplice);
+    add(&TestChainBuffer::testConsume);
+  }
+
+  void TestChainBuffer::testGrowth(tst::TestResult& result)
+  {
+    utl::BlockPool pool(BLOCK_SIZE);
+    utl::ChainBuffer buffer(pool);
+    utl::BasicOutStream<utl::ChainBuffer> stream(buffer);
+
+    TESTASSERT(buffer.empty());
+    TESTASSERTOP(buffer.blocks(), eq, 0);
+
+    stream << "value: " << 42;
+    TESTASSERTOP(buffer.size(), eq, 9);
+    TESTASSERTOP(buffer.blocks(), eq, 1);
+
+    iovec vector[4];
+    byte_t const* first = nullptr;
+
+    TESTASSERTOP(buffer.exportVector(vector, 4), eq, 1);
+    TESTASSERT(__builtin_memcmp(vector[0].iov_base, "value: 42", 9) == 0);
+    first = static_cast<byte_t const*>(vector[0].iov_base);
+
+    buffer.fill('x', 10 * BLOCK_SIZE);
+    TESTASSERTOP(buffer.size(), eq, 9 + 10 * BLOCK_SIZE);
+    TESTASSERT(buffer.blocks() > 10);
+
+    // data already written stays where it is
+    TESTASSERTOP(buffer.exportVector(vector, 1), eq, 1);
+    TESTASSERT(vector[0].iov_base == first);
+    TESTASSERT(__builtin_memcmp(first, "value: 42", 9) == 0);
+
+    buffer.clear();
+    TESTASSERT(buffer.empty());
+    TESTASSERTOP(buffer.blocks(), eq, 0);
+  }
+
+  void TestChainBuffer::testExport(tst::TestResult& result)
+  {
+    size_t const size = 50000;
+
+    utl::BlockPool pool(BLOCK_SIZE);
+    utl::ChainBuffer buffer(pool);
+
+    putPattern(buffer, 0, size);
+    TESTASSERTOP(buffer.size(), eq, size);
+
+    TempFile file;
+    int fd = file.fd();
+
+    // write everything with as few system calls as the vector size permits
+    while (!buffer.empty())
+    {
+      iovec vector[64];
+      size_t count = buffer.exportVector(vector, 64);
+
+      ssize_t written = writev(fd, vector, static_cast<int>(count));
+      TESTASSERT(written > 0);
+
+      buffer.consume(static_cast<size_t>(written));
+    }
+
+    TESTASSERTOP(lseek(fd, 0, SEEK_END), eq, static_cast<off_t>(size));
+    TESTASSERTOP(lseek(fd, 0, SEEK_SET), eq, 0);
+
+    byte_t* data = new byte_t[size];
+    TESTASSERTOP(read(fd, data, size), eq, static_cast<ssize_t>(size));
+
+    TESTASSERT(matches(data, size));
+
+    delete[] data;
+  }
+
+  void TestChainBuffer::testSplice(tst::TestResult& result)
+  {
+    size_t const size = 3000;
+
+    utl::BlockPool pool(BLOCK_SIZE);
+    utl::ChainBuffer first(pool);
+    utl::ChainBuffer second(pool);
+
+    putPattern(first, 0, size);
+    putPattern(second, size, 2 * size);
+
+    size_t blocks = first.blocks() + second.blocks();
+    iovec vector[1];
+
+    second.exportVector(vector, 1);
+    void* data = vector[0].iov_base;
+
+    first.splice(second);
+
+    TESTASSERT(second.empty());
+    TESTASSERTOP(second.blocks(), eq, 0);
+    TESTASSERTOP(first.size(), eq, 2 * size);
+    TESTASSERTOP(first.blocks(), eq, blocks);
+    TESTASSERT(matches(first, 0));
+
+    // the data of 'second' was not copied
+    iovec vectors[64];
+    size_t count = first.exportVector(vectors, 64);
+    bool found = false;
+
+    for (size_t i = 0; i < count; ++i)
+      found = found || vectors[i].iov_base == data;
+
+    TESTASSERT(found);
+
+    // both chains can still be written to
+    putPattern(first, 2 * size, 3 * size);
+    putPattern(second, 0, size);
+
+    TESTASSERTOP(first.size(), eq, 3 * size);
+    TESTASSERT(matches(first, 0));
+    TESTASSERTOP(second.size(), eq, size);
+    TESTASSERT(matches(second, 0));
+
+    // splicing into an empty chain and splicing an empty one
+    utl::ChainBuffer third(pool);
+
+    third.splice(second);
+    third.splice(second);
+
+    TESTASSERTOP(third.size(), eq, size);
+    TESTASSERT(matches(third, 0));
+  }
+
+  void TestChainBuffer::testConsume(tst::TestResult& result)
+  {
+    size_t const size = 10000;
+
+    utl::BlockPool pool(BLOCK_SIZE);
+    utl::ChainBuffer buffer(pool);
+
+    putPattern(buffer, 0, size);
+
+    size_t position = 0;
+    size_t blocks = buffer.blocks();
+
+    while (position < size)
+    {
+      size_t count = utl::min(static_cast<size_t>(1 + position % 377), size - position);
+
+      buffer.consume(count);
+      position += count;
+
+      TESTASSERTOP(buffer.size(), eq, size - position);
+      TESTASSERT(matches(buffer, position));
+      TESTASSERTOP(buffer.blocks(), le, blocks);
+    }
+
+    // the last block is kept and reused
+    TESTASSERT(buffer.empty());
+    TESTASSERTOP(buffer.blocks(), eq, 1);
+
+    putPattern(buffer, 0, 100);
+    TESTASSERTOP(buffer.blocks(), eq, 1);
+    TESTASSERT(matches(buffer, 0));
+
+    // consuming more than available drops everything
+    buffer.consume(1000);
+    TESTASSERT(buffer.empty());
+  }
+}
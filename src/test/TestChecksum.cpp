@@ -0,0 +1,199 @@
+// TestChecksum.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/Checksum.hpp>
+#include <util/io/ChecksumBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "RecordingBuffer.hpp"
+#include "TestChecksum.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * @return pointer to the given string as bytes
+     */
+    byte_t const* bytes(char const* string)
+    {
+      return reinterpret_cast<byte_t const*>(string);
+    }
+
+    /**
+     * @return CRC-32C of the given data, calculated bit by bit
+     */
+    uint32_t crc32cReference(byte_t const* data, size_t size)
+    {
+      uint32_t crc = ~static_cast<uint32_t>(0);
+
+      for (size_t i = 0; i < size; ++i)
+      {
+        crc ^= data[i];
+
+        for (size_t j = 0; j < 8; ++j)
+          crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+      }
+      return ~crc;
+    }
+
+    /**
+     * This function fills the given array with a pattern.
+     */
+    void fillPattern(byte_t* data, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<byte_t>(i * 7 + i / 13);
+    }
+  }
+
+
+  TestChecksum::TestChecksum()
+    : tst::TestCase<TestChecksum>(*this, "TestChecksum")
+  {
+    add(&TestChecksum::testCrc32c);
+    add(&TestChecksum::testHash64);
+    add(&TestChecksum::testBuffer);
+  }
+
+  void TestChecksum::testCrc32c(tst::TestResult& result)
+  {
+    TESTASSERTOP(utl::crc32c(bytes(""), 0), eq, 0);
+    TESTASSERTOP(utl::crc32c(bytes("a"), 1), eq, 0xc1d04330);
+    TESTASSERTOP(utl::crc32c(bytes("123456789"), 9), eq, 0xe3069283);
+
+    size_t const size = 100000;
+    byte_t* data = new byte_t[size + 8];
+
+    fillPattern(data, size + 8);
+
+    // all code paths, with aligned and unaligned data
+    size_t const lengths[] = {1, 7, 8, 9, 100, 767, 768, 769, 3000, 24575, 24576, 24577, size};
+
+    for (size_t length : lengths)
+    {
+      for (size_t offset = 0; offset < 8; offset += 3)
+      {
+        uint32_t crc = utl::crc32c(data + offset, length);
+        TESTASSERTOP(crc, eq, crc32cReference(data + offset, length));
+
+        // piecewise calculation gives the same result
+        size_t split = length / 3;
+        uint32_t first = utl::crc32c(data + offset, split);
+
+        TESTASSERTOP(utl::crc32c(data + offset + split, length - split, first), eq, crc);
+      }
+    }
+
+    delete[] data;
+  }
+
+  void TestChecksum::testHash64(tst::TestResult& result)
+  {
+    // the values of XXH64
+    TESTASSERTOP(utl::hash64(bytes(""), 0), eq, 0xef46db3751d8e999);
+    TESTASSERTOP(utl::hash64(bytes("abc"), 3), eq, 0x44bc2cf5ad770999);
+
+    byte_t data[200];
+    fillPattern(data, sizeof(data));
+
+    uint64_t hashes[sizeof(data)];
+
+    // every length is hashed differently, and so is every seed
+    for (size_t length = 0; length < sizeof(data); ++length)
+    {
+      hashes[length] = utl::hash64(data, length);
+
+      for (size_t i = 0; i < length; ++i)
+        TESTASSERT(hashes[i] != hashes[length]);
+
+      TESTASSERT(utl::hash64(data, length, 1) != hashes[length]);
+    }
+
+    // flipping any single bit changes about half of the bits of the hash
+    size_t changed = 0;
+
+    for (size_t bit = 0; bit < 64 * 8; ++bit)
+    {
+      data[bit / 8] ^= static_cast<byte_t>(1 << bit % 8);
+      changed += __builtin_popcountll(utl::hash64(data, 64) ^ hashes[64]);
+      data[bit / 8] ^= static_cast<byte_t>(1 << bit % 8);
+    }
+
+    TESTASSERTOP(changed, le, 64 * 8 * 36);
+    TESTASSERT(changed > 64 * 8 * 28);
+  }
+
+  void TestChecksum::testBuffer(tst::TestResult& result)
+  {
+    size_t const size = 20000;
+
+    byte_t* data = new byte_t[size];
+    fillPattern(data, size);
+
+    RecordingBuffer sink(size + 6000);
+    utl::ChecksumBuffer buffer(sink);
+
+    // single bytes, small and large ranges
+    for (size_t position = 0; position < size; )
+    {
+      size_t length = utl::min(static_cast<size_t>(1 + position % 5003), size - position);
+
+      if (length % 2 == 0)
+      {
+        for (size_t i = 0; i < length; ++i)
+          buffer.put(data[position + i]);
+      }
+      else
+        buffer.put(data + position, length);
+
+      position += length;
+    }
+
+    TESTASSERTOP(buffer.size(), eq, size);
+    TESTASSERTOP(buffer.checksum(), eq, utl::crc32c(data, size));
+
+    buffer.flush();
+
+    TESTASSERTOP(sink.size(), eq, size);
+    TESTASSERTOP(sink.flushes(), eq, 1);
+    TESTASSERT(__builtin_memcmp(sink.data(), data, size) == 0);
+
+    // the next record gets a checksum of its own
+    utl::BasicOutStream<utl::ChecksumBuffer> stream(buffer);
+
+    buffer.reset();
+    stream << "123456789";
+    buffer.fill('x', 5000);
+
+    TESTASSERTOP(buffer.size(), eq, 5009);
+
+    buffer.reset();
+    TESTASSERTOP(buffer.checksum(), eq, 0);
+
+    stream << "123456789";
+    TESTASSERTOP(buffer.checksum(), eq, 0xe3069283);
+
+    buffer.flush();
+    TESTASSERTOP(sink.size(), eq, size + 5009 + 9);
+
+    delete[] data;
+  }
+}
@@ -0,0 +1,359 @@
+// TestCompress.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/Compress.hpp>
+#include <util/io/CompressingBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "RecordingBuffer.hpp"
+#include "TestCompress.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * This function fills the given array with something resembling a log: lines of
+     * repeating words and changing numbers.
+     */
+    void fillLog(byte_t* data, size_t size)
+    {
+      static char const* const words[] = {
+        "request", "handled", "GET", "/index.html", "status", "200", "user", "latency",
+      };
+
+      uint32_t random = 1;
+      size_t position = 0;
+
+      while (position < size)
+      {
+        random = random * 1103515245 + 12345;
+
+        char const* word = words[(random >> 16) % 8];
+        size_t length = __builtin_strlen(word);
+
+        for (size_t i = 0; i < length && position < size; ++i)
+          data[position++] = static_cast<byte_t>(word[i]);
+
+        if (position < size)
+          data[position++] = (random >> 8) % 7 == 0 ? '\n' : ' ';
+
+        if (position < size && (random >> 12) % 3 == 0)
+          data[position++] = static_cast<byte_t>('0' + (random >> 20) % 10);
+      }
+    }
+
+    /**
+     * This function fills the given array with pseudo random bytes.
+     */
+    void fillRandom(byte_t* data, size_t size)
+    {
+      uint64_t random = 88172645463325252ull;
+
+      for (size_t i = 0; i < size; ++i)
+      {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+
+        data[i] = static_cast<byte_t>(random);
+      }
+    }
+
+    /**
+     * @return size of the given data compressed as a block and decompressed again, or a
+     *         huge value if that failed or did not reproduce the data
+     */
+    size_t roundTrip(utl::BlockCompressor& compressor, byte_t const* data, size_t size)
+    {
+      byte_t* compressed = new byte_t[utl::compressBound(size)];
+      byte_t* decompressed = new byte_t[size + 1];
+
+      byte_t* end = compressor.compress(data, data + size, compressed);
+      byte_t* output = utl::decompressBlock(compressed, end, decompressed, decompressed + size);
+
+      bool good = output == decompressed + size &&
+                  end <= compressed + utl::compressBound(size) &&
+                  __builtin_memcmp(data, decompressed, size) == 0;
+
+      // the output has to fit exactly
+      if (size > 0)
+        good = good && utl::decompressBlock(compressed, end, decompressed,
+                                            decompressed + size - 1) == nullptr;
+
+      size_t result = good ? end - compressed : ~static_cast<size_t>(0);
+
+      delete[] decompressed;
+      delete[] compressed;
+      return result;
+    }
+  }
+
+
+  TestCompress::TestCompress()
+    : tst::TestCase<TestCompress>(*this, "TestCompress")
+  {
+    add(&TestCompress::testBlock);
+    add(&TestCompress::testCorrupt);
+    add(&TestCompress::testBuffer);
+    add(&TestCompress::testFrames);
+  }
+
+  void TestCompress::testBlock(tst::TestResult& result)
+  {
+    size_t const size = 200000;
+    byte_t* data = new byte_t[size];
+
+    utl::BlockCompressor compressor;
+
+    TESTASSERTOP(roundTrip(compressor, data, 0), eq, 1);
+
+    // runs of a single byte and short repeating patterns overlap their own output
+    for (size_t period = 1; period < 10; ++period)
+    {
+      for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<byte_t>('a' + i % period);
+
+      TESTASSERTOP(roundTrip(compressor, data, size), le, size / 100);
+      TESTASSERTOP(roundTrip(compressor, data, 3), le, 4);
+      TESTASSERTOP(roundTrip(compressor, data, 20), le, 20);
+    }
+
+    // a log compresses well, every length and offset works
+    fillLog(data, size);
+
+    TESTASSERTOP(roundTrip(compressor, data, size), le, size / 2);
+
+    for (size_t length = 0; length < 300; ++length)
+      TESTASSERTOP(roundTrip(compressor, data + length % 7, length), le, length + 16);
+
+    // random data does not compress, but does not grow beyond the bound either
+    fillRandom(data, size);
+
+    TESTASSERTOP(roundTrip(compressor, data, size), le, utl::compressBound(size));
+    TESTASSERT(roundTrip(compressor, data, size) > size);
+
+    // a deeper search compresses at least as well
+    fillLog(data, size);
+
+    utl::BlockCompressor fast(1);
+    utl::BlockCompressor thorough(64);
+
+    TESTASSERTOP(roundTrip(thorough, data, size), le, roundTrip(fast, data, size));
+
+    delete[] data;
+  }
+
+  void TestCompress::testCorrupt(tst::TestResult& result)
+  {
+    size_t const size = 5000;
+
+    byte_t* data = new byte_t[size];
+    byte_t* compressed = new byte_t[utl::compressBound(size)];
+    byte_t* output = new byte_t[size];
+
+    fillLog(data, size);
+
+    utl::BlockCompressor compressor;
+    byte_t* end = compressor.compress(data, data + size, compressed);
+    size_t length = end - compressed;
+
+    // any truncation is detected
+    for (size_t i = 0; i < length; ++i)
+      TESTASSERT(utl::decompressBlock(compressed, compressed + i, output, output + size) !=
+                 output + size);
+
+    // changed bytes never cause accesses out of bounds
+    uint32_t random = 7;
+
+    for (size_t i = 0; i < 2000; ++i)
+    {
+      random = random * 1103515245 + 12345;
+
+      size_t position = (random >> 8) % length;
+      byte_t original = compressed[position];
+
+      compressed[position] = static_cast<byte_t>(random >> 24);
+      utl::decompressBlock(compressed, end, output, output + size);
+      compressed[position] = original;
+    }
+
+    TESTASSERT(utl::decompressBlock(compressed, end, output, output + size) == output + size);
+
+    // a match reaching in front of the output
+    byte_t const invalid[] = {0x10, 'a', 0x02, 0x00, 0x00};
+    TESTASSERT(utl::decompressBlock(invalid, invalid + 5, output, output + size) == nullptr);
+
+    delete[] output;
+    delete[] compressed;
+    delete[] data;
+  }
+
+  void TestCompress::testBuffer(tst::TestResult& result)
+  {
+    size_t const size = 300000;
+
+    byte_t* data = new byte_t[size];
+    fillLog(data, size);
+
+    RecordingBuffer compressed(size);
+    RecordingBuffer decompressed(size);
+
+    {
+      utl::CompressingBuffer buffer(compressed, 4096);
+
+      for (size_t position = 0; position < size; )
+      {
+        size_t length = utl::min(static_cast<size_t>(1 + position % 7001), size - position);
+
+        if (length % 2 == 0)
+        {
+          for (size_t i = 0; i < length; ++i)
+            buffer.put(data[position + i]);
+        }
+        else
+          buffer.put(data + position, length);
+
+        position += length;
+      }
+
+      buffer.finish();
+
+      TESTASSERTOP(buffer.size(), eq, size);
+      TESTASSERTOP(buffer.compressedSize(), eq, compressed.size());
+      TESTASSERTOP(compressed.size(), le, size / 2);
+    }
+
+    // the compressed data arrives in pieces of any size
+    utl::DecompressingBuffer buffer(decompressed);
+
+    for (size_t position = 0; position < compressed.size(); )
+    {
+      size_t length = utl::min(static_cast<size_t>(1 + position % 3001),
+                               compressed.size() - position);
+
+      TESTASSERT(!buffer.finished());
+
+      buffer.put(compressed.data() + position, length);
+      position += length;
+    }
+
+    TESTASSERT(buffer.good());
+    TESTASSERT(buffer.finished());
+    TESTASSERTOP(decompressed.size(), eq, size);
+    TESTASSERT(__builtin_memcmp(decompressed.data(), data, size) == 0);
+
+    // a corrupted byte is detected by the checksum at the latest
+    RecordingBuffer corrupted(size);
+    utl::DecompressingBuffer checker(corrupted);
+
+    compressed.data()[compressed.size() / 2] ^= 0x10;
+    checker.put(compressed.data(), compressed.size());
+
+    TESTASSERT(!checker.good());
+    TESTASSERT(!checker.finished());
+    TESTASSERTOP(corrupted.size(), le, size / 2);
+
+    delete[] data;
+  }
+
+  void TestCompress::testFrames(tst::TestResult& result)
+  {
+    byte_t random[5000];
+    fillRandom(random, sizeof(random));
+
+    RecordingBuffer compressed(100000);
+    RecordingBuffer decompressed(100000);
+
+    {
+      utl::CompressingBuffer buffer(compressed);
+      utl::BasicOutStream<utl::CompressingBuffer> stream(buffer);
+
+      // a flush ends a block, the buffer passed to is flushed as well
+      stream << "value: " << 42 << utl::flush;
+      TESTASSERTOP(compressed.flushes(), eq, 1);
+
+      stream << "value: " << 43;
+      buffer.finish();
+
+      // an empty frame, and one with data that does not compress
+      buffer.finish();
+      buffer.put(random, sizeof(random));
+
+      // the destructor finishes the last frame
+    }
+
+    TESTASSERTOP(compressed.size(), le, 3 * 5 + 4 * 8 + 3 * 4 + 18 + sizeof(random));
+
+    utl::DecompressingBuffer buffer(decompressed);
+
+    TESTASSERT(!buffer.finished());
+
+    buffer.put(compressed.data(), compressed.size());
+    buffer.flush();
+
+    TESTASSERT(buffer.finished());
+    TESTASSERTOP(decompressed.flushes(), eq, 1);
+    TESTASSERTOP(decompressed.size(), eq, 18 + sizeof(random));
+    TESTASSERT(__builtin_memcmp(decompressed.data(), "value: 42value: 43", 18) == 0);
+    TESTASSERT(__builtin_memcmp(decompressed.data() + 18, random, sizeof(random)) == 0);
+
+    // anything but a frame is rejected
+    utl::DecompressingBuffer invalid(decompressed);
+
+    invalid.put(reinterpret_cast<byte_t const*>("ulz2\x10"), 5);
+    TESTASSERT(!invalid.good());
+
+    // so is a block size out of range, no matter how far
+    byte_t const shifts[] = {0, 9, 23, 64, 255};
+    byte_t header[5];
+
+    __builtin_memcpy(header, compressed.data(), 4);
+
+    for (byte_t shift : shifts)
+    {
+      utl::DecompressingBuffer unsupported(decompressed);
+
+      header[4] = shift;
+      unsupported.put(header, sizeof(header));
+
+      TESTASSERT(!unsupported.good());
+    }
+
+    // a block is checked against the block size of its own frame, not of an earlier one
+    RecordingBuffer large(100000);
+
+    {
+      utl::CompressingBuffer buffer(large);
+      buffer.put(random, sizeof(random));
+    }
+
+    utl::DecompressingBuffer oversized(decompressed);
+
+    oversized.put(large.data(), large.size());
+    TESTASSERT(oversized.finished());
+
+    header[4] = __builtin_ctz(utl::CompressingBuffer::MIN_BLOCK_SIZE);
+    oversized.put(header, sizeof(header));
+    oversized.put(large.data() + sizeof(header), large.size() - sizeof(header));
+
+    TESTASSERT(!oversized.good());
+  }
+}
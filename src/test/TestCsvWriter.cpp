@@ -0,0 +1,131 @@
+// TestCsvWriter.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/io/CountingBuffer.hpp>
+#include <util/io/CsvWriter.hpp>
+
+#include "RecordingBuffer.hpp"
+#include "TestCsvWriter.hpp"
+
+
+namespace test
+{
+  TestCsvWriter::TestCsvWriter()
+    : tst::TestCase<TestCsvWriter>(*this, "TestCsvWriter")
+  {
+    add(&TestCsvWriter::testQuote);
+    add(&TestCsvWriter::testRecords);
+  }
+
+  void TestCsvWriter::testQuote(tst::TestResult& result)
+  {
+    RecordingBuffer buffer(4096);
+    utl::OutStream stream(buffer);
+    utl::CsvWriter writer(stream);
+
+    writer.field("plain");
+    writer.field("a,b");
+    writer.field("say \"hi\"");
+    writer.field("\"");
+    writer.field("line\nbreak");
+    writer.field("cr\r");
+    writer.field("");
+    writer.endRecord();
+
+    TESTASSERT(buffer.equals("plain,\"a,b\",\"say \"\"hi\"\"\",\"\"\"\",\"line\nbreak\","
+                             "\"cr\r\",\n"));
+
+    // a special character at every position of a field longer than a classified block
+    char string[150];
+    char expected[300];
+
+    for (size_t i = 0; i < sizeof(string); ++i)
+    {
+      for (char c : {',', '"', '\n'})
+      {
+        buffer.clear();
+        __builtin_memset(string, 'x', sizeof(string));
+        string[i] = c;
+        string[sizeof(string) - 1 - i / 2] = '"';
+
+        writer.field(string, sizeof(string));
+        writer.endRecord();
+
+        size_t length = 0;
+        expected[length++] = '"';
+
+        for (size_t j = 0; j < sizeof(string); ++j)
+        {
+          if (string[j] == '"')
+            expected[length++] = '"';
+
+          expected[length++] = string[j];
+        }
+
+        expected[length++] = '"';
+        expected[length++] = '\n';
+        expected[length] = '\0';
+
+        TESTASSERT(buffer.equals(expected));
+      }
+    }
+  }
+
+  void TestCsvWriter::testRecords(tst::TestResult& result)
+  {
+    RecordingBuffer buffer(4096);
+    utl::OutStream stream(buffer);
+    utl::CsvWriter writer(stream, ';');
+
+    stream << utl::hex;
+
+    writer.field("id");
+    writer.field("value");
+    writer.field("note");
+    writer.endRecord();
+    writer.field(255);
+    writer.field(-1.5);
+    writer.field("a,b;c");
+    writer.endRecord();
+    writer.field(18446744073709551615ul);
+    writer.endRecord();
+
+    TESTASSERT(buffer.equals("id;value;note\n255;-1.5;\"a,b;c\"\n18446744073709551615\n"));
+
+    // numbers are quoted like any other field if need be
+    buffer.clear();
+
+    utl::CsvWriter dashes(stream, '-');
+    dashes.field(1);
+    dashes.field(-2);
+    dashes.endRecord();
+
+    TESTASSERT(buffer.equals("1-\"-2\"\n"));
+
+    utl::CountingBuffer counter;
+    utl::BasicOutStream<utl::CountingBuffer> counting(counter);
+    utl::BasicCsvWriter<utl::CountingBuffer> counted(counting);
+
+    counted.field("x\"y");
+    counted.field(12345);
+    counted.endRecord();
+
+    TESTASSERTOP(counter.size(), eq, 13);
+  }
+}
@@ -0,0 +1,257 @@
+// TestEncode.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/Encode.hpp>
+#include <util/io/CountingBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "RecordingBuffer.hpp"
+#include "TestEncode.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    size_t const SIZE = 1000;
+
+    /**
+     * This function fills the given range with pseudo random bytes.
+     */
+    void generate(byte_t* data, size_t size)
+    {
+      uint32_t state = 0x2545f491;
+
+      for (size_t i = 0; i < size; ++i)
+      {
+        state = state * 1103515245 + 12345;
+        data[i] = static_cast<byte_t>(state >> 16);
+      }
+    }
+
+    /**
+     * @return true if the given encoded range equals the given zero terminated string
+     */
+    bool equal(char const* begin, char const* end, char const* string)
+    {
+      size_t length = __builtin_strlen(string);
+
+      return static_cast<size_t>(end - begin) == length &&
+             __builtin_memcmp(begin, string, length) == 0;
+    }
+  }
+
+
+  TestEncode::TestEncode()
+    : tst::TestCase<TestEncode>(*this, "TestEncode")
+  {
+    add(&TestEncode::testHex);
+    add(&TestEncode::testBase64);
+    add(&TestEncode::testInvalid);
+    add(&TestEncode::testStream);
+  }
+
+  void TestEncode::testHex(tst::TestResult& result)
+  {
+    byte_t const bytes[] = {0x00, 0x01, 0x7f, 0x80, 0xab, 0xff};
+    char characters[2 * SIZE];
+    byte_t decoded[SIZE];
+
+    char* end = utl::hexEncode(bytes, bytes + sizeof(bytes), characters);
+    TESTASSERT(equal(characters, end, "00017f80abff"));
+
+    char const upper[] = "00017F80ABFF";
+    byte_t* decoded_end = utl::hexDecode(upper, upper + 12, decoded);
+
+    TESTASSERT(decoded_end == decoded + sizeof(bytes));
+    TESTASSERT(__builtin_memcmp(decoded, bytes, sizeof(bytes)) == 0);
+
+    // all lengths around the vector width, compared against the scalar code
+    byte_t data[SIZE];
+    char expected[2 * SIZE];
+    generate(data, SIZE);
+
+    for (size_t size = 0; size < 300; ++size)
+    {
+      byte_t const* begin = data + size % 7;
+
+      end = utl::hexEncode(begin, begin + size, characters);
+      TESTASSERT(end == characters + utl::hexEncodedLength(size));
+      TESTASSERT(utl::impl::hexEncodeScalar(begin, begin + size, expected) == expected + 2 * size);
+      TESTASSERT(__builtin_memcmp(characters, expected, 2 * size) == 0);
+
+      decoded_end = utl::hexDecode(characters, end, decoded);
+      TESTASSERT(decoded_end == decoded + utl::hexDecodedLength(end - characters));
+      TESTASSERT(__builtin_memcmp(decoded, begin, size) == 0);
+    }
+  }
+
+  void TestEncode::testBase64(tst::TestResult& result)
+  {
+    // the test vectors of RFC 4648
+    char const* const vectors[][2] = {
+      {"", ""},
+      {"f", "Zg=="},
+      {"fo", "Zm8="},
+      {"foo", "Zm9v"},
+      {"foob", "Zm9vYg=="},
+      {"fooba", "Zm9vYmE="},
+      {"foobar", "Zm9vYmFy"},
+    };
+
+    char characters[2 * SIZE];
+    byte_t decoded[SIZE];
+
+    for (auto const& vector : vectors)
+    {
+      byte_t const* plain = reinterpret_cast<byte_t const*>(vector[0]);
+      size_t size = __builtin_strlen(vector[0]);
+      size_t length = __builtin_strlen(vector[1]);
+
+      char* end = utl::base64Encode(plain, plain + size, characters);
+      TESTASSERT(equal(characters, end, vector[1]));
+      TESTASSERTOP(utl::base64EncodedLength(size), eq, length);
+
+      byte_t* decoded_end = utl::base64Decode(vector[1], vector[1] + length, decoded);
+      TESTASSERT(decoded_end == decoded + size);
+      TESTASSERT(__builtin_memcmp(decoded, plain, size) == 0);
+    }
+
+    byte_t data[SIZE];
+    char expected[2 * SIZE];
+    generate(data, SIZE);
+
+    for (size_t size = 0; size < 300; ++size)
+    {
+      byte_t const* begin = data + size % 5;
+      size_t length = utl::base64EncodedLength(size);
+
+      char* end = utl::base64Encode(begin, begin + size, characters);
+      TESTASSERT(end == characters + length);
+      TESTASSERT(utl::impl::base64EncodeScalar(begin, begin + size, expected) == expected + length);
+      TESTASSERT(__builtin_memcmp(characters, expected, length) == 0);
+
+      byte_t* decoded_end = utl::base64Decode(characters, end, decoded);
+      TESTASSERT(decoded_end == decoded + size);
+      TESTASSERTOP(utl::base64DecodedLength(length) - size, le, 2);
+      TESTASSERT(__builtin_memcmp(decoded, begin, size) == 0);
+    }
+
+    // all 64 digits, both within and outside of the vectorized part
+    char const digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    byte_t* decoded_end = utl::base64Decode(digits, digits + 64, decoded);
+
+    TESTASSERT(decoded_end == decoded + 48);
+    TESTASSERT(equal(characters, utl::base64Encode(decoded, decoded_end, characters), digits));
+  }
+
+  void TestEncode::testInvalid(tst::TestResult& result)
+  {
+    byte_t data[SIZE];
+    char characters[2 * SIZE];
+    byte_t decoded[SIZE];
+
+    generate(data, SIZE);
+
+    TESTASSERT(utl::hexDecode("abc", "abc" + 3, decoded) == nullptr);
+    TESTASSERT(utl::base64Decode("Zm9", "Zm9" + 3, decoded) == nullptr);
+    TESTASSERT(utl::base64Decode("Zg=a", "Zg=a" + 4, decoded) == nullptr);
+    TESTASSERT(utl::base64Decode("Z===", "Z===" + 4, decoded) == nullptr);
+    TESTASSERT(utl::base64Decode("Zg==Zg==", "Zg==Zg==" + 8, decoded) == nullptr);
+    TESTASSERT(utl::base64Decode("Zm8=", "Zm8=" + 4, decoded) == decoded + 2);
+
+    // characters next to the valid ranges, at every position of a long input
+    char const hex_invalid[] = {'/', ':', '@', 'G', '`', 'g', ' ', '\0', '\x80', '\xff'};
+    char const base64_invalid[] = {'*', ',', '-', '.', ':', '@', '[', '`', '{', '=', '\x80'};
+
+    char* end = utl::hexEncode(data, data + 100, characters);
+
+    for (size_t i = 0; i < 200; ++i)
+    {
+      char original = characters[i];
+
+      for (char c : hex_invalid)
+      {
+        characters[i] = c;
+        TESTASSERT(utl::hexDecode(characters, end, decoded) == nullptr);
+      }
+      characters[i] = original;
+    }
+    TESTASSERT(utl::hexDecode(characters, end, decoded) == decoded + 100);
+
+    end = utl::base64Encode(data, data + 150, characters);
+
+    // padding is fine in the last group
+    for (size_t i = 0; i < 196; ++i)
+    {
+      char original = characters[i];
+
+      for (char c : base64_invalid)
+      {
+        characters[i] = c;
+        TESTASSERT(utl::base64Decode(characters, end, decoded) == nullptr);
+      }
+      characters[i] = original;
+    }
+    TESTASSERT(utl::base64Decode(characters, end, decoded) == decoded + 150);
+  }
+
+  void TestEncode::testStream(tst::TestResult& result)
+  {
+    byte_t data[4 * SIZE];
+    char expected[8 * SIZE];
+
+    generate(data, 4 * SIZE);
+
+    {
+      RecordingBuffer buffer(100);
+      utl::OutStream stream(buffer);
+
+      stream << "id=" << utl::hexBytes("\x01\xab", 2) << ' ' << utl::base64Bytes("utl", 3);
+
+      char const* characters = reinterpret_cast<char const*>(buffer.data());
+      TESTASSERT(equal(characters, characters + buffer.size(), "id=01ab dXRs"));
+    }
+
+    {
+      RecordingBuffer buffer(8 * SIZE);
+      utl::OutStream stream(buffer);
+
+      // small ranges end up in a single put
+      stream << utl::hexBytes(data, 100);
+      TESTASSERTOP(buffer.puts(), eq, 1);
+
+      stream << utl::base64Bytes(data, 4 * SIZE);
+
+      char* end = utl::hexEncode(data, data + 100, expected);
+      end = utl::base64Encode(data, data + 4 * SIZE, end);
+
+      TESTASSERTOP(buffer.size(), eq, static_cast<size_t>(end - expected));
+      TESTASSERT(__builtin_memcmp(buffer.data(), expected, buffer.size()) == 0);
+    }
+
+    {
+      utl::CountingBuffer buffer;
+      utl::BasicOutStream<utl::CountingBuffer> stream(buffer);
+
+      stream << utl::hexBytes(data, 1000) << utl::base64Bytes(data, 1000);
+      TESTASSERTOP(buffer.size(), eq, 2000 + 1336);
+    }
+  }
+}
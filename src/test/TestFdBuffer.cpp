@@ -0,0 +1,186 @@
+// TestFdBuffer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <util/io/FdBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "Pattern.hpp"
+#include "TempFile.hpp"
+#include "TestFdBuffer.hpp"
+
+
+namespace test
+{
+  TestFdBuffer::TestFdBuffer()
+    : tst::TestCase<TestFdBuffer>(*this, "TestFdBuffer")
+  {
+    add(&TestFdBuffer::testAdvance);
+    add(&TestFdBuffer::testWrite);
+    add(&TestFdBuffer::testLarge);
+    add(&TestFdBuffer::testDirect);
+    add(&TestFdBuffer::testError);
+  }
+
+  void TestFdBuffer::testAdvance(tst::TestResult& result)
+  {
+    byte_t data[10];
+    iovec vectors[3] = {{data, 2}, {data + 2, 3}, {data + 5, 5}};
+
+    iovec* vector = vectors;
+    int count = 3;
+
+    utl::impl::advanceVector(vector, count, 0);
+    TESTASSERTOP(vector, eq, vectors);
+    TESTASSERTOP(count, eq, 3);
+
+    utl::impl::advanceVector(vector, count, 3);
+    TESTASSERTOP(vector, eq, vectors + 1);
+    TESTASSERTOP(count, eq, 2);
+    TESTASSERTOP(vector->iov_base, eq, data + 3);
+    TESTASSERTOP(vector->iov_len, eq, 2);
+
+    utl::impl::advanceVector(vector, count, 2);
+    TESTASSERTOP(vector, eq, vectors + 2);
+    TESTASSERTOP(count, eq, 1);
+    TESTASSERTOP(vector->iov_len, eq, 5);
+
+    utl::impl::advanceVector(vector, count, 5);
+    TESTASSERTOP(count, eq, 0);
+  }
+
+  void TestFdBuffer::testWrite(tst::TestResult& result)
+  {
+    TempFile file;
+    byte_t data[64];
+
+    {
+      utl::FdBuffer buffer(file.fd());
+      utl::BasicOutStream<utl::FdBuffer> stream(buffer);
+
+      stream << "value: " << 42;
+      TESTASSERTOP(buffer.syscalls(), eq, 0);
+
+      stream << utl::flush;
+      TESTASSERTOP(buffer.syscalls(), eq, 1);
+      TESTASSERTOP(buffer.written(), eq, 9);
+
+      stream << '\n' << utl::width(3) << 7;
+    }
+
+    TESTASSERTOP(file.read(data, sizeof(data)), eq, 13);
+    TESTASSERTOP(data[0], eq, 'v');
+    TESTASSERTOP(data[8], eq, '2');
+    TESTASSERTOP(data[9], eq, '\n');
+    TESTASSERTOP(data[12], eq, '7');
+  }
+
+  void TestFdBuffer::testLarge(tst::TestResult& result)
+  {
+    static byte_t data[1000000];
+    TempFile file;
+
+    size_t syscalls;
+
+    {
+      utl::FdBuffer buffer(file.fd(), utl::FD_BUFFERED, 4096, 4);
+
+      putPattern(buffer, 0, sizeof(data));
+      buffer.flush();
+
+      TESTASSERT(buffer.good());
+      TESTASSERTOP(buffer.written(), eq, sizeof(data));
+
+      syscalls = buffer.syscalls();
+    }
+
+    // every payload larger than a chunk is written along with the data buffered before it
+    TESTASSERTOP(syscalls, le, sizeof(data) / (4 * 4096) + sizeof(data) / 70000 + 1);
+    TESTASSERTOP(file.read(data, sizeof(data)), eq, sizeof(data));
+    TESTASSERT(matches(data, sizeof(data)));
+  }
+
+  void TestFdBuffer::testDirect(tst::TestResult& result)
+  {
+    static byte_t data[300000];
+    TempFile file;
+
+    {
+      utl::FdBuffer buffer(file.fd(), utl::FD_DIRECT, 8192, 2);
+
+      // data written with explicit flushes in between must end up unchanged in either mode
+      putPattern(buffer, 0, 1000);
+      buffer.flush();
+
+      static byte_t piece[100000];
+
+      for (size_t i = 0; i < sizeof(piece); ++i)
+        piece[i] = pattern(1000 + i);
+
+      buffer.put(piece, sizeof(piece));
+      buffer.flush();
+
+      for (size_t i = 0; i < 199000; ++i)
+        buffer.put(pattern(101000 + i));
+
+      TESTASSERT(buffer.good());
+    }
+
+    TESTASSERTOP(file.read(data, sizeof(data)), eq, sizeof(data));
+    TESTASSERT(matches(data, sizeof(data)));
+
+    // the file offset is not aligned now, which O_DIRECT does not support
+    {
+      utl::FdBuffer buffer(file.fd(), utl::FD_DIRECT, 8192, 2);
+      TESTASSERTOP(buffer.mode(), eq, utl::FD_BUFFERED);
+
+      putPattern(buffer, sizeof(data), sizeof(data) + 10000);
+      buffer.flush();
+
+      TESTASSERT(buffer.good());
+    }
+
+    TESTASSERTOP(file.size(), eq, static_cast<off_t>(sizeof(data) + 10000));
+    TESTASSERTOP(lseek(file.fd(), sizeof(data), SEEK_SET), eq, static_cast<off_t>(sizeof(data)));
+    TESTASSERT(matchesFile(file.fd(), 10000, sizeof(data)));
+  }
+
+  void TestFdBuffer::testError(tst::TestResult& result)
+  {
+    utl::FdBuffer buffer(-1, utl::FD_BUFFERED, 4096, 1);
+
+    TESTASSERT(buffer.good());
+
+    buffer.fill('x', 10000);
+    TESTASSERT(!buffer.good());
+    TESTASSERTOP(buffer.error(), eq, EBADF);
+
+    // further output is discarded without any more attempts to write it
+    size_t syscalls = buffer.syscalls();
+
+    buffer.fill('x', 10000);
+    buffer.put('y');
+    buffer.flush();
+
+    TESTASSERTOP(buffer.syscalls(), eq, syscalls);
+    TESTASSERTOP(buffer.written(), eq, 0);
+  }
+}
@@ -0,0 +1,163 @@
+// TestFormat.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/io/Format.hpp>
+#include <util/io/MemoryBuffer.hpp>
+
+#include "TestFormat.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * This class is a buffer remembering everything put into it as a zero terminated string.
+     * It also counts the number of calls made to it.
+     */
+    class StringBuffer final: public utl::StreamBuffer
+    {
+    public:
+      StringBuffer()
+        : StreamBuffer(),
+          length_(0),
+          puts_(0)
+      {
+        string_[0] = '\0';
+      }
+
+      virtual void put(byte_t value) override
+      {
+        string_[length_++] = static_cast<char>(value);
+        string_[length_] = '\0';
+        ++puts_;
+      }
+
+      virtual void put(byte_t const* range, size_t size) override
+      {
+        for (size_t i = 0; i < size; ++i)
+          string_[length_++] = static_cast<char>(range[i]);
+
+        string_[length_] = '\0';
+        ++puts_;
+      }
+
+      virtual void flush() override
+      {
+      }
+
+      char const* string() const
+      {
+        return string_;
+      }
+
+      size_t puts() const
+      {
+        return puts_;
+      }
+
+    private:
+      char   string_[256];
+      size_t length_;
+      size_t puts_;
+    };
+  }
+
+
+  TestFormat::TestFormat()
+    : tst::TestCase<TestFormat>(*this, "TestFormat")
+  {
+    add(&TestFormat::testLiteral);
+    add(&TestFormat::testSlots);
+    add(&TestFormat::testSpecifiers);
+    add(&TestFormat::testEscape);
+    add(&TestFormat::testStream);
+  }
+
+  void TestFormat::testLiteral(tst::TestResult& result)
+  {
+    StringBuffer buffer;
+    utl::BasicOutStream<StringBuffer> stream(buffer);
+
+    utl::format(stream, UTL_FORMAT(""));
+    TESTASSERT(utl::compare(buffer.string(), "") == 0);
+    TESTASSERTOP(buffer.puts(), eq, 0);
+
+    utl::format(stream, UTL_FORMAT("just some text"));
+    TESTASSERT(utl::compare(buffer.string(), "just some text") == 0);
+    TESTASSERTOP(buffer.puts(), eq, 1);
+  }
+
+  void TestFormat::testSlots(tst::TestResult& result)
+  {
+    StringBuffer buffer;
+    utl::BasicOutStream<StringBuffer> stream(buffer);
+
+    utl::format(stream, UTL_FORMAT("id={} name={} value={}\n"), 42, "foo", -1.5);
+    TESTASSERT(utl::compare(buffer.string(), "id=42 name=foo value=-1.5\n") == 0);
+
+    // three literal spans and three arguments
+    TESTASSERTOP(buffer.puts(), eq, 7);
+
+    StringBuffer buffer2;
+    utl::BasicOutStream<StringBuffer> stream2(buffer2);
+
+    utl::format(stream2, UTL_FORMAT("{}{}{}"), 'a', static_cast<uchar_t>(98), nullptr);
+    TESTASSERT(utl::compare(buffer2.string(), "a98null") == 0);
+  }
+
+  void TestFormat::testSpecifiers(tst::TestResult& result)
+  {
+    StringBuffer buffer;
+    utl::BasicOutStream<StringBuffer> stream(buffer);
+
+    utl::format(stream, UTL_FORMAT("{b} {o} {d} {x} {x}"), 5u, 8, 10ul, 255, -255l);
+    TESTASSERT(utl::compare(buffer.string(), "101 10 10 FF -FF") == 0);
+
+    // a slot's specifier does not depend on or change the stream's base
+    StringBuffer buffer2;
+    utl::BasicOutStream<StringBuffer> stream2(buffer2);
+
+    stream2 << utl::hex;
+    utl::format(stream2, UTL_FORMAT("{d} {}"), 16, 16);
+    stream2 << 16;
+
+    TESTASSERT(utl::compare(buffer2.string(), "16 1010") == 0);
+  }
+
+  void TestFormat::testEscape(tst::TestResult& result)
+  {
+    StringBuffer buffer;
+    utl::BasicOutStream<StringBuffer> stream(buffer);
+
+    utl::format(stream, UTL_FORMAT("{{}} {{{}}} }}{{"), 1);
+    TESTASSERT(utl::compare(buffer.string(), "{} {1} }{") == 0);
+  }
+
+  void TestFormat::testStream(tst::TestResult& result)
+  {
+    // formatting works through the type-erased stream as well
+    StringBuffer buffer;
+    utl::OutStream stream(buffer);
+
+    utl::format(stream, UTL_FORMAT("[{x}]"), 0xabcu);
+    TESTASSERT(utl::compare(buffer.string(), "[ABC]") == 0);
+  }
+}
@@ -0,0 +1,209 @@
+// TestFormatFloat.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/FormatFloat.hpp>
+
+#include "TestFormatFloat.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    char buffer[utl::MAX_FLOAT_CHARACTERS + 1];
+
+    /**
+     * @return 'value' formatted in its shortest form as a zero terminated string
+     */
+    template<typename T>
+    char const* shortest(T value)
+    {
+      *utl::formatShortest(value, buffer) = '\0';
+      return buffer;
+    }
+
+    /**
+     * @return 'value' formatted in scientific notation as a zero terminated string
+     */
+    char const* scientific(double value, size_t precision)
+    {
+      *utl::formatScientific(value, buffer, precision) = '\0';
+      return buffer;
+    }
+
+    /**
+     * @return 'value' formatted in fixed point notation as a zero terminated string
+     */
+    char const* fixed(double value, size_t precision)
+    {
+      *utl::formatFixed(value, buffer, precision) = '\0';
+      return buffer;
+    }
+
+    /**
+     * @return double value with the given bit pattern
+     */
+    double fromBits(uint64_t bits)
+    {
+      double value;
+      __builtin_memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+  }
+
+
+  TestFormatFloat::TestFormatFloat()
+    : tst::TestCase<TestFormatFloat>(*this, "TestFormatFloat")
+  {
+    add(&TestFormatFloat::testShortest);
+    add(&TestFormatFloat::testShortestFloat);
+    add(&TestFormatFloat::testLayout);
+    add(&TestFormatFloat::testSpecial);
+    add(&TestFormatFloat::testScientific);
+    add(&TestFormatFloat::testFixed);
+    add(&TestFormatFloat::testRounding);
+  }
+
+  void TestFormatFloat::testShortest(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(shortest(0.0), "0") == 0);
+    TESTASSERT(utl::compare(shortest(-0.0), "-0") == 0);
+    TESTASSERT(utl::compare(shortest(1.0), "1") == 0);
+    TESTASSERT(utl::compare(shortest(-2.5), "-2.5") == 0);
+    TESTASSERT(utl::compare(shortest(0.1), "0.1") == 0);
+    TESTASSERT(utl::compare(shortest(0.3), "0.3") == 0);
+    TESTASSERT(utl::compare(shortest(0.1 + 0.2), "0.30000000000000004") == 0);
+    TESTASSERT(utl::compare(shortest(1.0 / 3.0), "0.3333333333333333") == 0);
+    TESTASSERT(utl::compare(shortest(123.456), "123.456") == 0);
+    TESTASSERT(utl::compare(shortest(9007199254740993.0), "9007199254740992") == 0);
+
+    // the extremes of the double range
+    TESTASSERT(utl::compare(shortest(5e-324), "5e-324") == 0);
+    TESTASSERT(utl::compare(shortest(2.2250738585072014e-308), "2.2250738585072014e-308") == 0);
+    TESTASSERT(utl::compare(shortest(1.7976931348623157e308), "1.7976931348623157e+308") == 0);
+
+    // values the closest shortest candidate has to be picked for, or that sit right at the
+    // bounds of their interval
+    TESTASSERT(utl::compare(shortest(1e23), "1e+23") == 0);
+    double large    = fromBits(0x4830f0cf064dd592ull);
+    double small    = fromBits(0x0040000000000000ull);
+    double greatest = fromBits(0x7fefffffffffffffull);
+    double denormal = fromBits(0x000fffffffffffffull);
+
+    TESTASSERT(utl::compare(shortest(large), "5.764607523034235e+39") == 0);
+    TESTASSERT(utl::compare(shortest(small), "1.7800590868057611e-307") == 0);
+    TESTASSERT(utl::compare(shortest(greatest), "1.7976931348623157e+308") == 0);
+    TESTASSERT(utl::compare(shortest(denormal), "2.225073858507201e-308") == 0);
+    TESTASSERT(utl::compare(shortest(7.1202363472230444e-307), "7.120236347223045e-307") == 0);
+  }
+
+  void TestFormatFloat::testShortestFloat(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(shortest(0.0f), "0") == 0);
+    TESTASSERT(utl::compare(shortest(0.1f), "0.1") == 0);
+    TESTASSERT(utl::compare(shortest(-1.5f), "-1.5") == 0);
+    TESTASSERT(utl::compare(shortest(1.0f / 3.0f), "0.33333334") == 0);
+    TESTASSERT(utl::compare(shortest(16777216.0f), "16777216") == 0);
+    TESTASSERT(utl::compare(shortest(3.4028235e38f), "3.4028235e+38") == 0);
+    TESTASSERT(utl::compare(shortest(1.17549435e-38f), "1.1754944e-38") == 0);
+    TESTASSERT(utl::compare(shortest(1e-45f), "1e-45") == 0);
+  }
+
+  void TestFormatFloat::testLayout(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(shortest(1e20), "100000000000000000000") == 0);
+    TESTASSERT(utl::compare(shortest(1e21), "1e+21") == 0);
+    TESTASSERT(utl::compare(shortest(1.5e21), "1.5e+21") == 0);
+    TESTASSERT(utl::compare(shortest(123e18), "123000000000000000000") == 0);
+    TESTASSERT(utl::compare(shortest(12.5), "12.5") == 0);
+    TESTASSERT(utl::compare(shortest(0.000001), "0.000001") == 0);
+    TESTASSERT(utl::compare(shortest(0.0000015), "0.0000015") == 0);
+    TESTASSERT(utl::compare(shortest(1e-7), "1e-7") == 0);
+    TESTASSERT(utl::compare(shortest(-1.25e-7), "-1.25e-7") == 0);
+  }
+
+  void TestFormatFloat::testSpecial(tst::TestResult& result)
+  {
+    double infinity = fromBits(0x7ff0000000000000ull);
+    double nan      = fromBits(0x7ff8000000000000ull);
+
+    TESTASSERT(utl::compare(shortest(infinity), "inf") == 0);
+    TESTASSERT(utl::compare(shortest(-infinity), "-inf") == 0);
+    TESTASSERT(utl::compare(shortest(nan), "nan") == 0);
+    TESTASSERT(utl::compare(shortest(static_cast<float>(-infinity)), "-inf") == 0);
+    TESTASSERT(utl::compare(scientific(infinity, 3), "inf") == 0);
+    TESTASSERT(utl::compare(fixed(-infinity, 3), "-inf") == 0);
+    TESTASSERT(utl::compare(fixed(nan, 3), "nan") == 0);
+  }
+
+  void TestFormatFloat::testScientific(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(scientific(0.0, 6), "0.000000e+00") == 0);
+    TESTASSERT(utl::compare(scientific(-0.0, 2), "-0.00e+00") == 0);
+    TESTASSERT(utl::compare(scientific(1500.0, 3), "1.500e+03") == 0);
+    TESTASSERT(utl::compare(scientific(1500.0, 0), "2e+03") == 0);
+    TESTASSERT(utl::compare(scientific(0.1, 20), "1.00000000000000005551e-01") == 0);
+    TESTASSERT(utl::compare(scientific(-123.456, 6), "-1.234560e+02") == 0);
+    TESTASSERT(utl::compare(scientific(1e100, 2), "1.00e+100") == 0);
+    TESTASSERT(utl::compare(scientific(5e-324, 5), "4.94066e-324") == 0);
+    TESTASSERT(utl::compare(scientific(1.7976931348623157e308, 16),
+                            "1.7976931348623157e+308") == 0);
+    TESTASSERT(utl::compare(scientific(9.9999, 2), "1.00e+01") == 0);
+  }
+
+  void TestFormatFloat::testFixed(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(fixed(0.0, 6), "0.000000") == 0);
+    TESTASSERT(utl::compare(fixed(-0.0, 0), "-0") == 0);
+    TESTASSERT(utl::compare(fixed(1500.0, 3), "1500.000") == 0);
+    TESTASSERT(utl::compare(fixed(0.1, 20), "0.10000000000000000555") == 0);
+    TESTASSERT(utl::compare(fixed(-123.456, 2), "-123.46") == 0);
+    TESTASSERT(utl::compare(fixed(99.996, 2), "100.00") == 0);
+    TESTASSERT(utl::compare(fixed(-0.001, 2), "-0.00") == 0);
+    TESTASSERT(utl::compare(fixed(1e22, 1), "10000000000000000000000.0") == 0);
+    TESTASSERT(utl::compare(fixed(1e-300, 3), "0.000") == 0);
+    TESTASSERT(utl::compare(fixed(1.7976931348623157e308, 0),
+                            "17976931348623157081452742373170435679807056752584499659891747680315"
+                            "72607800285387605895586327668781715404589535143824642343213268894641"
+                            "82768467546703537516986049910576551282076245490090389328944075868508"
+                            "45513394230458323690322294816580855933212334827479782620414472316873"
+                            "8177180919299881250404026184124858368") == 0);
+  }
+
+  void TestFormatFloat::testRounding(tst::TestResult& result)
+  {
+    // exact ties are rounded to even
+    TESTASSERT(utl::compare(fixed(0.5, 0), "0") == 0);
+    TESTASSERT(utl::compare(fixed(1.5, 0), "2") == 0);
+    TESTASSERT(utl::compare(fixed(2.5, 0), "2") == 0);
+    TESTASSERT(utl::compare(fixed(0.125, 2), "0.12") == 0);
+    TESTASSERT(utl::compare(fixed(0.375, 2), "0.38") == 0);
+    TESTASSERT(utl::compare(scientific(2.5, 0), "2e+00") == 0);
+
+    // values that merely look like ties are rounded according to their exact value
+    TESTASSERT(utl::compare(fixed(0.15, 1), "0.1") == 0);
+    TESTASSERT(utl::compare(fixed(0.35, 1), "0.3") == 0);
+    TESTASSERT(utl::compare(fixed(2.675, 2), "2.67") == 0);
+    TESTASSERT(utl::compare(fixed(1.005, 2), "1.00") == 0);
+
+    // precisions are limited
+    TESTASSERT(utl::length(fixed(1.0, 1000)) == 2 + utl::MAX_FLOAT_PRECISION);
+  }
+}
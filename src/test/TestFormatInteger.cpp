@@ -0,0 +1,172 @@
+// TestFormatInteger.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/FormatInteger.hpp>
+
+#include "Random.hpp"
+#include "TestFormatInteger.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * @return result of formatting the given value as a zero terminated string
+     */
+    template<typename T>
+    char const* format(T value, uint8_t base = utl::BASE_DECIMAL, size_t width = 0)
+    {
+      static char buffer[128];
+
+      *utl::formatInteger(value, buffer, base, width) = '\0';
+      return buffer;
+    }
+
+    /**
+     * This function formats a value in the given base, digit by digit.
+     * @return end of the formatted string
+     */
+    char* formatReference(uint64_t value, uint8_t base, char* buffer)
+    {
+      char digits[64];
+      size_t count = 0;
+
+      do
+      {
+        digits[count++] = "0123456789ABCDEF"[value % base];
+        value /= base;
+      } while (value != 0);
+
+      while (count > 0)
+        *buffer++ = digits[--count];
+
+      return buffer;
+    }
+  }
+
+
+  TestFormatInteger::TestFormatInteger()
+    : tst::TestCase<TestFormatInteger>(*this, "TestFormatInteger")
+  {
+    add(&TestFormatInteger::testCountDigits);
+    add(&TestFormatInteger::testFormat);
+    add(&TestFormatInteger::testWidth);
+    add(&TestFormatInteger::testLimits);
+    add(&TestFormatInteger::testRandom);
+  }
+
+  void TestFormatInteger::testCountDigits(tst::TestResult& result)
+  {
+    TESTASSERTOP(utl::countDigits(0u), eq, 1);
+    TESTASSERTOP(utl::countDigits(0u, utl::BASE_BINARY), eq, 1);
+    TESTASSERTOP(utl::countDigits(-1), eq, 1);
+    TESTASSERTOP(utl::countDigits(0xffu, utl::BASE_HEXADECIMAL), eq, 2);
+    TESTASSERTOP(utl::countDigits(0x100u, utl::BASE_HEXADECIMAL), eq, 3);
+    TESTASSERTOP(utl::countDigits(8u, utl::BASE_OCTAL), eq, 2);
+    TESTASSERTOP(utl::countDigits(80u, 3), eq, 4);
+    TESTASSERTOP(utl::countDigits(81u, 3), eq, 5);
+
+    // all powers of ten and their neighbors
+    uint64_t power = 1;
+
+    for (size_t digits = 1; digits <= 20; ++digits, power *= 10)
+    {
+      TESTASSERTOP(utl::countDigits(power), eq, digits);
+      TESTASSERTOP(utl::countDigits(power - 1), eq, digits == 1 ? 1 : digits - 1);
+      TESTASSERTOP(utl::countDigits(power + 1), eq, digits);
+    }
+
+    TESTASSERTOP(utl::maxDigits<uchar_t>(), eq, 3);
+    TESTASSERTOP(utl::maxDigits<sshort_t>(), eq, 5);
+    TESTASSERTOP(utl::maxDigits<uint_t>(utl::BASE_OCTAL), eq, 11);
+    TESTASSERTOP(utl::maxDigits<slong_t>(utl::BASE_BINARY), eq, 64);
+    TESTASSERTOP(utl::maxDigits<ulong_t>(), eq, 20);
+    TESTASSERTOP(utl::maxDigits<ulong_t>(7), eq, 23);
+
+    TESTASSERTOP(utl::integerLength(0), eq, 1);
+    TESTASSERTOP(utl::integerLength(-10), eq, 3);
+    TESTASSERTOP(utl::integerLength(-10, utl::BASE_DECIMAL, 4), eq, 5);
+    TESTASSERTOP(utl::integerLength(0xabcu, utl::BASE_HEXADECIMAL, 2), eq, 3);
+  }
+
+  void TestFormatInteger::testFormat(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(format(0u), "0") == 0);
+    TESTASSERT(utl::compare(format(7u), "7") == 0);
+    TESTASSERT(utl::compare(format(42u), "42") == 0);
+    TESTASSERT(utl::compare(format(100u), "100") == 0);
+    TESTASSERT(utl::compare(format(12345u), "12345") == 0);
+    TESTASSERT(utl::compare(format(-12345), "-12345") == 0);
+    TESTASSERT(utl::compare(format(0xbeefu, utl::BASE_HEXADECIMAL), "BEEF") == 0);
+    TESTASSERT(utl::compare(format(0755u, utl::BASE_OCTAL), "755") == 0);
+    TESTASSERT(utl::compare(format(10u, utl::BASE_BINARY), "1010") == 0);
+    TESTASSERT(utl::compare(format(10u, 4), "22") == 0);
+    TESTASSERT(utl::compare(format(-35, 12), "-2B") == 0);
+  }
+
+  void TestFormatInteger::testWidth(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(format(0u, utl::BASE_DECIMAL, 3), "000") == 0);
+    TESTASSERT(utl::compare(format(42u, utl::BASE_DECIMAL, 5), "00042") == 0);
+    TESTASSERT(utl::compare(format(-42, utl::BASE_DECIMAL, 5), "-00042") == 0);
+    TESTASSERT(utl::compare(format(12345u, utl::BASE_DECIMAL, 3), "12345") == 0);
+    TESTASSERT(utl::compare(format(0xau, utl::BASE_HEXADECIMAL, 4), "000A") == 0);
+    TESTASSERT(utl::compare(format(5u, 3, 4), "0012") == 0);
+  }
+
+  void TestFormatInteger::testLimits(tst::TestResult& result)
+  {
+    TESTASSERT(utl::compare(format(static_cast<uchar_t>(255)), "255") == 0);
+    TESTASSERT(utl::compare(format(static_cast<schar_t>(-128)), "-128") == 0);
+    TESTASSERT(utl::compare(format(static_cast<sshort_t>(-32768)), "-32768") == 0);
+    TESTASSERT(utl::compare(format(static_cast<sint_t>(-2147483647 - 1)), "-2147483648") == 0);
+    TESTASSERT(utl::compare(format(static_cast<uint_t>(-1)), "4294967295") == 0);
+    TESTASSERT(utl::compare(format(static_cast<ulong_t>(-1)), "18446744073709551615") == 0);
+    TESTASSERT(utl::compare(format(static_cast<slong_t>(-9223372036854775807 - 1)),
+                            "-9223372036854775808") == 0);
+    TESTASSERT(utl::compare(format(static_cast<ulong_t>(-1), utl::BASE_HEXADECIMAL),
+                            "FFFFFFFFFFFFFFFF") == 0);
+    TESTASSERT(utl::compare(format(static_cast<ulong_t>(-1), utl::BASE_OCTAL),
+                            "1777777777777777777777") == 0);
+    TESTASSERT(utl::compare(format(static_cast<ulong_t>(-1), utl::BASE_BINARY),
+                            "11111111111111111111111111111111"
+                            "11111111111111111111111111111111") == 0);
+  }
+
+  void TestFormatInteger::testRandom(tst::TestResult& result)
+  {
+    uint64_t state = 7;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+      uint64_t value = random(state);
+      value >>= value % 64;
+
+      uint8_t base = static_cast<uint8_t>(2 + random(state) % 15);
+
+      char expected[128];
+      *formatReference(value, base, expected) = '\0';
+
+      TESTASSERT(utl::compare(format(value, base), expected) == 0);
+      TESTASSERTOP(utl::countDigits(value, base), eq, utl::length(expected));
+    }
+  }
+}
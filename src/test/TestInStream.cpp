@@ -0,0 +1,203 @@
+// TestInStream.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/io/InStream.hpp>
+
+#include "TestInStream.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * A buffer serving its data in windows of a fixed size.
+     */
+    class ChunkedBuffer: public utl::InStreamBuffer
+    {
+    public:
+      ChunkedBuffer(char const* string, size_t size)
+        : utl::InStreamBuffer(),
+          current_(reinterpret_cast<byte_t const*>(string)),
+          end_(current_ + utl::length(string)),
+          size_(size)
+      {
+      }
+
+    protected:
+      virtual bool underflow() override
+      {
+        if (current_ == end_)
+          return false;
+
+        size_t size = static_cast<size_t>(end_ - current_) < size_ ? end_ - current_ : size_;
+
+        setWindow(current_, current_ + size);
+        current_ += size;
+        return true;
+      }
+
+    private:
+      byte_t const* current_;
+      byte_t const* end_;
+      size_t size_;
+    };
+
+    /**
+     * @return buffer for reading the given zero terminated string
+     */
+    utl::InStreamBuffer makeBuffer(char const* string)
+    {
+      byte_t const* begin = reinterpret_cast<byte_t const*>(string);
+      return utl::InStreamBuffer(begin, begin + utl::length(string));
+    }
+  }
+
+
+  TestInStream::TestInStream()
+    : tst::TestCase<TestInStream>(*this, "TestInStream")
+  {
+    add(&TestInStream::testRead);
+    add(&TestInStream::testManipulators);
+    add(&TestInStream::testWindows);
+    add(&TestInStream::testFailure);
+  }
+
+  void TestInStream::testRead(tst::TestResult& result)
+  {
+    utl::InStreamBuffer buffer = makeBuffer("42 -17\n\t 65535,x");
+    utl::InStream stream(buffer);
+
+    uint_t   value1 = 0;
+    sint_t   value2 = 0;
+    ushort_t value3 = 0;
+    char     value4 = 0;
+    char     value5 = 0;
+
+    stream >> value1 >> value2 >> value3 >> value4;
+
+    TESTASSERT(stream.good());
+    TESTASSERTOP(value1, eq, 42);
+    TESTASSERTOP(value2, eq, -17);
+    TESTASSERTOP(value3, eq, 65535);
+    TESTASSERTOP(value4, eq, ',');
+
+    TESTASSERT(stream.read(value5));
+    TESTASSERTOP(value5, eq, 'x');
+    TESTASSERT(!stream.read(value5));
+  }
+
+  void TestInStream::testManipulators(tst::TestResult& result)
+  {
+    utl::InStreamBuffer buffer = makeBuffer("ff 101 17 99");
+    utl::InStream stream(buffer);
+
+    uint_t value1 = 0;
+    uint_t value2 = 0;
+    uint_t value3 = 0;
+    uint_t value4 = 0;
+
+    stream >> utl::hex >> value1 >> utl::bin >> value2 >> utl::oct >> value3 >> utl::dec >> value4;
+
+    TESTASSERT(stream.good());
+    TESTASSERTOP(value1, eq, 0xff);
+    TESTASSERTOP(value2, eq, 5);
+    TESTASSERTOP(value3, eq, 15);
+    TESTASSERTOP(value4, eq, 99);
+  }
+
+  void TestInStream::testWindows(tst::TestResult& result)
+  {
+    char const* string = "  12345 -9876543210 +000000000000000000000000000000000007 -0000 "
+                         "18446744073709551615";
+
+    // numbers spanning windows of any size
+    for (size_t size = 1; size < 24; ++size)
+    {
+      ChunkedBuffer buffer(string, size);
+      utl::InStream stream(buffer);
+
+      uint_t  value1 = 0;
+      slong_t value2 = 0;
+      sint_t  value3 = 0;
+      sint_t  value4 = 1;
+      ulong_t value5 = 0;
+
+      stream >> value1 >> value2 >> value3 >> value4 >> value5;
+
+      TESTASSERT(stream.good());
+      TESTASSERTOP(value1, eq, 12345);
+      TESTASSERTOP(value2, eq, -9876543210ll);
+      TESTASSERTOP(value3, eq, 7);
+      TESTASSERTOP(value4, eq, 0);
+      TESTASSERTOP(value5, eq, 18446744073709551615ull);
+
+      TESTASSERT(!stream.read(value1));
+      TESTASSERTOP(stream.status(), eq, utl::PARSE_INVALID);
+    }
+
+    ChunkedBuffer buffer("1234567890123456789012345678901234567890123456789012345678901234567890 1",
+                         5);
+    utl::InStream stream(buffer);
+    ulong_t value = 0;
+
+    TESTASSERT(!stream.read(value));
+    TESTASSERTOP(stream.status(), eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(value, eq, 18446744073709551615ull);
+
+    stream.clear();
+
+    TESTASSERT(stream.read(value));
+    TESTASSERTOP(value, eq, 1);
+  }
+
+  void TestInStream::testFailure(tst::TestResult& result)
+  {
+    utl::InStreamBuffer buffer = makeBuffer("1 x 2 300 4");
+    utl::InStream stream(buffer);
+
+    uchar_t value = 0;
+
+    TESTASSERT(stream.read(value));
+    TESTASSERTOP(value, eq, 1);
+
+    // the stream stays in failed state until cleared
+    TESTASSERT(!stream.read(value));
+    TESTASSERTOP(stream.status(), eq, utl::PARSE_INVALID);
+    TESTASSERT(!stream.read(value));
+
+    char c = 0;
+
+    stream.clear();
+    TESTASSERT(stream.read(c));
+    TESTASSERTOP(c, eq, 'x');
+
+    TESTASSERT(stream.read(value));
+    TESTASSERTOP(value, eq, 2);
+
+    TESTASSERT(!stream.read(value));
+    TESTASSERTOP(stream.status(), eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(value, eq, 255);
+
+    stream.clear();
+    TESTASSERT(stream.read(value));
+    TESTASSERTOP(value, eq, 4);
+  }
+}
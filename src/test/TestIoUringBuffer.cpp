@@ -0,0 +1,125 @@
+// TestIoUringBuffer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <unistd.h>
+
+#include <util/io/IoUringBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "Pattern.hpp"
+#include "TempFile.hpp"
+#include "TestIoUringBuffer.hpp"
+
+
+namespace test
+{
+  TestIoUringBuffer::TestIoUringBuffer()
+    : tst::TestCase<TestIoUringBuffer>(*this, "TestIoUringBuffer")
+  {
+    add(&TestIoUringBuffer::testWrite);
+    add(&TestIoUringBuffer::testPipe);
+    add(&TestIoUringBuffer::testError);
+  }
+
+  void TestIoUringBuffer::testWrite(tst::TestResult& result)
+  {
+    utl::AsyncBackend const backends[] = {utl::ASYNC_URING, utl::ASYNC_THREAD};
+
+    for (utl::AsyncBackend backend : backends)
+    {
+      TempFile file;
+      int fd = file.fd();
+
+      size_t const size = 500000;
+
+      {
+        utl::IoUringBuffer buffer(fd, backend, 4096, 4);
+
+        // the thread backend is used as fallback, so it is always available
+        if (backend == utl::ASYNC_THREAD)
+          TESTASSERTOP(buffer.backend(), eq, utl::ASYNC_THREAD);
+
+        putPattern(buffer, 0, size, true);
+
+        utl::BasicOutStream<utl::IoUringBuffer> stream(buffer);
+        stream << utl::width(10) << 42 << utl::flush;
+
+        TESTASSERT(buffer.sync());
+        TESTASSERTOP(buffer.written(), eq, size + 10);
+      }
+
+      // the file offset is right after the data
+      TESTASSERTOP(lseek(fd, 0, SEEK_CUR), eq, static_cast<off_t>(size + 10));
+
+      lseek(fd, 0, SEEK_SET);
+      TESTASSERT(matchesFile(fd, size));
+    }
+  }
+
+  void TestIoUringBuffer::testPipe(tst::TestResult& result)
+  {
+    utl::AsyncBackend const backends[] = {utl::ASYNC_URING, utl::ASYNC_THREAD};
+
+    for (utl::AsyncBackend backend : backends)
+    {
+      int fds[2];
+      TESTASSERTOP(pipe(fds), eq, 0);
+
+      // small enough to fit into the pipe without a reader
+      size_t const size = 30000;
+
+      {
+        utl::IoUringBuffer buffer(fds[1], backend, 4096, 3);
+
+        putPattern(buffer, 0, size, true);
+
+        TESTASSERT(buffer.sync());
+        TESTASSERTOP(buffer.written(), eq, size);
+      }
+
+      TESTASSERT(matchesFile(fds[0], size));
+
+      close(fds[0]);
+      close(fds[1]);
+    }
+  }
+
+  void TestIoUringBuffer::testError(tst::TestResult& result)
+  {
+    utl::AsyncBackend const backends[] = {utl::ASYNC_URING, utl::ASYNC_THREAD};
+
+    for (utl::AsyncBackend backend : backends)
+    {
+      utl::IoUringBuffer buffer(-1, backend, 4096, 2);
+
+      buffer.fill('x', 100000);
+
+      TESTASSERT(!buffer.sync());
+      TESTASSERTOP(buffer.error(), eq, EBADF);
+      TESTASSERTOP(buffer.written(), eq, 0);
+
+      // further output is discarded
+      size_t submissions = buffer.submissions();
+
+      buffer.fill('x', 100000);
+      TESTASSERT(!buffer.sync());
+      TESTASSERTOP(buffer.submissions(), eq, submissions);
+    }
+  }
+}
@@ -0,0 +1,157 @@
+// TestJsonWriter.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/io/JsonWriter.hpp>
+
+#include "RecordingBuffer.hpp"
+#include "TestJsonWriter.hpp"
+
+
+namespace test
+{
+  TestJsonWriter::TestJsonWriter()
+    : tst::TestCase<TestJsonWriter>(*this, "TestJsonWriter")
+  {
+    add(&TestJsonWriter::testNesting);
+    add(&TestJsonWriter::testEscape);
+    add(&TestJsonWriter::testValues);
+  }
+
+  void TestJsonWriter::testNesting(tst::TestResult& result)
+  {
+    RecordingBuffer buffer(4096);
+    utl::OutStream stream(buffer);
+    utl::JsonWriter writer(stream);
+
+    writer.beginObject();
+    writer.key("id");
+    writer.value(42);
+    writer.key("tags");
+    writer.beginArray();
+    writer.value("a");
+    writer.value("b");
+    writer.beginObject();
+    writer.endObject();
+    writer.beginArray();
+    writer.endArray();
+    TESTASSERTOP(writer.depth(), eq, 2);
+    writer.endArray();
+    writer.key("inner");
+    writer.beginObject();
+    writer.key("ok");
+    writer.value(true);
+    writer.endObject();
+    writer.endObject();
+
+    TESTASSERTOP(writer.depth(), eq, 0);
+    TESTASSERT(buffer.equals("{\"id\":42,\"tags\":[\"a\",\"b\",{},[]],\"inner\":{\"ok\":true}}"));
+
+    // top level values are not separated, one document per line is up to the caller
+    buffer.clear();
+
+    writer.beginArray();
+    writer.endArray();
+    stream << '\n';
+    writer.value(nullptr);
+
+    TESTASSERT(buffer.equals("[]\nnull"));
+  }
+
+  void TestJsonWriter::testEscape(tst::TestResult& result)
+  {
+    RecordingBuffer buffer(4096);
+    utl::OutStream stream(buffer);
+    utl::JsonWriter writer(stream);
+
+    writer.value("quote \" backslash \\ tab \t newline \n bell \x07 utf-8 \xc3\xa4");
+    TESTASSERT(buffer.equals("\"quote \\\" backslash \\\\ tab \\t newline \\n bell \\u0007 "
+                             "utf-8 \xc3\xa4\""));
+
+    buffer.clear();
+
+    char const control[] = {'\0', '\x1f', '\b', '\f', '\r', '\x7f'};
+    writer.value(control, sizeof(control));
+    TESTASSERT(buffer.equals("\"\\u0000\\u001f\\b\\f\\r\x7f\""));
+
+    // characters to escape at every position of a string longer than a vector
+    char string[100];
+    char expected[200];
+
+    for (size_t i = 0; i < sizeof(string); ++i)
+    {
+      for (char c : {'"', '\\', '\x01', '\x80'})
+      {
+        buffer.clear();
+        __builtin_memset(string, 'x', sizeof(string));
+        string[i] = c;
+
+        writer.value(string, sizeof(string));
+
+        size_t length = 0;
+        expected[length++] = '"';
+
+        for (size_t j = 0; j < sizeof(string); ++j)
+        {
+          if (string[j] == '"' || string[j] == '\\')
+            expected[length++] = '\\';
+          else if (string[j] == '\x01')
+          {
+            __builtin_memcpy(expected + length, "\\u000", 5);
+            length += 5;
+            expected[length++] = '1';
+            continue;
+          }
+          expected[length++] = string[j];
+        }
+
+        expected[length++] = '"';
+        expected[length] = '\0';
+
+        TESTASSERT(buffer.equals(expected));
+      }
+    }
+  }
+
+  void TestJsonWriter::testValues(tst::TestResult& result)
+  {
+    RecordingBuffer buffer(4096);
+    utl::OutStream stream(buffer);
+    utl::JsonWriter writer(stream);
+
+    // the stream's settings do not apply to numbers
+    stream << utl::hex << utl::fix;
+
+    writer.beginArray();
+    writer.value(-1);
+    writer.value(4294967295u);
+    writer.value(-9223372036854775807l - 1);
+    writer.value(18446744073709551615ul);
+    writer.value(0.1);
+    writer.value(-2.5e21);
+    writer.value(1.0 / 0.0);
+    writer.value(0.0 / 0.0);
+    writer.value(false);
+    writer.value(nullptr);
+    writer.value("");
+    writer.endArray();
+
+    TESTASSERT(buffer.equals("[-1,4294967295,-9223372036854775808,18446744073709551615,"
+                             "0.1,-2.5e+21,null,null,false,null,\"\"]"));
+  }
+}
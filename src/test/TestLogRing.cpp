@@ -0,0 +1,188 @@
+// TestLogRing.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <pthread.h>
+
+#include <util/io/LogRing.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "RecordingBuffer.hpp"
+#include "TestLogRing.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    size_t const THREADS  = 8;
+    size_t const MESSAGES = 3000;
+
+    /**
+     * This structure describes the work of a producing thread.
+     */
+    struct Producer
+    {
+      utl::LogRing* ring;
+      byte_t id;
+    };
+
+    /**
+     * This function writes MESSAGES messages of varying length through a LogRingBuffer of its
+     * own. Each message consists of its length, the producer id, and the message number,
+     * followed by a filler derived from the latter two.
+     */
+    void* produce(void* argument)
+    {
+      Producer* producer = static_cast<Producer*>(argument);
+      utl::LogRingBuffer buffer(*producer->ring);
+
+      for (size_t i = 0; i < MESSAGES; ++i)
+      {
+        byte_t length = static_cast<byte_t>(4 + i % 40);
+
+        buffer.put(length);
+        buffer.put(producer->id);
+        buffer.put(static_cast<byte_t>(i & 0xff));
+        buffer.put(static_cast<byte_t>(i >> 8));
+        buffer.fill(static_cast<byte_t>(producer->id * 7 + i), length - 4);
+        buffer.flush();
+      }
+      return nullptr;
+    }
+  }
+
+
+  TestLogRing::TestLogRing()
+    : tst::TestCase<TestLogRing>(*this, "TestLogRing")
+  {
+    add(&TestLogRing::testOrder);
+    add(&TestLogRing::testThreads);
+    add(&TestLogRing::testSync);
+  }
+
+  void TestLogRing::testOrder(tst::TestResult& result)
+  {
+    size_t const size = 100000;
+    RecordingBuffer sink(size);
+
+    {
+      // a tiny ring that wraps around all the time
+      utl::LogRing ring(sink, 64, 4);
+      utl::LogRingBuffer buffer(ring);
+
+      TESTASSERTOP(ring.recordSize(), eq, 64);
+
+      for (size_t position = 0; position < size; )
+      {
+        size_t length = utl::min(static_cast<size_t>(1 + position % 301), size - position);
+
+        // messages larger than a record are spread over several ones
+        for (size_t i = 0; i < length; ++i)
+          buffer.put(static_cast<byte_t>((position + i) % 251));
+
+        buffer.flush();
+        position += length;
+      }
+
+      buffer.flush();
+    }
+
+    TESTASSERTOP(sink.size(), eq, size);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (sink.data()[i] != i % 251)
+      {
+        TESTASSERTOP(sink.data()[i], eq, i % 251);
+        break;
+      }
+    }
+  }
+
+  void TestLogRing::testThreads(tst::TestResult& result)
+  {
+    RecordingBuffer sink(THREADS * MESSAGES * 44);
+
+    {
+      utl::LogRing ring(sink, utl::LogRing::RECORD_SIZE, 16);
+
+      pthread_t threads[THREADS];
+      Producer producers[THREADS];
+
+      for (size_t i = 0; i < THREADS; ++i)
+      {
+        producers[i].ring = &ring;
+        producers[i].id   = static_cast<byte_t>(i);
+
+        TESTASSERTOP(pthread_create(&threads[i], nullptr, &produce, &producers[i]), eq, 0);
+      }
+
+      for (size_t i = 0; i < THREADS; ++i)
+        pthread_join(threads[i], nullptr);
+
+      ring.sync();
+      TESTASSERTOP(ring.records(), eq, THREADS * MESSAGES);
+    }
+
+    // all messages arrived intact, and those of each thread in order
+    size_t next[THREADS] = {};
+    byte_t const* data = sink.data();
+    byte_t const* end  = data + sink.size();
+
+    while (data < end)
+    {
+      size_t length = data[0];
+      size_t id     = data[1];
+      size_t number = data[2] | data[3] << 8;
+
+      TESTASSERTOP(id, le, THREADS - 1);
+      TESTASSERTOP(number, eq, next[id]);
+      TESTASSERTOP(length, eq, 4 + number % 40);
+
+      for (size_t i = 4; i < length; ++i)
+        TESTASSERTOP(data[i], eq, static_cast<byte_t>(id * 7 + number));
+
+      next[id]++;
+      data += length;
+    }
+
+    for (size_t i = 0; i < THREADS; ++i)
+      TESTASSERTOP(next[i], eq, MESSAGES);
+  }
+
+  void TestLogRing::testSync(tst::TestResult& result)
+  {
+    RecordingBuffer sink(64);
+    utl::LogRing ring(sink);
+    utl::LogRingBuffer buffer(ring);
+    utl::BasicOutStream<utl::LogRingBuffer> stream(buffer);
+
+    stream << "value: " << 42 << utl::flush;
+    ring.sync();
+
+    TESTASSERTOP(sink.size(), eq, 9);
+    TESTASSERTOP(sink.flushes(), eq, 1);
+    TESTASSERT(__builtin_memcmp(sink.data(), "value: 42", 9) == 0);
+
+    // nothing new to write, the sink is not flushed again
+    ring.sync();
+    TESTASSERTOP(sink.flushes(), eq, 1);
+    TESTASSERTOP(ring.records(), eq, 1);
+  }
+}
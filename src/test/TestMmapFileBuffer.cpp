@@ -0,0 +1,170 @@
+// TestMmapFileBuffer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <util/io/MmapFileBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
+#include "Pattern.hpp"
+#include "TempFile.hpp"
+#include "TestMmapFileBuffer.hpp"
+
+
+namespace test
+{
+  TestMmapFileBuffer::TestMmapFileBuffer()
+    : tst::TestCase<TestMmapFileBuffer>(*this, "TestMmapFileBuffer")
+  {
+    add(&TestMmapFileBuffer::testWrite);
+    add(&TestMmapFileBuffer::testOffset);
+    add(&TestMmapFileBuffer::testError);
+  }
+
+  void TestMmapFileBuffer::testWrite(tst::TestResult& result)
+  {
+    size_t const position = 1000000;
+
+    TempFile file;
+    int fd = file.fd();
+
+    {
+      // a small growth forces the mapping to be enlarged many times, partly by large payloads
+      utl::MmapFileBuffer buffer(fd, 4096);
+      putPattern(buffer, 0, position);
+
+      TESTASSERTOP(buffer.size(), eq, position);
+      TESTASSERT(buffer.sync());
+
+      utl::BasicOutStream<utl::MmapFileBuffer> stream(buffer);
+      stream << utl::fill('-') << utl::width(5) << 42 << utl::flush;
+
+      TESTASSERT(buffer.close());
+      TESTASSERTOP(file.size(), eq, static_cast<off_t>(position + 5));
+      TESTASSERTOP(lseek(fd, 0, SEEK_CUR), eq, static_cast<off_t>(position + 5));
+      TESTASSERTOP(lseek(fd, 0, SEEK_SET), eq, 0);
+      TESTASSERT(matchesFile(fd, position));
+
+      char end[5];
+      TESTASSERTOP(pread(fd, end, 5, position), eq, 5);
+      TESTASSERT(end[0] == '-' && end[2] == '-' && end[3] == '4' && end[4] == '2');
+
+      // output after closing is discarded
+      buffer.fill('x', 100000);
+      TESTASSERT(buffer.close());
+    }
+
+    TESTASSERTOP(file.size(), eq, static_cast<off_t>(position + 5));
+  }
+
+  void TestMmapFileBuffer::testOffset(tst::TestResult& result)
+  {
+    static byte_t data[10000];
+    static byte_t contents[6 + sizeof(data)];
+
+    TempFile file;
+    int fd = file.fd();
+
+    // output starts at the current (unaligned) offset, data before it is kept
+    TESTASSERTOP(write(fd, "header", 6), eq, 6);
+
+    for (size_t i = 0; i < sizeof(data); ++i)
+      data[i] = pattern(i);
+
+    {
+      utl::MmapFileBuffer buffer(fd, 4096);
+      buffer.put(data, sizeof(data));
+    }
+
+    TESTASSERTOP(file.size(), eq, static_cast<off_t>(sizeof(contents)));
+    TESTASSERTOP(file.read(contents, sizeof(contents)), eq, sizeof(contents));
+    TESTASSERT(contents[0] == 'h' && contents[5] == 'r');
+    TESTASSERT(matches(contents + 6, sizeof(data)));
+
+    // a second buffer continues where the first one stopped
+    {
+      utl::MmapFileBuffer buffer(fd);
+      buffer.put('!');
+    }
+
+    TESTASSERTOP(file.size(), eq, static_cast<off_t>(7 + sizeof(data)));
+  }
+
+  void TestMmapFileBuffer::testError(tst::TestResult& result)
+  {
+    {
+      utl::MmapFileBuffer buffer(-1);
+
+      buffer.fill('x', 100000);
+      buffer.put('x');
+
+      TESTASSERTOP(buffer.error(), eq, EBADF);
+      TESTASSERTOP(buffer.size(), eq, 0);
+    }
+
+    {
+      int fds[2];
+      TESTASSERTOP(pipe(fds), eq, 0);
+
+      // pipes cannot be mapped
+      utl::MmapFileBuffer buffer(fds[1]);
+      buffer.put('x');
+
+      TESTASSERT(!buffer.good());
+      TESTASSERT(!buffer.close());
+
+      close(fds[0]);
+      close(fds[1]);
+    }
+
+    {
+      TempFile file;
+      int readonly = open(file.path(), O_RDONLY);
+
+      // a descriptor not open for writing cannot be extended
+      utl::MmapFileBuffer buffer(readonly);
+      buffer.put('x');
+
+      TESTASSERT(!buffer.good());
+
+      close(readonly);
+    }
+
+    {
+      TempFile file;
+      int writeonly = open(file.path(), O_WRONLY);
+
+      TESTASSERTOP(write(writeonly, "header", 6), eq, 6);
+
+      {
+        // a descriptor not open for reading can be extended but not mapped
+        utl::MmapFileBuffer buffer(writeonly);
+        buffer.put('x');
+
+        TESTASSERTOP(buffer.error(), eq, EACCES);
+        TESTASSERTOP(buffer.size(), eq, 0);
+      }
+
+      TESTASSERTOP(file.size(), eq, 6);
+
+      close(writeonly);
+    }
+  }
+}
@@ -17,19 +17,243 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
  ***************************************************************************/
 
+#include <util/String.hpp>
+#include <util/io/CountingBuffer.hpp>
+#include <util/io/Format.hpp>
+#include <util/io/MemoryBuffer.hpp>
+#include <util/io/OutStream.hpp>
+
 #include "TestOutStream.hpp"
 
 
 namespace test
 {
+  namespace
+  {
+    /**
+     * The destination of all data written by a Writer.
+     */
+    struct Sink
+    {
+      byte_t data[4096];
+      size_t size;
+      size_t writes;
+      byte_t const* last;
+    };
+
+    /**
+     * A writer for MemoryBuffer objects that records all data written in a sink.
+     */
+    struct Writer
+    {
+      Sink* sink;
+
+      bool operator()(byte_t const* buffer, size_t count) const
+      {
+        utl::copy(buffer, buffer + count, sink->data + sink->size);
+
+        sink->size += count;
+        sink->writes++;
+        sink->last = buffer;
+        return true;
+      }
+    };
+
+    /**
+     * This function prints a bit of everything into the given stream.
+     */
+    template<typename StreamT>
+    void printMixed(StreamT& stream)
+    {
+      stream << "value: " << -1234 << ' ' << utl::hex << 255u << utl::fix << 7ul << utl::var;
+      stream << utl::dec << utl::width(8) << static_cast<sshort_t>(-3) << utl::left;
+      stream << utl::width(3) << 123456 << utl::width(4) << 0 << 0.1 << utl::fxp << 1e20;
+      stream << utl::bin << utl::fix << static_cast<uchar_t>(5) << utl::width(70) << static_cast<slong_t>(-1);
+
+      utl::format(stream, UTL_FORMAT("{}-{x}-{b}-{d}"), 42, 4096u, 6, -99);
+      stream << utl::flush;
+    }
+
+    /**
+     * @return true if the data in the given sink equals the given zero terminated string
+     */
+    bool equal(Sink const& sink, char const* string)
+    {
+      if (sink.size != utl::length(string))
+        return false;
+
+      for (size_t i = 0; i < sink.size; ++i)
+      {
+        if (sink.data[i] != static_cast<byte_t>(string[i]))
+          return false;
+      }
+      return true;
+    }
+  }
+
+
   TestOutStream::TestOutStream()
     : tst::TestCase<TestOutStream>(*this, "TestOutStream")
   {
     add(&TestOutStream::testOutput);
+    add(&TestOutStream::testPutRange);
+    add(&TestOutStream::testPutLarge);
+    add(&TestOutStream::testStaticBuffer);
+    add(&TestOutStream::testFloat);
+    add(&TestOutStream::testWidth);
+    add(&TestOutStream::testCounting);
   }
 
   void TestOutStream::testOutput(tst::TestResult& result)
   {
-    TESTASSERTM(false, "implement real test case");
+    Sink sink = {};
+    utl::MemoryBuffer<64, Writer> buffer(Writer{&sink});
+    utl::OutStream stream(buffer);
+
+    stream << "value: " << 42 << ',' << -17 << ' ' << utl::hex << 255u << ' '
+           << utl::bin << static_cast<uchar_t>(5) << ' ' << utl::dec << nullptr << utl::flush;
+
+    TESTASSERT(equal(sink, "value: 42,-17 FF 101 null"));
+
+    sink.size = 0;
+    stream << utl::fix << static_cast<ushort_t>(42) << ' ' << utl::hex << static_cast<ushort_t>(42)
+           << utl::var << utl::dec << ' ' << 0 << utl::flush;
+
+    TESTASSERT(equal(sink, "00042 002A 0"));
+  }
+
+  void TestOutStream::testPutRange(tst::TestResult& result)
+  {
+    Sink sink = {};
+    utl::MemoryBuffer<16, Writer> buffer(Writer{&sink});
+    utl::OutStream stream(buffer);
+
+    // the data is only written once the buffer is full
+    stream << "0123456789";
+    TESTASSERTOP(sink.writes, eq, 0);
+
+    stream << "abcdefghij";
+    TESTASSERTOP(sink.writes, eq, 1);
+    TESTASSERTOP(sink.size, eq, 16);
+
+    stream << "" << "ABCDEF" << utl::flush;
+    TESTASSERTOP(sink.writes, eq, 2);
+    TESTASSERT(equal(sink, "0123456789abcdefghijABCDEF"));
+  }
+
+  void TestOutStream::testPutLarge(tst::TestResult& result)
+  {
+    Sink sink = {};
+    utl::MemoryBuffer<16, Writer> buffer(Writer{&sink});
+
+    char const* string = "this string is larger than the buffer";
+    byte_t const* bytes = reinterpret_cast<byte_t const*>(string);
+
+    // large payloads are written directly, after the data already buffered
+    buffer.put('>');
+    buffer.put(bytes, utl::length(string));
+
+    TESTASSERTOP(sink.writes, eq, 2);
+    TESTASSERTOP(sink.last, eq, bytes);
+    TESTASSERT(equal(sink, ">this string is larger than the buffer"));
+
+    // without buffered data there is no need for an additional write
+    buffer.put(bytes, 16);
+
+    TESTASSERTOP(sink.writes, eq, 3);
+    TESTASSERTOP(sink.last, eq, bytes);
+  }
+
+  void TestOutStream::testStaticBuffer(tst::TestResult& result)
+  {
+    typedef utl::MemoryBuffer<8, Writer> Buffer;
+
+    Sink sink = {};
+    Buffer buffer(Writer{&sink});
+    utl::BasicOutStream<Buffer> stream(buffer);
+
+    // the buffer overflows several times while printing single characters
+    stream << "abc" << 'd' << 12345 << utl::hex << 0xabcu << utl::dec << -1 << ',' << nullptr;
+    stream << utl::fix << static_cast<uchar_t>(7) << utl::var << utl::flush;
+
+    TESTASSERT(equal(sink, "abcd12345ABC-1,null007"));
+  }
+
+  void TestOutStream::testFloat(tst::TestResult& result)
+  {
+    typedef utl::MemoryBuffer<16, Writer> Buffer;
+
+    Sink sink = {};
+    Buffer buffer(Writer{&sink});
+    utl::BasicOutStream<Buffer> stream(buffer);
+
+    stream << 0.1 << ' ' << 1.0f / 3.0f << ' ' << -1e21 << ' ';
+    stream << utl::sci << 1500.0 << ' ' << utl::precision(2) << 0.125f << ' ';
+    stream << utl::fxp << 2.5 << ' ' << utl::precision(0) << 2.5 << ' ';
+    stream << utl::gen << 2.5 << utl::flush;
+
+    TESTASSERT(equal(sink, "0.1 0.33333334 -1e+21 1.500000e+03 1.25e-01 2.50 2 2.5"));
+  }
+
+  void TestOutStream::testWidth(tst::TestResult& result)
+  {
+    typedef utl::MemoryBuffer<16, Writer> Buffer;
+
+    Sink sink = {};
+    Buffer buffer(Writer{&sink});
+    utl::BasicOutStream<Buffer> stream(buffer);
+
+    // the width only applies to the next value printed
+    stream << '[' << utl::width(5) << 42 << 7 << ']' << utl::width(4) << -42 << '|';
+    stream << utl::left << utl::width(6) << "abc" << '|' << utl::width(3) << 'x' << '|';
+    stream << utl::fill('.') << utl::width(6) << 2.5 << '|' << utl::right << utl::width(2) << 123;
+    stream << '|' << utl::fill('0') << utl::width(4) << -5 << utl::fill(' ') << utl::flush;
+
+    TESTASSERT(equal(sink, "[   427] -42|abc   |x  |2.5...|123|00-5"));
+
+    sink.size = 0;
+    stream << utl::hex << utl::fix << utl::width(6) << static_cast<uchar_t>(10) << '|';
+    stream << utl::var << utl::dec << utl::width(3) << utl::fxp << utl::precision(1) << 2.25;
+    stream << '|' << utl::width(0) << "none" << utl::flush;
+
+    TESTASSERT(equal(sink, "    0A|2.2|none"));
+
+    // the padding exceeds the buffer capacity
+    sink.size = 0;
+    stream << utl::width(40) << 1 << utl::left << utl::width(35) << "x" << '|' << utl::flush;
+
+    TESTASSERTOP(sink.size, eq, 76);
+    TESTASSERTOP(sink.data[38], eq, ' ');
+    TESTASSERTOP(sink.data[39], eq, '1');
+    TESTASSERTOP(sink.data[40], eq, 'x');
+    TESTASSERTOP(sink.data[74], eq, ' ');
+    TESTASSERTOP(sink.data[75], eq, '|');
+  }
+
+  void TestOutStream::testCounting(tst::TestResult& result)
+  {
+    Sink sink = {};
+    utl::MemoryBuffer<16, Writer> buffer(Writer{&sink});
+    utl::OutStream stream(buffer);
+
+    printMixed(stream);
+
+    utl::CountingBuffer counter;
+    utl::BasicOutStream<utl::CountingBuffer> measure(counter);
+
+    printMixed(measure);
+    TESTASSERTOP(counter.size(), eq, sink.size);
+
+    // the type-erased stream has to arrive at the same result
+    utl::CountingBuffer erased;
+    utl::OutStream erased_stream(erased);
+
+    printMixed(erased_stream);
+    TESTASSERTOP(erased.size(), eq, sink.size);
+
+    counter.reset();
+    measure << utl::dec << utl::var << "abc" << 'd' << utl::width(10) << 1;
+
+    TESTASSERTOP(counter.size(), eq, 14);
   }
 }
@@ -31,6 +31,12 @@ namespace test
     TestOutStream();
 
     void testOutput(tst::TestResult& result);
+    void testPutRange(tst::TestResult& result);
+    void testPutLarge(tst::TestResult& result);
+    void testStaticBuffer(tst::TestResult& result);
+    void testFloat(tst::TestResult& result);
+    void testWidth(tst::TestResult& result);
+    void testCounting(tst::TestResult& result);
   };
 }
 
@@ -0,0 +1,213 @@
+// TestParse.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/Parse.hpp>
+
+#include "Random.hpp"
+#include "TestParse.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * @return result of parsing the given zero terminated string
+     */
+    template<typename T>
+    utl::ParseResult<T> parse(char const* string, uint8_t base = utl::BASE_DECIMAL)
+    {
+      return utl::parse<T>(string, string + utl::length(string), base);
+    }
+
+    /**
+     * This function formats a value in the given base, digit by digit.
+     * @return end of the formatted string
+     */
+    char* format(uint64_t value, uint8_t base, char* buffer)
+    {
+      char digits[64];
+      size_t count = 0;
+
+      do
+      {
+        digits[count++] = "0123456789abcdef"[value % base];
+        value /= base;
+      } while (value != 0);
+
+      while (count > 0)
+        *buffer++ = digits[--count];
+
+      return buffer;
+    }
+  }
+
+
+  TestParse::TestParse()
+    : tst::TestCase<TestParse>(*this, "TestParse")
+  {
+    add(&TestParse::testDecimal);
+    add(&TestParse::testBases);
+    add(&TestParse::testSigns);
+    add(&TestParse::testLimits);
+    add(&TestParse::testInvalid);
+    add(&TestParse::testRandom);
+  }
+
+  void TestParse::testDecimal(tst::TestResult& result)
+  {
+    char const* string = "1234567890123456789,";
+
+    // every number of digits, with and without a terminating character
+    for (size_t i = 1; i <= 19; ++i)
+    {
+      uint64_t expected = 0;
+
+      for (size_t j = 0; j < i; ++j)
+        expected = expected * 10 + (string[j] - '0');
+
+      utl::ParseResult<uint64_t> result1 = utl::parse<uint64_t>(string, string + i);
+      TESTASSERTOP(result1.status, eq, utl::PARSE_SUCCESS);
+      TESTASSERTOP(result1.value, eq, expected);
+      TESTASSERTOP(result1.end, eq, string + i);
+    }
+
+    utl::ParseResult<uint64_t> result1 = parse<uint64_t>(string);
+    TESTASSERTOP(result1.value, eq, 1234567890123456789ull);
+    TESTASSERTOP(result1.end, eq, string + 19);
+
+    TESTASSERTOP(parse<uint_t>("0").value, eq, 0);
+    TESTASSERTOP(parse<uint_t>("00000000000000000000042").value, eq, 42);
+    TESTASSERTOP(parse<uint_t>("12345678/").value, eq, 12345678);
+    TESTASSERTOP(parse<uint_t>("1234567:").value, eq, 1234567);
+    TESTASSERTOP(parse<uint_t>("9 9").value, eq, 9);
+  }
+
+  void TestParse::testBases(tst::TestResult& result)
+  {
+    TESTASSERTOP(parse<uint_t>("101010", utl::BASE_BINARY).value, eq, 42);
+    TESTASSERTOP(parse<uint_t>("1012", utl::BASE_BINARY).value, eq, 5);
+    TESTASSERTOP(parse<uint_t>("777", utl::BASE_OCTAL).value, eq, 0777);
+    TESTASSERTOP(parse<uint_t>("deadBEEF", utl::BASE_HEXADECIMAL).value, eq, 0xdeadbeef);
+    TESTASSERTOP(parse<uint_t>("fg", utl::BASE_HEXADECIMAL).value, eq, 0xf);
+    TESTASSERTOP(parse<uint_t>("333", 4).value, eq, 63);
+    TESTASSERTOP(parse<uint_t>("zz", 16).status, eq, utl::PARSE_INVALID);
+    TESTASSERTOP(parse<uint_t>("120", 3).value, eq, 15);
+    TESTASSERTOP(parse<uint_t>("1a", 11).value, eq, 21);
+    TESTASSERTOP(parse<uint_t>("1", 1).status, eq, utl::PARSE_INVALID);
+    TESTASSERTOP(parse<uint_t>("1", 17).status, eq, utl::PARSE_INVALID);
+
+    utl::ParseResult<uint64_t> result1 = parse<uint64_t>("ffffffffffffffff", 16);
+    TESTASSERTOP(result1.status, eq, utl::PARSE_SUCCESS);
+    TESTASSERTOP(result1.value, eq, 0xffffffffffffffffull);
+
+    result1 = parse<uint64_t>("10000000000000000", 16);
+    TESTASSERTOP(result1.status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(result1.value, eq, 0xffffffffffffffffull);
+  }
+
+  void TestParse::testSigns(tst::TestResult& result)
+  {
+    TESTASSERTOP(parse<sint_t>("-42").value, eq, -42);
+    TESTASSERTOP(parse<sint_t>("+42").value, eq, 42);
+    TESTASSERTOP(parse<sint_t>("-0").value, eq, 0);
+    TESTASSERTOP(parse<sint_t>("-ff", 16).value, eq, -255);
+    TESTASSERTOP(parse<uint_t>("+42").value, eq, 42);
+
+    utl::ParseResult<uint_t> result1 = parse<uint_t>("-42");
+    TESTASSERTOP(result1.status, eq, utl::PARSE_INVALID);
+
+    utl::ParseResult<sint_t> result2 = parse<sint_t>("--42");
+    TESTASSERTOP(result2.status, eq, utl::PARSE_INVALID);
+  }
+
+  void TestParse::testLimits(tst::TestResult& result)
+  {
+    TESTASSERTOP(parse<uchar_t>("255").status, eq, utl::PARSE_SUCCESS);
+    TESTASSERTOP(parse<uchar_t>("256").status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(parse<uchar_t>("256").value, eq, 255);
+
+    TESTASSERTOP(parse<schar_t>("127").value, eq, 127);
+    TESTASSERTOP(parse<schar_t>("-128").value, eq, -128);
+    TESTASSERTOP(parse<schar_t>("128").status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(parse<schar_t>("128").value, eq, 127);
+    TESTASSERTOP(parse<schar_t>("-129").status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(parse<schar_t>("-129").value, eq, -128);
+
+    TESTASSERTOP(parse<sshort_t>("-32768").value, eq, -32768);
+    TESTASSERTOP(parse<sshort_t>("32768").status, eq, utl::PARSE_OVERFLOW);
+
+    TESTASSERTOP(parse<uint64_t>("18446744073709551615").value, eq, 18446744073709551615ull);
+    TESTASSERTOP(parse<uint64_t>("18446744073709551616").status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(parse<uint64_t>("99999999999999999999").status, eq, utl::PARSE_OVERFLOW);
+
+    TESTASSERTOP(parse<int64_t>("9223372036854775807").value, eq, 9223372036854775807ll);
+    TESTASSERTOP(parse<int64_t>("-9223372036854775808").value, eq, -9223372036854775807ll - 1);
+    TESTASSERTOP(parse<int64_t>("9223372036854775808").status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(parse<int64_t>("-9223372036854775809").status, eq, utl::PARSE_OVERFLOW);
+
+    // all digits are consumed even in case of an overflow
+    char const* string = "123456789012345678901234567890 ";
+    utl::ParseResult<uint64_t> result1 = parse<uint64_t>(string);
+
+    TESTASSERTOP(result1.status, eq, utl::PARSE_OVERFLOW);
+    TESTASSERTOP(result1.end, eq, string + 30);
+  }
+
+  void TestParse::testInvalid(tst::TestResult& result)
+  {
+    char const* strings[] = {"", "-", "+", " 1", "x1", "-+1", "/", ":"};
+
+    for (size_t i = 0; i < sizeof(strings) / sizeof(*strings); ++i)
+    {
+      utl::ParseResult<sint_t> result1 = parse<sint_t>(strings[i]);
+
+      TESTASSERTOP(result1.status, eq, utl::PARSE_INVALID);
+      TESTASSERTOP(result1.end, eq, strings[i]);
+    }
+  }
+
+  void TestParse::testRandom(tst::TestResult& result)
+  {
+    static uint8_t const bases[] = {2, 3, 4, 7, 8, 10, 10, 10, 13, 16};
+
+    char buffer[80];
+    uint64_t state = 1;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+      uint8_t  base  = bases[i % sizeof(bases)];
+      uint64_t value = random(state) >> (random(state) % 64);
+
+      char* end = format(value, base, buffer);
+      *end = ' ';
+
+      // parse once with a terminating character and once without one
+      utl::ParseResult<uint64_t> result1 = utl::parse<uint64_t>(buffer, end + 1, base);
+      utl::ParseResult<uint64_t> result2 = utl::parse<uint64_t>(buffer, end, base);
+
+      TESTASSERTOP(result1.status, eq, utl::PARSE_SUCCESS);
+      TESTASSERTOP(result1.value, eq, value);
+      TESTASSERTOP(result1.end, eq, end);
+      TESTASSERTOP(result2.value, eq, value);
+      TESTASSERTOP(result2.end, eq, end);
+    }
+  }
+}
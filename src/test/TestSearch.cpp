@@ -0,0 +1,265 @@
+// TestSearch.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/Search.hpp>
+#include <util/AhoCorasick.hpp>
+
+#include "Random.hpp"
+#include "TestSearch.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * @param haystack zero terminated string to search in
+     * @param needle zero terminated string to search for
+     * @return index of first occurrence of 'needle' in 'haystack' or -1 if none
+     */
+    long find(char const* haystack, char const* needle)
+    {
+      char const* end = haystack + utl::length(haystack);
+      char const* it  = utl::search(haystack, end, needle, needle + utl::length(needle));
+
+      return it == end ? -1 : it - haystack;
+    }
+
+    /**
+     * @return index of first occurrence of 'needle' in 'haystack' using the Two-Way algorithm
+     */
+    long findTwoWay(char const* haystack, char const* needle)
+    {
+      auto begin = reinterpret_cast<byte_t const*>(haystack);
+      auto end   = begin + utl::length(haystack);
+      auto it    = utl::searchTwoWay(begin, end, reinterpret_cast<byte_t const*>(needle),
+                                     utl::length(needle));
+
+      return it == end ? -1 : it - begin;
+    }
+
+    /**
+     * @return index of first occurrence of 'needle' in 'haystack' using a naive search
+     */
+    long findNaive(char const* haystack, char const* needle)
+    {
+      size_t haystack_length = utl::length(haystack);
+      size_t needle_length   = utl::length(needle);
+
+      for (size_t i = 0; i + needle_length <= haystack_length; ++i)
+      {
+        size_t j = 0;
+
+        while (j < needle_length && haystack[i + j] == needle[j])
+          ++j;
+
+        if (j == needle_length)
+          return i;
+      }
+      return -1;
+    }
+  }
+
+
+  TestSearch::TestSearch()
+    : tst::TestCase<TestSearch>(*this, "TestSearch")
+  {
+    add(&TestSearch::testSearchGeneric);
+    add(&TestSearch::testSearchBytes);
+    add(&TestSearch::testSearchPeriodic);
+    add(&TestSearch::testSearchRandom);
+    add(&TestSearch::testAhoCorasick1);
+    add(&TestSearch::testAhoCorasick2);
+  }
+
+  void TestSearch::testSearchGeneric(tst::TestResult& result)
+  {
+    int haystack[] = {1, 2, 3, 1, 2, 4};
+    int needle1[]  = {1, 2, 4};
+    int needle2[]  = {2, 4, 5};
+
+    int* begin = haystack;
+    int* end   = haystack + 6;
+
+    TESTASSERTOP(utl::search(begin, end, needle1, needle1 + 3), eq, begin + 3);
+    TESTASSERTOP(utl::search(begin, end, needle1, needle1 + 2), eq, begin);
+    TESTASSERTOP(utl::search(begin, end, needle2, needle2 + 3), eq, end);
+    TESTASSERTOP(utl::search(begin, end, needle2, needle2), eq, begin);
+    TESTASSERTOP(utl::search(begin, begin, needle2, needle2 + 1), eq, begin);
+  }
+
+  void TestSearch::testSearchBytes(tst::TestResult& result)
+  {
+    TESTASSERTOP(find("a", ""), eq, 0);
+    TESTASSERTOP(find("", "a"), eq, -1);
+    TESTASSERTOP(find("a", "a"), eq, 0);
+    TESTASSERTOP(find("ab", "b"), eq, 1);
+    TESTASSERTOP(find("abc", "abcd"), eq, -1);
+    TESTASSERTOP(find("hello world", "world"), eq, 6);
+    TESTASSERTOP(find("hello world", "word"), eq, -1);
+
+    char const* line = "2014-05-11 12:00:01 [INFO] connection established (fd=17, peer=10.0.0.1)";
+
+    TESTASSERTOP(find(line, "[INFO]"), eq, 20);
+    TESTASSERTOP(find(line, "peer=10.0.0.1)"), eq, 58);
+    TESTASSERTOP(find(line, "peer=10.0.0.2)"), eq, -1);
+    TESTASSERTOP(find(line, "2014"), eq, 0);
+    TESTASSERTOP(find(line, ")"), eq, 71);
+  }
+
+  void TestSearch::testSearchPeriodic(tst::TestResult& result)
+  {
+    static char haystack[4097];
+    static char needle[257];
+
+    // a haystack of only 'a's with an almost matching needle is the worst case for naive search
+    // and forces the fallback to the Two-Way algorithm
+    utl::fill(haystack, haystack + 4096, 'a');
+    utl::fill(needle, needle + 256, 'a');
+    needle[255] = 'b';
+
+    TESTASSERTOP(find(haystack, needle), eq, -1);
+
+    haystack[4000] = 'b';
+    TESTASSERTOP(find(haystack, needle), eq, 4000 - 255);
+
+    TESTASSERTOP(findTwoWay("abababac", "abac"), eq, 4);
+    TESTASSERTOP(findTwoWay("aaaaaaab", "aab"), eq, 5);
+    TESTASSERTOP(findTwoWay("abcabcabd", "abcabd"), eq, 3);
+    TESTASSERTOP(findTwoWay("abcabcab", "bca"), eq, 1);
+    TESTASSERTOP(findTwoWay("banana", "nana"), eq, 2);
+    TESTASSERTOP(findTwoWay("banana", "nab"), eq, -1);
+  }
+
+  void TestSearch::testSearchRandom(tst::TestResult& result)
+  {
+    uint64_t state = 42;
+    char haystack[512];
+    char needle[16];
+
+    for (int i = 0; i < 2000; ++i)
+    {
+      // use a small alphabet to get a decent number of (partial) matches
+      unsigned int alphabet = 2 + random(state) % 3;
+      unsigned int haystack_length = random(state) % (sizeof(haystack) - 1);
+      unsigned int needle_length = 1 + random(state) % (sizeof(needle) - 1);
+
+      for (unsigned int j = 0; j < haystack_length; ++j)
+        haystack[j] = static_cast<char>('a' + random(state) % alphabet);
+
+      for (unsigned int j = 0; j < needle_length; ++j)
+        needle[j] = static_cast<char>('a' + random(state) % alphabet);
+
+      haystack[haystack_length] = '\0';
+      needle[needle_length] = '\0';
+
+      long expected = findNaive(haystack, needle);
+
+      TESTASSERTOP(find(haystack, needle), eq, expected);
+      TESTASSERTOP(findTwoWay(haystack, needle), eq, expected);
+    }
+  }
+
+  void TestSearch::testAhoCorasick1(tst::TestResult& result)
+  {
+    char const* patterns[] = {"he", "she", "his", "hers"};
+    size_t lengths[] = {2, 3, 3, 4};
+
+    utl::AhoCorasick automaton(reinterpret_cast<byte_t const* const*>(patterns), lengths, 4);
+
+    char const* text = "ushers";
+    auto begin = reinterpret_cast<byte_t const*>(text);
+    auto end   = begin + 6;
+
+    size_t found[8];
+    size_t ends[8];
+    size_t count = 0;
+
+    automaton.search(begin, end, [&](size_t pattern, byte_t const* position)
+    {
+      found[count] = pattern;
+      ends[count]  = position - begin;
+      ++count;
+      return true;
+    });
+
+    TESTASSERTOP(count, eq, 3);
+    TESTASSERTOP(found[0], eq, 1);
+    TESTASSERTOP(ends[0], eq, 4);
+    TESTASSERTOP(found[1], eq, 0);
+    TESTASSERTOP(ends[1], eq, 4);
+    TESTASSERTOP(found[2], eq, 3);
+    TESTASSERTOP(ends[2], eq, 6);
+
+    size_t pattern = 0;
+
+    TESTASSERTOP(automaton.find(begin, end, pattern), eq, begin + 1);
+    TESTASSERTOP(pattern, eq, 1);
+    TESTASSERTOP(automaton.find(begin, begin + 3, pattern), eq, begin + 3);
+    TESTASSERTOP(automaton.states(), eq, 10);
+  }
+
+  void TestSearch::testAhoCorasick2(tst::TestResult& result)
+  {
+    char const* patterns[] = {"ERROR", "WARN", "timeout", "refused"};
+    size_t lengths[] = {5, 4, 7, 7};
+
+    utl::AhoCorasick automaton(reinterpret_cast<byte_t const* const*>(patterns), lengths, 4);
+
+    char const* lines[] = {
+      "12:00:01 INFO all good",
+      "12:00:02 WARN disk almost full",
+      "12:00:03 INFO connection refused",
+      "12:00:04 ERROR timeout",
+    };
+    long expected[] = {-1, 1, 3, 0};
+    long offsets[] = {-1, 9, 25, 9};
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+      auto begin = reinterpret_cast<byte_t const*>(lines[i]);
+      auto end   = begin + utl::length(lines[i]);
+
+      size_t pattern = static_cast<size_t>(-1);
+      auto it = automaton.find(begin, end, pattern);
+
+      TESTASSERTOP(it == end ? -1 : it - begin, eq, offsets[i]);
+      TESTASSERTOP(it == end ? -1 : static_cast<long>(pattern), eq, expected[i]);
+    }
+
+    TESTASSERT(automaton.good());
+
+    // a pattern set whose row offsets do not fit next to the match flag is rejected
+    size_t const size = 9 * 1024 * 1024;
+    byte_t* huge = new byte_t[size];
+
+    for (size_t i = 0; i < size; ++i)
+      huge[i] = static_cast<byte_t>(i);
+
+    utl::AhoCorasick rejected(&huge, &size, 1);
+    size_t pattern;
+
+    TESTASSERT(!rejected.good());
+    TESTASSERTOP(rejected.states(), eq, 1);
+    TESTASSERTOP(rejected.find(huge, huge + 1000, pattern), eq, huge + 1000);
+
+    delete[] huge;
+  }
+}
@@ -49,6 +49,20 @@ namespace test
 
     TESTASSERTOP(utl::length(string1), eq, 2);
     TESTASSERTOP(utl::length(string2), eq, 3);
+
+    // all alignments of begin and end relative to the blocks checked at once
+    char buffer[80];
+    utl::fill(buffer, buffer + sizeof(buffer), 'x');
+
+    for (size_t begin = 0; begin < 32; ++begin)
+    {
+      for (size_t end = begin; end < sizeof(buffer); ++end)
+      {
+        buffer[end] = '\0';
+        TESTASSERTOP(utl::length(buffer + begin), eq, end - begin);
+        buffer[end] = 'x';
+      }
+    }
   }
 
   void TestString::testCompareLess(tst::TestResult& result)
@@ -0,0 +1,156 @@
+// TestStringInterner.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/StringInterner.hpp>
+
+#include "TestStringInterner.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    typedef utl::StringInterner<char> Interner;
+
+
+    /**
+     * @param value some value
+     * @param buffer buffer large enough to hold the string representation of 'value'
+     * @return number of characters written to 'buffer'
+     */
+    size_t toString(unsigned int value, char* buffer)
+    {
+      char digits[16];
+      size_t count = 0;
+
+      do
+      {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+      } while (value != 0);
+
+      for (size_t i = 0; i < count; ++i)
+        buffer[i] = digits[count - 1 - i];
+
+      return count;
+    }
+  }
+
+
+  TestStringInterner::TestStringInterner()
+    : tst::TestCase<TestStringInterner>(*this, "TestStringInterner")
+  {
+    add(&TestStringInterner::testIntern);
+    add(&TestStringInterner::testFind);
+    add(&TestStringInterner::testString);
+    add(&TestStringInterner::testMany);
+    add(&TestStringInterner::testWide);
+  }
+
+  void TestStringInterner::testIntern(tst::TestResult& result)
+  {
+    Interner interner;
+
+    TESTASSERTOP(interner.size(), eq, 0);
+    TESTASSERTOP(interner.intern("foo", 3), eq, 0);
+    TESTASSERTOP(interner.intern("bar", 3), eq, 1);
+    TESTASSERTOP(interner.intern("foo", 3), eq, 0);
+    TESTASSERTOP(interner.intern("", 0), eq, 2);
+    TESTASSERTOP(interner.intern("", 0), eq, 2);
+    TESTASSERTOP(interner.size(), eq, 3);
+
+    // the strings do not need to be zero terminated
+    TESTASSERTOP(interner.intern("foobar", 3), eq, 0);
+    TESTASSERTOP(interner.intern("foobar" + 3, 3), eq, 1);
+    TESTASSERTOP(interner.intern("foobar", 6), eq, 3);
+    TESTASSERTOP(interner.size(), eq, 4);
+  }
+
+  void TestStringInterner::testFind(tst::TestResult& result)
+  {
+    Interner interner;
+
+    TESTASSERTOP(interner.find("foo", 3), eq, Interner::INVALID);
+
+    Interner::Id id = interner.intern("foo", 3);
+
+    TESTASSERTOP(interner.find("foo", 3), eq, id);
+    TESTASSERTOP(interner.find("fo", 2), eq, Interner::INVALID);
+    TESTASSERTOP(interner.find("fooo", 4), eq, Interner::INVALID);
+    TESTASSERTOP(interner.size(), eq, 1);
+  }
+
+  void TestStringInterner::testString(tst::TestResult& result)
+  {
+    Interner interner;
+
+    Interner::Id id1 = interner.intern("hello", 5);
+    Interner::Id id2 = interner.intern("world!", 5);
+
+    TESTASSERTOP(interner.length(id1), eq, 5);
+    TESTASSERTOP(interner.length(id2), eq, 5);
+    TESTASSERTOP(utl::compare(interner.string(id1), "hello"), eq, 0);
+    TESTASSERTOP(utl::compare(interner.string(id2), "world"), eq, 0);
+  }
+
+  void TestStringInterner::testMany(tst::TestResult& result)
+  {
+    unsigned int const count = 100000;
+
+    Interner interner;
+    char buffer[16];
+
+    for (unsigned int i = 0; i < count; ++i)
+      TESTASSERTOP(interner.intern(buffer, toString(i, buffer)), eq, i);
+
+    TESTASSERTOP(interner.size(), eq, count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      size_t length = toString(i, buffer);
+
+      TESTASSERTOP(interner.find(buffer, length), eq, i);
+      TESTASSERTOP(interner.length(i), eq, length);
+
+      buffer[length] = '\0';
+      TESTASSERTOP(utl::compare(interner.string(i), static_cast<char const*>(buffer)), eq, 0);
+    }
+
+    // strings larger than an arena chunk are stored just as well
+    static char large[128 * 1024];
+    utl::fill(large, large + sizeof(large), 'x');
+
+    Interner::Id id = interner.intern(large, sizeof(large));
+
+    TESTASSERTOP(id, eq, count);
+    TESTASSERTOP(interner.find(large, sizeof(large)), eq, id);
+    TESTASSERTOP(interner.length(id), eq, sizeof(large));
+  }
+
+  void TestStringInterner::testWide(tst::TestResult& result)
+  {
+    utl::StringInterner<wchar_t> interner;
+
+    TESTASSERTOP(interner.intern(L"foo", 3), eq, 0);
+    TESTASSERTOP(interner.intern(L"bar", 3), eq, 1);
+    TESTASSERTOP(interner.find(L"foo", 3), eq, 0);
+    TESTASSERTOP(utl::compare(interner.string(1), L"bar"), eq, 0);
+  }
+}
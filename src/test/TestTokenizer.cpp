@@ -0,0 +1,179 @@
+// TestTokenizer.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/Tokenizer.hpp>
+
+#include "TestTokenizer.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    /**
+     * @return true if the given token equals the given zero terminated string
+     */
+    bool equal(utl::Token const& token, char const* string)
+    {
+      if (token.length != utl::length(string))
+        return false;
+
+      for (size_t i = 0; i < token.length; ++i)
+      {
+        if (token.pointer[i] != static_cast<byte_t>(string[i]))
+          return false;
+      }
+      return true;
+    }
+
+    /**
+     * @return number of tokens in the given string
+     */
+    size_t count(char const* string, utl::DelimiterSet const& delimiters)
+    {
+      utl::Tokenizer tokenizer(string, string + utl::length(string), delimiters);
+      size_t count = 0;
+
+      for (auto it = tokenizer.begin(); it != tokenizer.end(); ++it)
+        ++count;
+
+      return count;
+    }
+  }
+
+
+  TestTokenizer::TestTokenizer()
+    : tst::TestCase<TestTokenizer>(*this, "TestTokenizer")
+  {
+    add(&TestTokenizer::testClassify);
+    add(&TestTokenizer::testTokenize1);
+    add(&TestTokenizer::testTokenize2);
+    add(&TestTokenizer::testTokenizeMany);
+  }
+
+  void TestTokenizer::testClassify(tst::TestResult& result)
+  {
+    utl::DelimiterSet set1(",\t\n", 3);
+    utl::DelimiterSet set2("0123456789", 10);
+
+    byte_t block[64];
+
+    for (size_t i = 0; i < 64; ++i)
+      block[i] = static_cast<byte_t>('a' + i % 26);
+
+    block[0]  = ',';
+    block[13] = '\t';
+    block[63] = '\n';
+    block[40] = '5';
+
+    TESTASSERTOP(set1.classify(block), eq, 0x8000000000002001ull);
+    TESTASSERTOP(set2.classify(block), eq, 0x0000010000000000ull);
+    TESTASSERTOP(set1.classify(block, block + 14), eq, 0x2001ull);
+
+    TESTASSERT(set1.find(block, block + 64) == block);
+    TESTASSERT(set1.find(block + 1, block + 64) == block + 13);
+    TESTASSERT(set1.find(block + 14, block + 63) == block + 63);
+    TESTASSERT(set2.find(block + 41, block + 64) == block + 64);
+
+    // bytes that share a nibble with a delimiter must not be classified as one
+    utl::DelimiterSet set3(",;", 2);
+
+    for (size_t i = 0; i < 64; ++i)
+      block[i] = static_cast<byte_t>(0x20 + i);
+
+    TESTASSERTOP(set3.classify(block), eq, (1ull << (',' - 0x20)) | (1ull << (';' - 0x20)));
+    TESTASSERT(set3.contains(','));
+    TESTASSERT(!set3.contains('<'));
+  }
+
+  void TestTokenizer::testTokenize1(tst::TestResult& result)
+  {
+    utl::DelimiterSet delimiters(",", 1);
+    char const* string = "a,bc,,def";
+
+    utl::Tokenizer tokenizer(string, string + utl::length(string), delimiters);
+    auto it = tokenizer.begin();
+
+    TESTASSERT(equal(*it++, "a"));
+    TESTASSERT(equal(*it++, "bc"));
+    TESTASSERT(equal(*it++, ""));
+    TESTASSERT(equal(*it, "def"));
+    TESTASSERTOP(it->pointer, eq, reinterpret_cast<byte_t const*>(string + 6));
+    TESTASSERT(++it == tokenizer.end());
+
+    TESTASSERTOP(count("", delimiters), eq, 1);
+    TESTASSERTOP(count(",", delimiters), eq, 2);
+    TESTASSERTOP(count("abc", delimiters), eq, 1);
+    TESTASSERTOP(count("abc,", delimiters), eq, 2);
+  }
+
+  void TestTokenizer::testTokenize2(tst::TestResult& result)
+  {
+    utl::DelimiterSet delimiters("\n\t", 2);
+
+    // make sure tokens spanning block boundaries are handled correctly
+    char const* string = "first line with a couple of words in it\tand a tab\n"
+                         "second line, which is a bit longer so that it spans across a block\n"
+                         "third\n";
+
+    utl::Tokenizer tokenizer(string, string + utl::length(string), delimiters);
+    auto it = tokenizer.begin();
+
+    TESTASSERT(equal(*it++, "first line with a couple of words in it"));
+    TESTASSERT(equal(*it++, "and a tab"));
+    TESTASSERT(equal(*it++, "second line, which is a bit longer so that it spans across a block"));
+    TESTASSERT(equal(*it++, "third"));
+    TESTASSERT(equal(*it++, ""));
+    TESTASSERT(it == tokenizer.end());
+  }
+
+  void TestTokenizer::testTokenizeMany(tst::TestResult& result)
+  {
+    static char buffer[1000];
+    utl::DelimiterSet delimiters(",", 1);
+
+    // delimiters at every possible position relative to block boundaries
+    for (size_t step = 1; step < 70; ++step)
+    {
+      utl::fill(buffer, buffer + sizeof(buffer), 'x');
+
+      size_t delimiter_count = 0;
+
+      for (size_t i = 0; i < sizeof(buffer); i += step)
+      {
+        buffer[i] = ',';
+        ++delimiter_count;
+      }
+
+      utl::Tokenizer tokenizer(buffer, buffer + sizeof(buffer), delimiters);
+      size_t tokens = 0;
+      size_t total  = 0;
+
+      for (auto it = tokenizer.begin(); it != tokenizer.end(); ++it)
+      {
+        ++tokens;
+        total += it->length;
+      }
+
+      TESTASSERTOP(tokens, eq, delimiter_count + 1);
+      TESTASSERTOP(total, eq, sizeof(buffer) - delimiter_count);
+    }
+  }
+}
@@ -0,0 +1,246 @@
+// TestUtf8.cpp
+
+/***************************************************************************
+ *   Copyright (C) 2014 Daniel Mueller (deso@posteo.net)                   *
+ *                                                                         *
+ *   This program is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include <util/String.hpp>
+#include <util/Utf8.hpp>
+
+#include "Random.hpp"
+#include "TestUtf8.hpp"
+
+
+namespace test
+{
+  namespace
+  {
+    char const* valid[] = {
+      "",
+      "plain ASCII",
+      "\x7f",
+      "\xc2\x80",
+      "\xc3\xa4",
+      "\xdf\xbf",
+      "\xe0\xa0\x80",
+      "\xe2\x82\xac",
+      "\xed\x9f\xbf",
+      "\xee\x80\x80",
+      "\xef\xbf\xbf",
+      "\xf0\x90\x80\x80",
+      "\xf0\x9d\x84\x9e",
+      "\xf4\x8f\xbf\xbf",
+    };
+
+    char const* invalid[] = {
+      "\x80",
+      "\xbf",
+      "\xc0\x80",
+      "\xc1\xbf",
+      "\xc2",
+      "\xc2\x41",
+      "\xc2\xc2\x80",
+      "\xe0\x80\x80",
+      "\xe0\x9f\xbf",
+      "\xe2\x82",
+      "\xe2\x82\x41",
+      "\xed\xa0\x80",
+      "\xed\xbf\xbf",
+      "\xf0\x80\x80\x80",
+      "\xf0\x8f\xbf\xbf",
+      "\xf0\x90\x80",
+      "\xf4\x90\x80\x80",
+      "\xf5\x80\x80\x80",
+      "\xf8\x88\x80\x80\x80",
+      "\xff",
+      "\xc3\xa4\xa4",
+    };
+
+    /**
+     * @return true if the given zero terminated string is valid UTF-8
+     */
+    bool validate(char const* string)
+    {
+      return utl::validateUtf8(string, string + utl::length(string));
+    }
+
+    /**
+     * This function validates a byte sequence by decoding it code point by code point.
+     * @return true if the given bytes are valid UTF-8
+     */
+    bool decode(byte_t const* sequence, size_t length)
+    {
+      for (size_t i = 0; i < length; )
+      {
+        uint32_t lead = sequence[i];
+        uint32_t code;
+        uint32_t minimum;
+        size_t count;
+
+        if (lead < 0x80)
+        {
+          code    = lead;
+          minimum = 0;
+          count   = 1;
+        }
+        else if ((lead & 0xe0) == 0xc0)
+        {
+          code    = lead & 0x1f;
+          minimum = 0x80;
+          count   = 2;
+        }
+        else if ((lead & 0xf0) == 0xe0)
+        {
+          code    = lead & 0x0f;
+          minimum = 0x800;
+          count   = 3;
+        }
+        else if ((lead & 0xf8) == 0xf0)
+        {
+          code    = lead & 0x07;
+          minimum = 0x10000;
+          count   = 4;
+        }
+        else
+          return false;
+
+        if (i + count > length)
+          return false;
+
+        for (size_t j = 1; j < count; ++j)
+        {
+          if ((sequence[i + j] & 0xc0) != 0x80)
+            return false;
+
+          code = (code << 6) | (sequence[i + j] & 0x3f);
+        }
+
+        if (code < minimum || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff))
+          return false;
+
+        i += count;
+      }
+      return true;
+    }
+  }
+
+
+  TestUtf8::TestUtf8()
+    : tst::TestCase<TestUtf8>(*this, "TestUtf8")
+  {
+    add(&TestUtf8::testValid);
+    add(&TestUtf8::testInvalid);
+    add(&TestUtf8::testPositions);
+    add(&TestUtf8::testSequences);
+    add(&TestUtf8::testRandom);
+  }
+
+  void TestUtf8::testValid(tst::TestResult& result)
+  {
+    for (size_t i = 0; i < sizeof(valid) / sizeof(*valid); ++i)
+      TESTASSERT(validate(valid[i]));
+
+    TESTASSERT(validate("gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln f\xc3\xbcr 3 \xe2\x82\xac"));
+  }
+
+  void TestUtf8::testInvalid(tst::TestResult& result)
+  {
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(*invalid); ++i)
+      TESTASSERT(!validate(invalid[i]));
+  }
+
+  void TestUtf8::testPositions(tst::TestResult& result)
+  {
+    byte_t buffer[128];
+
+    // place every sequence at every position relative to the vector boundaries, once followed by
+    // ASCII characters and once at the very end of the range
+    for (size_t i = 0; i < sizeof(valid) / sizeof(*valid) + sizeof(invalid) / sizeof(*invalid); ++i)
+    {
+      bool is_valid = i < sizeof(valid) / sizeof(*valid);
+      char const* sequence = is_valid ? valid[i] : invalid[i - sizeof(valid) / sizeof(*valid)];
+      size_t length = utl::length(sequence);
+
+      for (size_t offset = 0; offset + length <= 80; ++offset)
+      {
+        utl::fill(buffer, buffer + sizeof(buffer), 'x');
+        utl::copy(sequence, sequence + length, buffer + offset);
+
+        TESTASSERTOP(utl::validateUtf8(buffer, buffer + sizeof(buffer)), eq, is_valid);
+        TESTASSERTOP(utl::validateUtf8(buffer, buffer + offset + length), eq, is_valid);
+        TESTASSERTOP(utl::impl::validateUtf8Scalar(buffer, buffer + offset + length), eq, is_valid);
+      }
+    }
+  }
+
+  void TestUtf8::testSequences(tst::TestResult& result)
+  {
+    byte_t buffer[64];
+    utl::fill(buffer, buffer + sizeof(buffer), 'x');
+
+    // all one, two, and three byte sequences, spanning a vector boundary, checked against a
+    // decoder
+    for (uint32_t i = 0; i < 0x1000000; ++i)
+    {
+      byte_t* sequence = buffer + 15;
+      size_t length = i < 0x100 ? 1 : i < 0x10000 ? 2 : 3;
+
+      // of the three byte sequences only those starting with a three byte lead are interesting
+      if (length == 3 && (i >> 20) != 0xe)
+        continue;
+
+      for (size_t j = 0; j < length; ++j)
+        sequence[j] = static_cast<byte_t>(i >> (8 * (length - 1 - j)));
+
+      bool expected = decode(sequence, length);
+
+      TESTASSERTOP(utl::validateUtf8(buffer, sequence + length), eq, expected);
+      TESTASSERTOP(utl::impl::validateUtf8Scalar(sequence, sequence + length), eq, expected);
+    }
+  }
+
+  void TestUtf8::testRandom(tst::TestResult& result)
+  {
+    static byte_t const pieces[][4] = {
+      {'a'}, {0xc3, 0xa4}, {0xe2, 0x82, 0xac}, {0xf0, 0x9d, 0x84, 0x9e}, {0xed, 0x9f, 0xbf},
+    };
+    static size_t const lengths[] = {1, 2, 3, 4, 3};
+
+    uint64_t state = 42;
+    byte_t buffer[512];
+
+    for (size_t i = 0; i < 5000; ++i)
+    {
+      size_t size = 0;
+
+      // valid text, possibly with a single corrupted byte
+      while (size + 4 <= sizeof(buffer) && random(state) % 64 != 0)
+      {
+        size_t piece = random(state) % 5;
+        utl::copy(pieces[piece], pieces[piece] + lengths[piece], buffer + size);
+        size += lengths[piece];
+      }
+
+      if (size > 0 && i % 2 == 0)
+        buffer[random(state) % size] = static_cast<byte_t>(random(state));
+
+      bool expected = decode(buffer, size);
+
+      TESTASSERTOP(utl::validateUtf8(buffer, buffer + size), eq, expected);
+      TESTASSERTOP(utl::impl::validateUtf8Scalar(buffer, buffer + size), eq, expected);
+    }
+  }
+}